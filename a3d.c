@@ -211,7 +211,7 @@ get_el_idx(float elev)
  *               channels need to be flipped.
  */
 void
-a3d_lookup_indices(A3d * a3d,
+a3d_lookup_indices(const A3d * a3d,
                    float elev, float azim,
                    int * p_el, int * p_az, bool * p_flip)
 {
@@ -250,6 +250,37 @@ a3d_lookup_indices(A3d * a3d,
   *p_az = az_idx;
 }
 
+size_t
+a3d_ndirs(void)
+{
+  size_t n = 0;
+  for (int el_idx = 0; el_idx < N_ELEV; el_idx++) {
+    n += get_azimnum(el_idx);
+  }
+  return n;
+}
+
+int
+a3d_dir_index(const A3d * a3d, float elev, float azim, bool * p_flip)
+{
+  int el_idx, az_idx, d = 0;
+  a3d_lookup_indices(a3d, elev, azim, &el_idx, &az_idx, p_flip);
+  for (int e = 0; e < el_idx; e++) {
+    d += get_azimnum(e);
+  }
+  return d + az_idx;
+}
+
+const HRIR_t *
+a3d_dir_HRIR(const A3d * a3d, size_t d)
+{
+  int el_idx = 0;
+  while (d >= (size_t)get_azimnum(el_idx)) {
+    d -= get_azimnum(el_idx++);
+  }
+  return &a3d->HRIRs[el_idx][d];
+}
+
 /*! Change the internal indices of a3d to match [\p elev, \p azim] both given in
  * degrees.
  */
@@ -139,6 +139,20 @@ void a3d_filter(A3d * a3d,
                 float * ins, size_t inslen,
                 float * outL, float * outR);
 
+/* ---------------------------- Group Separator ---------------------------- */
+
+/*! Get the number of measured directions (elevation-azimuth pairs). */
+size_t a3d_ndirs(void);
+
+/*! Get flat index, in [0, a3d_ndirs()), of the direction closest to [\p
+ * elev, \p azim] in degrees. \p *p_flip is set to TRUE if left and right
+ * channels need to be flipped.
+ */
+int a3d_dir_index(const A3d * a3d, float elev, float azim, bool * p_flip);
+
+/*! Get HRIR of direction with flat index \p d. */
+const HRIR_t * a3d_dir_HRIR(const A3d * a3d, size_t d);
+
 /* ========================================================================= */
 
 #ifdef __cplusplus
@@ -0,0 +1,396 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "a3d_conv.h"
+#include "meman.h"
+#include "extremes.h"
+
+/*! Vector of 8 floats used by the spectral kernels (two SSE or one AVX register). */
+typedef float v8sf __attribute__ ((vector_size (8*sizeof(float))));
+
+/*! Allocate \p n zeroed floats aligned for \c v8sf. */
+static float *
+a3d_conv_falloc(size_t n)
+{
+  void *p = NULL;
+  if (posix_memalign(&p, sizeof(v8sf), n * sizeof(float)) != 0) { return NULL; }
+  memset(p, 0, n * sizeof(float));
+  return (float*)p;
+}
+
+/* ---------------------------- Group Separator ---------------------------- */
+
+/*! Initialize \p fft for real transforms of size \p n (a power of two >= 4). */
+static int
+a3d_fft_init(A3dFFT * fft, size_t n)
+{
+  const size_t m = n / 2;
+  fft->m = m;
+  fft->rev = (uint*)malloc(m * sizeof(uint));
+  fft->tw_re = farray_calloc(m);
+  fft->tw_im = farray_calloc(m);
+  fft->rt_re = farray_calloc(m + 1);
+  fft->rt_im = farray_calloc(m + 1);
+  fft->z_re = farray_calloc(m);
+  fft->z_im = farray_calloc(m);
+  if (!fft->rev || !fft->tw_re || !fft->tw_im || !fft->rt_re || !fft->rt_im ||
+      !fft->z_re || !fft->z_im) {
+    return -1;
+  }
+
+  uint lg = 0;
+  while (((size_t)1 << lg) < m) { lg++; }
+  for (size_t i = 0; i < m; i++) {
+    uint r = 0;
+    for (uint b = 0; b < lg; b++) { r |= ((i >> b) & 1) << (lg - 1 - b); }
+    fft->rev[i] = r;
+  }
+
+  /* Stage with half-length h uses twiddles exp(-2*pi*i*j/(2h)) at [h-1, 2h-1). */
+  for (size_t h = 1; h < m; h *= 2) {
+    for (size_t j = 0; j < h; j++) {
+      fft->tw_re[h - 1 + j] = cos(M_PI * j / h);
+      fft->tw_im[h - 1 + j] = -sin(M_PI * j / h);
+    }
+  }
+  for (size_t k = 0; k <= m; k++) {
+    fft->rt_re[k] = cos(M_PI * k / m);
+    fft->rt_im[k] = -sin(M_PI * k / m);
+  }
+  return 0;
+}
+
+static void
+a3d_fft_clear(A3dFFT * fft)
+{
+  free(fft->rev);
+  free(fft->tw_re); free(fft->tw_im);
+  free(fft->rt_re); free(fft->rt_im);
+  free(fft->z_re); free(fft->z_im);
+}
+
+/*! In-place complex radix-2 FFT of \c fft->z, inverse (unscaled) if \p inv. */
+static void
+a3d_fft_complex(A3dFFT * fft, int inv)
+{
+  const size_t m = fft->m;
+  float * restrict re = fft->z_re;
+  float * restrict im = fft->z_im;
+  for (size_t i = 0; i < m; i++) {
+    const size_t r = fft->rev[i];
+    if (i < r) {
+      float t = re[i]; re[i] = re[r]; re[r] = t;
+      t = im[i]; im[i] = im[r]; im[r] = t;
+    }
+  }
+  const float sign = inv ? -1.0f : 1.0f;
+  for (size_t h = 1; h < m; h *= 2) {
+    const float * restrict wr = fft->tw_re + h - 1;
+    const float * restrict wi = fft->tw_im + h - 1;
+    for (size_t i = 0; i < m; i += 2 * h) {
+      float * restrict ar = re + i, * restrict ai = im + i;
+      float * restrict br = re + i + h, * restrict bi = im + i + h;
+      for (size_t j = 0; j < h; j++) {   /* contiguous, vectorizable for h >= 8 */
+        const float tr = br[j] * wr[j] - bi[j] * sign * wi[j];
+        const float ti = br[j] * sign * wi[j] + bi[j] * wr[j];
+        br[j] = ar[j] - tr; bi[j] = ai[j] - ti;
+        ar[j] += tr; ai[j] += ti;
+      }
+    }
+  }
+}
+
+/*! Forward real FFT of the \c 2m samples \p x into bins [0, m] of \p X_re
+ * and \p X_im.
+ */
+static void
+a3d_fft_real(A3dFFT * fft, const float * x, float * X_re, float * X_im)
+{
+  const size_t m = fft->m;
+  for (size_t k = 0; k < m; k++) {
+    fft->z_re[k] = x[2*k];
+    fft->z_im[k] = x[2*k + 1];
+  }
+  a3d_fft_complex(fft, 0);
+  const float *zr = fft->z_re, *zi = fft->z_im;
+  for (size_t k = 0; k <= m; k++) {
+    const size_t j = k % m, c = (m - k) % m;
+    const float er = 0.5f * (zr[j] + zr[c]), ei = 0.5f * (zi[j] - zi[c]);
+    const float or_ = 0.5f * (zi[j] + zi[c]), oi = -0.5f * (zr[j] - zr[c]);
+    X_re[k] = er + fft->rt_re[k] * or_ - fft->rt_im[k] * oi;
+    X_im[k] = ei + fft->rt_re[k] * oi + fft->rt_im[k] * or_;
+  }
+}
+
+/*! Inverse real FFT of bins [0, m] of \p X_re and \p X_im into the \c 2m
+ * samples \p x, scaled by \p scale / m.
+ */
+static void
+a3d_ifft_real(A3dFFT * fft, const float * X_re, const float * X_im, float * x, float scale)
+{
+  const size_t m = fft->m;
+  for (size_t k = 0; k < m; k++) {
+    const size_t c = m - k;
+    const float er = 0.5f * (X_re[k] + X_re[c]), ei = 0.5f * (X_im[k] - X_im[c]);
+    const float dr = 0.5f * (X_re[k] - X_re[c]), di = 0.5f * (X_im[k] + X_im[c]);
+    /* O = D * conj(rt[k]) */
+    const float or_ = dr * fft->rt_re[k] + di * fft->rt_im[k];
+    const float oi = di * fft->rt_re[k] - dr * fft->rt_im[k];
+    fft->z_re[k] = er - oi;
+    fft->z_im[k] = ei + or_;
+  }
+  a3d_fft_complex(fft, 1);
+  const float s = scale / m;
+  for (size_t k = 0; k < m; k++) {
+    x[2*k] = fft->z_re[k] * s;
+    x[2*k + 1] = fft->z_im[k] * s;
+  }
+}
+
+/* ---------------------------- Group Separator ---------------------------- */
+
+static size_t
+a3d_conv_nbins(size_t B)
+{
+  return (B + 1 + 7) & ~(size_t)7;
+}
+
+int
+a3d_conv_bank_init(A3dConvBank * bank, size_t B,
+                   const float * irs_L, const float * irs_R,
+                   size_t ndirs, size_t irlen)
+{
+  if (B < 4 || (B & (B - 1))) { return -1; }
+  bank->B = B;
+  bank->K = a3d_conv_nbins(B);
+  bank->P = (irlen + B - 1) / B;
+  if (bank->P == 0) { bank->P = 1; }
+  bank->ndirs = ndirs;
+  const size_t K = bank->K, P = bank->P;
+  bank->spec = a3d_conv_falloc(ndirs * 2 * P * 2 * K);
+
+  A3dFFT fft;
+  float *x = farray_calloc(2 * B);
+  if (!bank->spec || !x || a3d_fft_init(&fft, 2 * B) < 0) {
+    free(x);
+    a3d_conv_bank_clear(bank);
+    return -1;
+  }
+
+  for (size_t d = 0; d < ndirs; d++) {
+    for (int e = 0; e < 2; e++) {
+      const float *ir = (e ? irs_R : irs_L) + d * irlen;
+      for (size_t p = 0; p < P; p++) {
+        /* Partition in first half, zero padded: overlap-save keeps the last B outputs. */
+        memset(x, 0, 2 * B * sizeof(float));
+        const size_t n = MIN2(B, irlen - p * B);
+        memcpy(x, ir + p * B, n * sizeof(float));
+        float *H = bank->spec + ((d * 2 + e) * P + p) * 2 * K;
+        a3d_fft_real(&fft, x, H, H + K);
+      }
+    }
+  }
+
+  a3d_fft_clear(&fft);
+  free(x);
+  return 0;
+}
+
+int
+a3d_conv_bank_init_a3d(A3dConvBank * bank, size_t B, const A3d * a3d)
+{
+  const size_t ndirs = a3d_ndirs(), n = a3d->filtlen;
+  float *L = farray_calloc(ndirs * n);
+  float *R = farray_calloc(ndirs * n);
+  int ret = -1;
+  if (L && R) {
+    for (size_t d = 0; d < ndirs; d++) {
+      const HRIR_t *h = a3d_dir_HRIR(a3d, d);
+      for (size_t i = 0; i < n; i++) {
+        L[d * n + i] = h->left[i] * a3d->invfiltnorm;
+        R[d * n + i] = h->right[i] * a3d->invfiltnorm;
+      }
+    }
+    ret = a3d_conv_bank_init(bank, B, L, R, ndirs, n);
+  }
+  free(L);
+  free(R);
+  return ret;
+}
+
+void
+a3d_conv_bank_clear(A3dConvBank * bank)
+{
+  free(bank->spec); bank->spec = NULL;
+  bank->ndirs = 0;
+}
+
+/* ---------------------------- Group Separator ---------------------------- */
+
+int
+a3d_conv_init(A3dConv * conv, const A3dConvBank * bank, size_t nsrc)
+{
+  const size_t B = bank->B, K = bank->K, P = bank->P;
+  memset(conv, 0, sizeof(*conv));
+  conv->bank = bank;
+  conv->nsrc = nsrc;
+  conv->src = (A3dConvSource*)calloc(nsrc, sizeof(A3dConvSource));
+  conv->x = farray_calloc(2 * B);
+  conv->acc = a3d_conv_falloc(3 * 2 * 2 * K);
+  conv->y = farray_calloc(2 * B);
+  conv->ramp = farray_calloc(B);
+  if (!conv->src || !conv->x || !conv->acc || !conv->y || !conv->ramp ||
+      a3d_fft_init(&conv->fft, 2 * B) < 0) {
+    a3d_conv_clear(conv);
+    return -1;
+  }
+  for (size_t i = 0; i < B; i++) {
+    conv->ramp[i] = (float)(i + 1) / B;
+  }
+  for (size_t s = 0; s < nsrc; s++) {
+    A3dConvSource *src = &conv->src[s];
+    src->fdl = a3d_conv_falloc(P * 2 * K);
+    src->prev = farray_calloc(B);
+    if (!src->fdl || !src->prev) {
+      a3d_conv_clear(conv);
+      return -1;
+    }
+    src->nsilent = P + 1;
+    src->gain = src->ogain = src->ngain = 1.0f;
+  }
+  return 0;
+}
+
+void
+a3d_conv_clear(A3dConv * conv)
+{
+  if (conv->src) {
+    for (size_t s = 0; s < conv->nsrc; s++) {
+      free(conv->src[s].fdl);
+      free(conv->src[s].prev);
+    }
+    free(conv->src); conv->src = NULL;
+  }
+  if (conv->fft.rev) { a3d_fft_clear(&conv->fft); conv->fft.rev = NULL; }
+  free(conv->x); conv->x = NULL;
+  free(conv->acc); conv->acc = NULL;
+  free(conv->y); conv->y = NULL;
+  free(conv->ramp); conv->ramp = NULL;
+}
+
+void
+a3d_conv_source_reset(A3dConv * conv, size_t s, int dir, int flip, float gain)
+{
+  const A3dConvBank *bank = conv->bank;
+  A3dConvSource *src = &conv->src[s];
+  memset(src->fdl, 0, bank->P * 2 * bank->K * sizeof(float));
+  memset(src->prev, 0, bank->B * sizeof(float));
+  src->nsilent = bank->P + 1;
+  src->dir = src->odir = src->ndir = dir;
+  src->flip = src->oflip = src->nflip = flip;
+  src->gain = src->ogain = src->ngain = gain;
+}
+
+/*! Accumulate \p gain times the product of the \p P spectra in the delay
+ * line \p fdl (newest at slot \p head) and the filter partitions \p H into
+ * \p acc. All spectra have \p K bins (a multiple of 8) stored re then im.
+ */
+static void
+a3d_conv_mac(float * acc, const float * fdl, size_t head,
+             const float * H, size_t P, size_t K, float gain)
+{
+  v8sf * restrict ar = (v8sf*)acc;
+  v8sf * restrict ai = (v8sf*)(acc + K);
+  const size_t kv = K / 8;
+  for (size_t p = 0; p < P; p++) {
+    const size_t slot = (head + P - p) % P;
+    const v8sf *xr = (const v8sf*)(fdl + slot * 2 * K), *xi = xr + kv;
+    const v8sf *hr = (const v8sf*)(H + p * 2 * K), *hi = hr + kv;
+    for (size_t k = 0; k < kv; k++) {
+      ar[k] += gain * (xr[k] * hr[k] - xi[k] * hi[k]);
+      ai[k] += gain * (xr[k] * hi[k] + xi[k] * hr[k]);
+    }
+  }
+}
+
+void
+a3d_conv_process(A3dConv * conv,
+                 const float * const * ins,
+                 float * outL, float * outR)
+{
+  const A3dConvBank *bank = conv->bank;
+  const size_t B = bank->B, K = bank->K, P = bank->P;
+  float *acc = conv->acc;
+  int fading = FALSE;
+
+  memset(acc, 0, 3 * 2 * 2 * K * sizeof(float));
+
+  for (size_t s = 0; s < conv->nsrc; s++) {
+    A3dConvSource *src = &conv->src[s];
+    const float *in = ins[s];
+
+    /* Apply requested direction; crossfade if it changed while audible. */
+    int change = (src->ndir != src->dir || src->nflip != src->flip ||
+                  src->ngain != src->gain);
+    if (change) {
+      src->odir = src->dir; src->oflip = src->flip; src->ogain = src->gain;
+      src->dir = src->ndir; src->flip = src->nflip; src->gain = src->ngain;
+      if (src->nsilent > P) { change = FALSE; }
+    }
+
+    if (in) {
+      src->nsilent = 0;
+    } else if (src->nsilent > P) {
+      continue;                 /* history fully decayed */
+    } else {
+      src->nsilent++;
+    }
+
+    /* Overlap-save input frame [previous block, this block] to the delay line. */
+    src->head = (src->head + 1) % P;
+    float *Xs = src->fdl + src->head * 2 * K;
+    if (src->nsilent > 1) {
+      memset(Xs, 0, 2 * K * sizeof(float));
+    } else {
+      memcpy(conv->x, src->prev, B * sizeof(float));
+      if (in) {
+        memcpy(conv->x + B, in, B * sizeof(float));
+        memcpy(src->prev, in, B * sizeof(float));
+      } else {
+        memset(conv->x + B, 0, B * sizeof(float));
+        memset(src->prev, 0, B * sizeof(float));
+      }
+      a3d_fft_real(&conv->fft, conv->x, Xs, Xs + K);
+    }
+
+    /* Filter into the steady mix, or both fade mixes while changing. */
+    for (int e = 0; e < 2; e++) {
+      const float *H = bank->spec + ((size_t)src->dir * 2 + (e ^ (src->flip != 0))) * P * 2 * K;
+      if (change) {
+        const float *Ho = bank->spec + ((size_t)src->odir * 2 + (e ^ (src->oflip != 0))) * P * 2 * K;
+        a3d_conv_mac(acc + (1 * 2 + e) * 2 * K, src->fdl, src->head, H, P, K, src->gain);
+        a3d_conv_mac(acc + (2 * 2 + e) * 2 * K, src->fdl, src->head, Ho, P, K, src->ogain);
+      } else {
+        a3d_conv_mac(acc + (0 * 2 + e) * 2 * K, src->fdl, src->head, H, P, K, src->gain);
+      }
+    }
+    fading |= change;
+  }
+
+  /* Inverse transforms; overlap-save keeps the last B samples. */
+  float *outs[2] = { outL, outR };
+  for (int e = 0; e < 2; e++) {
+    float *A = acc + e * 2 * K;
+    a3d_ifft_real(&conv->fft, A, A + K, conv->y, 1.0f);
+    memcpy(outs[e], conv->y + B, B * sizeof(float));
+    if (fading) {
+      float *Ai = acc + (1 * 2 + e) * 2 * K;
+      float *Ao = acc + (2 * 2 + e) * 2 * K;
+      a3d_ifft_real(&conv->fft, Ai, Ai + K, conv->y, 1.0f);
+      for (size_t i = 0; i < B; i++) { outs[e][i] += conv->ramp[i] * conv->y[B + i]; }
+      a3d_ifft_real(&conv->fft, Ao, Ao + K, conv->y, 1.0f);
+      for (size_t i = 0; i < B; i++) { outs[e][i] += (1.0f - conv->ramp[i]) * conv->y[B + i]; }
+    }
+  }
+}
@@ -0,0 +1,151 @@
+/*! \file a3d_conv.h
+ * \brief Block-Convolution HRTF Renderer for Many Moving Sources.
+ * \author Copyright (C) 2012 Per Nordlöw (per.nordlow@gmail.com)
+ *
+ * Uniformly Partitioned Overlap-Save (UPOLS) convolution: HRIRs are split
+ * into partitions of \c B samples whose \c 2B-point spectra are
+ * precomputed once in an \c A3dConvBank. Each source keeps a
+ * frequency-domain delay line of its last input spectra, so rendering a
+ * block costs one forward FFT per source plus complex multiply-accumulates.
+ *
+ * Sources are mixed in the frequency domain, so the number of inverse FFTs
+ * per block is constant (two, or six while any source is crossfading)
+ * regardless of the number of sources. A source that changes direction is
+ * rendered through both its old and new filters during one block and the
+ * two mixes are crossfaded linearly in the time domain.
+ *
+ * Latency is one block (\c B samples). Nothing is allocated after
+ * a3d_conv_init(), so a3d_conv_process() can run in an audio callback.
+ */
+
+#pragma once
+
+#include "utils.h"
+#include "a3d.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ========================================================================= */
+
+/*! Real FFT Plan of size \c 2m (complex radix-2 FFT of size \c m). */
+typedef struct A3dFFT
+{
+  size_t m;                     /**< Complex FFT size (half the real size). */
+  uint *rev;                    /**< Bit-reversal permutation. */
+  float *tw_re, *tw_im;         /**< Per-stage twiddles, \c m-1 entries. */
+  float *rt_re, *rt_im;         /**< Real split twiddles exp(-i*pi*k/m), \c m+1 entries. */
+  float *z_re, *z_im;           /**< Work buffers of \c m points. */
+} A3dFFT;
+
+/*! Bank of Partitioned HRTF Spectra.
+ *
+ * Spectrum of partition \c p of ear \c e (0 left, 1 right) for direction
+ * \c d is stored as \c K real parts followed by \c K imaginary parts at
+ * \c spec + ((d*2 + e)*P + p) * 2*K.
+ */
+typedef struct A3dConvBank
+{
+  size_t B;                     /**< Block (partition) length. */
+  size_t K;                     /**< Number of bins \c B+1 padded to a multiple of 8. */
+  size_t P;                     /**< Number of partitions. */
+  size_t ndirs;                 /**< Number of directions. */
+  float *spec;                  /**< Spectra. */
+} A3dConvBank;
+
+/*! Build \p bank with block length \p B (a power of two) from \p ndirs
+ * pairs of HRIRs \p irs_L and \p irs_R, each \p irlen samples, stored one
+ * direction after another.
+ *
+ * \return 0 on success, -1 upon error.
+ */
+int a3d_conv_bank_init(A3dConvBank * bank, size_t B,
+                       const float * irs_L, const float * irs_R,
+                       size_t ndirs, size_t irlen);
+
+/*! Build \p bank with block length \p B from the HRIRs loaded in \p a3d,
+ * indexed by a3d_dir_index().
+ */
+int a3d_conv_bank_init_a3d(A3dConvBank * bank, size_t B, const A3d * a3d);
+
+/*! Release memory held by \p bank. */
+void a3d_conv_bank_clear(A3dConvBank * bank);
+
+/* ---------------------------- Group Separator ---------------------------- */
+
+/*! Per-Source State. */
+typedef struct A3dConvSource
+{
+  float *fdl;                   /**< Frequency-domain delay line, \c P spectra. */
+  float *prev;                  /**< Previous input block. */
+  size_t head;                  /**< Slot of newest spectrum in \c fdl. */
+  size_t nsilent;               /**< Number of consecutive silent input blocks. */
+
+  int dir, flip;                /**< Current direction and ear flip. */
+  float gain;                   /**< Current gain. */
+  int odir, oflip;              /**< Previous direction and flip, used during crossfade. */
+  float ogain;                  /**< Previous gain. */
+  int ndir, nflip;              /**< Requested direction and flip. */
+  float ngain;                  /**< Requested gain. */
+} A3dConvSource;
+
+/*! Multi-Source HRTF Convolution Engine. */
+typedef struct A3dConv
+{
+  const A3dConvBank *bank;
+  size_t nsrc;                  /**< Number of sources. */
+  A3dConvSource *src;           /**< Sources. */
+  A3dFFT fft;                   /**< FFT plan of size \c 2B. */
+  float *x;                     /**< Time-domain work buffer of \c 2B samples. */
+  float *acc;                   /**< Accumulators [steady, fade in, fade out][ear] spectra. */
+  float *y;                     /**< Inverse FFT output of \c 2B samples. */
+  float *ramp;                  /**< Crossfade ramp up (0...1] of \c B samples. */
+} A3dConv;
+
+/*! Initialize engine \p conv for \p nsrc sources filtered through \p bank.
+ *
+ * All sources start idle at direction 0 with unit gain.
+ *
+ * \return 0 on success, -1 upon error.
+ */
+int a3d_conv_init(A3dConv * conv, const A3dConvBank * bank, size_t nsrc);
+
+/*! Release memory held by \p conv. */
+void a3d_conv_clear(A3dConv * conv);
+
+/*! Request that source \p s be rendered at direction \p dir (ears
+ * swapped if \p flip) with \p gain from the next block on. A change is
+ * crossfaded over one block.
+ */
+static inline void
+a3d_conv_source_set(A3dConv * conv, size_t s, int dir, int flip, float gain)
+{
+  A3dConvSource *src = &conv->src[s];
+  src->ndir = dir;
+  src->nflip = flip;
+  src->ngain = gain;
+}
+
+/*! Reset source \p s to silence at direction \p dir (ears swapped if \p
+ * flip) with \p gain, without crossfading.
+ */
+void a3d_conv_source_reset(A3dConv * conv, size_t s, int dir, int flip, float gain);
+
+/*! Render one block.
+ *
+ * \param[in] ins array of \c nsrc pointers to \c B input samples each. A
+ * null pointer means silence; sources whose history has decayed to
+ * silence cost nothing.
+ * \param[out] outL, outR \c B output samples each, the binaural mix at
+ * the sample times of \p ins.
+ */
+void a3d_conv_process(A3dConv * conv,
+                      const float * const * ins,
+                      float * outL, float * outR);
+
+/* ========================================================================= */
+
+#ifdef __cplusplus
+}
+#endif
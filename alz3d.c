@@ -282,14 +282,12 @@ alz3d_setSample(Alz3d * alz, size_t wi, float sl, float sr)
 }
 
 float
-alz3d_getFade(Alz3d * alz, float tcurr, size_t si)
+alz3d_fade(ALZ3D_FADE_t fade, float tcurr, float tdur, float inv_tdur)
 {
   float ff;
-  const float tdur = alz->models[si].tdur; /* duration */
   if (tcurr < tdur) {	/* if signal is in the "air" */
-    const float inv_tdur = alz->models[si].inv_tdur; /* inverse duration */
     ALZ3D_FADE_t fwin = ALZ3D_FADEWIN_QUADRATIC;
-    switch (alz->models[si].fade) {
+    switch (fade) {
     case ALZ3D_FADE_NONE: ff = 1; break;
     case ALZ3D_FADE_IN: ff = tcurr * inv_tdur; break; break;
     case ALZ3D_FADE_OUT: ff = (tdur - tcurr) * inv_tdur; break;
@@ -320,6 +318,13 @@ alz3d_getFade(Alz3d * alz, float tcurr, size_t si)
   return ff;
 }
 
+float
+alz3d_getFade(Alz3d * alz, float tcurr, size_t si)
+{
+  return alz3d_fade(alz->models[si].fade, tcurr,
+		    alz->models[si].tdur, alz->models[si].inv_tdur);
+}
+
 float
 alz3d_getWave(Alz3d * alz, float t, size_t si)
 {
@@ -154,6 +154,12 @@ int alz3d_addNow(Alz3d * alz,
 		 float wfq, float dur_sec, float azim, float amp,
 		 ALZ3D_WAVE_t wave, ALZ3D_FADE_t fade);
 
+/*!
+ * Get fade factor of a signal with fading \p fade and duration \p tdur
+ * [s] (inverse \p inv_tdur) at time \p tcurr [s] since its start.
+ */
+float alz3d_fade(ALZ3D_FADE_t fade, float tcurr, float tdur, float inv_tdur);
+
 /*!
  * Sample \p swlen samples from current time and ahead (\p swlen / \p srate) in time.
  */
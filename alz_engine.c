@@ -0,0 +1,456 @@
+#include "alz_engine.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sched.h>
+
+#include "math_x.h"
+#include "encode.h"
+#include "clamp.h"
+#include "extremes.h"
+#include "stdio_x.h"
+
+/*! Vector of 8 floats, the number of voices processed together. */
+typedef float v8sf __attribute__ ((vector_size (8*sizeof(float))));
+
+/*! Allocate \p n zeroed floats aligned for \c v8sf. */
+static float *
+alz_falloc(size_t n)
+{
+  void *p = NULL;
+  if (posix_memalign(&p, sizeof(v8sf), n * sizeof(float)) != 0) { return NULL; }
+  memset(p, 0, n * sizeof(float));
+  return (float*)p;
+}
+
+/* ---------------------------- Group Separator ---------------------------- */
+
+int
+alz_queue_init(AlzQueue * q, size_t cap)
+{
+  size_t n = 1;
+  while (n < cap) { n *= 2; }
+  q->buf = (AlzCmd*)calloc(n, sizeof(AlzCmd));
+  q->mask = n - 1;
+  q->head = 0;
+  q->tail = 0;
+  return q->buf ? 0 : -1;
+}
+
+void
+alz_queue_clear(AlzQueue * q)
+{
+  free(q->buf); q->buf = NULL;
+}
+
+/* ---------------------------- Group Separator ---------------------------- */
+
+int
+alz_engine_init(AlzEngine * eng, uint srate, size_t B,
+                size_t nvoices, size_t qcap)
+{
+  memset(eng, 0, sizeof(*eng));
+  eng->srate = srate;
+  eng->B = B;
+  eng->cap = (nvoices + 7) & ~(size_t)7;
+  eng->next_id = 1;
+
+  const size_t cap = eng->cap;
+  eng->voices = (AlzVoice*)calloc(cap, sizeof(AlzVoice));
+  float **vs[] = { &eng->c, &eng->s, &eng->cr, &eng->sr,
+                   &eng->aL, &eng->bL, &eng->aR, &eng->bR,
+                   &eng->env, &eng->denv };
+  int ok = eng->voices != NULL;
+  for (size_t i = 0; i < sizeof(vs) / sizeof(vs[0]); i++) {
+    *vs[i] = alz_falloc(cap);
+    ok &= *vs[i] != NULL;
+  }
+  eng->accL = alz_falloc(8 * B);
+  eng->accR = alz_falloc(8 * B);
+  eng->out = alz_falloc(2 * B);
+  ok &= eng->accL && eng->accR && eng->out;
+  ok &= alz_queue_init(&eng->q, qcap) == 0;
+  if (!ok) {
+    alz_engine_clear(eng);
+    return -1;
+  }
+  for (size_t v = 0; v < cap; v++) { /* keep unused lanes finite */
+    eng->c[v] = 1;
+    eng->cr[v] = 1;
+  }
+  return 0;
+}
+
+int
+alz_engine_use_a3d(AlzEngine * eng, const A3d * a3d, const A3dConvBank * bank)
+{
+  if (bank->B != eng->B || a3d_conv_init(&eng->conv, bank, eng->cap) < 0) {
+    return -1;
+  }
+  eng->mono = alz_falloc(eng->B * eng->cap);
+  eng->ins = (const float**)calloc(eng->cap, sizeof(float*));
+  if (!eng->mono || !eng->ins) {
+    free(eng->mono); eng->mono = NULL;
+    free(eng->ins); eng->ins = NULL;
+    a3d_conv_clear(&eng->conv);
+    return -1;
+  }
+  eng->a3d = a3d;
+  eng->ntail = bank->P * bank->B;
+  return 0;
+}
+
+void
+alz_engine_clear(AlzEngine * eng)
+{
+  alz_engine_stop(eng);
+  free(eng->voices); eng->voices = NULL;
+  float **vs[] = { &eng->c, &eng->s, &eng->cr, &eng->sr,
+                   &eng->aL, &eng->bL, &eng->aR, &eng->bR,
+                   &eng->env, &eng->denv,
+                   &eng->accL, &eng->accR, &eng->out, &eng->mono };
+  for (size_t i = 0; i < sizeof(vs) / sizeof(vs[0]); i++) {
+    free(*vs[i]); *vs[i] = NULL;
+  }
+  if (eng->a3d) {
+    a3d_conv_clear(&eng->conv);
+    free(eng->ins); eng->ins = NULL;
+    eng->a3d = NULL;
+  }
+  alz_queue_clear(&eng->q);
+  eng->nactive = 0;
+}
+
+/* ---------------------------- Group Separator ---------------------------- */
+
+uint32_t
+alz_engine_add(AlzEngine * eng,
+               float wfq, float dur_sec, float azim, float amp,
+               ALZ3D_WAVE_t wave, ALZ3D_FADE_t fade)
+{
+  AlzCmd cmd;
+  cmd.type = ALZ_CMD_ADD;
+  cmd.id = eng->next_id;
+  cmd.wfq = wfq;
+  cmd.tdur = dur_sec;
+  cmd.azim = azim;
+  cmd.amp = amp;
+  cmd.wave = wave;
+  cmd.fade = fade;
+  if (!alz_queue_push(&eng->q, &cmd)) { return 0; }
+  if (++eng->next_id == 0) { eng->next_id = 1; } /* 0 means none */
+  return cmd.id;
+}
+
+bool
+alz_engine_remove(AlzEngine * eng, uint32_t id)
+{
+  AlzCmd cmd;
+  memset(&cmd, 0, sizeof(cmd));
+  cmd.type = id ? ALZ_CMD_REMOVE : ALZ_CMD_REMOVE_ALL;
+  cmd.id = id;
+  return alz_queue_push(&eng->q, &cmd);
+}
+
+/*! Swap voices \p a and \p b, including their HRTF convolution state. */
+static void
+alz_engine_swap(AlzEngine * eng, size_t a, size_t b)
+{
+  if (a == b) { return; }
+  AlzVoice t = eng->voices[a]; eng->voices[a] = eng->voices[b]; eng->voices[b] = t;
+  float *vs[] = { eng->c, eng->s, eng->cr, eng->sr,
+                  eng->aL, eng->bL, eng->aR, eng->bR,
+                  eng->env, eng->denv };
+  for (size_t i = 0; i < sizeof(vs) / sizeof(vs[0]); i++) {
+    const float x = vs[i][a]; vs[i][a] = vs[i][b]; vs[i][b] = x;
+  }
+  if (eng->a3d) {
+    A3dConvSource s = eng->conv.src[a]; eng->conv.src[a] = eng->conv.src[b]; eng->conv.src[b] = s;
+  }
+}
+
+/*! Release voice \p v over the next block. */
+static void
+alz_engine_release(AlzEngine * eng, size_t v)
+{
+  AlzVoice *vc = &eng->voices[v];
+  const size_t n = vc->scnt + eng->B + eng->ntail;
+  vc->released = TRUE;
+  if (n < vc->send) { vc->send = n; }
+}
+
+/*! Execute command \p cmd (audio thread). */
+static void
+alz_engine_apply(AlzEngine * eng, const AlzCmd * cmd)
+{
+  switch (cmd->type) {
+  case ALZ_CMD_ADD: {
+    if (eng->nactive == eng->cap) { break; } /* pool exhausted, drop */
+    const size_t v = eng->nactive++;
+    AlzVoice *vc = &eng->voices[v];
+    vc->id = cmd->id;
+    vc->scnt = 0;
+    vc->tdur = cmd->tdur;
+    vc->inv_tdur = 1 / cmd->tdur;
+    vc->send = (size_t)lrintf(cmd->tdur * eng->srate) + eng->ntail;
+    vc->fade = cmd->fade;
+    vc->released = FALSE;
+
+    const float w = M_2PI * cmd->wfq / eng->srate;
+    eng->c[v] = 1; eng->s[v] = 0;
+    eng->cr[v] = cosf(w); eng->sr[v] = sinf(w);
+    eng->env[v] = alz3d_fade(vc->fade, 0, vc->tdur, vc->inv_tdur);
+    eng->denv[v] = 0;
+
+    if (eng->a3d) {
+      bool flip;
+      const int d = a3d_dir_index(eng->a3d, 0, cmd->azim, &flip);
+      a3d_conv_source_reset(&eng->conv, v, d, flip, 1.0f);
+      eng->aL[v] = cmd->amp;
+      eng->bL[v] = eng->aR[v] = eng->bR[v] = 0;
+    } else {
+      /* Same stereo model as alz3d_addNow(): level and time difference. */
+      const float azim_cos = cosf(float_azim2rad(cmd->azim));
+      const float ampL = cmd->amp * (1 - azim_cos) / 2.0f;
+      const float ampR = cmd->amp * (1 + azim_cos) / 2.0f;
+      const float sos = 340.29;	/* Speed of sound at sea level [m/s] */
+      const float esr = 0.075f;	/* Ear Separation Radius [m] */
+      const float phi = M_2PI * cmd->wfq * (esr / sos) * azim_cos;
+      eng->aL[v] = ampL * cosf(phi); eng->bL[v] = ampL * sinf(phi);
+      eng->aR[v] = ampR * cosf(phi); eng->bR[v] = -ampR * sinf(phi);
+    }
+    break;
+  }
+  case ALZ_CMD_REMOVE:
+    for (size_t v = 0; v < eng->nactive; v++) {
+      if (eng->voices[v].id == cmd->id) { alz_engine_release(eng, v); break; }
+    }
+    break;
+  case ALZ_CMD_REMOVE_ALL:
+    for (size_t v = 0; v < eng->nactive; v++) { alz_engine_release(eng, v); }
+    break;
+  }
+}
+
+/*! Mix voice group \p g into stereo per-lane accumulators. */
+static void
+alz_engine_mix_stereo(AlzEngine * eng, size_t g)
+{
+  const size_t B = eng->B, o = 8 * g;
+  v8sf c = *(v8sf*)(eng->c + o), s = *(v8sf*)(eng->s + o);
+  v8sf e = *(v8sf*)(eng->env + o);
+  const v8sf cr = *(v8sf*)(eng->cr + o), sr = *(v8sf*)(eng->sr + o);
+  const v8sf aL = *(v8sf*)(eng->aL + o), bL = *(v8sf*)(eng->bL + o);
+  const v8sf aR = *(v8sf*)(eng->aR + o), bR = *(v8sf*)(eng->bR + o);
+  const v8sf de = *(v8sf*)(eng->denv + o);
+  v8sf * restrict accL = (v8sf*)eng->accL;
+  v8sf * restrict accR = (v8sf*)eng->accR;
+  for (size_t i = 0; i < B; i++) {
+    accL[i] += e * (aL * s + bL * c);
+    accR[i] += e * (aR * s + bR * c);
+    const v8sf c2 = c * cr - s * sr;
+    s = s * cr + c * sr;
+    c = c2;
+    e += de;
+  }
+  const v8sf k = 1.5f - 0.5f * (c * c + s * s); /* keep on unit circle */
+  *(v8sf*)(eng->c + o) = c * k;
+  *(v8sf*)(eng->s + o) = s * k;
+  *(v8sf*)(eng->env + o) = e;
+}
+
+/*! Render voice group \p g as mono blocks into \c eng->mono. */
+static void
+alz_engine_mix_mono(AlzEngine * eng, size_t g)
+{
+  const size_t B = eng->B, o = 8 * g;
+  v8sf c = *(v8sf*)(eng->c + o), s = *(v8sf*)(eng->s + o);
+  v8sf e = *(v8sf*)(eng->env + o);
+  const v8sf cr = *(v8sf*)(eng->cr + o), sr = *(v8sf*)(eng->sr + o);
+  const v8sf a = *(v8sf*)(eng->aL + o);
+  const v8sf de = *(v8sf*)(eng->denv + o);
+  v8sf * restrict tmp = (v8sf*)eng->accL;
+  for (size_t i = 0; i < B; i++) {
+    tmp[i] = e * a * s;
+    const v8sf c2 = c * cr - s * sr;
+    s = s * cr + c * sr;
+    c = c2;
+    e += de;
+  }
+  const v8sf k = 1.5f - 0.5f * (c * c + s * s);
+  *(v8sf*)(eng->c + o) = c * k;
+  *(v8sf*)(eng->s + o) = s * k;
+  *(v8sf*)(eng->env + o) = e;
+
+  const size_t nl = MIN2(8, eng->nactive - o);
+  for (size_t l = 0; l < nl; l++) {
+    float *m = eng->mono + (o + l) * B;
+    for (size_t i = 0; i < B; i++) { m[i] = eng->accL[8 * i + l]; }
+  }
+}
+
+void
+alz_engine_render(AlzEngine * eng)
+{
+  const size_t B = eng->B;
+  const float tstep = 1.0f / eng->srate;
+  AlzCmd cmd;
+
+  while (alz_queue_pop(&eng->q, &cmd)) { alz_engine_apply(eng, &cmd); }
+
+  /* Envelopes, linear within block. */
+  const size_t n = eng->nactive, ng = (n + 7) / 8;
+  for (size_t v = 0; v < n; v++) {
+    const AlzVoice *vc = &eng->voices[v];
+    float ff0, ff1;
+    if (vc->released) {
+      ff0 = eng->env[v];
+      ff1 = 0;
+    } else {
+      ff0 = alz3d_fade(vc->fade, vc->scnt * tstep, vc->tdur, vc->inv_tdur);
+      ff1 = alz3d_fade(vc->fade, (vc->scnt + B) * tstep, vc->tdur, vc->inv_tdur);
+    }
+    eng->env[v] = ff0;
+    eng->denv[v] = (ff1 - ff0) / B;
+  }
+  for (size_t v = n; v < 8 * ng; v++) { eng->env[v] = eng->denv[v] = 0; }
+
+  if (eng->a3d) {
+    for (size_t g = 0; g < ng; g++) { alz_engine_mix_mono(eng, g); }
+    for (size_t v = 0; v < eng->cap; v++) { eng->ins[v] = v < n ? eng->mono + v * B : NULL; }
+    a3d_conv_process(&eng->conv, eng->ins, eng->accL, eng->accR);
+    for (size_t i = 0; i < B; i++) {
+      eng->out[2*i + 0] = float_clamp(-1, eng->accL[i], 1);
+      eng->out[2*i + 1] = float_clamp(-1, eng->accR[i], 1);
+    }
+  } else {
+    memset(eng->accL, 0, 8 * B * sizeof(float));
+    memset(eng->accR, 0, 8 * B * sizeof(float));
+    for (size_t g = 0; g < ng; g++) { alz_engine_mix_stereo(eng, g); }
+    for (size_t i = 0; i < B; i++) {
+      const float *l = eng->accL + 8 * i, *r = eng->accR + 8 * i;
+      const float sl = ((l[0] + l[1]) + (l[2] + l[3])) + ((l[4] + l[5]) + (l[6] + l[7]));
+      const float sr = ((r[0] + r[1]) + (r[2] + r[3])) + ((r[4] + r[5]) + (r[6] + r[7]));
+      eng->out[2*i + 0] = float_clamp(-1, sl, 1);
+      eng->out[2*i + 1] = float_clamp(-1, sr, 1);
+    }
+  }
+
+  /* Advance and drop finished voices, keeping the pool dense. */
+  for (size_t v = 0; v < eng->nactive; v++) { eng->voices[v].scnt += B; }
+  for (size_t v = 0; v < eng->nactive;) {
+    if (eng->voices[v].scnt >= eng->voices[v].send) {
+      alz_engine_swap(eng, v, --eng->nactive);
+    } else {
+      v++;
+    }
+  }
+}
+
+/* ---------------------------- Group Separator ---------------------------- */
+
+static void *
+alz_engine_loop(void * arg)
+{
+  AlzEngine *eng = (AlzEngine*)arg;
+  while (!__atomic_load_n(&eng->quit, __ATOMIC_ACQUIRE)) {
+    alz_engine_render(eng);
+    eng->sink(eng->sink_ctx, eng->out, eng->B);
+  }
+  return NULL;
+}
+
+int
+alz_engine_start(AlzEngine * eng, AlzSink sink, void * sink_ctx)
+{
+  if (eng->running) { return -1; }
+  eng->sink = sink;
+  eng->sink_ctx = sink_ctx;
+  eng->quit = 0;
+
+  /* Prefer real-time scheduling, fall back to normal if not permitted. */
+  pthread_attr_t attr;
+  struct sched_param sp;
+  pthread_attr_init(&attr);
+  pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+  pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+  sp.sched_priority = sched_get_priority_min(SCHED_FIFO) + 10;
+  pthread_attr_setschedparam(&attr, &sp);
+  int ret = pthread_create(&eng->thread, &attr, alz_engine_loop, eng);
+  pthread_attr_destroy(&attr);
+  if (ret != 0) {
+    ret = pthread_create(&eng->thread, NULL, alz_engine_loop, eng);
+  }
+  if (ret != 0) {
+    lperror("pthread_create");
+    return -1;
+  }
+  eng->running = 1;
+  return 0;
+}
+
+void
+alz_engine_stop(AlzEngine * eng)
+{
+  if (eng->running) {
+    __atomic_store_n(&eng->quit, 1, __ATOMIC_RELEASE);
+    pthread_join(eng->thread, NULL);
+    eng->running = 0;
+  }
+}
+
+/* ---------------------------- Group Separator ---------------------------- */
+
+int
+alz_fd_sink_init(AlzFdSink * sink, int fd, bool little_endian, size_t B)
+{
+  sink->fd = fd;
+  sink->little_endian = little_endian;
+  sink->len = 2 * B;
+  sink->buf = (int16_t*)calloc(sink->len, sizeof(int16_t));
+  return sink->buf ? 0 : -1;
+}
+
+void
+alz_fd_sink_clear(AlzFdSink * sink)
+{
+  free(sink->buf); sink->buf = NULL;
+}
+
+void
+alz_fd_sink_write(void * ctx, const float * LR, size_t nframes)
+{
+  AlzFdSink *sink = (AlzFdSink*)ctx;
+  const size_t n = MIN2(2 * nframes, sink->len);
+  for (size_t i = 0; i < n; i++) {
+    const int16_t x = (int16_t)lrintf(LR[i] * INT16_MAX);
+    if (sink->little_endian) {
+      benc_s16le((unsigned char*)&sink->buf[i], &x);
+    } else {
+      benc_s16be((unsigned char*)&sink->buf[i], &x);
+    }
+  }
+  const char *p = (const char*)sink->buf;
+  size_t left = n * sizeof(int16_t);
+  while (left) {
+    const ssize_t w = write(sink->fd, p, left);
+    if (w < 0) {
+      if (errno == EINTR) { continue; }
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        /* non-blocking device is full: sleep until it drains */
+        struct pollfd pfd = { .fd = sink->fd, .events = POLLOUT };
+        if (poll(&pfd, 1, -1) >= 0 || errno == EINTR) { continue; }
+        lperror("poll");
+        return;
+      }
+      lperror("write");
+      return;
+    }
+    p += w;
+    left -= w;
+  }
+}
@@ -0,0 +1,212 @@
+/*! \file alz_engine.h
+ * \brief Real-Time Audiolizer Engine.
+ * \author Copyright (C) 2012 Per Nordlöw (per.nordlow@gmail.com)
+ *
+ * Renders the same fading sine voices as alz3d.h, but on a dedicated audio
+ * thread that never blocks on, or allocates memory for, other threads:
+ *
+ * - Voices are added and removed by pushing commands onto a lock-free
+ *   single-producer single-consumer (SPSC) queue, drained by the audio
+ *   thread at the start of each block.
+ * - Voices live in a preallocated pool stored as structure-of-arrays and
+ *   kept dense, so the oscillator and mix kernels run eight voices per
+ *   vector. Sines are generated by complex rotation instead of \c sinf().
+ * - With 3D-audio enabled, voices are spatialized through a3d_conv.h.
+ *
+ * Several producer threads must serialize their calls to
+ * alz_engine_add() and alz_engine_remove() among themselves; the audio
+ * thread does not take part in that.
+ */
+
+#pragma once
+
+#include "utils.h"
+#include "alz3d.h"
+#include "a3d_conv.h"
+
+#include <pthread.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ========================================================================= */
+
+/*! Engine Command Type. */
+typedef enum {
+  ALZ_CMD_ADD,                  /**< Add voice. */
+  ALZ_CMD_REMOVE,               /**< Release voice \c id. */
+  ALZ_CMD_REMOVE_ALL,           /**< Release all voices. */
+} ALZ_CMD_t;
+
+/*! Engine Command. */
+typedef struct {
+  ALZ_CMD_t type;
+  uint32_t id;                  /**< Voice identifier. */
+  float wfq;                    /**< Wave Frequency [Hz]. */
+  float tdur;                   /**< Duration [s]. */
+  float azim;                   /**< Azimuth [Degrees]. */
+  float amp;                    /**< Normalized Amplitude. */
+  ALZ3D_WAVE_t wave;
+  ALZ3D_FADE_t fade;
+} AlzCmd;
+
+/*! Lock-Free Single-Producer Single-Consumer Command Queue. */
+typedef struct {
+  AlzCmd *buf;                  /**< Ring buffer of \c mask+1 commands. */
+  size_t mask;                  /**< Capacity minus one (capacity is a power of two). */
+  size_t head __attribute__((aligned(64))); /**< Next slot to pop, written by consumer. */
+  size_t tail __attribute__((aligned(64))); /**< Next slot to push, written by producer. */
+} AlzQueue;
+
+/*! Initialize \p q to hold at least \p cap commands. \return 0 on success. */
+int alz_queue_init(AlzQueue * q, size_t cap);
+
+/*! Release memory held by \p q. */
+void alz_queue_clear(AlzQueue * q);
+
+/*! Push \p cmd (producer side). \return FALSE if \p q is full. */
+static inline bool
+alz_queue_push(AlzQueue * q, const AlzCmd * cmd)
+{
+  const size_t t = q->tail;
+  if (t - __atomic_load_n(&q->head, __ATOMIC_ACQUIRE) > q->mask) { return FALSE; }
+  q->buf[t & q->mask] = *cmd;
+  __atomic_store_n(&q->tail, t + 1, __ATOMIC_RELEASE);
+  return TRUE;
+}
+
+/*! Pop into \p cmd (consumer side). \return FALSE if \p q is empty. */
+static inline bool
+alz_queue_pop(AlzQueue * q, AlzCmd * cmd)
+{
+  const size_t h = q->head;
+  if (h == __atomic_load_n(&q->tail, __ATOMIC_ACQUIRE)) { return FALSE; }
+  *cmd = q->buf[h & q->mask];
+  __atomic_store_n(&q->head, h + 1, __ATOMIC_RELEASE);
+  return TRUE;
+}
+
+/* ---------------------------- Group Separator ---------------------------- */
+
+/*! Voice Control State (the vectorized state is kept in \c AlzEngine). */
+typedef struct {
+  uint32_t id;                  /**< Identifier. */
+  size_t scnt;                  /**< Sample counter. */
+  float tdur;                   /**< Duration [s]. */
+  float inv_tdur;               /**< Inverse of duration. */
+  size_t send;                  /**< Sample count when voice is removed, including filter tail. */
+  ALZ3D_FADE_t fade;            /**< Fading type. */
+  bool released;                /**< Set when removed before its end. */
+} AlzVoice;
+
+/*! Output Sink receiving \p nframes interleaved stereo frames \p LR in [-1, 1]. */
+typedef void (*AlzSink)(void * ctx, const float * LR, size_t nframes);
+
+/*! Real-Time Audiolizer Engine. */
+typedef struct {
+  uint srate;                   /**< Sample rate. */
+  size_t B;                     /**< Block length in frames. */
+  size_t cap;                   /**< Voice capacity (a multiple of 8). */
+  size_t nactive;               /**< Number of active voices, stored first. */
+  AlzVoice *voices;             /**< Voice control states. */
+
+  /*! \name Vectorized voice state, \c cap entries each. */
+  /* @{ */
+  float *c, *s;                 /**< Oscillator state cos/sin(2*pi*wfq*t). */
+  float *cr, *sr;               /**< Per-sample rotation cos/sin(2*pi*wfq/srate). */
+  float *aL, *bL, *aR, *bR;     /**< Ear gains of sine and cosine parts. */
+  float *env, *denv;            /**< Envelope at block start and per-sample increment. */
+  /* @} */
+
+  float *accL, *accR;           /**< Per-lane mix accumulators, \c 8B each. */
+  float *out;                   /**< Interleaved output block of \c 2B samples. */
+
+  AlzQueue q;                   /**< Command queue. */
+  uint32_t next_id;             /**< Next voice identifier (producer side). */
+
+  const A3d *a3d;               /**< 3D-audio context or NULL for simple stereo. */
+  A3dConv conv;                 /**< HRTF convolution engine, one source per voice. */
+  float *mono;                  /**< Per-voice mono blocks for 3D-audio, \c B*cap. */
+  const float **ins;            /**< Per-voice input pointers for 3D-audio. */
+  size_t ntail;                 /**< HRTF tail length in samples. */
+
+  pthread_t thread;             /**< Audio thread. */
+  int running;                  /**< Set while audio thread is running. */
+  int quit;                     /**< Set to ask audio thread to exit. */
+  AlzSink sink;
+  void *sink_ctx;
+} AlzEngine;
+
+/*! Initialize \p eng rendering blocks of \p B frames at \p srate with
+ * room for \p nvoices voices and \p qcap pending commands.
+ *
+ * \return 0 on success, -1 upon error.
+ */
+int alz_engine_init(AlzEngine * eng, uint srate, size_t B,
+                    size_t nvoices, size_t qcap);
+
+/*! Render voices in 3D through the HRTFs of \p a3d precomputed in \p bank
+ * (built with block length \c B). Call before alz_engine_start().
+ *
+ * \return 0 on success, -1 upon error.
+ */
+int alz_engine_use_a3d(AlzEngine * eng, const A3d * a3d, const A3dConvBank * bank);
+
+/*! Stop and release \p eng. */
+void alz_engine_clear(AlzEngine * eng);
+
+/*! Start audio thread of \p eng that renders block after block into \p sink.
+ *
+ * The thread is paced by \p sink, typically by a blocking device write.
+ * \return 0 on success, -1 upon error.
+ */
+int alz_engine_start(AlzEngine * eng, AlzSink sink, void * sink_ctx);
+
+/*! Stop audio thread of \p eng and wait for it to exit. */
+void alz_engine_stop(AlzEngine * eng);
+
+/*! Queue a new voice (producer side).
+ *
+ * \return voice identifier, or 0 if the command queue is full.
+ */
+uint32_t alz_engine_add(AlzEngine * eng,
+                        float wfq, float dur_sec, float azim, float amp,
+                        ALZ3D_WAVE_t wave, ALZ3D_FADE_t fade);
+
+/*! Queue release of voice \p id, or of all voices if \p id is 0 (producer side).
+ *
+ * A released voice fades out over one block.
+ * \return FALSE if the command queue is full.
+ */
+bool alz_engine_remove(AlzEngine * eng, uint32_t id);
+
+/*! Render one block into \c eng->out (consumer side, i.e. the audio
+ * thread, or the caller when no thread is started).
+ */
+void alz_engine_render(AlzEngine * eng);
+
+/* ---------------------------- Group Separator ---------------------------- */
+
+/*! Sink writing 16-bit signed samples to a blocking file descriptor. */
+typedef struct {
+  int fd;
+  bool little_endian;
+  int16_t *buf;                 /**< Conversion buffer. */
+  size_t len;                   /**< Length of \c buf in samples. */
+} AlzFdSink;
+
+/*! Initialize \p sink for writing blocks of \p B frames to \p fd. */
+int alz_fd_sink_init(AlzFdSink * sink, int fd, bool little_endian, size_t B);
+
+/*! Release memory held by \p sink (does not close its file descriptor). */
+void alz_fd_sink_clear(AlzFdSink * sink);
+
+/*! \c AlzSink writing to the \c AlzFdSink \p ctx. */
+void alz_fd_sink_write(void * ctx, const float * LR, size_t nframes);
+
+/* ========================================================================= */
+
+#ifdef __cplusplus
+}
+#endif
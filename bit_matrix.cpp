@@ -1,12 +1,12 @@
 #include "bit_matrix.hpp"
 #include "sortn.hpp"
+extern "C" {
+#include "transpose.h"
+}
 
 void bit_matrix::zero()
 {
-    for (auto d = begin(data); d != end(data); d++)
-    {
-        *d = 0;
-    }
+    std::fill(begin(data), end(data), 0);
 }
 
 // \todo TODO
@@ -72,12 +72,9 @@ void bit_or(bit_matrix& a, const bit_matrix& b, const bit_matrix& c)
 
     for (size_t i = 0; i < m; i++)
     {
-	for (size_t j = 0; j < n; j++)
-	{
-	    a.put_bit(i, j,
-		       b(i, j) bitor c(i, j));
-	}
+        pnw::bitwords::or_n(a.row_words(i), b.row_words(i), c.row_words(i), a.nwords);
     }
+    a.clear_padding();
 }
 
 void bit_and(bit_matrix& a, const bit_matrix& b, const bit_matrix& c)
@@ -89,12 +86,9 @@ void bit_and(bit_matrix& a, const bit_matrix& b, const bit_matrix& c)
 
     for (size_t i = 0; i < m; i++)
     {
-	for (size_t j = 0; j < n; j++)
-	{
-	    a.put_bit(i, j,
-		       b(i, j) bitand c(i, j));
-	}
+        pnw::bitwords::and_n(a.row_words(i), b.row_words(i), c.row_words(i), a.nwords);
     }
+    a.clear_padding();
 }
 
 void bit_xor(bit_matrix& a, const bit_matrix& b, const bit_matrix& c)
@@ -106,10 +100,82 @@ void bit_xor(bit_matrix& a, const bit_matrix& b, const bit_matrix& c)
 
     for (size_t i = 0; i < m; i++)
     {
-	for (size_t j = 0; j < n; j++)
-	{
-	    a.put_bit(i, j,
-		       b(i, j) ^ c(i, j));
-	}
+        pnw::bitwords::xor_n(a.row_words(i), b.row_words(i), c.row_words(i), a.nwords);
+    }
+    a.clear_padding();
+}
+
+void bool_mul(bit_matrix& a, const bit_matrix& b, const bit_matrix& c)
+{
+    typedef bit_matrix::word_type word_type;
+    const size_t m = b.n_rows();
+    const size_t k = std::min(b.n_cols(), c.n_rows());
+    const size_t nw = c.nwords;
+
+    a.resize(m, c.n_cols());
+
+    std::vector<word_type> table(256 * nw); // unions of all subsets of 8 rows of c
+    for (size_t g = 0; g < k; g += 8)
+    {
+        const size_t t = std::min<size_t>(8, k - g); // rows in this group
+        std::fill(table.begin(), table.begin() + nw, 0);
+        for (size_t x = 1; x < (static_cast<size_t>(1) << t); x++)
+        {
+            const size_t low = __builtin_ctzl(x);
+            pnw::bitwords::or_n(&table[x * nw],
+                                &table[(x & (x - 1)) * nw],
+                                c.row_words(g + low), nw);
+        }
+
+        const size_t gw = g / 64;       // word of b holding group
+        const size_t gs = g % 64;       // bit shift within that word
+        const word_type gmask = (static_cast<word_type>(1) << t) - 1;
+        for (size_t i = 0; i < m; i++)
+        {
+            const size_t x = (b.row_words(i)[gw] >> gs) & gmask;
+            if (x)
+            {
+                pnw::bitwords::ip_or_n(a.row_words(i), &table[x * nw], nw);
+            }
+        }
+    }
+}
+
+void transpose(bit_matrix& a, const bit_matrix& b)
+{
+    static const bool inited = (init_transpose(), true); // build lookup table once
+    (void)inited;
+
+    typedef bit_matrix::word_type word_type;
+    const size_t m = b.n_rows();
+    const size_t n = b.n_cols();
+
+    a.resize(n, m);
+
+    char in[8], out[8];
+    for (size_t bi = 0; bi < m; bi += 8) // row block of b
+    {
+        const size_t ti = std::min<size_t>(8, m - bi);
+        for (size_t bj = 0; bj < n; bj += 8) // column block of b
+        {
+            const size_t w = bj / 64, s = bj % 64;
+            word_type any = 0;
+            for (size_t r = 0; r < 8; r++)
+            {
+                const word_type x = r < ti ? (b.row_words(bi + r)[w] >> s) & 0xff : 0;
+                in[r] = static_cast<char>(x);
+                any |= x;
+            }
+            if (not any) { continue; } // sparse fast path
+
+            chara8_bitTranspose8x8(out, in);
+
+            const size_t tj = std::min<size_t>(8, n - bj);
+            const size_t ow = bi / 64, os = bi % 64;
+            for (size_t r = 0; r < tj; r++)
+            {
+                a.row_words(bj + r)[ow] |= static_cast<word_type>(static_cast<unsigned char>(out[r])) << os;
+            }
+        }
     }
 }
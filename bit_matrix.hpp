@@ -4,24 +4,30 @@
  */
 
 #pragma once
+#include <cstdint>
 #include <iostream>
 #include <vector>
 #include "utils.hpp"
 #include "algorithm_x.hpp"
 #include "rand.hpp"
-#include "hamming_distance.hpp"
+#include "bitwords.hpp"
 
 /*!
  * Bit Matrix
  *
- * Matrix of bits (bool) similar to std::bit_vector.
+ * Matrix of bits (bool) stored row-major and packed into 64-bit words. Each
+ * row starts on a word boundary so that rows can be processed word-parallel
+ * (see bitwords.hpp). Bits past \c n_cols() in the last word of a row are
+ * always kept zero.
  */
 class bit_matrix
 {
 public:
-    bit_matrix() : nrows(0), ncols(0), data(0) {}
+    typedef uint64_t word_type;
+
+    bit_matrix() : nrows(0), ncols(0), nwords(0), data(0) {}
     bit_matrix(size_t m, size_t n)
-        : nrows(m), ncols(n), data(m*n) {}
+        : nrows(m), ncols(n), nwords(pnw::bitwords::words_of_bits(n)), data(m*nwords) {}
 
     /// \name Dimension Getters.
     /// \{
@@ -29,12 +35,15 @@ public:
     size_t n_rows() const { return nrows; }
     /// Get the number of columns.
     size_t n_cols() const { return ncols; }
-    /// Resize matrix to m rows and n columns.
+    /// Get the number of words per row.
+    size_t n_row_words() const { return nwords; }
+    /// Resize matrix to m rows and n columns. Contents are cleared.
     void resize(size_t m, size_t n)
     {
         nrows = m;
         ncols = n;
-        data.resize(m * n);
+        nwords = pnw::bitwords::words_of_bits(n);
+        data.assign(m * nwords, 0);
     }
     // \}
 
@@ -53,36 +62,30 @@ public:
     /// Set the element at row \p i, column \p j (to one).
     void set_bit(size_t i, size_t j)
     {
-        const unsigned ij = i * ncols + j;
-        DEBUG_CHECK_RANGE(ij, data.size());
-        data[ij] = 1;
+        DEBUG_CHECK_RANGE(j, ncols);
+        row_words(i)[j / 64] |= bit_of(j);
     }
     /// Set the element at row \p i, column \p j to the value of \p a.
     void put_bit(size_t i, size_t j, bool a)
     {
-        const unsigned ij = i * ncols + j;
-        DEBUG_CHECK_RANGE(ij, data.size());
-        data[ij] = a;
+        a ? set_bit(i, j) : clr_bit(i, j);
     }
     /// Clear the element at row \p i, column \p j (to zero).
     void clr_bit(size_t i, size_t j)
     {
-        const unsigned ij = i * ncols + j;
-        DEBUG_CHECK_RANGE(ij, data.size());
-        data[ij] = 0;
+        DEBUG_CHECK_RANGE(j, ncols);
+        row_words(i)[j / 64] &= ~bit_of(j);
     }
     /// Get the element at row \p i, column \p j.
     bool get_bit(size_t i, size_t j) const
     {
-        const unsigned ij = i * ncols + j;
-        DEBUG_CHECK_RANGE(ij, data.size());
-        return data[ij];
+        DEBUG_CHECK_RANGE(j, ncols);
+        return (row_words(i)[j / 64] & bit_of(j)) != 0;
     }
     /// Get the element at index \p i (row-major order).
     bool operator () (size_t i) const
     {
-        DEBUG_CHECK_RANGE(i, data.size());
-        return data[i];
+        return get_bit(i / ncols, i % ncols);
     }
     bool operator () (size_t i, size_t j) const
     {
@@ -95,7 +98,7 @@ public:
         std::vector<bool> a(n);
         for (size_t j = 0; j < n; j++)
         {
-            a[i] = get_bit(i, j);
+            a[j] = get_bit(i, j);
         }
         return a;
     }
@@ -110,6 +113,32 @@ public:
         }
         return a;
     }
+    /// Get pointer to the \p n_row_words() words of the \p i:th row.
+    word_type* row_words(size_t i)
+    {
+        DEBUG_CHECK_RANGE(i, nrows);
+        return data.data() + i * nwords;
+    }
+    /// Get pointer to the \p n_row_words() words of the \p i:th row.
+    const word_type* row_words(size_t i) const
+    {
+        DEBUG_CHECK_RANGE(i, nrows);
+        return data.data() + i * nwords;
+    }
+    // \}
+
+    /// \name Counting.
+    /// \{
+    /// Get the number of ones in the \p i:th row.
+    size_t row_popcount(size_t i) const
+    {
+        return pnw::bitwords::popcount_n(row_words(i), nwords);
+    }
+    /// Get the number of ones in the matrix.
+    size_t popcount() const
+    {
+        return pnw::bitwords::popcount_n(data.data(), data.size());
+    }
     // \}
 
     /// \name Generators.
@@ -118,17 +147,17 @@ public:
     void zero();
     /// Assign all elements a random value.
     void rand() {
-        // TODO: Reuse rand(bit_vector)
-        for (size_t i = 0; i < data.size(); i++) {
-            data[i] = pnw::get_random_bit();
-        }
+        rand_n(data.data(), data.size());
+        clear_padding();
     }
     /// Assign n random elements a value of one.
     void randomly_set_n_ones(size_t n)
     {
-        for (size_t i = 0; i < n; i++)
+        const size_t mn = nrows * ncols;
+        for (size_t i = 0; mn and i < n; i++)
         {
-            data[rand() % (data.size())] = 1;
+            const size_t k = static_cast<size_t>(int64_rand()) % mn;
+            set_bit(k / ncols, k % ncols);
         }
     }
     /// Construct a random adjacency matrix.
@@ -155,10 +184,34 @@ public:
     friend size_t hamming_distance(const bit_matrix & a,
                                    const bit_matrix & b)
     {
-        return pnw::hamming_distance(a.data, b.data);
+        return pnw::bitwords::popcount_xor_n(a.data.data(), b.data.data(),
+                                             std::min(a.data.size(), b.data.size()));
     }
     // \}
 
+    /// \name Boolean Matrix Algebra.
+    /// \{
+    /*!
+     * Boolean Matrix Product \p a = \p b * \p c (AND as multiplication, OR as
+     * addition) using the <em>Method of Four Russians</em>.
+     *
+     * Rows of \p c are grouped eight at a time into a 256-entry table of all
+     * their unions, so each row of \p a costs n_cols(b)/8 table lookups of
+     * n_row_words(c) words each.
+     *
+     * \see https://en.wikipedia.org/wiki/Method_of_Four_Russians
+     */
+    friend void bool_mul(bit_matrix & a,
+                         const bit_matrix & b,
+                         const bit_matrix & c);
+    /*!
+     * Transpose \p b into \p a in blocks of 8-by-8 bits using
+     * chara8_bitTranspose8x8().
+     */
+    friend void transpose(bit_matrix & a,
+                          const bit_matrix & b);
+    // \}
+
     /// \name IO.
     /// \{
     void print(std::ostream & os) const
@@ -187,7 +240,21 @@ public:
     // \}
 
 protected:
-    size_t nrows;		/// The number of rows of the matrix.
-    size_t ncols;		/// The number of columns of the matrix.
-    std::vector<bool> data;	///< The matrix data.
+    /// Get mask of column \p j in its word.
+    static word_type bit_of(size_t j) { return static_cast<word_type>(1) << (j % 64); }
+    /// Zero the unused bits past \c ncols in each row.
+    void clear_padding()
+    {
+        if (ncols % 64 == 0) { return; }
+        const word_type mask = pnw::bitwords::tail_mask(ncols);
+        for (size_t i = 0; i < nrows; i++)
+        {
+            row_words(i)[nwords - 1] &= mask;
+        }
+    }
+
+    size_t nrows;		///< The number of rows of the matrix.
+    size_t ncols;		///< The number of columns of the matrix.
+    size_t nwords;		///< The number of words per row.
+    std::vector<word_type> data;	///< The matrix data.
 };
@@ -0,0 +1,94 @@
+#include "bitvec_rs.h"
+#include "utils.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+void
+bitvec_rs_init(Bitvec_RS * a, const Bitvec * b)
+{
+  const size_t wnum = bitvec_get_data_blocknum(b->l);
+
+  a->l = b->l;
+  a->bnum = b->l / BITVEC_RS_BLOCK_BITS + 1; /* extra block makes rank1(l) valid */
+  a->d = (uint64_t*)calloc_aligned(64, a->bnum * BITVEC_RS_STRIDE * sizeof(uint64_t));
+
+  /* Copy bits and fill in absolute and relative counts. */
+  size_t c = 0;
+  for (size_t i = 0; i < a->bnum; i++) {
+    uint64_t * blk = a->d + i * BITVEC_RS_STRIDE;
+    uint64_t rel = 0;
+    uint rc = 0;
+    blk[0] = c;
+    for (uint w = 0; w < BITVEC_RS_BLOCK_WORDS; w++) {
+      const size_t j = i * BITVEC_RS_BLOCK_WORDS + w;
+      BitsBlock x = j < wnum ? b->d[j] : 0;
+      if (j + 1 == wnum && (b->l % BITVEC_BLOCK_BITSIZE)) { /* mask out rest bits */
+        x &= ((BitsBlock)1 << (b->l % BITVEC_BLOCK_BITSIZE)) - 1;
+      }
+      blk[2 + w] = x;
+      if (w) { rel |= (uint64_t)rc << (9 * (w - 1)); }
+      rc += bitsblock_popcount(x);
+    }
+    blk[1] = rel;
+    c += rc;
+  }
+  a->ones = c;
+
+  /* Sample block of every BITVEC_RS_SELECT_SAMPLE:th one. */
+  a->snum = (c + BITVEC_RS_SELECT_SAMPLE - 1) / BITVEC_RS_SELECT_SAMPLE;
+  a->s = (uint32_t*)malloc((a->snum + 1) * sizeof(uint32_t));
+  size_t k = 0;
+  for (size_t i = 0; i < a->bnum && k < a->snum; i++) {
+    const size_t next = (i + 1 < a->bnum) ? a->d[(i + 1) * BITVEC_RS_STRIDE] : c;
+    while (k < a->snum && k * BITVEC_RS_SELECT_SAMPLE < next) {
+      a->s[k++] = i;
+    }
+  }
+  a->s[a->snum] = a->bnum - 1;  /* sentinel */
+}
+
+void
+bitvec_rs_clear(Bitvec_RS * a)
+{
+  free(a->d); a->d = NULL;
+  free(a->s); a->s = NULL;
+  a->l = a->ones = a->bnum = a->snum = 0;
+}
+
+size_t
+bitvec_rs_bytesize(const Bitvec_RS * a)
+{
+  return (sizeof(Bitvec_RS) +
+          a->bnum * BITVEC_RS_STRIDE * sizeof(uint64_t) +
+          (a->snum + 1) * sizeof(uint32_t));
+}
+
+size_t
+bitvec_rs_select1(const Bitvec_RS * a, size_t k)
+{
+  if (k >= a->ones) { return a->l; }
+
+  /* Binary search for last block with absolute count <= k between samples. */
+  const size_t j = k / BITVEC_RS_SELECT_SAMPLE;
+  size_t lo = a->s[j], hi = a->s[j + 1];
+  while (lo < hi) {
+    const size_t mid = lo + (hi - lo + 1) / 2;
+    if (a->d[mid * BITVEC_RS_STRIDE] <= k) { lo = mid; } else { hi = mid - 1; }
+  }
+
+  const uint64_t * blk = a->d + lo * BITVEC_RS_STRIDE;
+  size_t r = k - blk[0];
+
+  /* Find word within block from relative counts. */
+  uint w = 0;
+  while (w + 1 < BITVEC_RS_BLOCK_WORDS &&
+         ((blk[1] >> (9 * w)) & 0x1ff) <= r) {
+    w++;
+  }
+  if (w) { r -= (blk[1] >> (9 * (w - 1))) & 0x1ff; }
+
+  return (lo * BITVEC_RS_BLOCK_BITS +
+          w * BITVEC_BLOCK_BITSIZE +
+          bitsblock_select1(blk[2 + w], r));
+}
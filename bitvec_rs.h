@@ -0,0 +1,119 @@
+/*! \file bitvec_rs.h
+ * \brief Rank/Select Succinct Index over Bit Vectors.
+ * \author Copyright (C) 2012 Per Nordlöw (per.nordlow@gmail.com)
+ *
+ * Uses the \em rank9 layout interleaved with the bits themselves: every
+ * basic block of 512 bits (8 words) is preceded by one absolute count word
+ * and one word of seven packed 9-bit relative counts, so \c rank1 touches a
+ * single 80-byte span. \c select1 is narrowed by samples taken every
+ * \c BITVEC_RS_SELECT_SAMPLE ones and finished in-word with \c pdep when
+ * BMI2 is available.
+ *
+ * Overhead is 25% of the bit vector plus 32 bits per sampled one.
+ *
+ * \see http://vigna.di.unimi.it/ftp/papers/Broadword.pdf
+ * \see http://www.cs.cmu.edu/~dga/papers/zhou-sea2013.pdf
+ */
+
+#pragma once
+
+#include "bitvec.h"
+#include <stdint.h>
+#include <stddef.h>
+#if defined(__BMI2__)
+#  include <immintrin.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ========================================================================= */
+
+/*! Number of bit words per basic block. */
+#define BITVEC_RS_BLOCK_WORDS (8)
+/*! Number of words in an interleaved block (counts + bits). */
+#define BITVEC_RS_STRIDE (2 + BITVEC_RS_BLOCK_WORDS)
+/*! Number of bits per basic block. */
+#define BITVEC_RS_BLOCK_BITS (BITVEC_RS_BLOCK_WORDS * BITVEC_BLOCK_BITSIZE)
+/*! Distance in ones between select samples. */
+#define BITVEC_RS_SELECT_SAMPLE (512)
+
+/*! Rank/Select Indexed Bit Vector. */
+typedef struct Bitvec_RS
+{
+  size_t l;                     /**< Length in bits. */
+  size_t ones;                  /**< Total number of ones. */
+  size_t bnum;                  /**< Number of basic blocks. */
+  uint64_t *d;                  /**< Interleaved counts and bits. */
+  size_t snum;                  /**< Number of select samples. */
+  uint32_t *s;                  /**< Block index of every \c BITVEC_RS_SELECT_SAMPLE:th one. */
+} Bitvec_RS;
+
+/* ---------------------------- Group Separator ---------------------------- */
+
+/*! Population Count of \p a. */
+static inline uint bitsblock_popcount(BitsBlock a) { return __builtin_popcountll(a); }
+
+/*! Position of the \p r:th (0-based) set bit in \p a. Undefined if \p a
+ * has fewer than \p r + 1 ones.
+ */
+static inline uint bitsblock_select1(BitsBlock a, uint r)
+{
+#if defined(__BMI2__)
+  return __builtin_ctzll(_pdep_u64((BitsBlock)1 << r, a));
+#else
+  for (uint k = 0; k < r; k++) { a &= a - 1; } /* clear lowest one */
+  return __builtin_ctzll(a);
+#endif
+}
+
+/* ---------------------------- Group Separator ---------------------------- */
+
+/*! Build the index \p a from the bits in \p b. */
+void bitvec_rs_init(Bitvec_RS * a, const Bitvec * b);
+
+/*! Release memory held by \p a. */
+void bitvec_rs_clear(Bitvec_RS * a);
+
+/*! Get the number of bytes used by \p a. */
+size_t bitvec_rs_bytesize(const Bitvec_RS * a);
+
+/*! Get bit \p i in \p a. */
+static inline uint bitvec_rs_get(const Bitvec_RS * a, size_t i)
+{
+  const size_t b = i / BITVEC_RS_BLOCK_BITS;
+  const size_t w = (i / BITVEC_BLOCK_BITSIZE) % BITVEC_RS_BLOCK_WORDS;
+  const uint64_t * blk = a->d + b * BITVEC_RS_STRIDE;
+  return (blk[2 + w] >> (i % BITVEC_BLOCK_BITSIZE)) & 1;
+}
+
+/*! Get number of ones in the range [0, \p i) of \p a, where \p i <= a->l. */
+static inline size_t bitvec_rs_rank1(const Bitvec_RS * a, size_t i)
+{
+  const size_t b = i / BITVEC_RS_BLOCK_BITS;
+  const uint w = (i / BITVEC_BLOCK_BITSIZE) % BITVEC_RS_BLOCK_WORDS;
+  const uint r = i % BITVEC_BLOCK_BITSIZE;
+  const uint64_t * blk = a->d + b * BITVEC_RS_STRIDE;
+  size_t c = blk[0];
+  if (w) { c += (blk[1] >> (9 * (w - 1))) & 0x1ff; }
+  if (r) { c += bitsblock_popcount(blk[2 + w] << (BITVEC_BLOCK_BITSIZE - r)); }
+  return c;
+}
+
+/*! Get number of zeros in the range [0, \p i) of \p a. */
+static inline size_t bitvec_rs_rank0(const Bitvec_RS * a, size_t i)
+{
+  return i - bitvec_rs_rank1(a, i);
+}
+
+/*! Get position of the \p k:th (0-based) one in \p a, or \c a->l if \p k
+ * >= \c a->ones.
+ */
+size_t bitvec_rs_select1(const Bitvec_RS * a, size_t k);
+
+/* ========================================================================= */
+
+#ifdef __cplusplus
+}
+#endif
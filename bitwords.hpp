@@ -0,0 +1,133 @@
+/*! \file bitwords.hpp
+ * \brief Bulk Bitwise Operations on Arrays of 64-bit Words.
+ * \author Copyright (C) 2012 Per Nordlöw (per.nordlow@gmail.com)
+ *
+ * Kernels use AVX2 when compiled with \c -mavx2 (or \c -march=native on a
+ * capable CPU) and fall back to plain 64-bit word loops otherwise.
+ *
+ * \see http://0x80.pl/articles/sse-popcount.html
+ * \see https://arxiv.org/abs/1611.07612
+ */
+
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#if defined(__AVX2__)
+#  include <immintrin.h>
+#endif
+
+namespace pnw
+{
+namespace bitwords
+{
+
+/*! Number of words needed to store \p n bits. */
+inline size_t words_of_bits(size_t n) { return (n + 63) / 64; }
+
+/*! Mask of the valid bits in the last word of an \p n bit array. */
+inline uint64_t tail_mask(size_t n)
+{
+    const size_t r = n % 64;
+    return r ? (~static_cast<uint64_t>(0) >> (64 - r)) : ~static_cast<uint64_t>(0);
+}
+
+/*! Population Count of \p a. */
+inline size_t popcount(uint64_t a) { return __builtin_popcountll(a); }
+
+#if defined(__AVX2__)
+/*! Per-byte population count of \p v using nibble lookup (Muła). */
+inline __m256i popcount_bytes_avx2(__m256i v)
+{
+    const __m256i lookup = _mm256_setr_epi8(0,1,1,2,1,2,2,3,1,2,2,3,2,3,3,4,
+                                            0,1,1,2,1,2,2,3,1,2,2,3,2,3,3,4);
+    const __m256i low_mask = _mm256_set1_epi8(0x0f);
+    const __m256i lo = _mm256_and_si256(v, low_mask);
+    const __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), low_mask);
+    return _mm256_add_epi8(_mm256_shuffle_epi8(lookup, lo),
+                           _mm256_shuffle_epi8(lookup, hi));
+}
+/*! Sum of the four 64-bit lanes of \p v. */
+inline uint64_t hsum_epi64_avx2(__m256i v)
+{
+    return (static_cast<uint64_t>(_mm256_extract_epi64(v, 0)) +
+            static_cast<uint64_t>(_mm256_extract_epi64(v, 1)) +
+            static_cast<uint64_t>(_mm256_extract_epi64(v, 2)) +
+            static_cast<uint64_t>(_mm256_extract_epi64(v, 3)));
+}
+#endif
+
+/*! \name Elementwise Operations.
+ * Compute \p a[i] = \p b[i] op \p c[i] for \p n words. \p a may alias \p b or \p c.
+ */
+/// \{
+#if defined(__AVX2__)
+#  define PNW_BITWORDS_BINOP(name, simd_op, op)                          \
+    inline void name(uint64_t* a, const uint64_t* b, const uint64_t* c, size_t n) \
+    {                                                                   \
+        size_t i = 0;                                                   \
+        for (; i + 4 <= n; i += 4) {                                    \
+            const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i)); \
+            const __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(c + i)); \
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(a + i), simd_op(x, y)); \
+        }                                                               \
+        for (; i < n; i++) { a[i] = b[i] op c[i]; }                     \
+    }
+#else
+#  define PNW_BITWORDS_BINOP(name, simd_op, op)                          \
+    inline void name(uint64_t* a, const uint64_t* b, const uint64_t* c, size_t n) \
+    {                                                                   \
+        for (size_t i = 0; i < n; i++) { a[i] = b[i] op c[i]; }         \
+    }
+#endif
+PNW_BITWORDS_BINOP(and_n, _mm256_and_si256, &)
+PNW_BITWORDS_BINOP(or_n, _mm256_or_si256, |)
+PNW_BITWORDS_BINOP(xor_n, _mm256_xor_si256, ^)
+#undef PNW_BITWORDS_BINOP
+
+/*! In-place \p a[i] |= \p b[i] for \p n words. */
+inline void ip_or_n(uint64_t* a, const uint64_t* b, size_t n) { or_n(a, a, b, n); }
+/*! In-place \p a[i] &= \p b[i] for \p n words. */
+inline void ip_and_n(uint64_t* a, const uint64_t* b, size_t n) { and_n(a, a, b, n); }
+/// \}
+
+/*! Population Count of the \p n words at \p a. */
+inline size_t popcount_n(const uint64_t* a, size_t n)
+{
+    size_t i = 0;
+    size_t c = 0;
+#if defined(__AVX2__)
+    __m256i acc = _mm256_setzero_si256();
+    while (i + 4 <= n) {
+        // Byte counters saturate after 255/8 = 31 iterations.
+        const size_t m = std::min<size_t>((n - i) / 4, 31);
+        __m256i bytes = _mm256_setzero_si256();
+        for (size_t k = 0; k < m; k++, i += 4) {
+            const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+            bytes = _mm256_add_epi8(bytes, popcount_bytes_avx2(v));
+        }
+        acc = _mm256_add_epi64(acc, _mm256_sad_epu8(bytes, _mm256_setzero_si256()));
+    }
+    c += hsum_epi64_avx2(acc);
+#endif
+    for (; i < n; i++) { c += popcount(a[i]); }
+    return c;
+}
+
+/*! Population Count of (\p a[i] ^ \p b[i]) over \p n words (Hamming Distance). */
+inline size_t popcount_xor_n(const uint64_t* a, const uint64_t* b, size_t n)
+{
+    size_t c = 0;
+    for (size_t i = 0; i < n; i++) { c += popcount(a[i] ^ b[i]); }
+    return c;
+}
+
+/*! Return true if any of the \p n words at \p a is non-zero. */
+inline bool any_n(const uint64_t* a, size_t n)
+{
+    for (size_t i = 0; i < n; i++) { if (a[i]) { return true; } }
+    return false;
+}
+
+}
+}
@@ -0,0 +1,117 @@
+/*! \file bytestats.hpp
+ * \brief Byte Histogram, Entropy, Line Count and Text/Binary Verdict.
+ * \author Copyright (C) 2012 Per Nordlöw (per.nordlow@gmail.com)
+ *
+ * All statistics follow from one byte histogram, which is filled eight bytes
+ * per load into four interleaved tables of 32-bit counters. Consecutive
+ * equal bytes then increment different tables, so an increment need not
+ * wait for the store of the previous one, as it would with a single table on
+ * runs of equal bytes such as indentation or zero padding.
+ */
+
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+namespace pnw
+{
+
+/*! Byte Content Statistics, accumulated over blocks of any size. */
+class byte_stats {
+public:
+    byte_stats() { clear(); }
+
+    void clear() {
+        std::fill(m_hist, m_hist + 256, 0);
+        std::fill(&m_lane[0][0], &m_lane[0][0] + 4*256, 0);
+        m_pending = 0;
+        m_bytes = 0;
+        m_last = 0;
+    }
+
+    /// Add \p n bytes at \p buf.
+    void add(const void* buf, size_t n) {
+        auto p = static_cast<const uint8_t*>(buf);
+        if (n == 0) { return; }
+        m_last = p[n - 1];
+        m_bytes += n;
+        while (n) {             // keep lanes below 2^32
+            const size_t m = std::min<size_t>(n, LANE_MAX - m_pending);
+            add_lanes(p, m);
+            p += m; n -= m;
+            if (m_pending == LANE_MAX) { flush(); }
+        }
+    }
+
+    const uint64_t* hist() const { flush(); return m_hist; } ///< Counts of byte values.
+    uint64_t operator[](uint8_t b) const { flush(); return m_hist[b]; } ///< Count of \p b.
+    uint64_t bytes() const { return m_bytes; } ///< Number of bytes added.
+
+    /// Number of lines, including a last one not ended by newline.
+    uint64_t lines() const { return (*this)['\n'] + (m_bytes and m_last != '\n'); }
+
+    /// Shannon entropy in bits per byte, in [0, 8].
+    double entropy() const {
+        flush();
+        if (m_bytes == 0) { return 0; }
+        const double n = double(m_bytes);
+        double h = 0;
+        for (size_t i = 0; i < 256; i++) {
+            if (m_hist[i]) { const double p = m_hist[i] / n; h -= p * std::log2(p); }
+        }
+        return h;
+    }
+
+    /*! Check if contents look binary: contains a NUL or more than 1/16
+     * control bytes other than white-space, backspace and escape. */
+    bool is_binary() const {
+        flush();
+        if (m_hist[0]) { return true; }
+        uint64_t ctl = m_hist[0x7F];
+        for (size_t i = 1; i < 0x20; i++) {
+            if (not ((i >= '\b' and i <= '\r') or i == 0x1B)) { ctl += m_hist[i]; }
+        }
+        return ctl * 16 > m_bytes;
+    }
+
+private:
+    static const size_t LANE_MAX = size_t(1) << 31; ///< Bytes between flushes.
+
+    void add_lanes(const uint8_t* p, size_t n) {
+        uint32_t* c0 = m_lane[0];
+        uint32_t* c1 = m_lane[1];
+        uint32_t* c2 = m_lane[2];
+        uint32_t* c3 = m_lane[3];
+        size_t i = 0;
+        for (; i + 8 <= n; i += 8) {
+            uint64_t w;
+            memcpy(&w, p + i, 8);
+            c0[w & 0xFF]++; c1[(w >> 8) & 0xFF]++;
+            c2[(w >> 16) & 0xFF]++; c3[(w >> 24) & 0xFF]++;
+            c0[(w >> 32) & 0xFF]++; c1[(w >> 40) & 0xFF]++;
+            c2[(w >> 48) & 0xFF]++; c3[w >> 56]++;
+        }
+        for (; i < n; i++) { c0[p[i]]++; }
+        m_pending += n;
+    }
+
+    /// Fold lanes into \c m_hist.
+    void flush() const {
+        if (m_pending == 0) { return; }
+        for (size_t i = 0; i < 256; i++) {
+            m_hist[i] += uint64_t(m_lane[0][i]) + m_lane[1][i] + m_lane[2][i] + m_lane[3][i];
+        }
+        std::fill(&m_lane[0][0], &m_lane[0][0] + 4*256, 0);
+        m_pending = 0;
+    }
+
+    mutable uint64_t m_hist[256];   ///< Flushed counts.
+    mutable uint32_t m_lane[4][256]; ///< Pending counts.
+    mutable size_t m_pending;       ///< Bytes in lanes.
+    uint64_t m_bytes;
+    uint8_t m_last;                 ///< Last byte added.
+};
+
+}
@@ -167,6 +167,49 @@ bzip2_decode(const char *bufC, size_t lenC, char **bufD, size_t *lenD)
   return 0;
 }
 
+int
+bzip2_decode_cb(const char *bufC, size_t lenC, size_t blksize,
+                int (*sink)(void *ctx, const void *buf, size_t len), void *ctx)
+{
+#ifdef HAVE_BZLIB_H
+  int ret = BZ_OK;
+  char *bufT = (char*)malloc(blksize);
+  if (!bufT) { return -1; }
+
+  while (lenC != 0 && ret == BZ_OK) { /* for each stream */
+    bz_stream bzs;
+    bzs.bzalloc = NULL;
+    bzs.bzfree = NULL;
+    bzs.opaque = NULL;
+    if (BZ2_bzDecompressInit(&bzs, 0, 0) != BZ_OK) { ret = BZ_MEM_ERROR; break; }
+    do {
+      /* feed input in pieces that fit in avail_in */
+      const size_t n = lenC < (1u << 30) ? lenC : (1u << 30);
+      bzs.next_in = (char *) bufC;
+      bzs.avail_in = n;
+      do {
+        bzs.next_out = bufT;
+        bzs.avail_out = blksize;
+        ret = BZ2_bzDecompress(&bzs);
+        if (ret != BZ_OK && ret != BZ_STREAM_END) { break; }
+        if (bzs.next_out != bufT &&
+            sink(ctx, bufT, bzs.next_out - bufT) != 0) { ret = BZ_PARAM_ERROR; break; }
+      } while (ret == BZ_OK && (bzs.avail_in != 0 || bzs.avail_out == 0));
+      bufC += n - bzs.avail_in;
+      lenC -= n - bzs.avail_in;
+    } while (ret == BZ_OK && lenC != 0);
+    BZ2_bzDecompressEnd(&bzs);
+    if (ret == BZ_STREAM_END) { ret = BZ_OK; } /* next stream, if any */
+    else if (ret == BZ_OK) { ret = BZ_UNEXPECTED_EOF; }
+  }
+
+  free(bufT);
+  return ret == BZ_OK ? 0 : -1;
+#else
+  return -1;
+#endif
+}
+
 /*!
  * Tests BZip Compression of a Random Char Array of length \p len
  * randomized using a specific segment extracted from the rand() function.
@@ -48,6 +48,17 @@ int bzip2_encode(const char *bufI, size_t lenI, char **bufC, size_t *lenC,
  */
 int bzip2_decode(const char *bufC, size_t lenC, char **bufD, size_t *lenD);
 
+/*!
+ * Decode (decompress) \p lenC bytes of bzip2 data at \p bufC, calling
+ * \p sink with \p ctx for each decoded block of at most \p blksize bytes,
+ * without collecting all output. Concatenated streams are decoded in turn.
+ * \p sink returns non-zero to stop decoding.
+ *
+ * \return 0 on success, -1 on error or if stopped.
+ */
+int bzip2_decode_cb(const char *bufC, size_t lenC, size_t blksize,
+                    int (*sink)(void *ctx, const void *buf, size_t len), void *ctx);
+
 /* ---------------------------- Group Separator ---------------------------- */
 
 int test_bzip2(void);
@@ -0,0 +1,201 @@
+/*! \file cmaes.hpp
+ * \brief Covariance Matrix Adaptation Evolution Strategy (CMA-ES).
+ * \author Copyright (C) 2012 Per Nordlöw (per.nordlow@gmail.com)
+ *
+ * Standard (mu/mu_w, lambda)-CMA-ES with the default strategy parameters
+ * of Hansen's tutorial. All \c lambda offspring of a generation are
+ * evaluated in one call to the batched objective.
+ *
+ * \see https://arxiv.org/abs/1604.00772 (Hansen, The CMA Evolution Strategy: A Tutorial)
+ */
+
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <vector>
+#include "opt_batch.hpp"
+#include "rand_streams.hpp"
+
+namespace pnw { namespace opt {
+
+/*! Eigendecompose symmetric \p n x \p n row-major matrix \p A into
+ * eigenvalues \p d and column eigenvectors \p B using cyclic Jacobi
+ * rotations. \p A is destroyed.
+ */
+template<class T>
+inline void jacobi_eigen(T* A, size_t n, T* d, T* B, size_t max_sweeps = 50)
+{
+    for (size_t i = 0; i < n; ++i) {
+        for (size_t j = 0; j < n; ++j) { B[i*n+j] = i == j; }
+    }
+    for (size_t sweep = 0; sweep < max_sweeps; ++sweep) {
+        T off = 0;
+        for (size_t i = 0; i < n; ++i) {
+            for (size_t j = i+1; j < n; ++j) { off += A[i*n+j] * A[i*n+j]; }
+        }
+        if (off == 0) { break; }
+        for (size_t p = 0; p < n; ++p) {
+            for (size_t q = p+1; q < n; ++q) {
+                const T apq = A[p*n+q];
+                if (apq == 0) { continue; }
+                const T theta = (A[q*n+q] - A[p*n+p]) / (2 * apq);
+                const T t = (theta >= 0 ? 1 : -1) / (std::abs(theta) + std::sqrt(theta*theta + 1));
+                const T c = 1 / std::sqrt(t*t + 1), s = t * c;
+                for (size_t k = 0; k < n; ++k) { // rotate columns p and q
+                    const T akp = A[k*n+p], akq = A[k*n+q];
+                    A[k*n+p] = c*akp - s*akq;
+                    A[k*n+q] = s*akp + c*akq;
+                }
+                for (size_t k = 0; k < n; ++k) { // rotate rows p and q
+                    const T apk = A[p*n+k], aqk = A[q*n+k];
+                    A[p*n+k] = c*apk - s*aqk;
+                    A[q*n+k] = s*apk + c*aqk;
+                }
+                for (size_t k = 0; k < n; ++k) {
+                    const T bkp = B[k*n+p], bkq = B[k*n+q];
+                    B[k*n+p] = c*bkp - s*bkq;
+                    B[k*n+q] = s*bkp + c*bkq;
+                }
+            }
+        }
+    }
+    for (size_t i = 0; i < n; ++i) { d[i] = A[i*n+i]; }
+}
+
+}}
+
+/*! Minimize batched objective \p fn over \p n variables with CMA-ES.
+ *
+ * \param[in] x0 is the initial mean.
+ * \param[in] sigma0 is the initial step size.
+ * \param[in] lower, upper if non-null clamp sampled points to this box.
+ * \param[in] lambda is the population size, or 0 for 4 + 3 ln(n).
+ * \param[in] tol stops when sigma times the largest axis length drops below it.
+ * \param[in] seed selects the random stream used for sampling.
+ */
+template<class T>
+inline
+pnw::opt::result<T> cmaes(const pnw::opt::batch_fn<T>& fn, size_t n,
+                          const T* x0, T sigma0,
+                          size_t max_evals,
+                          const T* lower = nullptr, const T* upper = nullptr,
+                          size_t lambda = 0,
+                          T tol = 1e-12,
+                          uint64_t seed = 0)
+{
+    pnw::opt::result<T> res;
+    if (lambda == 0) { lambda = 4 + static_cast<size_t>(3 * std::log(static_cast<T>(n))); }
+    const size_t mu = lambda / 2;
+
+    // Recombination weights.
+    std::vector<T> w(mu);
+    for (size_t i = 0; i < mu; ++i) { w[i] = std::log(static_cast<T>(lambda + 1) / 2) - std::log(static_cast<T>(i + 1)); }
+    const T wsum = std::accumulate(w.begin(), w.end(), static_cast<T>(0));
+    T w2sum = 0;
+    for (auto& wi : w) { wi /= wsum; w2sum += wi * wi; }
+    const T mueff = 1 / w2sum;
+
+    // Adaptation parameters.
+    const T N = static_cast<T>(n);
+    const T cc = (4 + mueff/N) / (N + 4 + 2*mueff/N);
+    const T cs = (mueff + 2) / (N + mueff + 5);
+    const T c1 = 2 / ((N + 1.3)*(N + 1.3) + mueff);
+    const T cmu = std::min(1 - c1, 2 * (mueff - 2 + 1/mueff) / ((N + 2)*(N + 2) + mueff));
+    const T damps = 1 + 2 * std::max(static_cast<T>(0), std::sqrt((mueff - 1) / (N + 1)) - 1) + cs;
+    const T chiN = std::sqrt(N) * (1 - 1/(4*N) + 1/(21*N*N));
+
+    // State.
+    std::vector<T> m(x0, x0 + n), mold(n);
+    T sigma = sigma0;
+    std::vector<T> pc(n, 0), ps(n, 0);
+    std::vector<T> C(n*n, 0), B(n*n, 0), D(n, 1), Ctmp(n*n);
+    for (size_t i = 0; i < n; ++i) { C[i*n+i] = 1; B[i*n+i] = 1; }
+    size_t eigen_evals = 0;
+
+    std::vector<T> Z(lambda*n), Y(lambda*n), X(lambda*n), f(lambda), tmp(n);
+    std::vector<size_t> order(lambda);
+    pnw::xoshiro256ss_x4 rng(seed);
+
+    while (res.nevals + lambda <= max_evals) {
+        ++res.niters;
+
+        // Sample x_k = m + sigma * B * D * z_k.
+        rng.fill_normal(Z.data(), Z.size());
+        for (size_t k = 0; k < lambda; ++k) {
+            const T* z = &Z[k*n];
+            T* y = &Y[k*n];
+            T* x = &X[k*n];
+            for (size_t i = 0; i < n; ++i) {
+                T s = 0;
+                for (size_t j = 0; j < n; ++j) { s += B[i*n+j] * D[j] * z[j]; }
+                y[i] = s;
+                x[i] = m[i] + sigma * s;
+                if (lower) { x[i] = std::max(lower[i], x[i]); }
+                if (upper) { x[i] = std::min(upper[i], x[i]); }
+            }
+        }
+        fn(X.data(), lambda, n, f.data());
+        res.nevals += lambda;
+        for (size_t k = 0; k < lambda; ++k) { res.offer(&X[k*n], n, f[k]); }
+
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [&f](size_t a, size_t b) { return f[a] < f[b]; });
+
+        // Recombine mean from the mu best (clamped) points.
+        mold = m;
+        std::fill(m.begin(), m.end(), 0);
+        for (size_t r = 0; r < mu; ++r) {
+            const T* x = &X[order[r]*n];
+            for (size_t i = 0; i < n; ++i) { m[i] += w[r] * x[i]; }
+        }
+
+        // Step in sampling space and its whitened version C^-1/2 * ymean.
+        std::vector<T> ymean(n);
+        for (size_t i = 0; i < n; ++i) { ymean[i] = (m[i] - mold[i]) / sigma; }
+        for (size_t j = 0; j < n; ++j) {
+            T s = 0;
+            for (size_t i = 0; i < n; ++i) { s += B[i*n+j] * ymean[i]; }
+            tmp[j] = s / D[j];
+        }
+        const T csn = std::sqrt(cs * (2 - cs) * mueff);
+        for (size_t i = 0; i < n; ++i) {
+            T s = 0;
+            for (size_t j = 0; j < n; ++j) { s += B[i*n+j] * tmp[j]; }
+            ps[i] = (1 - cs) * ps[i] + csn * s;
+        }
+        const T psn = std::sqrt(std::inner_product(ps.begin(), ps.end(), ps.begin(), static_cast<T>(0)));
+        const T gen = static_cast<T>(res.niters);
+        const bool hsig = psn / std::sqrt(1 - std::pow(1 - cs, 2 * gen)) / chiN < 1.4 + 2 / (N + 1);
+        const T ccn = std::sqrt(cc * (2 - cc) * mueff);
+        for (size_t i = 0; i < n; ++i) { pc[i] = (1 - cc) * pc[i] + (hsig ? ccn * ymean[i] : 0); }
+
+        // Rank-one and rank-mu covariance update.
+        const T dh = (1 - hsig) * cc * (2 - cc);
+        for (size_t i = 0; i < n; ++i) {
+            for (size_t j = 0; j <= i; ++j) {
+                T rmu = 0;
+                for (size_t r = 0; r < mu; ++r) {
+                    const T* x = &X[order[r]*n];
+                    rmu += w[r] * (x[i] - mold[i]) * (x[j] - mold[j]);
+                }
+                rmu /= sigma * sigma;
+                const T c = (1 - c1 - cmu) * C[i*n+j] + c1 * (pc[i]*pc[j] + dh * C[i*n+j]) + cmu * rmu;
+                C[i*n+j] = C[j*n+i] = c;
+            }
+        }
+
+        sigma *= std::exp((cs / damps) * (psn / chiN - 1));
+
+        // Lazy eigendecomposition, about every n/10 generations of evaluations.
+        if (res.nevals - eigen_evals > lambda / (c1 + cmu) / N / 10) {
+            eigen_evals = res.nevals;
+            Ctmp = C;
+            pnw::opt::jacobi_eigen(Ctmp.data(), n, D.data(), B.data());
+            for (auto& di : D) { di = std::sqrt(std::max(di, std::numeric_limits<T>::min())); }
+        }
+
+        if (sigma * *std::max_element(D.begin(), D.end()) < tol) { break; }
+    }
+    return res;
+}
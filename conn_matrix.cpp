@@ -0,0 +1,142 @@
+#include "conn_matrix.hpp"
+
+namespace
+{
+
+/// Call \p f(j) for each set bit j in the \p nw words at \p w.
+template<class F>
+inline void for_each_bit(const bit_matrix::word_type* w, size_t nw, F f)
+{
+    for (size_t k = 0; k < nw; k++)
+    {
+        for (bit_matrix::word_type x = w[k]; x; x &= x - 1)
+        {
+            f(k * 64 + __builtin_ctzll(x));
+        }
+    }
+}
+
+}
+
+void conn_matrix::transitive_closure()
+{
+    const size_t n = n_rows();
+    const size_t none = static_cast<size_t>(-1);
+
+    // Iterative Tarjan. Components are emitted in reverse topological order.
+    std::vector<size_t> index(n, none), low(n), comp(n, none);
+    std::vector<size_t> stack;  // Tarjan node stack
+    std::vector<size_t> order;  // nodes grouped by component, sinks first
+    std::vector<size_t> comp_beg; // start of each component in \c order
+    struct Frame { size_t v; size_t k; word_type rest; };
+    std::vector<Frame> call;
+    size_t next_index = 0;
+
+    for (size_t s = 0; s < n; s++)
+    {
+        if (index[s] != none) { continue; }
+        call.push_back(Frame{s, 0, nwords ? row_words(s)[0] : 0});
+        index[s] = low[s] = next_index++;
+        stack.push_back(s);
+        while (not call.empty())
+        {
+            Frame& f = call.back();
+            const size_t v = f.v;
+            // Find next successor of v.
+            while (not f.rest and ++f.k < nwords) { f.rest = row_words(v)[f.k]; }
+            if (f.rest)
+            {
+                const size_t u = f.k * 64 + __builtin_ctzll(f.rest);
+                f.rest &= f.rest - 1;
+                if (index[u] == none)
+                {
+                    index[u] = low[u] = next_index++;
+                    stack.push_back(u);
+                    call.push_back(Frame{u, 0, row_words(u)[0]}); // invalidates f
+                }
+                else if (comp[u] == none) // u on stack
+                {
+                    low[v] = std::min(low[v], index[u]);
+                }
+                continue;
+            }
+            // v is finished.
+            if (low[v] == index[v])
+            {
+                const size_t c = comp_beg.size();
+                comp_beg.push_back(order.size());
+                size_t u;
+                do
+                {
+                    u = stack.back(); stack.pop_back();
+                    comp[u] = c;
+                    order.push_back(u);
+                } while (u != v);
+            }
+            call.pop_back();
+            if (not call.empty())
+            {
+                const size_t p = call.back().v;
+                low[p] = std::min(low[p], low[v]);
+            }
+        }
+    }
+    comp_beg.push_back(order.size());
+
+    // Sinks first: successors' rows in other components are already closed.
+    std::vector<word_type> reach(nwords);
+    std::vector<size_t> seen(comp_beg.size(), none); // last component that merged it
+    for (size_t c = 0; c + 1 < comp_beg.size(); c++)
+    {
+        const size_t* mem = &order[comp_beg[c]];
+        const size_t nmem = comp_beg[c + 1] - comp_beg[c];
+
+        std::fill(reach.begin(), reach.end(), 0);
+        for (size_t i = 0; i < nmem; i++)
+        {
+            pnw::bitwords::ip_or_n(reach.data(), row_words(mem[i]), nwords);
+        }
+        std::vector<word_type> direct(reach); // iterate over a copy as reach grows
+        for_each_bit(direct.data(), nwords, [&](size_t u) {
+                const size_t cu = comp[u];
+                if (cu != c and seen[cu] != c)
+                {
+                    seen[cu] = c;
+                    pnw::bitwords::ip_or_n(reach.data(), row_words(u), nwords);
+                }
+            });
+        if (nmem > 1)           // cycle: all members reach each other
+        {
+            for (size_t i = 0; i < nmem; i++)
+            {
+                reach[mem[i] / 64] |= bit_of(mem[i]);
+            }
+        }
+        for (size_t i = 0; i < nmem; i++)
+        {
+            std::copy(reach.begin(), reach.end(), row_words(mem[i]));
+        }
+    }
+}
+
+std::vector<conn_matrix::word_type> conn_matrix::reachable_from(size_t src) const
+{
+    std::vector<word_type> visited(nwords, 0);
+    std::vector<word_type> frontier(row_words(src), row_words(src) + nwords);
+    std::vector<word_type> next(nwords);
+    pnw::bitwords::ip_or_n(visited.data(), frontier.data(), nwords);
+    while (pnw::bitwords::any_n(frontier.data(), nwords))
+    {
+        std::fill(next.begin(), next.end(), 0);
+        for_each_bit(frontier.data(), nwords, [&](size_t u) {
+                pnw::bitwords::ip_or_n(next.data(), row_words(u), nwords);
+            });
+        for (size_t k = 0; k < nwords; k++)
+        {
+            next[k] &= ~visited[k];
+            visited[k] |= next[k];
+        }
+        frontier.swap(next);
+    }
+    return visited;
+}
@@ -8,6 +8,8 @@
 #include "algorithm_x.hpp"
 
 /*! Connectivity Matrix
+ *
+ * Row \c i is the set of nodes having an edge from node \c i.
  */
 class conn_matrix : public bit_matrix {
 public:
@@ -20,11 +22,35 @@ public:
     /// Resize matrix to m rows and m columns.
     void resize(size_t m)
     {
-	nrows = m;
-	ncols = m;
-	data.resize(m * m);
+        bit_matrix::resize(m, m);
     }
 
     /// Return true if matrix is a square matrix.
     bool is_square() const { return true; }
+
+    /*!
+     * Replace matrix by its \em Transitive Closure, that is set (i,j) if and
+     * only if there is a path of length one or more from i to j.
+     *
+     * The strongly connected components are found first (Tarjan). The
+     * components are then visited sinks first so that each reach row is the
+     * word-parallel union of its successors' already finished rows. Cost is
+     * O(n^2/64 + e*n/64) with e the number of edges between components.
+     */
+    void transitive_closure();
+
+    /*!
+     * Get the set of nodes reachable from \p src (excluding \p src itself
+     * unless it lies on a cycle) as a row of n_row_words() words.
+     *
+     * Breadth-first search over whole frontier words.
+     */
+    std::vector<word_type> reachable_from(size_t src) const;
+
+    /// Return true if node \p dst is reachable from \p src.
+    bool is_reachable(size_t src, size_t dst) const
+    {
+        const std::vector<word_type> r = reachable_from(src);
+        return (r[dst / 64] & bit_of(dst)) != 0;
+    }
 };
@@ -2,72 +2,420 @@
  * \file convolve.hpp
  * \brief Convolution or Polynomial Multiplication.
  * \author Copyright (C) 2012 Per Nordlöw (per.nordlow@gmail.com)
+ *
+ * convolve() picks the algorithm from the operand sizes and element type:
+ * - direct, O(n*m), for short operands, as axpy rows that vectorize,
+ * - Karatsuba, O(n^1.58), for mid sizes and for all integer types,
+ * - FFT, O(n*log(n)), for long floating point operands, overlap-save when
+ *   one operand is much shorter than the other.
+ *
+ * convolve2d() maps 2-D to 1-D convolution by padding rows, and
+ * convolve_ntt() multiplies exactly over the integers by number theoretic
+ * transforms, for big-integer multiplication.
  */
 
 #pragma once
 
 #include <algorithm>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+#include "rfft.hpp"
 
-/*! Convolution or polynomial multiplication.
- * Length of out must be at least n1 + n2 - 1.
+namespace pnw
+{
+
+/*!
+ * Overlap-Save FFT Convolution with a fixed kernel.
+ *
+ * For a kernel of length \c m the direct loops above cost O(m) per output
+ * sample while this costs O(log(N)) with FFT size N = pow2_ceil(block + m - 1).
+ * The kernel spectrum is computed once at construction.
  */
-template<typename T>
-void convolve(T * out, const T * in1, const T * in2,
-              int n1, int n2)
+template<class T>
+class fft_convolver {
+public:
+    /// Convolver for kernel \p h of length \p m, producing at least \p block outputs per call.
+    fft_convolver(const T* h, size_t m, size_t block = 0)
+        : m_m(std::max<size_t>(m, 1)),
+          m_plan(pow2_ceil(std::max<size_t>(block ? block + m_m - 1 : 2 * m_m, 4))),
+          m_H_re(m_plan.nbins()), m_H_im(m_plan.nbins()),
+          m_X_re(m_plan.nbins()), m_X_im(m_plan.nbins()),
+          m_t(m_plan.size()) {
+        std::fill(m_t.begin(), m_t.end(), T(0));
+        std::copy(h, h + m, m_t.begin());
+        m_plan.forward(m_t.data(), m_H_re.data(), m_H_im.data());
+    }
+
+    size_t kernel_size() const { return m_m; }
+    size_t fft_size() const { return m_plan.size(); }
+    /// Number of outputs per apply().
+    size_t block_size() const { return m_plan.size() - m_m + 1; }
+
+    /*! Convolve: \p x holds <tt>kernel_size()-1</tt> samples of history
+     * followed by block_size() new samples, and \p y receives the
+     * block_size() fully overlapped outputs aligned with the new samples.
+     */
+    void apply(const T* x, T* y) { apply(x, y, block_size()); }
+
+    /*! Convolve only \p n <= block_size() new samples. \p x still spans
+     * fft_size() samples, but those after the \p n new ones do not affect
+     * the \p n outputs in \p y, so a partly filled block may be passed.
+     */
+    void apply(const T* x, T* y, size_t n) {
+        const size_t K = m_plan.nbins();
+        m_plan.forward(x, m_X_re.data(), m_X_im.data());
+        T* __restrict xr = m_X_re.data();
+        T* __restrict xi = m_X_im.data();
+        const T* __restrict hr = m_H_re.data();
+        const T* __restrict hi = m_H_im.data();
+        for (size_t k = 0; k < K; k++) {
+            const T r = xr[k] * hr[k] - xi[k] * hi[k];
+            xi[k] = xr[k] * hi[k] + xi[k] * hr[k];
+            xr[k] = r;
+        }
+        m_plan.inverse(xr, xi, m_t.data());
+        std::copy(m_t.begin() + (m_m - 1), m_t.begin() + (m_m - 1 + n), y); // first m-1 are circularly aliased
+    }
+
+private:
+    size_t m_m;
+    rfft_plan<T> m_plan;
+    std::vector<T> m_H_re, m_H_im; ///< Kernel spectrum.
+    std::vector<T> m_X_re, m_X_im; ///< Block spectrum.
+    std::vector<T> m_t;            ///< Time-domain work buffer.
+};
+
+/* ---------------------------- Group Separator ---------------------------- */
+
+/*! Direct Convolution \p out = \p a * \p b of lengths \p na and \p nb.
+ * Length of out must be at least na + nb - 1.
+ */
+template<class T>
+void convolve_direct(T* out, const T* a, size_t na, const T* b, size_t nb)
+{
+    if (na < nb) { std::swap(a, b); std::swap(na, nb); } // longer rows vectorize better
+    std::fill(out, out + na + nb - 1, T(0));
+    for (size_t j = 0; j < nb; j++) {
+        const T bj = b[j];
+        T* __restrict o = out + j;
+        const T* __restrict x = a;
+        for (size_t i = 0; i < na; i++) { o[i] += bj * x[i]; }
+    }
+}
+
+/// Operand length below which Karatsuba falls back to the direct loops.
+const size_t karatsuba_min = 256;
+
+/*! Karatsuba product of \p a and \p b both of length \p n into the
+ * <tt>2n-1</tt> elements of \p out, using \p tmp of at least 8n elements.
+ */
+template<class T>
+void karatsuba_square(T* out, const T* a, const T* b, size_t n, T* tmp)
+{
+    if (n < karatsuba_min) { convolve_direct(out, a, n, b, n); return; }
+    const size_t h = n / 2, k = n - h; // a = a0 + a1*x^h, |a0| = h, |a1| = k
+    karatsuba_square(out, a, b, h, tmp);                     // z0 at [0, 2h-1)
+    out[2*h - 1] = 0;
+    karatsuba_square(out + 2*h, a + h, b + h, k, tmp);       // z2 at [2h, 2n-1)
+    T* sa = tmp;
+    T* sb = tmp + k;
+    T* z1 = tmp + 2*k;
+    for (size_t i = 0; i < k; i++) {
+        sa[i] = a[h + i] + (i < h ? a[i] : T(0));
+        sb[i] = b[h + i] + (i < h ? b[i] : T(0));
+    }
+    karatsuba_square(z1, sa, sb, k, tmp + 4*k);              // (a0+a1)(b0+b1)
+    for (size_t i = 0; i < 2*h - 1; i++) { z1[i] -= out[i]; }
+    for (size_t i = 0; i < 2*k - 1; i++) { z1[i] -= out[2*h + i]; }
+    for (size_t i = 0; i < 2*k - 1; i++) { out[h + i] += z1[i]; }
+}
+
+/*! Karatsuba Convolution \p out = \p a * \p b of lengths \p na and \p nb.
+ * The longer operand is cut into blocks of the shorter one's length.
+ */
+template<class T>
+void convolve_karatsuba(T* out, const T* a, size_t na, const T* b, size_t nb)
+{
+    if (na < nb) { std::swap(a, b); std::swap(na, nb); }
+    std::fill(out, out + na + nb - 1, T(0));
+    std::vector<T> blk(nb), prod(2*nb - 1), tmp(8*nb + 64);
+    for (size_t i = 0; i < na; i += nb) {
+        const size_t k = std::min(nb, na - i);
+        std::copy(a + i, a + i + k, blk.begin());
+        std::fill(blk.begin() + k, blk.end(), T(0));
+        karatsuba_square(prod.data(), blk.data(), b, nb, tmp.data());
+        const size_t np = std::min(2*nb - 1, na + nb - 1 - i);
+        for (size_t j = 0; j < np; j++) { out[i + j] += prod[j]; }
+    }
+}
+
+/*! FFT Convolution \p out = \p a * \p b of lengths \p na and \p nb.
+ * Uses one transform of size pow2_ceil(na + nb - 1), or overlap-save with
+ * fft_convolver when one operand is more than eight times longer.
+ */
+template<class T>
+void convolve_fft(T* out, const T* a, size_t na, const T* b, size_t nb)
+{
+    if (na < nb) { std::swap(a, b); std::swap(na, nb); }
+    const size_t n = na + nb - 1;
+    if (na > 8 * nb) {
+        fft_convolver<T> conv(b, nb, 8 * nb);
+        const size_t B = conv.block_size(), H = nb - 1;
+        std::vector<T> x(H + B), y(B);
+        for (size_t o = 0; o < n; o += B) { // x = the H samples before o, then B from o
+            for (size_t i = 0; i < H + B; i++) {
+                const size_t s = o + i;     // index into a shifted by H
+                x[i] = (s >= H && s - H < na) ? a[s - H] : T(0);
+            }
+            conv.apply(x.data(), y.data());
+            std::copy(y.begin(), y.begin() + std::min(B, n - o), out + o);
+        }
+        return;
+    }
+    rfft_plan<T> plan(pow2_ceil(std::max<size_t>(n, 4)));
+    const size_t N = plan.size(), K = plan.nbins();
+    std::vector<T> t(N, T(0)), A_re(K), A_im(K), B_re(K), B_im(K);
+    std::copy(a, a + na, t.begin());
+    plan.forward(t.data(), A_re.data(), A_im.data());
+    std::fill(t.begin(), t.end(), T(0));
+    std::copy(b, b + nb, t.begin());
+    plan.forward(t.data(), B_re.data(), B_im.data());
+    for (size_t k = 0; k < K; k++) {
+        const T r = A_re[k] * B_re[k] - A_im[k] * B_im[k];
+        A_im[k] = A_re[k] * B_im[k] + A_im[k] * B_re[k];
+        A_re[k] = r;
+    }
+    plan.inverse(A_re.data(), A_im.data(), t.data());
+    std::copy(t.begin(), t.begin() + n, out);
+}
+
+/*! Convolution or Polynomial Multiplication \p out = \p a * \p b, with
+ * the algorithm chosen from the operand lengths. Integer types never take
+ * the inexact FFT path.
+ * Length of out must be at least na + nb - 1.
+ */
+template<class T>
+void convolve(T* out, const T* a, size_t na, const T* b, size_t nb)
+{
+    if (na == 0 || nb == 0) { return; }
+    const size_t m = std::min(na, nb);
+    if (m < 384) {
+        convolve_direct(out, a, na, b, nb);
+    } else if (!std::is_floating_point<T>::value || m < 4096) {
+        convolve_karatsuba(out, a, na, b, nb);
+    } else {
+        convolve_fft(out, a, na, b, nb);
+    }
+}
+
+/*! Direct 2-D Convolution of row-major \p a of \p ha x \p wa and \p b of
+ * \p hb x \p wb into the <tt>(ha+hb-1) x (wa+wb-1)</tt> row-major \p out,
+ * in ha*wa*hb*wb multiply-adds along the rows of the larger operand.
+ */
+template<class T>
+void convolve2d_direct(T* out, const T* a, size_t ha, size_t wa, const T* b, size_t hb, size_t wb)
 {
-    /* Make in1 the larger vector with length n1
-       and  in2 the shorter vector with length n2. */
-    if (n1 < n2)
-    {
-        std::swap(in1, in2);
-        std::swap(n1, n2);
-    }
-
-    int o = 0;                  // reset out index
-
-    for (int m = 1; m < n2; m++, o++)
-    {
-        out[o] = 0;
-        for (int j = 0; j < m; j++) // if n2 > 1
-        {
-            out[o] += in1[j] * in2[m - 1 - j];
+    if (ha * wa < hb * wb) { std::swap(a, b); std::swap(ha, hb); std::swap(wa, wb); }
+    const size_t W = wa + wb - 1;
+    std::fill(out, out + (ha + hb - 1) * W, T(0));
+    for (size_t k = 0; k < hb; k++) {
+        for (size_t l = 0; l < wb; l++) {
+            const T bkl = b[k * wb + l];
+            for (size_t i = 0; i < ha; i++) {
+                T* __restrict o = out + (i + k) * W + l;
+                const T* __restrict x = a + i * wa;
+                for (size_t j = 0; j < wa; j++) { o[j] += bkl * x[j]; }
+            }
         }
     }
+}
+
+/*! 2-D Convolution of row-major \p a of \p ha x \p wa and \p b of \p hb x
+ * \p wb into the <tt>(ha+hb-1) x (wa+wb-1)</tt> row-major \p out.
+ *
+ * Small kernels are convolved directly. Otherwise rows are padded to the
+ * output width \c W, which makes the 2-D product equal to the 1-D one of
+ * the flattened arrays, so convolve() picks the algorithm.
+ */
+template<class T>
+void convolve2d(T* out, const T* a, size_t ha, size_t wa, const T* b, size_t hb, size_t wb)
+{
+    if (!ha || !wa || !hb || !wb) { return; }
+    if (std::min(ha * wa, hb * wb) < 384) { // as in convolve()
+        convolve2d_direct(out, a, ha, wa, b, hb, wb);
+        return;
+    }
+    const size_t W = wa + wb - 1;
+    std::vector<T> pa((ha - 1) * W + wa, T(0)), pb((hb - 1) * W + wb, T(0));
+    for (size_t r = 0; r < ha; r++) { std::copy(a + r * wa, a + (r + 1) * wa, pa.begin() + r * W); }
+    for (size_t r = 0; r < hb; r++) { std::copy(b + r * wb, b + (r + 1) * wb, pb.begin() + r * W); }
+    convolve(out, pa.data(), pa.size(), pb.data(), pb.size()); // (ha+hb-1)*W outputs
+}
+
+/* ---------------------------- Group Separator ---------------------------- */
+
+/*!
+ * Number Theoretic Transform modulo the prime \c p = c*2^k + 1 < 2^30,
+ * in Montgomery form with R = 2^32.
+ */
+class ntt_prime {
+public:
+    ntt_prime(uint32_t p, uint32_t g) : m_p(p), m_g(g) {
+        uint32_t inv = p;       // Newton iteration for p^-1 mod 2^32
+        for (int i = 0; i < 4; i++) { inv *= 2 - p * inv; }
+        m_pinv = -inv;
+        const uint64_t r = (uint64_t(1) << 32) % p;
+        m_r2 = uint32_t(r * r % p);
+    }
 
-    for (int m = 0; m <= n1 - n2 ; m++ , o++)
-    {
-        out [o] = 0;
-        // \todo FLIp in2 and call normal dot which can be reused.
-        for (int j = 0; j < n2; j++) // Always
-        {
-            out [o] += in1 [m + j] * in2 [n2 - 1 - j];
+    uint32_t prime() const { return m_p; }
+
+    uint32_t reduce(uint64_t x) const { // x * R^-1 mod p, for x < p * 2^32
+        const uint32_t m = uint32_t(x) * m_pinv;
+        const uint32_t t = uint32_t((x + uint64_t(m) * m_p) >> 32);
+        return t >= m_p ? t - m_p : t;
+    }
+    uint32_t mul(uint32_t a, uint32_t b) const { return reduce(uint64_t(a) * b); }
+    uint32_t to_mont(uint32_t a) const { return mul(a % m_p, m_r2); }
+    uint32_t from_mont(uint32_t a) const { return reduce(a); }
+    uint32_t pow(uint32_t a, uint64_t e) const { // a in Montgomery form
+        uint32_t r = to_mont(1);
+        for (; e; e >>= 1, a = mul(a, a)) { if (e & 1) { r = mul(r, a); } }
+        return r;
+    }
+
+    /// In-place transform of the Montgomery form \p x of power of two length \p n.
+    void transform(uint32_t* x, size_t n, bool inv) const {
+        for (size_t i = 1, j = 0; i < n; i++) { // bit reversal
+            size_t bit = n >> 1;
+            for (; j & bit; bit >>= 1) { j ^= bit; }
+            j ^= bit;
+            if (i < j) { std::swap(x[i], x[j]); }
+        }
+        std::vector<uint32_t> w(n / 2 + 1);
+        const uint32_t p = m_p;
+        for (size_t h = 1; h < n; h *= 2) {
+            uint32_t wl = pow(to_mont(m_g), (p - 1) / (2 * h));
+            if (inv) { wl = pow(wl, p - 2); }
+            w[0] = to_mont(1);
+            for (size_t j = 1; j < h; j++) { w[j] = mul(w[j - 1], wl); }
+            for (size_t i = 0; i < n; i += 2 * h) {
+                uint32_t* __restrict u = x + i;
+                uint32_t* __restrict v = x + i + h;
+                for (size_t j = 0; j < h; j++) {
+                    const uint32_t a = u[j], b = mul(v[j], w[j]);
+                    const uint32_t s = a + b, d = a + p - b;
+                    u[j] = s >= p ? s - p : s;
+                    v[j] = d >= p ? d - p : d;
+                }
+            }
+        }
+        if (inv) {
+            const uint32_t ninv = pow(to_mont(uint32_t(n % p)), p - 2);
+            for (size_t i = 0; i < n; i++) { x[i] = mul(x[i], ninv); }
         }
     }
 
-    for (int m = n2 - 1; m >= 1; m--, o++)
-    {
-        out[o] = 0;
-        for (int j = 0; j < m; j++) // if n2 > 1
-        {
-            out[o] += in1[n1 - m + j] * in2[n2 - 1 - j];
+    /// Cyclic convolution modulo prime() of \p a and \p b, both zero-padded to length \p n.
+    std::vector<uint32_t> convolve(const uint32_t* a, size_t na, const uint32_t* b, size_t nb, size_t n) const {
+        std::vector<uint32_t> fa(n, 0), fb(n, 0);
+        for (size_t i = 0; i < na; i++) { fa[i] = to_mont(a[i]); }
+        for (size_t i = 0; i < nb; i++) { fb[i] = to_mont(b[i]); }
+        transform(fa.data(), n, false);
+        transform(fb.data(), n, false);
+        for (size_t i = 0; i < n; i++) { fa[i] = mul(fa[i], fb[i]); }
+        transform(fa.data(), n, true);
+        for (size_t i = 0; i < n; i++) { fa[i] = from_mont(fa[i]); }
+        return fa;
+    }
+
+private:
+    uint32_t m_p, m_g, m_pinv, m_r2;
+};
+
+/*! Exact Convolution of non-negative integers \p out = \p a * \p b.
+ *
+ * Transforms modulo the primes 998244353 and 469762049 and joins them by
+ * the Chinese remainder theorem, so every output must be below their
+ * product, about 2^58.7, for instance 16-bit digits with min(na, nb) < 2^26.
+ * 998244353 = 119*2^23 + 1 only has roots of unity up to order 2^23, so
+ * products longer than that are summed from products of 2^22 long blocks.
+ * Length of out must be at least na + nb - 1.
+ */
+inline void convolve_ntt(uint64_t* out, const uint32_t* a, size_t na, const uint32_t* b, size_t nb)
+{
+    if (na == 0 || nb == 0) { return; }
+    const size_t n = na + nb - 1, N = pow2_ceil(n);
+    const size_t NMAX = size_t(1) << 23; // longest transform of both primes
+    if (N > NMAX) {
+        const size_t S = NMAX / 2;
+        std::fill(out, out + n, 0);
+        std::vector<uint64_t> part(2 * S - 1);
+        for (size_t i = 0; i < na; i += S) {
+            for (size_t j = 0; j < nb; j += S) {
+                const size_t la = std::min(S, na - i), lb = std::min(S, nb - j);
+                convolve_ntt(part.data(), a + i, la, b + j, lb);
+                for (size_t k = 0; k < la + lb - 1; k++) { out[i + j + k] += part[k]; }
+            }
         }
+        return;
     }
+    const ntt_prime P1(998244353, 3), P2(469762049, 3);
+    const std::vector<uint32_t> r1 = P1.convolve(a, na, b, nb, N);
+    const std::vector<uint32_t> r2 = P2.convolve(a, na, b, nb, N);
+    const uint64_t p1 = P1.prime(), p2 = P2.prime();
+    const uint32_t p1inv = P2.from_mont(P2.pow(P2.to_mont(uint32_t(p1 % p2)), p2 - 2)); // p1^-1 mod p2
+    for (size_t i = 0; i < n; i++) { // Garner: x = r1 + p1*((r2 - r1)*p1^-1 mod p2)
+        const uint64_t d = (r2[i] + p2 - r1[i] % p2) % p2;
+        out[i] = r1[i] + p1 * (d * p1inv % p2);
+    }
+}
+
+/*! Multiply the natural numbers \p a and \p b given as little-endian
+ * digits in \p base <= 2^16 into the <tt>na+nb</tt> digits of \p out.
+ */
+inline void multiply_digits(uint32_t* out, const uint32_t* a, size_t na, const uint32_t* b, size_t nb,
+                            uint32_t base)
+{
+    if (na == 0 || nb == 0) { std::fill(out, out + na + nb, 0); return; }
+    std::vector<uint64_t> c(na + nb - 1);
+    convolve_ntt(c.data(), a, na, b, nb);
+    uint64_t carry = 0;
+    for (size_t i = 0; i < na + nb - 1; i++) {
+        const uint64_t v = c[i] + carry;
+        out[i] = uint32_t(v % base);
+        carry = v / base;
+    }
+    out[na + nb - 1] = uint32_t(carry);
+}
+
+}
+
+/* ---------------------------- Group Separator ---------------------------- */
+
+/*! Convolution or polynomial multiplication.
+ * Length of out must be at least n1 + n2 - 1.
+ */
+template<typename T>
+void convolve(T * out, const T * in1, const T * in2,
+              int n1, int n2)
+{
+    pnw::convolve(out, in1, n1, in2, n2);
 }
 
-/*! Convolution or Polynomial Multiplication.
- * \todo We could reuse convolve...
+/*! 2-D Convolution of \p in1 of \p h1 rows by \p w1 columns and \p in2 of
+ * \p h2 by \p w2 into the <tt>(h1+h2-1)</tt> rows of <tt>(w1+w2-1)</tt>
+ * columns of \p out.
  */
 template<typename T>
 void convolve(T **out, const T **in1, const T **in2,
               int w1, int h1, int w2, int h2)
 {
-    /* Make in1 the larger matrix with lengths w1 and h1
-       and  in2 the shorter matrix with lengths w2 and h2. */
-    if (w1 * h1 < w2 * h2)
-    {
-        std::swap(in1, in2);
-        std::swap(w1, w2);
-        std::swap(h1, h2);
-    }
-    // \todo ...
+    std::vector<T> a(w1 * h1), b(w2 * h2), c((w1 + w2 - 1) * (h1 + h2 - 1));
+    for (int r = 0; r < h1; r++) { std::copy(in1[r], in1[r] + w1, a.begin() + r * w1); }
+    for (int r = 0; r < h2; r++) { std::copy(in2[r], in2[r] + w2, b.begin() + r * w2); }
+    pnw::convolve2d(c.data(), a.data(), h1, w1, b.data(), h2, w2);
+    const int W = w1 + w2 - 1;
+    for (int r = 0; r < h1 + h2 - 1; r++) { std::copy(c.begin() + r * W, c.begin() + (r + 1) * W, out[r]); }
 }
@@ -0,0 +1,61 @@
+#include "elias_fano.h"
+#include "utils.h"
+
+#include <stdlib.h>
+
+void
+elias_fano_init(EliasFano * a, const uint64_t * x, size_t n, uint64_t u)
+{
+  a->n = n;
+  a->u = u;
+
+  /* lbits = floor(log2(u/n)) */
+  a->lbits = 0;
+  if (n && u / n > 1) { a->lbits = 63 - __builtin_clzll(u / n); }
+
+  const size_t lwnum = (n * a->lbits + 63) / 64 + 1; /* +1: unaligned reads in get */
+  a->low = (uint64_t*)calloc(lwnum, sizeof(uint64_t));
+
+  /* Upper parts: value i sets bit (x[i] >> lbits) + i. */
+  Bitvec hb;
+  bitvec_initZ(&hb, n + (u >> a->lbits) + 1);
+  const uint64_t lmask = a->lbits ? (((uint64_t)1 << a->lbits) - 1) : 0;
+  for (size_t i = 0; i < n; i++) {
+    bitvec_set1(&hb, (x[i] >> a->lbits) + i);
+    if (a->lbits) {
+      const size_t p = i * a->lbits, q = p / 64, r = p % 64;
+      const uint64_t lo = x[i] & lmask;
+      a->low[q] |= lo << r;
+      if (r + a->lbits > 64) { a->low[q + 1] |= lo >> (64 - r); }
+    }
+  }
+  bitvec_rs_init(&a->high, &hb);
+  bitvec_clear(&hb);
+}
+
+void
+elias_fano_clear(EliasFano * a)
+{
+  free(a->low); a->low = NULL;
+  bitvec_rs_clear(&a->high);
+  a->n = 0;
+}
+
+size_t
+elias_fano_bytesize(const EliasFano * a)
+{
+  return (sizeof(EliasFano) - sizeof(Bitvec_RS) +
+          ((a->n * a->lbits + 63) / 64 + 1) * sizeof(uint64_t) +
+          bitvec_rs_bytesize(&a->high));
+}
+
+size_t
+elias_fano_lower_bound(const EliasFano * a, uint64_t x)
+{
+  size_t lo = 0, hi = a->n;
+  while (lo < hi) {
+    const size_t mid = lo + (hi - lo) / 2;
+    if (elias_fano_get(a, mid) < x) { lo = mid + 1; } else { hi = mid; }
+  }
+  return lo;
+}
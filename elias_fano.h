@@ -0,0 +1,60 @@
+/*! \file elias_fano.h
+ * \brief Elias-Fano Encoding of Monotone Integer Sequences.
+ * \author Copyright (C) 2012 Per Nordlöw (per.nordlow@gmail.com)
+ *
+ * Stores \c n sorted values less than \c u in about 2 + log2(u/n) bits
+ * each. The lower \c lbits of each value are packed verbatim, the upper
+ * part is unary-coded in a Bitvec_RS so that random access is one
+ * \c select1.
+ *
+ * \see http://vigna.di.unimi.it/ftp/papers/QuasiSuccinctIndices.pdf
+ */
+
+#pragma once
+
+#include "bitvec_rs.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ========================================================================= */
+
+/*! Elias-Fano Encoded Sequence. */
+typedef struct EliasFano
+{
+  size_t n;                     /**< Number of values. */
+  uint64_t u;                   /**< Universe: all values are < u. */
+  uint lbits;                   /**< Number of explicitly stored low bits. */
+  uint64_t *low;                /**< Packed low bits. */
+  Bitvec_RS high;               /**< Unary-coded high parts. */
+} EliasFano;
+
+/*! Encode the \p n non-decreasing values \p x (all < \p u) into \p a. */
+void elias_fano_init(EliasFano * a, const uint64_t * x, size_t n, uint64_t u);
+
+/*! Release memory held by \p a. */
+void elias_fano_clear(EliasFano * a);
+
+/*! Get the number of bytes used by \p a. */
+size_t elias_fano_bytesize(const EliasFano * a);
+
+/*! Get the \p i:th value of \p a. */
+static inline uint64_t elias_fano_get(const EliasFano * a, size_t i)
+{
+  const uint64_t hi = bitvec_rs_select1(&a->high, i) - i;
+  if (!a->lbits) { return hi; }
+  const size_t p = i * a->lbits, q = p / 64, r = p % 64;
+  uint64_t lo = a->low[q] >> r;
+  if (r + a->lbits > 64) { lo |= a->low[q + 1] << (64 - r); }
+  return (hi << a->lbits) | (lo & (((uint64_t)1 << a->lbits) - 1));
+}
+
+/*! Get index of first value in \p a that is >= \p x, or \c a->n if none. */
+size_t elias_fano_lower_bound(const EliasFano * a, uint64_t x);
+
+/* ========================================================================= */
+
+#ifdef __cplusplus
+}
+#endif
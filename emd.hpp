@@ -1,194 +1,381 @@
-/*!
- * \file emd.hpp
- * \brief Empirical Mode Decomposition (EMD).
- * \author Copyright (C) 2012 Per Nordlöw (per.nordlow@gmail.com)
- *
- * Required paramters include:
- * - nF: the number of IMFs to return
- * - nI: the number of iterations per IMF
- * - locality: in samples, the nearest two extrema may be
- *
- * If it is not specified, there is no limit (locality = 0).
- *
- * Typical use consists of calling \c emd(), followed by
- * \c decompose(), and then using the struct's "imfs" field
- * to retrieve the data. Call \c emdclear() to deallocate memory
- * inside the struct.
- *
- * \see https://code.google.com/p/realtime-emd/e (Real Shit C Code!)
- * \todo MDL Stopping Criteria
- */
-
-#pragma once
-#include "interpolate.hpp"
-
-#define cnew(type, size) ((type*) malloc((size) * sizeof(type)))
-#define cdelete(ptr) free(ptr)
-
-/*!
- * Empirical Mode Decomposition (EMD).
- */
-template<class T>
-class emd {
-public:
-    void emd(size_t size, size_t nF, int nI, size_t locality) {
-        setup(nF, nI, locality);
-        resize(size);
-    }
-
-    void setup(size_t nF, int nI, size_t locality) {
-        m_nI = nI;
-        m_nF = nF;
-        m_locality = locality;
-        m_size = 0;
-        m_imfs = nullptr;
-        m_residue = nullptr;
-        m_minP = nullptr;
-        m_maxP = nullptr;
-        m_min = nullptr;
-        m_max = nullptr;
-    }
-
-    void resize(size_t size) {
-        size_t i;
-
-        clear(emd);
-
-        m_size = size;
-        m_imfs = cnew(T*, m_nF);
-        for(i = 0; i < m_nF; i++)
-            m_imfs[i] = cnew(T, size);
-        m_residue = cnew(T, size);
-        m_minP = cnew(size_t, size / 2);
-        m_maxP = cnew(size_t, size / 2);
-        m_min = cnew(T, size);
-        m_max = cnew(T, size);
-    }
-
-    void clear() {
-        if(m_imfs != nullptr) {
-            for(size_t i = 0; i < m_nF; i++)
-                cdelete(m_imfs[i]);
-            cdelete(m_imfs);
-            cdelete(m_minP);
-            cdelete(m_maxP);
-            cdelete(m_min);
-            cdelete(m_max);
-            cdelete(m_residue);
-        }
-    }
-
-    void decompose(const T* signal) {
-        memcpy(m_imfs[0], signal, m_size * sizeof(T));
-        memcpy(m_residue, signal, m_size * sizeof(T));
-        for(size_t i = 0; i < m_nF - 1; i++) {
-            T* curImf = m_imfs[i];
-            for(size_t j = 0; j < m_nI; j++) {
-                make_extremas(curImf);
-                if(m_minSize < 4 || m_maxSize < 4)
-                    break; // can't fit splines
-                interpolate(curImf, m_min, m_minP, m_minSize);
-                interpolate(curImf, m_max, m_maxP, m_maxSize);
-                update_imf(curImf);
-            }
-            make_residue(curImf);
-            memcpy(m_imfs[i + 1], m_residue, m_size * sizeof(T));
-        }
-    }
-
-    // Currently, extrema within (locality) of the boundaries are not allowed.
-    // A better algorithm might be to collect all the extrema, and then assume
-    // that extrema near the boundaries are valid, working toward the center.
-
-    void make_extremas(const T* curImf) {
-        size_t i, lastMin = 0, lastMax = 0;
-        m_minSize = 0;
-        m_maxSize = 0;
-        for(i = 1; i < m_size - 1; i++) {
-            if(curImf[i - 1] < curImf[i]) {
-                if(curImf[i] > curImf[i + 1] && (i - lastMax) > m_locality) {
-                    m_maxP[m_maxSize++] = i;
-                    lastMax = i;
-                }
-            } else {
-                if(curImf[i] < curImf[i + 1] && (i - lastMin) > m_locality) {
-                    m_minP[m_minSize++] = i;
-                    lastMin = i;
-                }
-            }
-        }
-    }
-
-    // Replace with my interpolate.hpp.
-    void interpolate(const T* in, T* out, size_t* points, size_t pointsSize) {
-        size_t size = m_size;
-        size_t i, j, i0, i1, i2, i3, start, end;
-        T a0, a1, a2, a3;
-        T y0, y1, y2, y3, muScale, mu;
-        for(i = -1; i < pointsSize; i++) {
-            i0 = points[mirror_index(i - 1, pointsSize)];
-            i1 = points[mirror_index(i, pointsSize)];
-            i2 = points[mirror_index(i + 1, pointsSize)];
-            i3 = points[mirror_index(i + 2, pointsSize)];
-
-            y0 = in[i0];
-            y1 = in[i1];
-            y2 = in[i2];
-            y3 = in[i3];
-
-            a0 = y3 - y2 - y0 + y1;
-            a1 = y0 - y1 - a0;
-            a2 = y2 - y0;
-            a3 = y1;
-
-            // left boundary
-            if(i == -1) {
-                start = 0;
-                i1 = -i1;
-            } else
-                start = i1;
-
-            // right boundary
-            if(i == pointsSize - 1) {
-                end = size;
-                i2 = size + size - i2;
-            } else
-                end = i2;
-
-            muScale = 1.f / (i2 - i1);
-            for(j = start; j < end; j++) {
-                mu = (j - i1) * muScale;
-                out[j] = ((a0 * mu + a1) * mu + a2) * mu + a3;
-            }
-        }
-    }
-
-    void update_imf(T* imf) {
-        size_t i;
-        for(i = 0; i < m_size; i++)
-            imf[i] -= (m_min[i] + m_max[i]) * .5f;
-    }
-
-    void make_residue(const T* cur) {
-        size_t i;
-        for(i = 0; i < m_size; i++)
-            m_residue[i] -= cur[i];
-    }
-
-    size_t mirror_index(size_t i, int size) {
-        if(i < size) {
-            if(i < 0)
-                return -i - 1;
-            return i;
-        }
-        return (size - 1) + (size - i);
-    }
-private:
-	size_t m_nI;                ///< Number of Iterations.
-	size_t m_nF;                ///< Number of Functions.
-	size_t m_locality;
-	size_t *m_minP;             ///< Minimas.
-	size_t *m_maxP;             ///< Maximums.
-	T *m_min, *m_max, **m_imfs, *m_residue;
-	size_t m_size, m_minSize, m_maxSize;
-};
+/*!
+ * \file emd.hpp
+ * \brief Empirical Mode Decomposition (EMD).
+ * \author Copyright (C) 2012 Per Nordlöw (per.nordlow@gmail.com)
+ *
+ * Required paramters include:
+ * - nF: the number of functions to return, the last one being the residue
+ * - nI: the (maximum) number of sifting iterations per IMF
+ * - locality: in samples, the nearest two extrema may be
+ *
+ * If it is not specified, there is no limit (locality = 0).
+ *
+ * Typical use consists of constructing an \c emd, calling \c decompose(),
+ * and then reading \c imf(i). All work memory is kept in the object and
+ * reused by later calls of the same or smaller size, so nothing is
+ * allocated inside the sifting loop.
+ *
+ * Sifting finds extrema with \c extrema() from peaks.hpp and fits natural
+ * cubic spline envelopes through them, mirrored at the signal ends, by
+ * solving their tridiagonal system directly (O(extrema) per envelope).
+ *
+ * \c eemd runs Ensemble EMD with members spread over threads, and
+ * \c emd_stream decomposes long recordings in overlapping windows.
+ *
+ * \see https://code.google.com/p/realtime-emd/e (Real Shit C Code!)
+ * \see Wu, Huang, "Ensemble Empirical Mode Decomposition", 2009
+ * \todo MDL Stopping Criteria
+ */
+
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include "peaks.hpp"
+#include "rand_streams.hpp"
+
+namespace pnw
+{
+
+/*!
+ * Empirical Mode Decomposition (EMD).
+ */
+template<class T>
+class emd {
+public:
+    /*! Construct for \p nF functions (nF-1 IMFs and residue), at most \p nI
+     * sifting iterations each.
+     *
+     * Sifting of an IMF stops early when the Cauchy-type standard deviation
+     * between two iterations falls below \p sd_tol (0 disables).
+     */
+    emd(size_t nF, size_t nI, size_t locality = 0, T sd_tol = 0)
+        : m_nF(std::max<size_t>(nF, 1)), m_nI(nI), m_locality(locality), m_sd_tol(sd_tol) {}
+
+    /// Reserve work memory for signals of up to \p size samples.
+    void resize(size_t size) {
+        if (size == m_size) { return; }
+        m_size = size;
+        m_imfs.resize(m_nF * size);
+        m_maxP.resize(size / 2 + 1);
+        m_minP.resize(size / 2 + 1);
+        m_kt.resize(size / 2 + 5);
+        m_ky.resize(size / 2 + 5);
+        m_M.resize(size / 2 + 5);
+        m_cp.resize(size / 2 + 5);
+        m_env.resize(size);
+        m_lo.resize(size);
+    }
+
+    /*! Decompose \p n samples of \p signal.
+     *
+     * IMFs sum exactly (up to rounding) to \p signal. When the remainder
+     * has too few extrema to be sifted further, the remaining IMFs are zero.
+     */
+    void decompose(const T* signal, size_t n) {
+        resize(n);
+        m_nimfs = 0;
+        T* res = imf(m_nF - 1);
+        std::copy(signal, signal + n, res);
+        for (size_t i = 0; i + 1 < m_nF; i++) {
+            T* cur = imf(i);
+            std::copy(res, res + n, cur);
+            if (!make_extremas(cur)) {
+                std::fill(cur, cur + n, T(0));
+                continue;
+            }
+            for (size_t j = 0; j < m_nI; j++) {
+                if (j && !make_extremas(cur)) { break; } // can't fit splines
+                envelope(cur, m_maxP.data(), m_maxSize, m_env.data());
+                const T sd = update_imf(cur);
+                if (sd < m_sd_tol) { break; }
+            }
+            for (size_t k = 0; k < n; k++) { res[k] -= cur[k]; }
+            m_nimfs++;
+        }
+    }
+
+    /// Function \p i, where <tt>i == nfuns()-1</tt> is the residue.
+    T* imf(size_t i) { return m_imfs.data() + i * m_size; }
+    const T* imf(size_t i) const { return m_imfs.data() + i * m_size; }
+    const T* residue() const { return imf(m_nF - 1); }
+
+    size_t size() const { return m_size; }     ///< Signal length of last decompose().
+    size_t nfuns() const { return m_nF; }      ///< Number of functions including residue.
+    size_t nimfs() const { return m_nimfs; }   ///< Number of nonzero IMFs of last decompose().
+
+private:
+    /*! Find extrema of \p cur and thin them to \c m_locality.
+     * \return true if there are enough on both sides to fit envelopes.
+     */
+    bool make_extremas(const T* cur) {
+        extrema(cur, m_size, m_maxP.data(), m_maxSize, m_minP.data(), m_minSize);
+        if (m_locality) {
+            m_maxSize = thin(m_maxP.data(), m_maxSize);
+            m_minSize = thin(m_minP.data(), m_minSize);
+        }
+        return m_maxSize >= 2 and m_minSize >= 2;
+    }
+
+    /// Drop extrema closer than \c m_locality to the previous one kept, always keeping the first.
+    size_t thin(size_t* p, size_t np) const {
+        if (np == 0) { return 0; }
+        size_t m = 1;
+        for (size_t k = 1; k < np; k++) {
+            if (p[k] - p[m-1] > m_locality) { p[m++] = p[k]; }
+        }
+        return m;
+    }
+
+    /*! Evaluate natural cubic spline through \p np points \c in[points[k]]
+     * at all \c m_size sample indexes into \p out.
+     *
+     * The two outermost points at each end are mirrored around the signal
+     * boundaries to tame end effects.
+     */
+    void envelope(const T* in, const size_t* points, size_t np, T* out) {
+        const size_t n = m_size;
+        const T last = static_cast<T>(n - 1);
+        T* t = m_kt.data();
+        T* y = m_ky.data();
+        size_t k = 0;
+        t[k] = -T(points[1]); y[k++] = in[points[1]];
+        t[k] = -T(points[0]); y[k++] = in[points[0]];
+        for (size_t i = 0; i < np; i++) { t[k] = T(points[i]); y[k++] = in[points[i]]; }
+        t[k] = 2*last - T(points[np-1]); y[k++] = in[points[np-1]];
+        t[k] = 2*last - T(points[np-2]); y[k++] = in[points[np-2]];
+        solve_natural(t, y, k, m_M.data());
+        eval(t, y, k, m_M.data(), out);
+    }
+
+    /*! Second derivatives \p M of natural cubic spline through (\p t, \p y)
+     * by forward elimination and back substitution (Thomas algorithm).
+     */
+    void solve_natural(const T* t, const T* y, size_t k, T* M) {
+        T* cp = m_cp.data();
+        M[0] = 0; cp[0] = 0;
+        T hp = t[1] - t[0], sp = (y[1] - y[0]) / hp;
+        for (size_t i = 1; i + 1 < k; i++) {
+            const T h = t[i+1] - t[i], s = (y[i+1] - y[i]) / h;
+            const T den = 2*(hp + h) - hp * cp[i-1];
+            cp[i] = h / den;
+            M[i] = (6*(s - sp) - hp * M[i-1]) / den;
+            hp = h; sp = s;
+        }
+        M[k-1] = 0;
+        for (size_t i = k - 2; i >= 1; i--) { M[i] -= cp[i] * M[i+1]; }
+    }
+
+    /// Evaluate spline at 0...m_size-1, one knot interval at a time.
+    void eval(const T* t, const T* y, size_t k, const T* M, T* out) const {
+        const size_t n = m_size;
+        size_t j = 0;
+        for (size_t i = 0; i + 1 < k and j < n; i++) {
+            const T h = t[i+1] - t[i];
+            const T b = (y[i+1] - y[i]) / h - h * (2*M[i] + M[i+1]) / 6;
+            const T c = M[i] / 2;
+            const T d = (M[i+1] - M[i]) / (6*h);
+            const T a = y[i], t0 = t[i];
+            const size_t end = (i + 2 == k) ? n : std::min<size_t>(n, static_cast<size_t>(std::max<T>(t[i+1], 0)));
+            for (; j < end; j++) {
+                const T dx = T(j) - t0;
+                out[j] = ((d * dx + c) * dx + b) * dx + a;
+            }
+        }
+    }
+
+    /*! Subtract mean of upper envelope \c m_env and lower envelope
+     * (evaluated here) from \p imf.
+     * \return Cauchy-type standard deviation of the update.
+     */
+    T update_imf(T* imf) {
+        T* lo = m_lo.data();
+        envelope(imf, m_minP.data(), m_minSize, lo);
+        T num = 0, den = 0;
+        for (size_t i = 0; i < m_size; i++) {
+            const T m = (m_env[i] + lo[i]) * T(0.5);
+            num += m * m;
+            den += imf[i] * imf[i];
+            imf[i] -= m;
+        }
+        return den > 0 ? num / den : T(0);
+    }
+
+    size_t m_nF;                ///< Number of Functions including residue.
+    size_t m_nI;                ///< Number of Iterations.
+    size_t m_locality;
+    T m_sd_tol;                 ///< Sifting stop threshold.
+    size_t m_size = 0;
+    size_t m_nimfs = 0;
+    std::vector<T> m_imfs;      ///< \c m_nF functions of \c m_size samples.
+    std::vector<size_t> m_maxP; ///< Maximas.
+    std::vector<size_t> m_minP; ///< Minimas.
+    size_t m_maxSize = 0, m_minSize = 0;
+    std::vector<T> m_kt, m_ky, m_M, m_cp; ///< Spline knots, second derivatives and elimination factors.
+    std::vector<T> m_env, m_lo; ///< Upper and lower envelope.
+};
+
+/* ---------------------------- Group Separator ---------------------------- */
+
+/*!
+ * Ensemble Empirical Mode Decomposition (EEMD).
+ *
+ * Averages the IMFs of \c nens decompositions of the signal plus white
+ * noise of standard deviation <tt>noise * std(signal)</tt>. Members are
+ * run on \c nthreads threads, each with its own \c emd workspace and
+ * random stream, so results do not depend on scheduling. With \c paired
+ * set, members use noise in +/- pairs (complementary EEMD) which cancels
+ * the added noise from the sum of the IMFs.
+ */
+template<class T>
+class eemd {
+public:
+    eemd(size_t nF, size_t nI, size_t nens, T noise,
+         uint64_t seed = 0, bool paired = true,
+         size_t nthreads = std::thread::hardware_concurrency(),
+         size_t locality = 0)
+        : m_nF(std::max<size_t>(nF, 1)), m_nens(nens), m_noise(noise),
+          m_seed(seed), m_paired(paired)
+    {
+        const size_t nt = std::max<size_t>(1, std::min(nthreads, std::max<size_t>(nens, 1)));
+        m_workers.reserve(nt);
+        for (size_t t = 0; t < nt; t++) { m_workers.emplace_back(nF, nI, locality); }
+        m_sums.resize(nt);
+        m_noisy.resize(nt);
+    }
+
+    /// Decompose \p n samples of \p signal.
+    void decompose(const T* signal, size_t n) {
+        m_size = n;
+        T mean = 0, var = 0;
+        for (size_t i = 0; i < n; i++) { mean += signal[i]; }
+        mean /= std::max<size_t>(n, 1);
+        for (size_t i = 0; i < n; i++) { var += (signal[i] - mean) * (signal[i] - mean); }
+        const T sd = m_noise * std::sqrt(var / std::max<size_t>(n, 1));
+
+        const size_t nt = m_workers.size();
+        auto run = [&](size_t t) {
+            std::vector<T>& sum = m_sums[t];
+            std::vector<T>& noisy = m_noisy[t];
+            sum.assign(m_nF * n, T(0));
+            noisy.resize(n);
+            for (size_t m = t; m < m_nens; m += nt) {
+                const size_t stream = m_paired ? m / 2 : m;
+                const T sign = (m_paired and (m & 1)) ? T(-1) : T(1);
+                xoshiro256ss_x4 rng(m_seed, stream);
+                rng.fill_normal(noisy.data(), n, T(0), sd);
+                for (size_t i = 0; i < n; i++) { noisy[i] = signal[i] + sign * noisy[i]; }
+                m_workers[t].decompose(noisy.data(), n);
+                const T* f = m_workers[t].imf(0);
+                for (size_t i = 0; i < m_nF * n; i++) { sum[i] += f[i]; }
+            }
+        };
+        if (nt == 1) {
+            run(0);
+        } else {
+            std::vector<std::thread> threads;
+            threads.reserve(nt);
+            for (size_t t = 0; t < nt; t++) { threads.emplace_back(run, t); }
+            for (auto& th : threads) { th.join(); }
+        }
+
+        m_imfs.assign(m_nF * n, T(0));
+        const T scale = T(1) / std::max<size_t>(m_nens, 1);
+        for (size_t t = 0; t < nt; t++) {
+            for (size_t i = 0; i < m_nF * n; i++) { m_imfs[i] += m_sums[t][i]; }
+        }
+        for (auto& v : m_imfs) { v *= scale; }
+    }
+
+    /// Averaged function \p i, where <tt>i == nfuns()-1</tt> is the residue.
+    const T* imf(size_t i) const { return m_imfs.data() + i * m_size; }
+    const T* residue() const { return imf(m_nF - 1); }
+    size_t size() const { return m_size; }
+    size_t nfuns() const { return m_nF; }
+
+private:
+    size_t m_nF;
+    size_t m_nens;              ///< Number of ensemble members.
+    T m_noise;                  ///< Noise level relative to signal standard deviation.
+    uint64_t m_seed;
+    bool m_paired;
+    size_t m_size = 0;
+    std::vector<emd<T> > m_workers;          ///< Per-thread workspaces.
+    std::vector<std::vector<T> > m_sums;     ///< Per-thread IMF sums.
+    std::vector<std::vector<T> > m_noisy;    ///< Per-thread noisy signal.
+    std::vector<T> m_imfs;
+};
+
+/* ---------------------------- Group Separator ---------------------------- */
+
+/*!
+ * Streaming EMD over Sliding Windows.
+ *
+ * Input is decomposed in windows of \c window samples advanced by \c hop.
+ * Only the central \c hop samples of each window are emitted, so samples
+ * within <tt>(window-hop)/2</tt> of a window edge, where envelopes are
+ * least reliable, are taken from the neighbouring window instead. Emitted
+ * IMFs sum exactly to the input. Latency is <tt>(window+hop)/2</tt>
+ * samples. Any \c emd-like decomposer with \c decompose() and \c imf()
+ * (for example \c eemd) can be plugged in as \c D.
+ */
+template<class T, class D = emd<T> >
+class emd_stream {
+public:
+    /// Stream through \p dec in windows of \p window samples advanced by \p hop.
+    emd_stream(D dec, size_t window, size_t hop)
+        : m_dec(std::move(dec)), m_window(window),
+          m_hop(std::min(std::max<size_t>(hop, 1), window)),
+          m_margin((window - m_hop) / 2),
+          m_buf(window), m_ptrs(m_dec.nfuns()) {}
+
+    /*! Append \p n samples \p x and call \p sink(imfs, nfuns, len) for
+     * each completed segment, where \c imfs[i] points to \c len samples of
+     * function \c i.
+     */
+    template<class Sink>
+    void push(const T* x, size_t n, Sink&& sink) {
+        while (n) {
+            const size_t m = std::min(n, m_window - m_fill);
+            std::copy(x, x + m, m_buf.begin() + m_fill);
+            m_fill += m; x += m; n -= m;
+            if (m_fill == m_window) {
+                const size_t beg = m_first ? 0 : m_margin;
+                emit(m_window, beg, m_margin + m_hop, sink);
+                std::copy(m_buf.begin() + m_hop, m_buf.end(), m_buf.begin());
+                m_fill = m_window - m_hop;
+                m_first = false;
+            }
+        }
+    }
+
+    /// Decompose and emit all remaining samples, then restart.
+    template<class Sink>
+    void flush(Sink&& sink) {
+        const size_t beg = m_first ? 0 : m_margin;
+        if (m_fill > beg) { emit(m_fill, beg, m_fill, sink); }
+        m_fill = 0;
+        m_first = true;
+    }
+
+    D& decomposer() { return m_dec; }
+
+private:
+    template<class Sink>
+    void emit(size_t n, size_t beg, size_t end, Sink&& sink) {
+        m_dec.decompose(m_buf.data(), n);
+        for (size_t i = 0; i < m_ptrs.size(); i++) { m_ptrs[i] = m_dec.imf(i) + beg; }
+        sink(static_cast<const T* const*>(m_ptrs.data()), m_ptrs.size(), end - beg);
+    }
+
+    D m_dec;
+    size_t m_window, m_hop, m_margin;
+    std::vector<T> m_buf;       ///< Current window.
+    size_t m_fill = 0;          ///< Number of samples in \c m_buf.
+    bool m_first = true;        ///< Set until first window emitted.
+    std::vector<const T*> m_ptrs;
+};
+
+}
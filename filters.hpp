@@ -6,7 +6,13 @@
  */
 
 #pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <vector>
 #include "utils.hpp"
+#include "convolve.hpp"
 
 /*! Hamming Filter Tap at \p i / \p n.
  * Maximal sidolobsniv: -43 dB.
@@ -36,20 +42,355 @@ template<class T> inline T hanning_tap(size_t i, size_t n) {
             - 0.5  * std::cos(M_2PI * i / (n-1)));
 }
 
+/*! Generate Cosine-Sum Window \p a of resolution \p n,
+ * a[i] = c[0] - c[1]*cos(x) + c[2]*cos(2x) - c[3]*cos(3x), x = 2*pi*i/(n-1).
+ *
+ * Only cos(x) is evaluated, by rotating eight lanes of complex phasors
+ * that are reseeded exactly every 256 samples, and the harmonics follow by
+ * Chebyshev recurrence. This is vectorizable and an order of magnitude
+ * faster than the per-tap trig calls. Symmetry halves the work.
+ */
+template<class T> inline void cosine_sum_window(T* a, size_t n, const T c[4])
+{
+    if (n <= 1) { if (n) { a[0] = 1; } return; }
+    const size_t h = (n + 1) / 2;
+    const double w = M_PI * 2 / (n - 1);
+    const T rr = T(std::cos(8 * w)), ri = T(std::sin(8 * w)); // rotation by 8 samples
+    T cr[8] = { 0 }, ci[8] = { 0 };
+    for (size_t i0 = 0; i0 < h; i0 += 8) {
+        if (i0 % 256 == 0) {
+            for (size_t l = 0; l < 8; l++) { cr[l] = T(std::cos(w * (i0 + l))); ci[l] = T(std::sin(w * (i0 + l))); }
+        }
+        T y[8];
+        for (size_t l = 0; l < 8; l++) {
+            const T x1 = cr[l], x2 = 2 * x1 * x1 - 1, x3 = x1 * (2 * x2 - 1); // cos(kx)
+            y[l] = c[0] - c[1] * x1 + c[2] * x2 - c[3] * x3;
+            const T t = cr[l] * rr - ci[l] * ri;
+            ci[l] = cr[l] * ri + ci[l] * rr;
+            cr[l] = t;
+        }
+        const size_t e = std::min<size_t>(8, h - i0);
+        for (size_t l = 0; l < e; l++) { a[i0 + l] = y[l]; a[n - 1 - i0 - l] = y[l]; }
+    }
+}
+
 /*! Generate Hamming Window \p a of resolution \p n.
  */
 template<class T> inline void hamming(T* a, size_t n) {
-    for (size_t i = 0; i < n; i++) { a[i] = hamming_tap(i, n); }
+    const T c[4] = { T(0.54), T(0.46), 0, 0 };
+    cosine_sum_window(a, n, c);
 }
 
 /*! Generate Blackman Window \p a of resolution \p n.
  */
 template<class T> inline void blackman(T* a, size_t n) {
-    for (size_t i = 0; i < n; i++) { a[i] = blackman_tap(i, n); }
+    const T c[4] = { T(0.42), T(0.5), T(0.08), 0 };
+    cosine_sum_window(a, n, c);
 }
 
 /*! Generate Hanning Window \p of resolution \p n.
  */
 template<class T> inline void hanning(T* a, size_t n) {
-    for (size_t i = 0; i < n; i++) { a[i] = hanning_tap(i, n); }
+    const T c[4] = { T(0.5), T(0.5), 0, 0 };
+    cosine_sum_window(a, n, c);
+}
+
+/*! Generate 4-term Blackman-Harris Window \p a of resolution \p n.
+ * Maximal sidolobsniv: -92 dB.
+ */
+template<class T> inline void blackman_harris(T* a, size_t n) {
+    const T c[4] = { T(0.35875), T(0.48829), T(0.14128), T(0.01168) };
+    cosine_sum_window(a, n, c);
+}
+
+/* ---------------------------- Group Separator ---------------------------- */
+
+namespace pnw
+{
+
+/*! Dot product of \p a and \p b of length \p n in GCC vectors of eight
+ * lanes, with two accumulators to hide the add latency. */
+template<class T>
+inline T dot8(const T* a, const T* b, size_t n)
+{
+    typedef T v8 __attribute__ ((vector_size (8 * sizeof(T))));
+    v8 s0 = { 0 }, s1 = { 0 }, x, y;
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        std::memcpy(&x, a + i, sizeof(x)); std::memcpy(&y, b + i, sizeof(y)); s0 += x * y;
+        std::memcpy(&x, a + i + 8, sizeof(x)); std::memcpy(&y, b + i + 8, sizeof(y)); s1 += x * y;
+    }
+    if (i + 8 <= n) {
+        std::memcpy(&x, a + i, sizeof(x)); std::memcpy(&y, b + i, sizeof(y)); s0 += x * y;
+        i += 8;
+    }
+    s0 += s1;
+    T r = ((s0[0] + s0[4]) + (s0[1] + s0[5])) + ((s0[2] + s0[6]) + (s0[3] + s0[7]));
+    for (; i < n; i++) { r += a[i] * b[i]; }
+    return r;
+}
+
+/*!
+ * Block-Streaming FIR Filter.
+ *
+ * Output sample i is sum_j h[j]*x[i-j] over all samples pushed so far, so
+ * calls with chunks of any size give the same result as one call over the
+ * whole signal. Kernels of at least \c fft_min_taps taps are applied by
+ * overlap-save FFT convolution (\see fft_convolver) on blocks of up to
+ * block_size() samples. As the FFT size is rounded up to a power of two,
+ * block_size() is usually larger than requested, so partly filled blocks
+ * also go through the FFT unless they are too short to pay for it. Those
+ * and short kernels use a direct vectorized dot product. The default
+ * crossover of 256 taps is where the two paths ran equally fast with AVX2.
+ */
+template<class T>
+class fir {
+public:
+    fir(const T* h, size_t m, size_t block = 1024, size_t fft_min_taps = 256)
+        : m_m(std::max<size_t>(m, 1)), m_hr(m_m, T(0)) {
+        for (size_t j = 0; j < m; j++) { m_hr[m_m - 1 - j] = h[j]; }
+        if (fft_min_taps && m >= fft_min_taps) {
+            m_fft.reset(new fft_convolver<T>(h, m, std::max(block, m)));
+            block = m_fft->block_size();
+            // FFTs of size N ran as fast as 20*N*log2(N) vectorized multiply-adds with AVX2,
+            // against m per direct output
+            const size_t N = m_fft->fft_size();
+            size_t lg = 0;
+            while ((size_t(1) << lg) < N) { lg++; }
+            m_fft_min = std::max<size_t>(20 * N * lg / m_m, 1);
+        }
+        m_block = std::max<size_t>(block, 1);
+        m_buf.assign(m_m - 1 + m_block, T(0));
+    }
+
+    size_t ntaps() const { return m_m; }
+    size_t block_size() const { return m_block; }
+    bool uses_fft() const { return bool(m_fft); }
+    /// Whether a chunk of \p n samples is filtered by FFT rather than directly.
+    bool uses_fft(size_t n) const { return m_fft && std::min(n, m_block) >= m_fft_min; }
+
+    /// Filter \p n samples \p x into \p y (which may equal \p x).
+    void process(const T* x, T* y, size_t n) {
+        const size_t H = m_m - 1;
+        while (n) {
+            const size_t k = std::min(n, m_block);
+            std::copy(x, x + k, m_buf.begin() + H);
+            if (m_fft && k >= m_fft_min) {
+                m_fft->apply(m_buf.data(), y, k); // stale samples after k do not matter
+            } else {
+                for (size_t i = 0; i < k; i++) { y[i] = dot8(m_hr.data(), m_buf.data() + i, m_m); }
+            }
+            std::copy(m_buf.begin() + k, m_buf.begin() + k + H, m_buf.begin()); // keep history
+            x += k; y += k; n -= k;
+        }
+    }
+
+    /// Forget history, as if only zeros had been pushed.
+    void reset() { std::fill(m_buf.begin(), m_buf.end(), T(0)); }
+
+private:
+    size_t m_m;
+    size_t m_block;
+    size_t m_fft_min = 0;       ///< Shortest chunk worth an FFT.
+    std::vector<T> m_hr;        ///< Reversed taps.
+    std::vector<T> m_buf;       ///< m-1 samples of history followed by a block.
+    std::unique_ptr<fft_convolver<T> > m_fft;
+};
+
+/*!
+ * Block-Streaming FIR Decimator by \c factor.
+ *
+ * Keeps every \c factor:th output of the FIR filter \c h. Only the kept
+ * outputs are computed, which is the polyphase saving of \c factor.
+ */
+template<class T>
+class fir_decimator {
+public:
+    fir_decimator(const T* h, size_t m, size_t factor, size_t block = 1024)
+        : m_m(std::max<size_t>(m, 1)), m_factor(std::max<size_t>(factor, 1)),
+          m_block(std::max<size_t>(block, 1)), m_hr(m_m, T(0)), m_buf(m_m - 1 + m_block, T(0)) {
+        for (size_t j = 0; j < m; j++) { m_hr[m_m - 1 - j] = h[j]; }
+    }
+
+    /*! Consume \p n samples \p x, writing the outputs due into \p y,
+     * at most <tt>n/factor + 1</tt>. \return number of outputs written.
+     */
+    size_t process(const T* x, size_t n, T* y) {
+        const size_t H = m_m - 1;
+        size_t ny = 0;
+        while (n) {
+            const size_t k = std::min(n, m_block);
+            std::copy(x, x + k, m_buf.begin() + H);
+            size_t i = m_phase;
+            for (; i < k; i += m_factor) { y[ny++] = dot8(m_hr.data(), m_buf.data() + i, m_m); }
+            m_phase = i - k;
+            std::copy(m_buf.begin() + k, m_buf.begin() + k + H, m_buf.begin());
+            x += k; n -= k;
+        }
+        return ny;
+    }
+
+    void reset() { std::fill(m_buf.begin(), m_buf.end(), T(0)); m_phase = 0; }
+
+private:
+    size_t m_m, m_factor, m_block;
+    size_t m_phase = 0;         ///< Input samples to skip before the next output.
+    std::vector<T> m_hr;
+    std::vector<T> m_buf;
+};
+
+/*!
+ * Block-Streaming Polyphase FIR Interpolator by \c factor.
+ *
+ * Equivalent to inserting <tt>factor-1</tt> zeros after each input sample
+ * and filtering with \c h, but runs \c factor subfilters of length
+ * <tt>m/factor</tt> on the original samples. Scale \c h by \c factor for
+ * unity passband gain.
+ */
+template<class T>
+class fir_interpolator {
+public:
+    fir_interpolator(const T* h, size_t m, size_t factor, size_t block = 1024)
+        : m_L(std::max<size_t>(factor, 1)), m_q(std::max<size_t>((m + m_L - 1) / m_L, 1)),
+          m_block(std::max<size_t>(block, 1)),
+          m_sub(m_L * m_q, T(0)), m_buf(m_q - 1 + m_block, T(0)) {
+        for (size_t j = 0; j < m; j++) { // phase p holds h[p], h[p+L], ... reversed
+            m_sub[(j % m_L) * m_q + (m_q - 1 - j / m_L)] = h[j];
+        }
+    }
+
+    /// Consume \p n samples \p x, writing <tt>n*factor</tt> outputs into \p y.
+    void process(const T* x, size_t n, T* y) {
+        const size_t H = m_q - 1;
+        while (n) {
+            const size_t k = std::min(n, m_block);
+            std::copy(x, x + k, m_buf.begin() + H);
+            for (size_t i = 0; i < k; i++) {
+                for (size_t p = 0; p < m_L; p++) {
+                    *y++ = dot8(m_sub.data() + p * m_q, m_buf.data() + i, m_q);
+                }
+            }
+            std::copy(m_buf.begin() + k, m_buf.begin() + k + H, m_buf.begin());
+            x += k; n -= k;
+        }
+    }
+
+    void reset() { std::fill(m_buf.begin(), m_buf.end(), T(0)); }
+
+private:
+    size_t m_L, m_q, m_block;
+    std::vector<T> m_sub;       ///< Reversed subfilters, one row per phase.
+    std::vector<T> m_buf;
+};
+
+/* ---------------------------- Group Separator ---------------------------- */
+
+/*!
+ * Biquad Coefficients, normalized so that a0 = 1.
+ * \see http://www.musicdsp.org/files/Audio-EQ-Cookbook.txt
+ */
+template<class T>
+struct biquad {
+    T b0, b1, b2, a1, a2;
+
+    static biquad lowpass(double fs, double f0, double Q) {
+        const double w = M_PI * 2 * f0 / fs, cs = std::cos(w), al = std::sin(w) / (2 * Q);
+        return make((1 - cs) / 2, 1 - cs, (1 - cs) / 2, 1 + al, -2 * cs, 1 - al);
+    }
+    static biquad highpass(double fs, double f0, double Q) {
+        const double w = M_PI * 2 * f0 / fs, cs = std::cos(w), al = std::sin(w) / (2 * Q);
+        return make((1 + cs) / 2, -(1 + cs), (1 + cs) / 2, 1 + al, -2 * cs, 1 - al);
+    }
+    /// Band-pass with 0 dB peak gain.
+    static biquad bandpass(double fs, double f0, double Q) {
+        const double w = M_PI * 2 * f0 / fs, cs = std::cos(w), al = std::sin(w) / (2 * Q);
+        return make(al, 0, -al, 1 + al, -2 * cs, 1 - al);
+    }
+    static biquad notch(double fs, double f0, double Q) {
+        const double w = M_PI * 2 * f0 / fs, cs = std::cos(w), al = std::sin(w) / (2 * Q);
+        return make(1, -2 * cs, 1, 1 + al, -2 * cs, 1 - al);
+    }
+    /// Peaking equalizer with gain \p db at \p f0.
+    static biquad peaking(double fs, double f0, double Q, double db) {
+        const double A = std::pow(10, db / 40);
+        const double w = M_PI * 2 * f0 / fs, cs = std::cos(w), al = std::sin(w) / (2 * Q);
+        return make(1 + al * A, -2 * cs, 1 - al * A, 1 + al / A, -2 * cs, 1 - al / A);
+    }
+
+private:
+    static biquad make(double b0, double b1, double b2, double a0, double a1, double a2) {
+        biquad c;
+        c.b0 = T(b0 / a0); c.b1 = T(b1 / a0); c.b2 = T(b2 / a0);
+        c.a1 = T(a1 / a0); c.a2 = T(a2 / a0);
+        return c;
+    }
+};
+
+/*!
+ * Biquad Cascades over Many Channels.
+ *
+ * Runs \c nsections biquads in series on each of \c nchannels channels of
+ * interleaved frames, in transposed direct form II. Coefficients and state
+ * are stored section-major with channels contiguous, so each section is
+ * applied to a whole frame with one loop over channels that vectorizes;
+ * the recursion only runs along time. Channels may have different
+ * coefficients.
+ */
+template<class T>
+class biquad_bank {
+public:
+    biquad_bank(size_t nchannels, size_t nsections)
+        : m_C(nchannels), m_S(nsections),
+          m_b0(m_C * m_S, T(1)), m_b1(m_C * m_S, T(0)), m_b2(m_C * m_S, T(0)),
+          m_a1(m_C * m_S, T(0)), m_a2(m_C * m_S, T(0)),
+          m_z1(m_C * m_S, T(0)), m_z2(m_C * m_S, T(0)) {}
+
+    size_t nchannels() const { return m_C; }
+    size_t nsections() const { return m_S; }
+
+    /// Set section \p s of channel \p c to \p q.
+    void set(size_t s, size_t c, const biquad<T>& q) {
+        const size_t i = s * m_C + c;
+        m_b0[i] = q.b0; m_b1[i] = q.b1; m_b2[i] = q.b2; m_a1[i] = q.a1; m_a2[i] = q.a2;
+    }
+    /// Set section \p s of all channels to \p q.
+    void set(size_t s, const biquad<T>& q) { for (size_t c = 0; c < m_C; c++) { set(s, c, q); } }
+
+    /// Filter \p nframes interleaved frames \p x into \p y (which may equal \p x).
+    void process(const T* x, T* y, size_t nframes) {
+        const size_t C = m_C;
+        for (size_t t = 0; t < nframes; t++) {
+            T* __restrict v = y + t * C;
+            if (x != y) { std::copy(x + t * C, x + (t + 1) * C, v); }
+            for (size_t s = 0; s < m_S; s++) {
+                const size_t o = s * C;
+                const T* __restrict b0 = m_b0.data() + o;
+                const T* __restrict b1 = m_b1.data() + o;
+                const T* __restrict b2 = m_b2.data() + o;
+                const T* __restrict a1 = m_a1.data() + o;
+                const T* __restrict a2 = m_a2.data() + o;
+                T* __restrict z1 = m_z1.data() + o;
+                T* __restrict z2 = m_z2.data() + o;
+                for (size_t c = 0; c < C; c++) {
+                    const T in = v[c];
+                    const T out = b0[c] * in + z1[c];
+                    z1[c] = b1[c] * in - a1[c] * out + z2[c];
+                    z2[c] = b2[c] * in - a2[c] * out;
+                    v[c] = out;
+                }
+            }
+        }
+    }
+
+    void reset() {
+        std::fill(m_z1.begin(), m_z1.end(), T(0));
+        std::fill(m_z2.begin(), m_z2.end(), T(0));
+    }
+
+private:
+    size_t m_C, m_S;
+    std::vector<T> m_b0, m_b1, m_b2, m_a1, m_a2; ///< [section][channel]
+    std::vector<T> m_z1, m_z2;                   ///< State, [section][channel]
+};
+
 }
@@ -6,12 +6,19 @@
  * \see lis, lcs
  *
  * \todo Generalize to Bidirectional Access Containers.
+ *
+ * \see http://www.gersteinlab.org/courses/452/09-spring/pdf/Myers.pdf
+ * \see http://www.dcc.uchile.cl/~gnavarro/ps/jea06.pdf (Hyyrö, Blocked Bit-Parallel)
  */
 
 #pragma once
 #include <algorithm>
 #include "algorithm_x.hpp"
 #include <limits>
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstring>
 #include "permn.hpp"
 #include <type_traits> // <boost/type_traits/is_pointer.hpp>, <boost/integer_traits.hpp>
 #include "cc_features.h"
@@ -233,5 +240,270 @@ D test_levenshtein_symmetry(const T& s, const T& t,
     return sym ? st : std::numeric_limits<D>::max();
 }
 
+/* ---------------------------- Group Separator ---------------------------- */
+
+/*! Get \em Unit-Cost Levenshtein Distance between \p s and \p t limited to \p k.
+ *
+ * Only the diagonal band |i-j| <= \p k of the dynamic programming table is
+ * computed (Ukkonen) and computation stops as soon as every cell in a row
+ * exceeds \p k.
+ *
+ * \return the distance, or \p k + 1 if it is larger than \p k.
+ * \complexity[time] O(k * min(m,n))
+ */
+template<class T>
+inline pure
+size_t levenshtein_banded(const T& s, const T& t, size_t k)
+{
+    const size_t m = s.size(), n = t.size();
+    k = std::min(k, std::max(m, n)); // distance is never larger, and k + 1 must not wrap
+    const size_t diff = m > n ? m - n : n - m;
+    if (diff > k) { return k + 1; }
+    if (m == 0 or n == 0) { return m + n; }
+
+    const size_t inf = k + 1;
+    std::vector<size_t> pr(n + 1, inf), cr(n + 1, inf); // previous and current row
+    for (size_t j = 0; j <= std::min(n, k); ++j) { pr[j] = j; }
+    for (size_t i = 1; i <= m; ++i) {
+        const size_t lo = i > k ? i - k : 1;
+        const size_t hi = std::min(n, i + k);
+        size_t rmin = inf;
+        cr[lo - 1] = (lo == 1 and i <= k) ? i : inf;
+        for (size_t j = lo; j <= hi; ++j) {
+            size_t d = pr[j - 1] + (s[i - 1] == t[j - 1] ? 0 : 1); // substitution
+            d = std::min(d, pr[j] + 1);                           // deletion
+            d = std::min(d, cr[j - 1] + 1);                       // insertion
+            cr[j] = std::min(d, inf);
+            rmin = std::min(rmin, cr[j]);
+        }
+        if (hi < n) { cr[hi + 1] = inf; }
+        if (rmin > k) { return k + 1; } // early exit
+        std::swap(pr, cr);
+    }
+    return std::min(pr[n], inf);
+}
+
+/*! Myers Bit-Parallel Pattern.
+ *
+ * Precomputed match masks (Peq) of a byte \em pattern for computing its
+ * unit-cost Levenshtein distance to any number of texts in O(ceil(m/64) * n)
+ * word operations each. Patterns longer than 64 are processed in blocks of
+ * 64 rows (Hyyrö) with only the blocks that may still be within the limit.
+ */
+class myers_pattern
+{
+public:
+    typedef uint64_t word_type;
+
+    myers_pattern(const char* p, size_t m) { init(p, m); }
+    template<class T> explicit myers_pattern(const T& p) { init(reinterpret_cast<const char*>(&p[0]), p.size()); }
+
+    /// Get pattern length.
+    size_t size() const { return m_m; }
+    /// Get number of 64-bit blocks.
+    size_t nblocks() const { return m_nb; }
+    /// Get match mask of byte \p c in block \p b.
+    word_type peq(uint8_t c, size_t b = 0) const { return m_peq[c * m_nb + b]; }
+
+    /*! Get Levenshtein distance to text \p t of length \p n limited to \p k.
+     * \return the distance, or \p k + 1 if it is larger than \p k.
+     */
+    size_t distance(const char* t, size_t n,
+                    size_t k = std::numeric_limits<size_t>::max() - 1) const
+    {
+        k = std::min(k, std::max(m_m, n)); // distance is never larger, and k + 1 must not wrap
+        if (m_m == 0) { return std::min(n, k + 1); }
+        const size_t diff = m_m > n ? m_m - n : n - m_m;
+        if (diff > k) { return k + 1; }
+        return m_nb == 1 ? distance1(t, n, k) : distanceN(t, n, k);
+    }
+    template<class T> size_t distance(const T& t,
+                                      size_t k = std::numeric_limits<size_t>::max() - 1) const
+    {
+        return distance(reinterpret_cast<const char*>(&t[0]), t.size(), k);
+    }
+
+private:
+    void init(const char* p, size_t m)
+    {
+        m_m = m;
+        m_nb = (m + 63) / 64;
+        m_peq.assign(256 * m_nb, 0);
+        for (size_t i = 0; i < m; ++i) {
+            m_peq[static_cast<uint8_t>(p[i]) * m_nb + i / 64] |= static_cast<word_type>(1) << (i % 64);
+        }
+    }
+
+    /// Single block case (pattern length <= 64).
+    size_t distance1(const char* t, size_t n, size_t k) const
+    {
+        const word_type hb = static_cast<word_type>(1) << (m_m - 1);
+        word_type pv = ~static_cast<word_type>(0), mv = 0;
+        size_t score = m_m;
+        for (size_t j = 0; j < n; ++j) {
+            const word_type eq = m_peq[static_cast<uint8_t>(t[j])];
+            const word_type xv = eq | mv;
+            const word_type xh = (((eq & pv) + pv) ^ pv) | eq;
+            word_type ph = mv | ~(xh | pv);
+            word_type mh = pv & xh;
+            if (ph & hb) { ++score; } else if (mh & hb) { --score; }
+            ph = (ph << 1) | 1;
+            mh <<= 1;
+            pv = mh | ~(xv | ph);
+            mv = ph & xv;
+            const size_t left = n - 1 - j;
+            if (score > left and score - left > k) { return k + 1; } // cannot come back below k
+        }
+        return std::min(score, k + 1);
+    }
+
+    /// Advance block (\p pv, \p mv) one column given match mask \p eq and incoming
+    /// horizontal delta \p hin. Return outgoing delta at bit \p hb.
+    static int step(word_type& pv, word_type& mv, word_type eq, int hin, word_type hb)
+    {
+        if (hin < 0) { eq |= 1; }
+        const word_type xv = eq | mv;
+        const word_type xh = (((eq & pv) + pv) ^ pv) | eq;
+        word_type ph = mv | ~(xh | pv);
+        word_type mh = pv & xh;
+        const int hout = (ph & hb) ? 1 : (mh & hb) ? -1 : 0;
+        ph <<= 1;
+        mh <<= 1;
+        if (hin < 0) { mh |= 1; } else if (hin > 0) { ph |= 1; }
+        pv = mh | ~(xv | ph);
+        mv = ph & xv;
+        return hout;
+    }
+
+    /// Blocked case (pattern length > 64).
+    size_t distanceN(const char* t, size_t n, size_t k) const
+    {
+        const word_type top = static_cast<word_type>(1) << 63;
+        const word_type last_hb = static_cast<word_type>(1) << ((m_m - 1) % 64);
+        std::vector<word_type> pv(m_nb, ~static_cast<word_type>(0)), mv(m_nb, 0);
+        size_t score = m_m;
+        for (size_t j = 0; j < n; ++j) {
+            const word_type* eq = &m_peq[static_cast<uint8_t>(t[j]) * m_nb];
+            int h = 1;
+            for (size_t b = 0; b + 1 < m_nb; ++b) { h = step(pv[b], mv[b], eq[b], h, top); }
+            h = step(pv[m_nb - 1], mv[m_nb - 1], eq[m_nb - 1], h, last_hb);
+            score += h;
+            const size_t left = n - 1 - j;
+            if (score > left and score - left > k) { return k + 1; }
+        }
+        return std::min(score, k + 1);
+    }
+
+    size_t m_m;                     ///< Pattern length.
+    size_t m_nb;                    ///< Number of 64-bit blocks.
+    std::vector<word_type> m_peq;   ///< Match masks indexed [byte][block].
+};
+
+/*! Get \em Unit-Cost Levenshtein Distance between byte sequences \p s and \p t
+ * using Myers' bit-parallel algorithm, limited to \p k.
+ */
+template<class T>
+inline pure
+size_t levenshtein_myers(const T& s, const T& t,
+                         size_t k = std::numeric_limits<size_t>::max() - 1)
+{
+    static_assert(sizeof(s[0]) == 1, "levenshtein_myers requires byte sequences");
+    const bool ook = s.size() <= t.size(); // use shortest as pattern
+    return myers_pattern(ook ? s : t).distance(ook ? t : s, k);
+}
+
+/*! Get \em Unit-Cost Levenshtein Distances from \p q to each of the \p n
+ * candidates \p cands (of lengths \p lens) limited to \p k into \p out.
+ *
+ * For patterns of at most 64 bytes, four candidates are advanced at once, one
+ * per 64-bit lane of a GCC vector (AVX2 when enabled). Lanes that finish or
+ * exceed \p k are refilled with the next candidate. Longer patterns fall
+ * back to myers_pattern::distance() per candidate.
+ */
+inline void levenshtein_batch(const myers_pattern& q,
+                              const char* const* cands, const size_t* lens, size_t n,
+                              size_t* out,
+                              size_t k = std::numeric_limits<size_t>::max() - 1)
+{
+    const size_t m = q.size();
+    if (m == 0 or q.nblocks() > 1) {
+        for (size_t i = 0; i < n; ++i) { out[i] = q.distance(cands[i], lens[i], k); }
+        return;
+    }
+
+    typedef uint64_t v4u __attribute__ ((vector_size (4*sizeof(uint64_t))));
+    typedef int64_t v4s __attribute__ ((vector_size (4*sizeof(int64_t))));
+    enum { W = 4 };
+    const uint64_t hb = static_cast<uint64_t>(1) << (m - 1);
+    const size_t none = std::numeric_limits<size_t>::max();
+    k = std::min(k, none - 1);  // k + 1 must not wrap
+
+    v4u pv, mv, score;
+    size_t id[W], pos[W], len[W];
+    const char* txt[W];
+    size_t next = 0;
+    auto load = [&](int l) {    // start next candidate in lane l
+        id[l] = none;
+        while (next < n) {
+            const size_t i = next++;
+            const size_t d = m > lens[i] ? m - lens[i] : lens[i] - m;
+            if (d > k) { out[i] = k + 1; continue; }        // length filter
+            if (lens[i] == 0) { out[i] = std::min(m, k + 1); continue; }
+            id[l] = i; txt[l] = cands[i]; pos[l] = 0; len[l] = lens[i];
+            pv[l] = ~static_cast<uint64_t>(0); mv[l] = 0; score[l] = m;
+            return;
+        }
+        pv[l] = ~static_cast<uint64_t>(0); mv[l] = 0; score[l] = m; // idle lane
+        pos[l] = 0; len[l] = 0;
+    };
+    for (int l = 0; l < W; ++l) { load(l); }
+
+    const v4u one = {1, 1, 1, 1};
+    const v4u hbv = {hb, hb, hb, hb};
+    while (id[0] != none or id[1] != none or id[2] != none or id[3] != none) {
+        v4u eq;
+        for (int l = 0; l < W; ++l) {
+            eq[l] = id[l] != none ? q.peq(static_cast<uint8_t>(txt[l][pos[l]])) : 0;
+        }
+        const v4u xv = eq | mv;
+        const v4u xh = (((eq & pv) + pv) ^ pv) | eq;
+        v4u ph = mv | ~(xh | pv);
+        v4u mh = pv & xh;
+        score += (v4u)(-(v4s)((ph & hbv) != 0)); // comparisons yield -1 for true
+        score -= (v4u)(-(v4s)((mh & hbv) != 0));
+        ph = (ph << 1) | one;
+        mh <<= 1;
+        pv = mh | ~(xv | ph);
+        mv = ph & xv;
+        for (int l = 0; l < W; ++l) {
+            if (id[l] == none) { continue; }
+            const size_t left = len[l] - 1 - pos[l]++;
+            if (left == 0 or (score[l] > left and score[l] - left > k)) {
+                out[id[l]] = std::min<size_t>(score[l], k + 1);
+                load(l);
+            }
+        }
+    }
+}
+
+/*! Get \em Unit-Cost Levenshtein Distances from \p q to each string in \p cands limited to \p k. */
+template<class T, class C>
+inline std::vector<size_t> levenshtein_batch(const T& q, const C& cands,
+                                             size_t k = std::numeric_limits<size_t>::max() - 1)
+{
+    const myers_pattern p(q);
+    std::vector<const char*> ptrs;
+    std::vector<size_t> lens;
+    ptrs.reserve(cands.size());
+    lens.reserve(cands.size());
+    for (const auto& c : cands) {
+        ptrs.push_back(reinterpret_cast<const char*>(c.data()));
+        lens.push_back(c.size());
+    }
+    std::vector<size_t> out(cands.size());
+    levenshtein_batch(p, ptrs.data(), lens.data(), ptrs.size(), out.data(), k);
+    return out;
+}
+
 }
 }
@@ -14,6 +14,11 @@
 // #include <cmath>
 #include <algorithm>
 #include <memory>
+#include <numeric>
+#include <vector>
+#include <cmath>
+#include "opt_batch.hpp"
+#include "rand_streams.hpp"
 
 // #undef HAVE_C99_VARIABLE_LENGTH_ARRAYS
 
@@ -380,3 +385,194 @@ nelder_mead_min(T fn (const T* x), size_t n,
 #endif
     return 0;
 }
+
+/*! Minimize batched objective \p fn over \p n variables using \p nstarts
+ * Nelder-Mead simplices advanced in lockstep, with random restarts.
+ *
+ * Each iteration gathers the reflection points of all simplices into one
+ * batch, then the expansion/contraction points of those that need one, then
+ * any shrink points, so \p fn is called with up to \p nstarts * \p n points
+ * at a time instead of one. A simplex whose function values have variance
+ * below \p reqmin is restarted at a uniformly random point in [\p lower,
+ * \p upper] until \p max_evals evaluations are spent (the last iteration
+ * may overshoot it by up to \p nstarts * \p n).
+ *
+ * \param[in] start if non-null is the starting point of the first simplex.
+ * \param[in] seed selects the random stream used for restart points.
+ */
+template<class T>
+pnw::opt::result<T>
+nelder_mead_multistart(const pnw::opt::batch_fn<T>& fn, size_t n,
+                       const T* lower, const T* upper,
+                       size_t nstarts,
+                       size_t max_evals,
+                       T reqmin = 1e-8,
+                       const T* start = nullptr,
+                       uint64_t seed = 0,
+                       const T step_frac = 0.1, // initial step relative to box
+                       const T ccoeff = 0.5,    // contraction coefficient
+                       const T ecoeff = 2.0,    // extension coefficient
+                       const T rcoeff = 1.0,    // reflection coefficient
+                       const T scoeff = 0.5)    // shrink coefficient
+{
+    enum { NONE, EXPAND, CONTRACT_OUT, CONTRACT_IN };
+    const size_t nn = n + 1;
+    pnw::opt::result<T> res;
+    pnw::xoshiro256ss_x4 rng(seed);
+
+    std::vector<T> P(nstarts * nn * n);   // vertices [s][v][i]
+    std::vector<T> Y(nstarts * nn);       // values [s][v]
+    std::vector<T> C(nstarts * n);        // centroids
+    std::vector<T> R(nstarts * n), fR(nstarts); // reflections
+    std::vector<int> todo(nstarts);
+    std::vector<char> active(nstarts, 1);
+    std::vector<T> X;                     // batch points
+    std::vector<T> fX;                    // batch values
+    std::vector<size_t> who;              // simplex of each batch point
+
+    auto eval = [&]() {
+        fX.resize(who.size());
+        if (not who.empty()) { fn(X.data(), who.size(), n, fX.data()); }
+        res.nevals += who.size();
+        for (size_t b = 0; b < who.size(); ++b) { res.offer(&X[b*n], n, fX[b]); }
+    };
+    auto vertex = [&](size_t s, size_t v) { return &P[(s*nn + v)*n]; };
+
+    // Queue initial simplex of \c s around \p x0.
+    auto queue_simplex = [&](size_t s, const T* x0) {
+        for (size_t v = 0; v < nn; ++v) {
+            T* p = vertex(s, v);
+            std::copy(x0, x0 + n, p);
+            if (v) { p[v-1] += step_frac * (upper[v-1] - lower[v-1]); }
+            X.insert(X.end(), p, p + n);
+            who.push_back(s*nn + v);
+        }
+    };
+    auto random_point = [&](std::vector<T>& x) {
+        x.resize(n);
+        for (size_t i = 0; i < n; ++i) {
+            double u[1]; rng.fill_uniform(u, 1);
+            x[i] = lower[i] + static_cast<T>(u[0]) * (upper[i] - lower[i]);
+        }
+    };
+
+    std::vector<T> x0;
+    X.clear(); who.clear();
+    for (size_t s = 0; s < nstarts; ++s) {
+        if (s == 0 and start) { x0.assign(start, start + n); } else { random_point(x0); }
+        queue_simplex(s, x0.data());
+    }
+    eval();
+    for (size_t b = 0; b < who.size(); ++b) { Y[who[b]] = fX[b]; }
+
+    std::vector<size_t> order(nn);
+    std::vector<T> tmpP(nn * n), tmpY(nn);
+    while (res.nevals < max_evals and
+           std::find(active.begin(), active.end(), 1) != active.end()) {
+        ++res.niters;
+
+        // Sort each simplex, compute centroid and reflection.
+        X.clear(); who.clear();
+        for (size_t s = 0; s < nstarts; ++s) {
+            if (not active[s]) { continue; }
+            T* y = &Y[s*nn];
+            std::iota(order.begin(), order.end(), 0);
+            std::sort(order.begin(), order.end(), [y](size_t a, size_t b) { return y[a] < y[b]; });
+            for (size_t v = 0; v < nn; ++v) {
+                std::copy(vertex(s, order[v]), vertex(s, order[v]) + n, &tmpP[v*n]);
+                tmpY[v] = y[order[v]];
+            }
+            std::copy(tmpP.begin(), tmpP.end(), vertex(s, 0));
+            std::copy(tmpY.begin(), tmpY.end(), y);
+
+            T* c = &C[s*n];
+            T* r = &R[s*n];
+            const T* h = vertex(s, n);
+            for (size_t i = 0; i < n; ++i) {
+                T z = 0;
+                for (size_t v = 0; v < n; ++v) { z += vertex(s, v)[i]; }
+                c[i] = z / n;
+                r[i] = c[i] + rcoeff * (c[i] - h[i]);
+            }
+            X.insert(X.end(), r, r + n);
+            who.push_back(s);
+        }
+        eval();
+
+        // Decide expansion or contraction.
+        std::vector<size_t> refl(who);
+        X.clear(); who.clear();
+        for (size_t b = 0; b < refl.size(); ++b) {
+            const size_t s = refl[b];
+            const T* y = &Y[s*nn];
+            const T* c = &C[s*n];
+            const T* r = &R[s*n];
+            const T* h = vertex(s, n);
+            const T fr = fR[s] = fX[b];
+            todo[s] = NONE;
+            if (fr < y[0]) {
+                todo[s] = EXPAND;
+                for (size_t i = 0; i < n; ++i) { X.push_back(c[i] + ecoeff * (r[i] - c[i])); }
+            } else if (fr >= y[n-1]) {
+                todo[s] = fr < y[n] ? CONTRACT_OUT : CONTRACT_IN;
+                const T* d = todo[s] == CONTRACT_OUT ? r : h;
+                for (size_t i = 0; i < n; ++i) { X.push_back(c[i] + ccoeff * (d[i] - c[i])); }
+            } else {            // accept reflection
+                std::copy(r, r + n, vertex(s, n));
+                Y[s*nn + n] = fr;
+                continue;
+            }
+            who.push_back(s);
+        }
+        eval();
+
+        // Accept or shrink.
+        std::vector<size_t> second(who);
+        std::vector<T> X2(X), fX2(fX);
+        X.clear(); who.clear();
+        for (size_t b = 0; b < second.size(); ++b) {
+            const size_t s = second[b];
+            const T* x2 = &X2[b*n];
+            const T f2 = fX2[b];
+            const T fr = fR[s];
+            T* y = &Y[s*nn];
+            if (todo[s] == EXPAND) {
+                const bool e = f2 < fr;
+                std::copy(e ? x2 : &R[s*n], (e ? x2 : &R[s*n]) + n, vertex(s, n));
+                y[n] = e ? f2 : fr;
+            } else if ((todo[s] == CONTRACT_OUT and f2 <= fr) or
+                       (todo[s] == CONTRACT_IN and f2 < y[n])) {
+                std::copy(x2, x2 + n, vertex(s, n));
+                y[n] = f2;
+            } else {            // shrink towards best vertex
+                const T* l = vertex(s, 0);
+                for (size_t v = 1; v < nn; ++v) {
+                    T* p = vertex(s, v);
+                    for (size_t i = 0; i < n; ++i) { p[i] = l[i] + scoeff * (p[i] - l[i]); }
+                    X.insert(X.end(), p, p + n);
+                    who.push_back(s*nn + v);
+                }
+            }
+        }
+        eval();
+        for (size_t b = 0; b < who.size(); ++b) { Y[who[b]] = fX[b]; }
+
+        // Converged simplices restart at a random point.
+        X.clear(); who.clear();
+        for (size_t s = 0; s < nstarts; ++s) {
+            if (not active[s]) { continue; }
+            const T* y = &Y[s*nn];
+            const T mean = std::accumulate(y, y + nn, static_cast<T>(0)) / nn;
+            T var = 0;
+            for (size_t v = 0; v < nn; ++v) { var += (y[v] - mean) * (y[v] - mean); }
+            if (var / nn > reqmin) { continue; }
+            if (res.nevals + nn > max_evals) { active[s] = 0; continue; }
+            random_point(x0);
+            queue_simplex(s, x0.data());
+            ++res.nrestarts;
+        }
+        eval();
+        for (size_t b = 0; b < who.size(); ++b) { Y[who[b]] = fX[b]; }
+    }
+    return res;
+}
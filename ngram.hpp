@@ -11,9 +11,12 @@
  * \todo Reuse histogram container from histogram.hpp
  * \todo Can we make use of STL algorithms similar to std::for_each in \c sub_log and \c seq_log?
  * \todo Add Support for N-Grams in Boost.Accumulator.
+ *
+ * \see http://www.aclweb.org/anthology/P11-1027 (KenLM Hashed Tables)
  */
 
 #pragma once
+#include <functional>
 #include <memory>
 #include <type_traits>
 #include <vector>
@@ -21,6 +24,13 @@
 #include <cstdint>
 #include <iomanip>
 #include <algorithm>
+#include <thread>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "memory_x.hpp"
 #include "saturate.hpp"
 #include "histogram.hpp"
@@ -94,4 +104,273 @@ private:
     L m_level;                  ///< N-Gram Level.
 };
 
+/*! Mix 64-bit Hash \p h (MurmurHash3 finalizer). */
+inline uint64_t mix64(uint64_t h) {
+    h ^= h >> 33; h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33; h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+/*! Hash Slot in \c table and \c frozen_table. Key zero marks an empty slot. */
+template<class C> struct slot { uint64_t key; C count; };
+
+/*! Header of a saved \c table. Followed by \c capacity slots. */
+struct table_header {
+    char magic[8];              ///< "NGRAMTB2"
+    uint64_t order;             ///< Maximum n-gram length.
+    uint64_t capacity;          ///< Number of slots (power of two).
+    uint64_t size;              ///< Number of occupied slots.
+    uint64_t count_size;        ///< sizeof(C) of saved table.
+    uint64_t aux[4];            ///< Caller data saved along, such as model options and statistics.
+};
+
+/*! Rolling Hash of n-gram prefix \p h extended with \p value. Never zero. */
+template<class V> inline uint64_t roll(uint64_t h, const V& value) {
+    const uint64_t k = mix64(h + 0x9e3779b97f4a7c15ULL * (std::hash<V>()(value) + 1));
+    return k ? k : 1;
+}
+
+/*! Lookup \p key in open addressed (linear probing) \p slots of power of two size \p capacity.
+ * \return the matching or first empty slot.
+ */
+template<class C> inline const slot<C>* probe(const slot<C>* slots, size_t capacity, uint64_t key) {
+    const size_t mask = capacity - 1;
+    for (size_t i = key & mask; ; i = (i + 1) & mask) {
+        if (slots[i].key == key or slots[i].key == 0) { return &slots[i]; }
+    }
+}
+
+/*! Hashed N-gram Table.
+ *
+ * Flat alternative to \c tree: every 1- to \p n-gram is identified by the
+ * rolling hash of its elements and counted in a single open addressed array
+ * of (hash, count) slots. Memory is one slot per distinct n-gram with no
+ * per-node allocation, at the price of (with 64-bit keys, negligible) hash
+ * collisions merging counts.
+ *
+ * \tparam V is Value Type (must be hashable by \c std::hash).
+ * \tparam C is Count Type.
+ */
+template<class V, class C = uint32_t, class L = uint8_t>
+class table {
+public:
+    typedef slot<C> Slot;
+
+    /// Construct empty table for up to \p n long n-grams with room for \p capacity_hint n-grams.
+    table(L n, size_t capacity_hint = 1024) : m_order(n), m_size(0) {
+        size_t cap = 16;
+        while (cap < capacity_hint * 2) { cap *= 2; }
+        m_slots.assign(cap, Slot{0, 0});
+    }
+
+    /// Construct from all n-grams up to length \p n in [\p begin, \p end] using \p nthreads threads.
+    template<class It> table(const It begin, const It end, L n,
+                             size_t nthreads = std::thread::hardware_concurrency())
+        : table(n) { seq_log_parallel(begin, end, nthreads); }
+
+    L order() const { return m_order; }
+    /// Get number of distinct n-grams.
+    size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+    /// Get number of slots.
+    size_t capacity() const { return m_slots.size(); }
+    /// Get size of table in bytes.
+    size_t bytesize() const { return sizeof(*this) + m_slots.size() * sizeof(Slot); }
+
+    /*! Log All 1- to \c order() long n-grams starting at each position in [begin end].
+     * \complexity[time] O(order() * (end-begin))
+     */
+    template<class It> void seq_log(const It begin, const It end) { seq_log_starts(begin, end, end); }
+    template<class Container> void seq_log(const Container& cont) { seq_log(std::begin(cont), std::end(cont)); }
+
+    /*! Parallel \c seq_log() of [begin end] (random access iterators).
+     *
+     * Each of \p nthreads threads counts the n-grams starting in its own
+     * chunk into a private shard; the shards are merged at the end.
+     */
+    template<class It> void seq_log_parallel(const It begin, const It end,
+                                             size_t nthreads = std::thread::hardware_concurrency()) {
+        const size_t len = end - begin;
+        if (nthreads <= 1 or len < 4096 * nthreads) { seq_log(begin, end); return; }
+        const size_t chunk = (len + nthreads - 1) / nthreads;
+        std::vector<table> shards(nthreads, table(m_order, chunk));
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < nthreads; t++) {
+            threads.emplace_back([&, t]() {
+                    const size_t first = std::min(len, t * chunk), last = std::min(len, first + chunk);
+                    shards[t].seq_log_starts(begin + first, begin + last, end);
+                });
+        }
+        for (auto& th : threads) { th.join(); }
+        for (const auto& s : shards) { merge(s); }
+    }
+
+    /// Merge (add) counts of \p other into this.
+    void merge(const table& other) {
+        for (const auto& s : other.m_slots) {
+            if (s.key) { add(s.key, s.count); }
+        }
+    }
+
+    /// Get count of n-gram [\p begin, \p end], or 0 if not present or longer than \c order().
+    template<class It> C count(const It begin, const It end) const {
+        return lookup(m_slots.data(), m_slots.size(), m_order, begin, end);
+    }
+
+    /*! Add \p c to count of n-gram with rolling hash \p key, for streams
+     * that \c roll() hashes of n-grams ending at each element themselves. */
+    void add_key(uint64_t key, C c = 1) { add(key, c); }
+
+    /// Get count of n-gram with rolling hash \p key.
+    C count_key(uint64_t key) const {
+        const Slot* s = probe(m_slots.data(), m_slots.size(), key);
+        return s->key ? s->count : 0;
+    }
+
+    /*! Save table to \p path in a form that can be mapped by \c
+     * frozen_table, along with the four words at \p aux if given.
+     * \return true on success.
+     */
+    bool save(const char* path, const uint64_t* aux = nullptr) const {
+        FILE* f = fopen(path, "wb");
+        if (not f) { perror("fopen"); return false; }
+        table_header hdr;
+        memcpy(hdr.magic, "NGRAMTB2", 8);
+        for (size_t i = 0; i < 4; i++) { hdr.aux[i] = aux ? aux[i] : 0; }
+        hdr.order = m_order;
+        hdr.capacity = m_slots.size();
+        hdr.size = m_size;
+        hdr.count_size = sizeof(C);
+        const bool ok = (fwrite(&hdr, sizeof(hdr), 1, f) == 1 and
+                         fwrite(m_slots.data(), sizeof(Slot), m_slots.size(), f) == m_slots.size());
+        if (not ok) { perror("fwrite"); }
+        return (fclose(f) == 0) and ok;
+    }
+
+    /// Lookup n-gram [\p begin, \p end] in \p slots.
+    template<class It> static C lookup(const Slot* slots, size_t capacity, L order,
+                                       const It begin, const It end) {
+        if (begin == end or static_cast<size_t>(end - begin) > order) { return 0; }
+        uint64_t h = 0;
+        for (auto it = begin; it != end; ++it) { h = roll(h, *it); }
+        const Slot* s = probe(slots, capacity, h);
+        return s->key ? s->count : 0;
+    }
+
+private:
+    /// Log n-grams starting in [begin last] that may extend to \p end.
+    template<class It> void seq_log_starts(const It begin, const It last, const It end) {
+        for (auto it = begin; it != last; ++it) {
+            uint64_t h = 0;
+            auto jt = it;
+            for (L k = 0; k < m_order and jt != end; ++k, ++jt) {
+                h = roll(h, *jt);
+                add(h, 1);
+            }
+        }
+    }
+
+    /// Add \p c to count of \p key.
+    void add(uint64_t key, C c) {
+        Slot* s = const_cast<Slot*>(probe(m_slots.data(), m_slots.size(), key));
+        if (s->key == 0) {
+            if (2 * (m_size + 1) > m_slots.size()) { grow(); s = const_cast<Slot*>(probe(m_slots.data(), m_slots.size(), key)); }
+            s->key = key;
+            s->count = c;
+            m_size++;
+        } else {
+            s->count = sadd(s->count, c);
+        }
+    }
+    /// Double capacity and rehash.
+    void grow() {
+        std::vector<Slot> old(m_slots.size() * 2, Slot{0, 0});
+        old.swap(m_slots);
+        for (const auto& s : old) {
+            if (s.key) { *const_cast<Slot*>(probe(m_slots.data(), m_slots.size(), s.key)) = s; }
+        }
+    }
+
+    L m_order;                  ///< Maximum n-gram length.
+    size_t m_size;              ///< Number of occupied slots.
+    std::vector<Slot> m_slots;  ///< Open addressed slots.
+};
+
+/*! Read-only Memory Mapped \c table saved with \c table::save(). */
+template<class V, class C = uint32_t, class L = uint8_t>
+class frozen_table {
+public:
+    typedef slot<C> Slot;
+
+    frozen_table() {}
+    frozen_table(const char* path) { open(path); }
+    ~frozen_table() { close(); }
+    frozen_table(const frozen_table&) = delete;
+    frozen_table& operator = (const frozen_table&) = delete;
+
+    /*! Map table at \p path.
+     * \return true on success.
+     */
+    bool open(const char* path) {
+        close();
+        const int fd = ::open(path, O_RDONLY);
+        if (fd < 0) { perror("open"); return false; }
+        struct stat st;
+        if (fstat(fd, &st) != 0 or st.st_size < static_cast<off_t>(sizeof(table_header))) { ::close(fd); return false; }
+        void* dat = ::mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (dat == MAP_FAILED) { perror("mmap"); return false; }
+        m_dat = dat;
+        m_bysz = st.st_size;
+        const table_header* hdr = reinterpret_cast<const table_header*>(dat);
+        if (memcmp(hdr->magic, "NGRAMTB2", 8) != 0 or
+            hdr->count_size != sizeof(C) or
+            m_bysz != sizeof(table_header) + hdr->capacity * sizeof(Slot)) {
+            close();
+            return false;
+        }
+        m_hdr = hdr;
+        m_slots = reinterpret_cast<const Slot*>(hdr + 1);
+        return true;
+    }
+    /// Unmap table.
+    void close() {
+        if (m_dat) { ::munmap(m_dat, m_bysz); }
+        m_dat = nullptr; m_hdr = nullptr; m_slots = nullptr; m_bysz = 0;
+    }
+
+    bool is_open() const { return m_hdr != nullptr; }
+    L order() const { return m_hdr ? m_hdr->order : 0; }
+    size_t size() const { return m_hdr ? m_hdr->size : 0; }
+    /// Get caller data saved along with table, or nullptr if not open.
+    const uint64_t* aux() const { return m_hdr ? m_hdr->aux : nullptr; }
+
+    /// Get count of n-gram [\p begin, \p end].
+    template<class It> C count(const It begin, const It end) const {
+        if (not m_hdr) { return 0; }
+        return table<V,C,L>::lookup(m_slots, m_hdr->capacity, m_hdr->order, begin, end);
+    }
+
+    /// Get count of n-gram with rolling hash \p key.
+    C count_key(uint64_t key) const {
+        if (not m_hdr) { return 0; }
+        const Slot* s = probe(m_slots, m_hdr->capacity, key);
+        return s->key ? s->count : 0;
+    }
+
+    /// Call \p f(uint64_t key, C count) for each n-gram.
+    template<class F> void for_each_key(F f) const {
+        for (size_t i = 0; m_hdr and i < m_hdr->capacity; i++) {
+            if (m_slots[i].key) { f(m_slots[i].key, m_slots[i].count); }
+        }
+    }
+
+private:
+    void* m_dat = nullptr;              ///< Mapped data.
+    size_t m_bysz = 0;                  ///< Mapped byte size.
+    const table_header* m_hdr = nullptr;
+    const Slot* m_slots = nullptr;
+};
+
 }}}
@@ -9,6 +9,8 @@
 #pragma once
 
 #include "nelder_mead.hpp"
+#include "pso.hpp"
+#include "cmaes.hpp"
 
 template<class T>
 void gradient_descent(const std::vector<T> & y, T & a, T & b)
@@ -0,0 +1,145 @@
+/*! \file opt_batch.hpp
+ * \brief Batched Objective Functions for Optimizers.
+ * \author Copyright (C) 2012 Per Nordlöw (per.nordlow@gmail.com)
+ *
+ * A \em batched objective evaluates \c k points of dimension \c n, stored
+ * row-major in \c X[k*n], into \c y[k] in one call. This lets an expensive
+ * objective vectorize across points or spread them over threads, and lets
+ * the optimizers (nelder_mead_multistart(), pso(), cmaes()) hand it all
+ * independent points of an iteration at once.
+ */
+
+#pragma once
+#include <algorithm>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace pnw { namespace opt {
+
+/*! Batched Objective: evaluate \p k points of dimension \p n at \p X into \p y. */
+template<class T> using batch_fn = std::function<void(const T* X, size_t k, size_t n, T* y)>;
+
+/*! Team of \c size() Threads, the caller and \c size()-1 workers, that
+ * runs a function on all of them at once. The workers are spawned once and
+ * reused by each \c run(), as optimizers run every iteration.
+ */
+class thread_team {
+public:
+    explicit thread_team(size_t nthreads) {
+        for (size_t t = 1; t < std::max<size_t>(nthreads, 1); ++t) {
+            m_workers.emplace_back([this, t]() { work(t); });
+        }
+    }
+    ~thread_team() {
+        { std::lock_guard<std::mutex> lock(m_mutex); m_stop = true; }
+        m_start.notify_all();
+        for (auto& th : m_workers) { th.join(); }
+    }
+    thread_team(const thread_team&) = delete;
+    thread_team& operator=(const thread_team&) = delete;
+
+    size_t size() const { return m_workers.size() + 1; }
+
+    /*! Call \p f(t) for each \p t in [0, \c size()), with 0 on the calling
+     * thread, and wait for all calls. Rethrows the first exception thrown.
+     */
+    void run(const std::function<void(size_t)>& f) {
+        std::lock_guard<std::mutex> run_lock(m_run_mutex); // one run at a time
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_job = &f;
+            m_pending = m_workers.size();
+            m_error = nullptr;
+            ++m_generation;
+        }
+        m_start.notify_all();
+        std::exception_ptr error;
+        try { f(0); } catch (...) { error = std::current_exception(); }
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_done.wait(lock, [this]() { return m_pending == 0; });
+        if (not error) { error = m_error; }
+        if (error) { std::rethrow_exception(error); }
+    }
+
+private:
+    void work(size_t t) {
+        size_t seen = 0;        // generation last run
+        for (;;) {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_start.wait(lock, [&]() { return m_stop or m_generation != seen; });
+            if (m_stop) { return; }
+            seen = m_generation;
+            const auto job = m_job;
+            lock.unlock();
+            std::exception_ptr error;
+            try { (*job)(t); } catch (...) { error = std::current_exception(); }
+            lock.lock();
+            if (error and not m_error) { m_error = error; }
+            if (--m_pending == 0) { m_done.notify_one(); }
+        }
+    }
+
+    std::vector<std::thread> m_workers;
+    std::mutex m_run_mutex;
+    std::mutex m_mutex;         ///< Guards members below.
+    std::condition_variable m_start, m_done;
+    const std::function<void(size_t)>* m_job = nullptr;
+    size_t m_generation = 0;
+    size_t m_pending = 0;       ///< Workers still running current job.
+    std::exception_ptr m_error; ///< First exception thrown by a worker.
+    bool m_stop = false;
+};
+
+/*! Wrap scalar objective \p fn into a batched objective that evaluates the
+ * points of each batch on a \c thread_team of \p nthreads threads, shared by
+ * all copies of the returned objective.
+ *
+ * \p fn must be safe to call concurrently.
+ */
+template<class T, class F>
+inline batch_fn<T> parallel_batch(F fn, size_t nthreads = std::thread::hardware_concurrency())
+{
+    auto team = std::make_shared<thread_team>(nthreads);
+    return [fn, team](const T* X, size_t k, size_t n, T* y) {
+        const size_t nt = team->size();
+        if (nt == 1 or k < 2) {
+            for (size_t i = 0; i < k; ++i) { y[i] = fn(X + i*n); }
+            return;
+        }
+        team->run([&](size_t t) {
+                for (size_t i = t; i < k; i += nt) { y[i] = fn(X + i*n); } // interleaved for balance
+            });
+    };
+}
+
+/*! Wrap scalar objective \p fn into a serial batched objective. */
+template<class T, class F>
+inline batch_fn<T> serial_batch(F fn)
+{
+    return [fn](const T* X, size_t k, size_t n, T* y) {
+        for (size_t i = 0; i < k; ++i) { y[i] = fn(X + i*n); }
+    };
+}
+
+/*! Optimization Result. */
+template<class T> struct result
+{
+    std::vector<T> xmin;        ///< Best point found.
+    T ymin = std::numeric_limits<T>::max(); ///< Objective value at \c xmin.
+    size_t nevals = 0;          ///< Number of objective evaluations.
+    size_t niters = 0;          ///< Number of iterations (generations).
+    size_t nrestarts = 0;       ///< Number of restarts.
+
+    /// Update with point \p x of value \p y if better.
+    void offer(const T* x, size_t n, T y) {
+        if (y < ymin) { ymin = y; xmin.assign(x, x + n); }
+    }
+};
+
+}}
@@ -12,6 +12,7 @@
 
 #pragma once
 #include <vector>
+#include "cc_features.h"
 
 /*!
  * Find \em Peak Indexes of all elements in [first, last].
@@ -74,3 +75,39 @@ std::vector<Ix> valleys(const InputIterator first,
 template<class C, class Ix = typename C::size_type>
 inline pure
 std::vector<Ix> valleys(C x) { return valleys<typename C::const_iterator, Ix>(begin(x), end(x)); }
+
+/*!
+ * Find \em Peak and \em Valley Indexes of contiguous \p x of length \p n in
+ * one pass, same criteria as \c peaks() and \c valleys().
+ *
+ * Neighbour comparisons are done eight elements at a time into bit masks
+ * that are expanded with count-trailing-zeros, so runs without extrema cost
+ * no branches. \p pk and \p vl must have room for <tt>n/2</tt> indexes
+ * each. Nothing is allocated, making this suitable for inner loops such as
+ * EMD sifting.
+ */
+template<class T, class Ix>
+inline void extrema(const T* x, size_t n,
+                    Ix* pk, size_t& npk,
+                    Ix* vl, size_t& nvl)
+{
+    npk = nvl = 0;
+    if (n < 3) { return; }
+    const size_t W = 8;
+    size_t i = 1;
+    for (; i + W < n; i += W) {
+        unsigned mp = 0, mv = 0;
+        for (size_t k = 0; k < W; k++) {
+            const T p = x[i+k-1], m = x[i+k], q = x[i+k+1];
+            mp |= static_cast<unsigned>((p < m) & (m > q)) << k;
+            mv |= static_cast<unsigned>((p > m) & (m < q)) << k;
+        }
+        while (mp) { pk[npk++] = i + __builtin_ctz(mp); mp &= mp - 1; }
+        while (mv) { vl[nvl++] = i + __builtin_ctz(mv); mv &= mv - 1; }
+    }
+    for (; i + 1 < n; i++) {
+        const T p = x[i-1], m = x[i], q = x[i+1];
+        if (p < m and m > q) { pk[npk++] = i; }
+        if (p > m and m < q) { vl[nvl++] = i; }
+    }
+}
@@ -0,0 +1,230 @@
+/*! \file peaks_stream.hpp
+ * \brief Streaming Peak Detection and Sliding-Window Extremes.
+ * \author Copyright (C) 2012 Per Nordlöw (per.nordlow@gmail.com)
+ * \see peaks.hpp for the whole-container versions.
+ * \see MATLAB's \c findpeaks(), SciPy's \c find_peaks()
+ *
+ * Consumers here take their input in chunks of any size and keep only
+ * O(window) state, so they run on unbounded sensor streams. Sample
+ * indexes are 64-bit and count from the start of the stream. Nothing is
+ * allocated after construction.
+ */
+
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <vector>
+#include "utils.h"
+
+namespace pnw
+{
+
+/*! Minimum and maximum of \p n elements at \p x in one vectorized pass. */
+inline void minmax(const float* x, size_t n, float& mn, float& mx) { farray_extremes(x, n, &mn, &mx); }
+inline void minmax(const double* x, size_t n, double& mn, double& mx) { darray_extremes(x, n, &mn, &mx); }
+
+/*!
+ * Sliding-Window Minimum and Maximum.
+ *
+ * Keeps two monotone deques of (index, value) in fixed rings of \c window
+ * entries, so each push costs amortized O(1) regardless of window length.
+ */
+template<class T>
+class sliding_minmax {
+public:
+    explicit sliding_minmax(size_t window)
+        : m_window(std::max<size_t>(window, 1)),
+          m_lo(m_window), m_hi(m_window) {}
+
+    /// Push \p x, then min() and max() cover the last \c window samples.
+    void push(T x) {
+        const uint64_t i = m_count++;
+        m_lo.push(i, x, m_window, [](T a, T b) { return a >= b; });
+        m_hi.push(i, x, m_window, [](T a, T b) { return a <= b; });
+    }
+
+    /*! Push \p n samples \p x, writing running extremes after each into
+     * \p mins and \p maxs (either may be null). */
+    void push(const T* x, size_t n, T* mins, T* maxs) {
+        for (size_t i = 0; i < n; i++) {
+            push(x[i]);
+            if (mins) { mins[i] = min(); }
+            if (maxs) { maxs[i] = max(); }
+        }
+    }
+
+    T min() const { return m_lo.front(); } ///< Minimum of current window.
+    T max() const { return m_hi.front(); } ///< Maximum of current window.
+    uint64_t count() const { return m_count; } ///< Number of samples pushed.
+
+    void clear() { m_count = 0; m_lo.clear(); m_hi.clear(); }
+
+private:
+    /// Ring-buffered monotone deque.
+    struct deque {
+        explicit deque(size_t cap) : ix(cap), val(cap) {}
+        template<class Dominated>
+        void push(uint64_t i, T x, size_t window, Dominated dominated) {
+            const size_t cap = ix.size();
+            while (n && dominated(val[(head + n - 1) % cap], x)) { n--; } // drop from back
+            if (n && ix[head] + window <= i) { head = (head + 1) % cap; n--; } // expire front
+            const size_t t = (head + n) % cap;
+            ix[t] = i; val[t] = x;
+            n++;
+        }
+        T front() const { return val[head]; }
+        void clear() { head = n = 0; }
+        std::vector<uint64_t> ix;
+        std::vector<T> val;
+        size_t head = 0, n = 0;
+    };
+
+    size_t m_window;
+    uint64_t m_count = 0;
+    deque m_lo, m_hi;
+};
+
+/* ---------------------------- Group Separator ---------------------------- */
+
+/*! Detected Peak. */
+template<class T>
+struct peak_info {
+    uint64_t index;             ///< Sample index in stream.
+    T value;                    ///< Sample value.
+    T prominence;               ///< Height above the higher of its two bases.
+    T width;                    ///< Width in samples at \c rel_height of prominence.
+    double left, right;         ///< Interpolated positions where width is measured.
+    uint64_t left_base, right_base; ///< Positions of the bases.
+};
+
+/*!
+ * Streaming Peak (or Valley) Detector.
+ *
+ * A peak is a sample strictly greater than both neighbours, as in \c
+ * peaks(). Its bases are the minima between it and the nearest strictly
+ * higher sample on each side, searched at most \c wlen/2 samples away, and
+ * its prominence is its height above the higher base. Width is measured
+ * where the signal crosses <tt>value - rel_height*prominence</tt>, with
+ * linear interpolation, as SciPy does.
+ *
+ * A peak is reported once \c wlen/2 samples after it have arrived, so the
+ * latency is \c wlen/2 samples and the state a ring of about \c wlen samples.
+ * Peaks below any of the thresholds are dropped.
+ */
+template<class T>
+class peak_stream {
+public:
+    struct params {
+        size_t wlen = 256;          ///< Window bounding base and width searches.
+        T min_height = std::numeric_limits<T>::lowest(); ///< Of value, or of -value for valleys.
+        T min_prominence = 0;
+        T min_width = 0;
+        T rel_height = T(0.5);
+        bool valleys = false;       ///< Detect valleys (prominence of -x) instead.
+    };
+
+    explicit peak_stream(const params& p)
+        : m_p(p), m_half(std::max<size_t>(p.wlen / 2, 1)),
+          m_buf(pow2(2 * m_half + 2)), m_mask(m_buf.size() - 1),
+          m_cand(pow2(m_half + 2)), m_cmask(m_cand.size() - 1) {}
+
+    /// Consume \p n samples \p x, calling \p sink(const peak_info<T>&) for each confirmed peak.
+    template<class Sink>
+    void push(const T* x, size_t n, Sink&& sink) {
+        for (size_t k = 0; k < n; k++) {
+            const uint64_t j = m_count++;
+            const T v = m_p.valleys ? -x[k] : x[k];
+            m_buf[j & m_mask] = v;
+            if (j >= 2) {
+                const T p = at(j - 2), m = at(j - 1);
+                if (p < m and m > v and m >= m_p.min_height) { // new candidate
+                    m_cand[(m_chead + m_cn++) & m_cmask] = j - 1;
+                }
+            }
+            while (m_cn && m_cand[m_chead & m_cmask] + m_half <= j) {
+                evaluate(m_cand[m_chead & m_cmask], j, sink);
+                m_chead++; m_cn--;
+            }
+        }
+    }
+
+    /// Report pending peaks using the samples seen so far, then restart.
+    template<class Sink>
+    void flush(Sink&& sink) {
+        if (m_count) {
+            while (m_cn) {
+                evaluate(m_cand[m_chead & m_cmask], m_count - 1, sink);
+                m_chead++; m_cn--;
+            }
+        }
+        m_count = 0;
+    }
+
+    uint64_t count() const { return m_count; } ///< Number of samples consumed.
+
+private:
+    static size_t pow2(size_t n) { size_t p = 1; while (p < n) { p *= 2; } return p; }
+    T at(uint64_t i) const { return m_buf[i & m_mask]; }
+
+    /// Measure candidate \p c with samples up to \p last and report it if it qualifies.
+    template<class Sink>
+    void evaluate(uint64_t c, uint64_t last, Sink&& sink) {
+        const T h = at(c);
+        const uint64_t lo = c >= m_half ? c - m_half : 0;
+        const uint64_t hi = std::min<uint64_t>(c + m_half, last);
+
+        uint64_t lbase = c, rbase = c; // nearest minima before a higher sample
+        T lmin = h, rmin = h;
+        for (uint64_t k = c; k-- > lo;) {
+            const T v = at(k);
+            if (v > h) { break; }
+            if (v < lmin) { lmin = v; lbase = k; }
+        }
+        for (uint64_t k = c + 1; k <= hi; k++) {
+            const T v = at(k);
+            if (v > h) { break; }
+            if (v < rmin) { rmin = v; rbase = k; }
+        }
+        const T prom = h - std::max(lmin, rmin);
+        if (prom < m_p.min_prominence) { return; }
+
+        const T ref = h - m_p.rel_height * prom;
+        double left = double(lbase), right = double(rbase);
+        for (uint64_t k = c; k > lbase; k--) {
+            if (at(k - 1) < ref) { // crossing between k-1 and k
+                left = double(k - 1) + double(ref - at(k - 1)) / double(at(k) - at(k - 1));
+                break;
+            }
+        }
+        for (uint64_t k = c; k < rbase; k++) {
+            if (at(k + 1) < ref) {
+                right = double(k) + double(at(k) - ref) / double(at(k) - at(k + 1));
+                break;
+            }
+        }
+        const T width = static_cast<T>(right - left);
+        if (width < m_p.min_width) { return; }
+
+        peak_info<T> pk;
+        pk.index = c;
+        pk.value = m_p.valleys ? -h : h;
+        pk.prominence = prom;
+        pk.width = width;
+        pk.left = left; pk.right = right;
+        pk.left_base = lbase; pk.right_base = rbase;
+        sink(pk);
+    }
+
+    params m_p;
+    size_t m_half;              ///< Half window, also the reporting latency.
+    std::vector<T> m_buf;       ///< Ring of recent (sign-adjusted) samples.
+    uint64_t m_mask;
+    std::vector<uint64_t> m_cand; ///< Ring of pending candidate indexes.
+    uint64_t m_cmask;
+    uint64_t m_chead = 0;
+    size_t m_cn = 0;
+    uint64_t m_count = 0;
+};
+
+}
@@ -5,6 +5,10 @@
  */
 
 #pragma once
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <type_traits>
 
 /*  #define EQN_EPS (1e-9) */
 
@@ -59,3 +63,194 @@ template<class T> inline void polysolve3rd(T a, T b, T c, T d,
     }
 }
 /* @} */
+
+/* ---------------------------- Group Separator ---------------------------- */
+
+/*! \name Batch Solving of Polynomial Equations.
+ *
+ * Solve \c n independent equations stored as Structure-of-Arrays: \c ck[i]
+ * is coefficient k of equation i, in the same order as above. Real roots
+ * are returned ascending in \c x0[i], \c x1[i], ... with unused slots set
+ * to NaN, and their count in \c nroots[i].
+ *
+ * Every case (negative discriminant, vanishing leading coefficient, the
+ * trigonometric and Cardano branches of the cubic, biquadratic quartics) is
+ * computed for all equations and chosen by selects instead of branches, so
+ * the loops vectorize and do not mispredict on mixed data. A repeated root
+ * may be reported once or once per multiplicity.
+ */
+/* @{ */
+
+namespace polysolve_detail {
+
+template<class T> inline T nan() { return std::numeric_limits<T>::quiet_NaN(); }
+
+/// Order \p a, \p b ascending with NaN last, without branches.
+template<class T> inline void sort2(T& a, T& b)
+{
+    const bool swap = (b < a) | (a != a);
+    const T lo = swap ? b : a, hi = swap ? a : b;
+    a = lo; b = hi;
+}
+
+/// Roots of c2*x^2 + c1*x + c0 = 0, also when c2 (and c1) vanish.
+template<class T> inline int quad(T c0, T c1, T c2, T& x0, T& x1)
+{
+    const T D = c1 * c1 - 4 * c2 * c0;
+    const T sq = std::sqrt(D > 0 ? D : T(0));
+    const T q = T(-0.5) * (c1 + std::copysign(sq, c1)); // avoid cancellation
+    const T r0 = q / c2;
+    const T r1 = q != 0 ? c0 / q : r0;
+    const T lin = -c0 / c1;
+    const bool is_quad = c2 != 0, is_lin = (c2 == 0) & (c1 != 0);
+    const int n = is_quad ? (D > 0 ? 2 : D == 0 ? 1 : 0) : (is_lin ? 1 : 0);
+    const T lo = r0 < r1 ? r0 : r1, hi = r0 < r1 ? r1 : r0;
+    x0 = is_quad ? (n == 2 ? lo : n == 1 ? -c1 / (2 * c2) : nan<T>()) : (is_lin ? lin : nan<T>());
+    x1 = n == 2 ? hi : nan<T>();
+    return n;
+}
+
+/// Real roots of monic x^3 + a2*x^2 + a1*x + a0 = 0, ascending.
+template<class T> inline int cubic_monic(T a0, T a1, T a2, T& x0, T& x1, T& x2)
+{
+    const T Q = (a2 * a2 - 3 * a1) / 9;
+    const T R = (2 * a2 * a2 * a2 - 9 * a2 * a1 + 27 * a0) / 54;
+    const T Q3 = Q * Q * Q;
+    const T s = a2 / 3;
+    // three real roots, also when R^2 == Q^3 up to rounding, where two
+    // (or, at Q == 0, all three) of them coincide
+    const T tol = 16 * std::numeric_limits<T>::epsilon();
+    const bool three = R * R - Q3 <= tol * (R * R + (Q3 > 0 ? Q3 : -Q3));
+    // trigonometric form
+    const T sQ = std::sqrt(Q > 0 ? Q : T(0));
+    T cth = (three and Q3 > 0) ? R / std::sqrt(Q3) : T(0);
+    cth = cth < -1 ? T(-1) : cth > 1 ? T(1) : cth;
+    const T th = std::acos(cth) / 3;
+    const T t0 = -2 * sQ * std::cos(th) - s;
+    const T t1 = -2 * sQ * std::cos(th + T(2 * M_PI / 3)) - s;
+    const T t2 = -2 * sQ * std::cos(th - T(2 * M_PI / 3)) - s;
+    // one real root: Cardano
+    const T sq = std::sqrt(three ? T(0) : R * R - Q3);
+    const T A = -std::copysign(std::cbrt(std::abs(R) + sq), R);
+    const T B = A != 0 ? Q / A : T(0);
+    const T c = A + B - s;
+    // t0 <= t2 <= t1 for theta in [0, pi/3]
+    x0 = three ? t0 : c;
+    x1 = three ? t2 : nan<T>();
+    x2 = three ? t1 : nan<T>();
+    return three ? 3 : 1;
+}
+
+/// Real roots of c3*x^3 + ... + c0 = 0, falling back to \c quad() when c3 vanishes.
+template<class T> inline int cubic(T c0, T c1, T c2, T c3, T& x0, T& x1, T& x2)
+{
+    T y0, y1, y2, q0, q1;
+    const int n3 = cubic_monic(c0 / c3, c1 / c3, c2 / c3, y0, y1, y2);
+    const int n2 = quad(c0, c1, c2, q0, q1);
+    const bool deg3 = c3 != 0;
+    x0 = deg3 ? y0 : q0;
+    x1 = deg3 ? y1 : q1;
+    x2 = deg3 ? y2 : nan<T>();
+    return deg3 ? n3 : n2;
+}
+
+/// Newton step of \p x on c4*x^4 + ... + c0, kept only if it lowers the residual,
+/// as near a repeated root the derivative nearly vanishes and the step overshoots.
+template<class T> inline T newton4(T c0, T c1, T c2, T c3, T c4, T x)
+{
+    const T p = (((c4 * x + c3) * x + c2) * x + c1) * x + c0;
+    const T d = ((4 * c4 * x + 3 * c3) * x + 2 * c2) * x + c1;
+    const T xn = d != 0 ? x - p / d : x;
+    const T pn = (((c4 * xn + c3) * xn + c2) * xn + c1) * xn + c0;
+    return std::abs(pn) < std::abs(p) ? xn : x;
+}
+
+/// Real roots of c4*x^4 + ... + c0 = 0 (Ferrari), falling back to \c cubic() when c4 vanishes.
+template<class T> inline int quartic(T c0, T c1, T c2, T c3, T c4,
+                                     T& x0, T& x1, T& x2, T& x3)
+{
+    // depressed quartic y^4 + p*y^2 + q*y + r, x = y - b/4
+    const T b = c3 / c4, c = c2 / c4, d = c1 / c4, e = c0 / c4;
+    const T sh = b / 4, b2 = b * b;
+    const T p = c - T(3) / 8 * b2;
+    const T q = d - b * c / 2 + b2 * b / 8;
+    const T r = e - b * d / 4 + b2 * c / 16 - T(3) / 256 * b2 * b2;
+
+    // largest root m >= 0 of resolvent 8m^3 + 8p*m^2 + (2p^2 - 8r)*m - q^2
+    T m0, m1, m2;
+    const int nm = cubic_monic(-q * q / 8, p * p / 4 - r, p, m0, m1, m2);
+    T m = nm == 3 ? m2 : m0;
+    m = m > 0 ? m : T(0);
+
+    // (y^2 + p/2 + m)^2 = (sqrt(2m)*y - q/(2*sqrt(2m)))^2
+    const T s2m = std::sqrt(2 * m);
+    const bool biq = s2m == 0;  // q == 0: quadratic in y^2
+    const T k = biq ? T(0) : q / (2 * s2m);
+    T y0, y1, y2, y3;           // missing roots are NaN and counted out below
+    quad(p / 2 + m + k, -s2m, T(1), y0, y1);
+    quad(p / 2 + m - k, s2m, T(1), y2, y3);
+    // biquadratic: z = y^2 from z^2 + p*z + r
+    T z0, z1;
+    quad(r, p, T(1), z0, z1);
+    const T sz0 = std::sqrt(z0), sz1 = std::sqrt(z1); // NaN for negative z
+    y0 = biq ? -sz1 : y0; y1 = biq ? -sz0 : y1;
+    y2 = biq ? sz0 : y2;  y3 = biq ? sz1 : y3;
+
+    // shift back and polish once against the original coefficients
+    T r4[4] = { y0 - sh, y1 - sh, y2 - sh, y3 - sh };
+    for (int i = 0; i < 4; i++) { r4[i] = newton4(c0, c1, c2, c3, c4, r4[i]); }
+    sort2(r4[0], r4[1]); sort2(r4[2], r4[3]);
+    sort2(r4[0], r4[2]); sort2(r4[1], r4[3]);
+    sort2(r4[1], r4[2]);
+    const int n4 = (r4[0] == r4[0]) + (r4[1] == r4[1]) + (r4[2] == r4[2]) + (r4[3] == r4[3]);
+
+    T w0, w1, w2;
+    const int n3 = cubic(c0, c1, c2, c3, w0, w1, w2);
+    const bool deg4 = c4 != 0;
+    x0 = deg4 ? r4[0] : w0;
+    x1 = deg4 ? r4[1] : w1;
+    x2 = deg4 ? r4[2] : w2;
+    x3 = deg4 ? r4[3] : nan<T>();
+    return deg4 ? n4 : n3;
+}
+
+}
+
+/*! Solve \p n quadratics c2*x^2 + c1*x + c0 = 0. */
+template<class T> inline void polysolve2nd_batch(size_t n,
+                                                 const T* c0, const T* c1, const T* c2,
+                                                 T* x0, T* x1, int* nroots)
+{
+    for (size_t i = 0; i < n; i++) {
+        nroots[i] = polysolve_detail::quad(c0[i], c1[i], c2[i], x0[i], x1[i]);
+    }
+}
+
+/*! Solve \p n cubics c3*x^3 + c2*x^2 + c1*x + c0 = 0. */
+template<class T> inline void polysolve3rd_batch(size_t n,
+                                                 const T* c0, const T* c1, const T* c2, const T* c3,
+                                                 T* x0, T* x1, T* x2, int* nroots)
+{
+    for (size_t i = 0; i < n; i++) {
+        nroots[i] = polysolve_detail::cubic(c0[i], c1[i], c2[i], c3[i], x0[i], x1[i], x2[i]);
+    }
+}
+
+/*! Solve \p n quartics c4*x^4 + c3*x^3 + c2*x^2 + c1*x + c0 = 0.
+ *
+ * The resolvent cubic loses too much precision in single precision, so
+ * \c float equations are solved in \c double.
+ */
+template<class T> inline void polysolve4th_batch(size_t n,
+                                                 const T* c0, const T* c1, const T* c2, const T* c3, const T* c4,
+                                                 T* x0, T* x1, T* x2, T* x3, int* nroots)
+{
+    typedef typename std::conditional<(sizeof(T) < sizeof(double)), double, T>::type W;
+    for (size_t i = 0; i < n; i++) {
+        W y0, y1, y2, y3;
+        nroots[i] = polysolve_detail::quartic<W>(c0[i], c1[i], c2[i], c3[i], c4[i], y0, y1, y2, y3);
+        x0[i] = static_cast<T>(y0); x1[i] = static_cast<T>(y1);
+        x2[i] = static_cast<T>(y2); x3[i] = static_cast<T>(y3);
+    }
+}
+/* @} */
@@ -18,3 +18,57 @@ inline T T_polyval(T x, T *coeffs, int n)
         y = coeffs[j] + x * y;
     return y;
 }
+
+/*! Evaluate polynomial c[0] + c[1]*x + ... + c[deg]*x^deg at \p x by
+ * Estrin's scheme, which pairs terms so the dependency chain is
+ * O(log(deg)) instead of O(deg). Fastest for a single point of high degree.
+ */
+template<class T>
+inline T polyval_estrin(const T* c, size_t deg, T x)
+{
+    T b[32];                    // pairs (c[2i] + c[2i+1]*x)
+    if (deg >= 64) {            // fall back to Horner for very high degree
+        T y = c[deg];
+        for (size_t j = deg; j-- > 0;) { y = c[j] + x * y; }
+        return y;
+    }
+    size_t m = deg + 1;
+    for (size_t i = 0; i < m / 2; i++) { b[i] = c[2*i] + c[2*i + 1] * x; }
+    if (m & 1) { b[m / 2] = c[m - 1]; }
+    m = (m + 1) / 2;
+    T xp = x * x;
+    while (m > 1) {
+        for (size_t i = 0; i < m / 2; i++) { b[i] = b[2*i] + b[2*i + 1] * xp; }
+        if (m & 1) { b[m / 2] = b[m - 1]; }
+        m = (m + 1) / 2;
+        xp *= xp;
+    }
+    return b[0];
+}
+
+/*! Evaluate polynomial c[0] + c[1]*x + ... + c[deg]*x^deg at the \p n
+ * points \p x into \p y.
+ *
+ * Runs Horner's rule on blocks of 16 points at once so the independent
+ * chains fill the vector units and hide multiply-add latency.
+ */
+template<class T>
+inline void polyval_batch(const T* c, size_t deg, const T* x, T* y, size_t n)
+{
+    const size_t W = 16;
+    size_t i = 0;
+    for (; i + W <= n; i += W) {
+        T acc[W], xv[W];
+        for (size_t l = 0; l < W; l++) { acc[l] = c[deg]; xv[l] = x[i + l]; }
+        for (size_t j = deg; j-- > 0;) {
+            const T cj = c[j];
+            for (size_t l = 0; l < W; l++) { acc[l] = cj + xv[l] * acc[l]; }
+        }
+        for (size_t l = 0; l < W; l++) { y[i + l] = acc[l]; }
+    }
+    for (; i < n; i++) {
+        T a = c[deg];
+        for (size_t j = deg; j-- > 0;) { a = c[j] + x[i] * a; }
+        y[i] = a;
+    }
+}
@@ -35,10 +35,97 @@
  */
 
 #pragma once
+#include <algorithm>
+#include <thread>
+#include <vector>
+#include "opt_batch.hpp"
+#include "rand_streams.hpp"
 
-/*! Particle Swarm Optimization. */
+/*! Particle Swarm Optimization.
+ *
+ * Minimizes batched objective \p fn over \p n variables in the box [\p
+ * lower, \p upper] using a global-best swarm of \p nparticles particles with
+ * constriction coefficients (Clerc). All particle positions of an iteration
+ * are evaluated in one call to \p fn. Velocity and position updates are
+ * split over a \c pnw::opt::thread_team of \p nthreads threads, each
+ * drawing its random factors in bulk from its own stream (\p seed, thread
+ * index) so results are reproducible for a given thread count.
+ *
+ * Until \p fn returns a value below the maximum of \p T, which NaN never is,
+ * particles are only drawn to their personal best, and if it never does
+ * the result has an empty \c xmin.
+ */
 template<class T>
 inline
-void pso()
+pnw::opt::result<T> pso(const pnw::opt::batch_fn<T>& fn, size_t n,
+                        const T* lower, const T* upper,
+                        size_t nparticles = 20,
+                        size_t max_iters = 1000,
+                        uint64_t seed = 0,
+                        size_t nthreads = std::thread::hardware_concurrency(),
+                        const T w = 0.7298,   // inertia weight
+                        const T c1 = 1.49618, // cognitive (personal best) weight
+                        const T c2 = 1.49618) // social (global best) weight
 {
+    pnw::opt::result<T> res;
+    const size_t np = nparticles;
+    nthreads = std::max<size_t>(1, std::min(nthreads, np));
+
+    std::vector<pnw::xoshiro256ss_x4> rngs;
+    for (size_t t = 0; t < nthreads; ++t) { rngs.emplace_back(seed, t); }
+    pnw::opt::thread_team team(nthreads);
+
+    std::vector<T> x(np*n), v(np*n), fx(np), fpbest(np, std::numeric_limits<T>::max());
+
+    // Random initial positions and velocities.
+    rngs[0].fill_uniform(x.data(), np*n);
+    rngs[0].fill_uniform(v.data(), np*n);
+    for (size_t p = 0; p < np; ++p) {
+        for (size_t i = 0; i < n; ++i) {
+            const T span = upper[i] - lower[i];
+            x[p*n+i] = lower[i] + x[p*n+i] * span;
+            v[p*n+i] = (2 * v[p*n+i] - 1) * span;
+        }
+    }
+    std::vector<T> pbest(x);
+
+    // Update particles [first last) using stream \p rng.
+    auto update = [&](size_t first, size_t last, pnw::xoshiro256ss_x4& rng) {
+        std::vector<T> r((last - first) * n * 2);
+        rng.fill_uniform(r.data(), r.size());
+        const T* g = res.xmin.empty() ? nullptr : res.xmin.data(); // global best
+        for (size_t p = first; p < last; ++p) {
+            const T* r1 = &r[(p - first) * n * 2];
+            const T* r2 = r1 + n;
+            T* xp = &x[p*n];
+            T* vp = &v[p*n];
+            const T* bp = &pbest[p*n];
+            const T* gp = g ? g : bp;
+            for (size_t i = 0; i < n; ++i) {
+                const T vmax = upper[i] - lower[i];
+                vp[i] = w * vp[i] + c1 * r1[i] * (bp[i] - xp[i]) + c2 * r2[i] * (gp[i] - xp[i]);
+                vp[i] = std::max(-vmax, std::min(vmax, vp[i]));
+                xp[i] = std::max(lower[i], std::min(upper[i], xp[i] + vp[i]));
+            }
+        }
+    };
+
+    for (res.niters = 0; res.niters < max_iters; ++res.niters) {
+        fn(x.data(), np, n, fx.data());
+        res.nevals += np;
+        for (size_t p = 0; p < np; ++p) {
+            if (fx[p] < fpbest[p]) {
+                fpbest[p] = fx[p];
+                std::copy(&x[p*n], &x[p*n] + n, &pbest[p*n]);
+            }
+            res.offer(&x[p*n], n, fx[p]);
+        }
+
+        const size_t chunk = (np + nthreads - 1) / nthreads;
+        team.run([&](size_t t) {
+                const size_t first = std::min(np, t * chunk), last = std::min(np, first + chunk);
+                update(first, last, rngs[t]);
+            });
+    }
+    return res;
 }
@@ -1,8 +1,7 @@
 #include "rand.hpp"
-
-#include <ext/random>
+#include "rand_streams.hpp"
 
 /*! Randomized \p n elements at \p first. */
-int32_t* rand_n(int32_t* first, size_t n) { __gnu_cxx::sfmt607 r; std::generate(first, first + n, r); return first + n; }
+int32_t* rand_n(int32_t* first, size_t n) { pnw::thread_rand_stream().fill_u32(reinterpret_cast<uint32_t*>(first), n); return first + n; }
 /*! Randomized \p n elements at \p first. */
-int64_t* rand_n(int64_t* first, size_t n) { __gnu_cxx::sfmt607_64 r; std::generate(first, first + n, r); return first + n; }
+int64_t* rand_n(int64_t* first, size_t n) { pnw::thread_rand_stream().fill_u64(reinterpret_cast<uint64_t*>(first), n); return first + n; }
@@ -0,0 +1,285 @@
+/*! \file rand_streams.hpp
+ * \brief Fast Bulk and Parallel Random Number Streams.
+ * \author Copyright (C) 2012 Per Nordlöw (per.nordlow@gmail.com)
+ *
+ * Counterpart to the per-call generators in rand.hpp for code that needs
+ * many random numbers at once: \c xoshiro256** with four interleaved lanes
+ * advanced together as one GCC vector (AVX2 when enabled), bulk fills of
+ * uniform integers and reals and of normal deviates, and independent
+ * reproducible streams via jump-ahead.
+ *
+ * A stream is identified by (\c seed, \c index). Stream \c index starts
+ * \c index * 2^192 steps into the sequence of \c seed and its lanes are
+ * 2^128 steps apart, so streams handed to different threads never overlap
+ * in practice.
+ *
+ * \see http://prng.di.unimi.it/
+ * \see https://arxiv.org/abs/1805.10941 (Lemire, Bounded Integers)
+ */
+
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <cmath>
+#include <limits>
+
+namespace pnw
+{
+
+/*! SplitMix64 step used to expand seeds into generator states. */
+inline uint64_t splitmix64(uint64_t& x)
+{
+    uint64_t z = (x += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+/*! Scalar \c xoshiro256** Generator.
+ *
+ * Models \em UniformRandomBitGenerator so it can be used with the \c
+ * <random> distributions.
+ */
+class xoshiro256ss
+{
+public:
+    typedef uint64_t result_type;
+
+    explicit xoshiro256ss(uint64_t seed = 0x853c49e6748fea9bULL) { this->seed(seed); }
+
+    /// Seed from \p seed through SplitMix64.
+    void seed(uint64_t seed)
+    {
+        for (int i = 0; i < 4; i++) { s[i] = splitmix64(seed); }
+    }
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+
+    result_type operator () ()
+    {
+        const uint64_t r = rotl(s[1] * 5, 7) * 9;
+        const uint64_t t = s[1] << 17;
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = rotl(s[3], 45);
+        return r;
+    }
+
+    /// Advance 2^128 steps.
+    void jump()
+    {
+        static const uint64_t J[] = { 0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL,
+                                      0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL };
+        jump_by(J);
+    }
+    /// Advance 2^192 steps.
+    void long_jump()
+    {
+        static const uint64_t J[] = { 0x76e15d3efefdcbbfULL, 0xc5004e441c522fb3ULL,
+                                      0x77710069854ee241ULL, 0x39109bb02acbe635ULL };
+        jump_by(J);
+    }
+
+    /// Get state word \p i.
+    uint64_t state(int i) const { return s[i]; }
+
+private:
+    static uint64_t rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+    void jump_by(const uint64_t* J)
+    {
+        uint64_t t[4] = { 0, 0, 0, 0 };
+        for (int i = 0; i < 4; i++) {
+            for (int b = 0; b < 64; b++) {
+                if (J[i] & (static_cast<uint64_t>(1) << b)) {
+                    for (int k = 0; k < 4; k++) { t[k] ^= s[k]; }
+                }
+                (*this)();
+            }
+        }
+        for (int k = 0; k < 4; k++) { s[k] = t[k]; }
+    }
+
+    uint64_t s[4];              ///< State.
+};
+
+/*! Four-Lane Vectorized \c xoshiro256** Stream.
+ *
+ * Lane \c l is a scalar \c xoshiro256** jumped \c l times, so four outputs
+ * are produced per step using only shifts, xors and adds (no 64-bit vector
+ * multiply needed).
+ *
+ * Lane states are kept as plain words and loaded into vectors per step, so
+ * a stream needs no more than 8-byte alignment and can live in a \c
+ * std::vector or on the heap also when built with AVX enabled.
+ */
+class xoshiro256ss_x4
+{
+public:
+    typedef uint64_t result_type;
+    typedef uint64_t v4u __attribute__ ((vector_size (4*sizeof(uint64_t))));
+
+    /// Construct stream number \p index of \p seed.
+    explicit xoshiro256ss_x4(uint64_t seed = 0x853c49e6748fea9bULL, uint64_t index = 0) { this->seed(seed, index); }
+
+    /// Reseed to stream number \p index of \p seed.
+    void seed(uint64_t seed, uint64_t index = 0)
+    {
+        xoshiro256ss g(seed);
+        for (uint64_t i = 0; i < index; i++) { g.long_jump(); }
+        for (int l = 0; l < 4; l++) {
+            for (int i = 0; i < 4; i++) { m_s[i][l] = g.state(i); }
+            g.jump();
+        }
+        m_pos = 4;
+    }
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+
+    /// Get next value (buffered from four lanes).
+    result_type operator () ()
+    {
+        if (m_pos == 4) { const v4u r = next4(); __builtin_memcpy(m_buf, &r, sizeof(r)); m_pos = 0; }
+        return m_buf[m_pos++];
+    }
+
+    /// Advance all lanes one step and return their four outputs.
+    v4u next4()
+    {
+        v4u s0, s1, s2, s3;
+        __builtin_memcpy(&s0, m_s[0], sizeof(s0));
+        __builtin_memcpy(&s1, m_s[1], sizeof(s1));
+        __builtin_memcpy(&s2, m_s[2], sizeof(s2));
+        __builtin_memcpy(&s3, m_s[3], sizeof(s3));
+        const v4u x = s1 + (s1 << 2);                   // s1 * 5
+        const v4u y = (x << 7) | (x >> 57);             // rotl(., 7)
+        const v4u r = y + (y << 3);                     // * 9
+        const v4u t = s1 << 17;
+        s2 ^= s0;
+        s3 ^= s1;
+        s1 ^= s2;
+        s0 ^= s3;
+        s2 ^= t;
+        s3 = (s3 << 45) | (s3 >> 19);
+        __builtin_memcpy(m_s[0], &s0, sizeof(s0));
+        __builtin_memcpy(m_s[1], &s1, sizeof(s1));
+        __builtin_memcpy(m_s[2], &s2, sizeof(s2));
+        __builtin_memcpy(m_s[3], &s3, sizeof(s3));
+        return r;
+    }
+
+    /// \name Bulk Fills.
+    /// \{
+    /// Fill \p out with \p n uniform 64-bit values.
+    void fill_u64(uint64_t* out, size_t n)
+    {
+        size_t i = 0;
+        for (; i < n and m_pos < 4; i++) { out[i] = m_buf[m_pos++]; }
+        for (; i + 4 <= n; i += 4) {
+            const v4u r = next4();
+            __builtin_memcpy(out + i, &r, sizeof(r));
+        }
+        for (; i < n; i++) { out[i] = (*this)(); }
+    }
+    /// Fill \p out with \p n uniform 32-bit values.
+    void fill_u32(uint32_t* out, size_t n)
+    {
+        size_t i = 0;
+        for (; i + 8 <= n; i += 8) {
+            const v4u r = next4();
+            __builtin_memcpy(out + i, &r, sizeof(r));
+        }
+        for (; i < n; i++) { out[i] = static_cast<uint32_t>((*this)() >> 32); }
+    }
+    /// Fill \p out with \p n uniform values in [\p l, \p h).
+    void fill_uniform(double* out, size_t n, double l = 0.0, double h = 1.0)
+    {
+        fill_u64(reinterpret_cast<uint64_t*>(out), n);
+        const double scale = (h - l) * 0x1.0p-53;
+        for (size_t i = 0; i < n; i++) {
+            const uint64_t u = reinterpret_cast<const uint64_t*>(out)[i];
+            out[i] = l + static_cast<double>(u >> 11) * scale;
+        }
+    }
+    /// Fill \p out with \p n uniform values in [\p l, \p h).
+    void fill_uniform(float* out, size_t n, float l = 0.0f, float h = 1.0f)
+    {
+        fill_u32(reinterpret_cast<uint32_t*>(out), n);
+        const float scale = (h - l) * 0x1.0p-24f;
+        for (size_t i = 0; i < n; i++) {
+            const uint32_t u = reinterpret_cast<const uint32_t*>(out)[i];
+            out[i] = l + static_cast<float>(u >> 8) * scale;
+        }
+    }
+    /*! Fill \p out with \p n unbiased uniform integers in [\p l, \p h].
+     *
+     * Uses Lemire's multiply-and-shift with rejection of the (rare) biased
+     * low products.
+     */
+    template<class T> void fill_int(T* out, size_t n, T l, T h)
+    {
+        const uint64_t r = static_cast<uint64_t>(h) - static_cast<uint64_t>(l) + 1; // 0 means full range
+        for (size_t i = 0; i < n; i++) {
+            out[i] = static_cast<T>(static_cast<uint64_t>(l) + bounded(r));
+        }
+    }
+    /// Get unbiased uniform integer in [0, \p r), or any value if \p r is zero.
+    uint64_t bounded(uint64_t r)
+    {
+        uint64_t x = (*this)();
+        if (r == 0) { return x; }
+        unsigned __int128 m = static_cast<unsigned __int128>(x) * r;
+        uint64_t lo = static_cast<uint64_t>(m);
+        if (lo < r) {
+            const uint64_t t = -r % r;
+            while (lo < t) {
+                x = (*this)();
+                m = static_cast<unsigned __int128>(x) * r;
+                lo = static_cast<uint64_t>(m);
+            }
+        }
+        return static_cast<uint64_t>(m >> 64);
+    }
+    /// Fill \p out with \p n normal deviates of \p mean and standard deviation \p sd (Box-Muller).
+    template<class T> void fill_normal(T* out, size_t n, T mean = 0, T sd = 1)
+    {
+        fill_uniform(out, n);
+        const T two_pi = static_cast<T>(2 * M_PI);
+        for (size_t i = 0; i + 1 < n; i += 2) {
+            const T u1 = static_cast<T>(1) - out[i]; // (0, 1]
+            const T u2 = out[i + 1];
+            const T r = sd * std::sqrt(static_cast<T>(-2) * std::log(u1));
+            out[i]     = mean + r * std::cos(two_pi * u2);
+            out[i + 1] = mean + r * std::sin(two_pi * u2);
+        }
+        if (n % 2) {
+            T u[2];
+            fill_uniform(u, 2);
+            out[n - 1] = mean + sd * std::sqrt(static_cast<T>(-2) * std::log(static_cast<T>(1) - u[0])) * std::cos(two_pi * u[1]);
+        }
+    }
+    /// \}
+
+private:
+    uint64_t m_s[4][4];         ///< State word \c i of lane \c l at <tt>[i][l]</tt>.
+    uint64_t m_buf[4];          ///< Buffered outputs of last \c next4().
+    int m_pos;                  ///< Next unused index in \c m_buf.
+};
+
+/*! Get the calling thread's default stream.
+ *
+ * Each thread gets its own stream index the first time it calls this, in
+ * order of first use.
+ */
+inline xoshiro256ss_x4& thread_rand_stream()
+{
+    static uint64_t next_index = 0;
+    thread_local xoshiro256ss_x4 g(0x853c49e6748fea9bULL, __atomic_fetch_add(&next_index, 1, __ATOMIC_RELAXED));
+    return g;
+}
+
+}
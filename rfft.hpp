@@ -0,0 +1,129 @@
+/*! \file rfft.hpp
+ * \brief Planned Real-Valued FFT.
+ * \author Copyright (C) 2012 Per Nordlöw (per.nordlow@gmail.com)
+ * \see fft.hpp for the unplanned reference transforms.
+ *
+ * A plan precomputes bit-reversal and all twiddle factors once, so
+ * repeated transforms of the same size, as in block convolution, do no
+ * trigonometry. Complex data is kept split into real and imaginary arrays
+ * so that the butterflies run over contiguous memory and vectorize.
+ */
+
+#pragma once
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <vector>
+
+namespace pnw
+{
+
+/*! Smallest power of two >= \p n. */
+inline size_t pow2_ceil(size_t n) { size_t p = 1; while (p < n) { p *= 2; } return p; }
+
+/*!
+ * Real FFT Plan of size \c n, a power of two >= 4.
+ *
+ * The length \c n real transform is done as a complex one of length \c n/2
+ * on the even/odd samples followed by a split step, giving bins [0, n/2].
+ */
+template<class T>
+class rfft_plan {
+public:
+    explicit rfft_plan(size_t n)
+        : m_m(n / 2), m_rev(m_m), m_tw_re(m_m), m_tw_im(m_m),
+          m_rt_re(m_m + 1), m_rt_im(m_m + 1), m_z_re(m_m), m_z_im(m_m) {
+        size_t lg = 0;
+        while ((size_t(1) << lg) < m_m) { lg++; }
+        for (size_t i = 0; i < m_m; i++) {
+            uint32_t r = 0;
+            for (size_t b = 0; b < lg; b++) { r |= ((i >> b) & 1) << (lg - 1 - b); }
+            m_rev[i] = r;
+        }
+        // stage with half-length h uses exp(-i*pi*j/h) at [h-1, 2h-1)
+        for (size_t h = 1; h < m_m; h *= 2) {
+            for (size_t j = 0; j < h; j++) {
+                m_tw_re[h - 1 + j] = T(std::cos(M_PI * j / h));
+                m_tw_im[h - 1 + j] = T(-std::sin(M_PI * j / h));
+            }
+        }
+        for (size_t k = 0; k <= m_m; k++) {
+            m_rt_re[k] = T(std::cos(M_PI * k / m_m));
+            m_rt_im[k] = T(-std::sin(M_PI * k / m_m));
+        }
+    }
+
+    size_t size() const { return 2 * m_m; } ///< Number of real samples.
+    size_t nbins() const { return m_m + 1; } ///< Number of output bins.
+
+    /// Forward transform of size() samples \p x into nbins() bins of \p X_re and \p X_im.
+    void forward(const T* x, T* X_re, T* X_im) {
+        const size_t m = m_m;
+        for (size_t k = 0; k < m; k++) { m_z_re[k] = x[2*k]; m_z_im[k] = x[2*k + 1]; }
+        complex(false);
+        const T* zr = m_z_re.data();
+        const T* zi = m_z_im.data();
+        for (size_t k = 0; k <= m; k++) {
+            const size_t j = k % m, c = (m - k) % m;
+            const T er = T(0.5) * (zr[j] + zr[c]), ei = T(0.5) * (zi[j] - zi[c]);
+            const T or_ = T(0.5) * (zi[j] + zi[c]), oi = T(-0.5) * (zr[j] - zr[c]);
+            X_re[k] = er + m_rt_re[k] * or_ - m_rt_im[k] * oi;
+            X_im[k] = ei + m_rt_re[k] * oi + m_rt_im[k] * or_;
+        }
+    }
+
+    /// Inverse of forward(): nbins() bins into size() samples \p x, multiplied by \p scale.
+    void inverse(const T* X_re, const T* X_im, T* x, T scale = 1) {
+        const size_t m = m_m;
+        for (size_t k = 0; k < m; k++) {
+            const size_t c = m - k;
+            const T er = T(0.5) * (X_re[k] + X_re[c]), ei = T(0.5) * (X_im[k] - X_im[c]);
+            const T dr = T(0.5) * (X_re[k] - X_re[c]), di = T(0.5) * (X_im[k] + X_im[c]);
+            const T or_ = dr * m_rt_re[k] + di * m_rt_im[k]; // D * conj(rt[k])
+            const T oi = di * m_rt_re[k] - dr * m_rt_im[k];
+            m_z_re[k] = er - oi;
+            m_z_im[k] = ei + or_;
+        }
+        complex(true);
+        const T s = scale / T(m);
+        for (size_t k = 0; k < m; k++) { x[2*k] = m_z_re[k] * s; x[2*k + 1] = m_z_im[k] * s; }
+    }
+
+private:
+    /// In-place radix-2 transform of \c m_z, unscaled inverse if \p inv.
+    void complex(bool inv) {
+        const size_t m = m_m;
+        T* __restrict re = m_z_re.data();
+        T* __restrict im = m_z_im.data();
+        for (size_t i = 0; i < m; i++) {
+            const size_t r = m_rev[i];
+            if (i < r) { std::swap(re[i], re[r]); std::swap(im[i], im[r]); }
+        }
+        const T sign = inv ? T(-1) : T(1);
+        for (size_t h = 1; h < m; h *= 2) {
+            const T* __restrict wr = m_tw_re.data() + h - 1;
+            const T* __restrict wi = m_tw_im.data() + h - 1;
+            for (size_t i = 0; i < m; i += 2 * h) {
+                T* __restrict ar = re + i;
+                T* __restrict ai = im + i;
+                T* __restrict br = re + i + h;
+                T* __restrict bi = im + i + h;
+                for (size_t j = 0; j < h; j++) { // contiguous, vectorizes for h >= 8
+                    const T tr = br[j] * wr[j] - bi[j] * sign * wi[j];
+                    const T ti = br[j] * sign * wi[j] + bi[j] * wr[j];
+                    br[j] = ar[j] - tr; bi[j] = ai[j] - ti;
+                    ar[j] += tr; ai[j] += ti;
+                }
+            }
+        }
+    }
+
+    size_t m_m;                 ///< Complex transform size.
+    std::vector<uint32_t> m_rev;
+    std::vector<T> m_tw_re, m_tw_im; ///< Per-stage twiddles.
+    std::vector<T> m_rt_re, m_rt_im; ///< Split-step twiddles.
+    std::vector<T> m_z_re, m_z_im;   ///< Work buffer.
+};
+
+}
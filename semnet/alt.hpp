@@ -74,6 +74,10 @@ public:
 
     /*! Set Complementary Status to \p complement. */
     Alt* set_complement(bool complement) { if (m_complement != complement) { unprepare(); } m_complement = complement; return this; }
+    bool is_complement() const { return m_complement; }
+
+    /// Get Sub Alternatives.
+    const Alts& get_subs() const { return m_subs; }
 
     // TODO: Replace \c mutating_canonicalize with expression templates when use smart pointers.
     // friend Alt* operator | (Base* a, Base* b) { return (new Alt(a, b))->mutating_canonicalize(); }
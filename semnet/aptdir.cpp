@@ -12,25 +12,26 @@ APTDir::new_sub(const csc& name, bool dir_flag)
     {
         net_connectS(REL_PARENT, this,
                      REL_CHILD, sub);
-        if (m_subs_hash.insert(sub, name.size(), name.data()) == -1) {
-            PERR("name already present in m_subs_hash\n");
+        if (not m_subs.emplace(name, sub).second) {
+            PERR("name already present in m_subs\n");
         }
         return sub;
     } else { PERR("sub could not be allocated\n"); return nullptr; }
 }
 
-URI * APTDir::lookup_sub(const csc& name)
+URI * APTDir::lookup_sub(const char * name, size_t name_N)
 {
-    return reinterpret_cast<URI*>(m_subs_hash.get(name.size(), name.data()));
+    auto hit = m_subs.find(csc(name, name_N));
+    return hit != m_subs.end() ? hit->second : nullptr;
 }
 
-URI * APTDir::get_sub(const csc& name, bool dir_flag, bool * load_flag)
+URI * APTDir::get_sub(const char * name, size_t name_N, bool dir_flag, bool * load_flag)
 {
-    if (URI * file = lookup_sub(name)) {
+    if (URI * file = lookup_sub(name, name_N)) {
         return file;
     } else {
         if (load_flag) { *load_flag = true; }
-        return new_sub(name, dir_flag);
+        return new_sub(csc(name, name_N), dir_flag);
     }
 }
 
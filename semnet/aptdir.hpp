@@ -5,7 +5,7 @@
 
 #pragma once
 #include "uri.hpp"
-#include "../xhash.hpp"
+#include <unordered_map>
 
 namespace semnet {
 namespace filesystem {
@@ -17,18 +17,21 @@ public:
     virtual OB_t get_type() const { return OB_APTDIR; }
     APTDir(const csc& name) : URI(name) {}
     virtual ~APTDir() {}
-    URI* get_sub(const csc& name, bool dir_flag, bool * load_flag = nullptr);
+    URI* get_sub(const csc& name, bool dir_flag, bool * load_flag = nullptr) {
+        return get_sub(name.data(), name.size(), dir_flag, load_flag);
+    }
+    /// Get sub named \p name of length \p name_N, loading it if not present.
+    URI* get_sub(const char * name, size_t name_N, bool dir_flag, bool * load_flag = nullptr);
 protected:
     URI* new_sub(const csc& name, bool dir_flag);
-    URI* lookup_sub(const csc& name);
+    URI* lookup_sub(const char * name, size_t name_N);
 private:
     /*!
-     * \em Sub-Files/Dirs \em Name Hash Table. Hashes from
-     * string to pointer. Used by inotify \c speedup lookups from a
-     * working-dir-relative filename to a \c Ob typically a sub-
-     * \c Dir / @c File.
+     * \em Sub-Files/Dirs by \em Name. Grows with the number of subs, as
+     * directories such as \c usr/share/doc in a Contents index have tens
+     * of thousands.
      */
-    mutable xHash m_subs_hash;
+    std::unordered_map<csc, URI*> m_subs;
 };
 
 }
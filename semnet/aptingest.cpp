@@ -0,0 +1,293 @@
+#include "aptingest.hpp"
+#include "../zlib_utils.h"
+#include "../bz2_utils.h"
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace semnet {
+
+/// Chunk of Whole Lines.
+struct APTIngest::Chunk {
+    const char * dat;
+    size_t len;
+    bool first;                 ///< First chunk, which may hold preamble.
+    std::vector<char> own;      ///< Decompressed bytes at \c dat, empty if \c dat is mapped.
+    bool done = false;          ///< Parsed.
+    size_t lines = 0;
+    std::vector<Entry> entries;
+};
+
+/// Chunks Shared by Reader, Workers and Consumer.
+struct APTIngest::Queue {
+    std::mutex mtx;
+    std::condition_variable work;  ///< Signalled on new chunk or read done.
+    std::condition_variable ready; ///< Signalled when first chunk in flight is done.
+    std::condition_variable room;  ///< Signalled when a chunk leaves flight.
+    std::deque<std::unique_ptr<Chunk> > flight; ///< Chunks in flight, in file order.
+    std::deque<Chunk*> todo;    ///< Chunks not yet taken by a worker.
+    size_t window = 1;
+    void * map = MAP_FAILED;    ///< Mapping of index file.
+    size_t map_len = 0;
+    bool read = false;          ///< Read done.
+    bool failed = false;        ///< Read or decompression failed.
+    bool stop = false;          ///< Run is abandoned, so reader and workers quit.
+};
+
+/// Stopper and Joiner of the Threads of a Run, also when unwound by an exception.
+struct APTIngest::Crew {
+    Queue& q;
+    std::vector<std::thread> threads;
+    ~Crew() {
+        {
+            std::lock_guard<std::mutex> lock(q.mtx);
+            q.stop = true;
+        }
+        q.work.notify_all();
+        q.room.notify_all();
+        for (auto& t : threads) {
+            if (t.joinable()) { t.join(); }
+        }
+        if (q.map != MAP_FAILED) { ::munmap(q.map, q.map_len); }
+    }
+};
+
+namespace {
+
+const size_t BLOCK_SIZE = 1 << 18; ///< Decompressed block byte size.
+
+inline bool is_blank(char c) { return c == ' ' or c == '\t'; }
+
+inline bool has_suffix(const csc& s, const char * suf)
+{
+    const size_t n = strlen(suf);
+    return s.size() >= n and s.compare(s.size() - n, n, suf) == 0;
+}
+
+/// Get end of preamble ended by "FILE  LOCATION" in \p dat of length \p len, or 0 if none.
+size_t preamble_end(const char * dat, size_t len)
+{
+    const char * p = dat, * end = dat + len;
+    for (size_t i = 0; i < 64 and p < end; i++) { // preamble is short
+        const char * nl = static_cast<const char*>(memchr(p, '\n', end - p));
+        const char * e = nl ? nl : end;
+        if (e - p >= 4 and memcmp(p, "FILE", 4) == 0) {
+            const char * q = p + 4;
+            while (q < e and is_blank(*q)) { q++; }
+            if (q > p + 4 and e - q >= 8 and memcmp(q, "LOCATION", 8) == 0) {
+                return nl ? nl + 1 - dat : len;
+            }
+        }
+        p = e + 1;
+    }
+    return 0;
+}
+
+}
+
+APTIngest::APTIngest()
+    : APTIngest(Options())
+{
+}
+
+APTIngest::APTIngest(const Options& opts)
+    : m_opts(opts)
+{
+    m_opts.nthreads = std::max<size_t>(m_opts.nthreads, 1);
+    m_opts.chunk = std::max<size_t>(m_opts.chunk, 1);
+    if (m_opts.window == 0) { m_opts.window = 4 * m_opts.nthreads; }
+}
+
+APTIngest::~APTIngest()
+{
+}
+
+/* ---------------------------- Group Separator ---------------------------- */
+
+bool
+APTIngest::parse_line(const char * line, size_t len, Entry& e)
+{
+    while (len and (is_blank(line[len - 1]) or line[len - 1] == '\r')) { len--; }
+    size_t i = len;             // packages begin after last blank, as paths may contain blanks
+    while (i and not is_blank(line[i - 1])) { i--; }
+    if (i == 0) { return false; }
+    size_t j = i;               // path end
+    while (j and is_blank(line[j - 1])) { j--; }
+    const char * path = line;
+    if (j >= 2 and path[0] == '.' and path[1] == '/') { path += 2; j -= 2; }
+    if (j == 0) { return false; }
+    e.path = path;
+    e.pathN = j;
+    e.pkgs = line + i;
+    e.pkgsN = len - i;
+    return true;
+}
+
+bool
+APTIngest::push(Queue& q, Chunk * chunk) const
+{
+    std::unique_ptr<Chunk> c(chunk);
+    std::unique_lock<std::mutex> lock(q.mtx);
+    q.room.wait(lock, [&q]() { return q.flight.size() < q.window or q.stop; });
+    if (q.stop) { return false; }
+    q.todo.push_back(c.get());
+    q.flight.push_back(std::move(c));
+    q.work.notify_one();
+    return true;
+}
+
+void
+APTIngest::read(const csc& path, Queue& q) const
+{
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) { q.failed = true; return; }
+    struct stat st;
+    if (::fstat(fd, &st) != 0) { ::close(fd); q.failed = true; return; }
+    const size_t len = st.st_size;
+    if (len == 0) { ::close(fd); return; }
+    q.map = ::mmap(nullptr, len, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);                // mapping stays valid
+    if (q.map == MAP_FAILED) { q.failed = true; return; }
+    q.map_len = len;
+    ::madvise(q.map, len, MADV_SEQUENTIAL);
+    const char * dat = static_cast<const char*>(q.map);
+
+    const bool gz = has_suffix(path, ".gz"), bz2 = has_suffix(path, ".bz2");
+    if (not (gz or bz2)) {      // chunks point into mapping
+        for (size_t off = 0; off < len;) {
+            size_t end = std::min(off + m_opts.chunk, len);
+            if (auto nl = static_cast<const char*>(memchr(dat + end - 1, '\n', len - end + 1))) {
+                end = nl + 1 - dat;
+            } else {
+                end = len;
+            }
+            Chunk * c = new Chunk;
+            c->dat = dat + off;
+            c->len = end - off;
+            c->first = (off == 0);
+            if (not push(q, c)) { return; }
+            off = end;
+        }
+        return;
+    }
+
+    /// Decompressed Block Sink, cutting blocks into chunks at line ends.
+    struct Sink {
+        const APTIngest * self;
+        Queue * q;
+        std::vector<char> buf;
+        bool first = true;
+        bool emit(size_t n) {
+            Chunk * c = new Chunk;
+            c->own.swap(buf);
+            buf.assign(c->own.begin() + n, c->own.end()); // rest of last line
+            buf.reserve(self->m_opts.chunk + BLOCK_SIZE);
+            c->own.resize(n);
+            c->dat = c->own.data();
+            c->len = n;
+            c->first = first;
+            first = false;
+            return self->push(*q, c);
+        }
+        static int put(void * ctx, const void * blk, size_t n) {
+            auto s = static_cast<Sink*>(ctx);
+            auto b = static_cast<const char*>(blk);
+            s->buf.insert(s->buf.end(), b, b + n);
+            if (s->buf.size() >= s->self->m_opts.chunk) {
+                if (auto nl = static_cast<const char*>(memrchr(s->buf.data(), '\n', s->buf.size()))) {
+                    if (not s->emit(nl + 1 - s->buf.data())) { return -1; } // stopped
+                }
+            }
+            return 0;
+        }
+    };
+    Sink sink;
+    sink.self = this;
+    sink.q = &q;
+    sink.buf.reserve(m_opts.chunk + BLOCK_SIZE);
+    const int ret = (gz ?
+                     (zlib_decompress_cb(dat, len, BLOCK_SIZE, Sink::put, &sink) == Z_OK ? 0 : -1) :
+                     bzip2_decode_cb(dat, len, BLOCK_SIZE, Sink::put, &sink));
+    if (not sink.buf.empty()) { sink.emit(sink.buf.size()); }
+    if (ret != 0) { q.failed = true; }
+}
+
+void
+APTIngest::work(Queue& q) const
+{
+    for (;;) {
+        Chunk * c = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(q.mtx);
+            q.work.wait(lock, [&q]() { return not q.todo.empty() or q.read or q.stop; });
+            if (q.todo.empty() or q.stop) { break; }
+            c = q.todo.front();
+            q.todo.pop_front();
+        }
+        const char * p = c->dat, * end = c->dat + c->len;
+        if (c->first) { p += preamble_end(p, c->len); }
+        c->entries.reserve(c->len / 64); // typical line length
+        while (p < end) {
+            const char * nl = static_cast<const char*>(memchr(p, '\n', end - p));
+            const char * e = nl ? nl : end;
+            Entry entry;
+            if (parse_line(p, e - p, entry)) { c->entries.push_back(entry); }
+            c->lines++;
+            p = e + 1;
+        }
+        std::lock_guard<std::mutex> lock(q.mtx);
+        c->done = true;
+        if (c == q.flight.front().get()) { q.ready.notify_one(); }
+    }
+}
+
+ssize_t
+APTIngest::run(const csc& path,
+               const std::function<void(const Entry*, size_t)>& f)
+{
+    m_stats = Stats();
+    Queue q;
+    q.window = m_opts.window;
+
+    Crew crew{q, {}};           // stops and joins threads, and unmaps, however we leave
+    for (size_t i = 0; i < m_opts.nthreads; i++) {
+        crew.threads.emplace_back([this, &q]() { work(q); });
+    }
+    crew.threads.emplace_back([this, &q, &path]() {
+            read(path, q);
+            std::lock_guard<std::mutex> lock(q.mtx);
+            q.read = true;
+            q.work.notify_all();
+            q.ready.notify_one();
+        });
+
+    for (;;) {                  // deliver chunks in file order
+        std::unique_ptr<Chunk> c;
+        {
+            std::unique_lock<std::mutex> lock(q.mtx);
+            q.ready.wait(lock, [&q]() {
+                    return ((not q.flight.empty() and q.flight.front()->done) or
+                            (q.flight.empty() and q.read)); });
+            if (q.flight.empty()) { break; }
+            c = std::move(q.flight.front());
+            q.flight.pop_front();
+            q.room.notify_one();
+        }
+        m_stats.bytes += c->len;
+        m_stats.lines += c->lines;
+        m_stats.entries += c->entries.size();
+        if (not c->entries.empty()) { f(c->entries.data(), c->entries.size()); } // may throw
+    }
+
+    return q.failed ? -1 : ssize_t(m_stats.entries);
+}
+
+}
@@ -0,0 +1,91 @@
+/*! \file aptingest.hpp
+ * \brief Parallel Streaming APT Contents Index Reader.
+ * \author Copyright (C) 2012 Per Nordlöw (per.nordlow@gmail.com)
+ *
+ * An APT \c Contents index maps each file path to a comma-separated list of
+ * \c section/package names, one path per line, optionally after a free-text
+ * preamble ended by a \c FILE \c LOCATION header line. Reading runs as a
+ * pipeline:
+ * - one thread maps the index, or decompresses it block by block through
+ *   \c zlib_decompress_cb() or \c bzip2_decode_cb() if it ends in \c .gz or
+ *   \c .bz2, and cuts it into chunks of whole lines. Chunks of a plain index
+ *   point into the mapping and are never copied,
+ * - worker threads split each line of a chunk into path and package list,
+ * - the calling thread gets the entries, chunk by chunk in file order.
+ *
+ * At most \c window chunks are in flight at a time, so a compressed index
+ * is never held decompressed as a whole.
+ */
+
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <thread>
+#include <sys/types.h>
+#include "../csc.hpp"
+
+namespace semnet {
+
+/*! Parallel Streaming Reader of APT Contents Index. */
+class APTIngest {
+public:
+    /// Index Entry, pointing into its chunk.
+    struct Entry {
+        const char * path;      ///< File path, without leading './'.
+        size_t pathN;           ///< Byte length of \c path.
+        const char * pkgs;      ///< Comma-separated packages.
+        size_t pkgsN;           ///< Byte length of \c pkgs.
+    };
+
+    /// Reader Options.
+    struct Options {
+        size_t nthreads = std::thread::hardware_concurrency(); ///< Number of worker threads.
+        size_t window = 0;      ///< Maximum chunks in flight, 0 for \c 4*nthreads.
+        size_t chunk = 1 << 20; ///< Chunk byte size, extended to end of line.
+    };
+
+    /// Reader Statistics.
+    struct Stats {
+        size_t bytes = 0;       ///< Bytes read, after decompression.
+        size_t lines = 0;       ///< Lines read.
+        size_t entries = 0;     ///< Entries found.
+    };
+
+    APTIngest();
+    explicit APTIngest(const Options& opts);
+    ~APTIngest();
+
+    /*! Read index at \p path, calling \p f(const Entry*, size_t) on the
+     * calling thread for the entries of each chunk, in file order. Entries
+     * are only valid during the call. If \p f throws, reading is stopped
+     * and the exception propagated.
+     * \return number of entries, or -1 if \p path could not be read or
+     * decompressed.
+     */
+    ssize_t run(const csc& path,
+                const std::function<void(const Entry*, size_t)>& f);
+
+    /*! Split \p line of length \p len, without newline, into path and
+     * packages at \p e.
+     * \return true if \p line holds an entry.
+     */
+    static bool parse_line(const char * line, size_t len, Entry& e);
+
+    /// Get statistics of last run().
+    const Stats& stats() const { return m_stats; }
+
+private:
+    struct Chunk;
+    struct Queue;
+    struct Crew;
+
+    void read(const csc& path, Queue& q) const;
+    /// Put \p chunk in flight, waiting for room. \return false if run is stopped.
+    bool push(Queue& q, Chunk * chunk) const;
+    void work(Queue& q) const;
+
+    Options m_opts;
+    Stats m_stats;
+};
+
+}
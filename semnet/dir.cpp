@@ -16,8 +16,10 @@
 #include <fcntl.h>
 
 #include <algorithm>
+#include <atomic>
 #include <iomanip>
 #include <iostream>
+#include <thread>
 
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -230,7 +232,9 @@ Dir::remove()
 void
 Dir::unload_tdig()
 {
-    m_tdig.reset();
+    for (Dir * dir = this; dir and dir->m_tdig.get(); dir = dir->get_parent()) {
+        dir->m_tdig.reset();
+    }
 }
 
 void
@@ -511,6 +515,43 @@ Dir::set_tree_height(theight_t theight) const
 
 /* ---------------------------- Group Separator ---------------------------- */
 
+namespace {
+
+/// Get digest of \p sub, or nullptr if none.
+const uchar * sub_digest(const File * sub, chash::chashid hid)
+{
+    if (auto dir = dynamic_cast<const Dir*>(sub)) { return dir->get_chash(hid); }
+    else if (auto file = dynamic_cast<const RegFile*>(sub)) { return file->get_chash(hid); }
+    else if (auto link = dynamic_cast<const SymLink*>(sub)) { return link->get_chash(hid); }
+    else { return nullptr; }
+}
+
+const size_t TDIG_SIZE = sizeof(CDigestF); ///< Digest byte size.
+const uchar g_no_dig[TDIG_SIZE] = {};      ///< Digest of subs without one.
+
+}
+
+Dir::SortedSubs
+Dir::sorted_subs() const
+{
+    SortedSubs ret;
+    ret.reserve(m_subs.size());
+    for (const auto& sub : m_subs) { ret.push_back(&sub); }
+    std::sort(ret.begin(), ret.end(),
+              [](const Subs::value_type* a,
+                 const Subs::value_type* b) { return a->first < b->first; });
+    return ret;
+}
+
+uchar
+Dir::sub_tag(const File * sub)
+{
+    if (dynamic_cast<const Dir*>(sub)) { return 'd'; }
+    else if (dynamic_cast<const RegFile*>(sub)) { return 'f'; }
+    else if (dynamic_cast<const SymLink*>(sub)) { return 'l'; }
+    else { return 'o'; }        // other files have no contents to hash
+}
+
 uint64_t
 Dir::update_chash(chash::chashid hid) const
 {
@@ -518,18 +559,12 @@ Dir::update_chash(chash::chashid hid) const
     if (hid == chash::CHASH_undefined_) { hid = g_default_hid; }
     CHashF chash;
 
-    using std::cout;
-    /* distribute all hits build up tree digest */
-    for (auto it : m_subs) {
-        File* sub = it.second;
-        const uchar * sub_cdig = sub->get_chash(hid);
-        if (sub_cdig) {         /* if sub has content hash */
-            chash.update(sub_cdig, chashid_get_digest_size(hid)); // update chash using sub-chash
-        } else {
-            const csc pathF = sub->path();
-            PNOTE("path:"); cout << pathF;
-            PTODO("sub had no chash. Use content instead?\n");
-        }
+    for (auto sub : sorted_subs()) {
+        const uchar tag = sub_tag(sub->second);
+        const uchar * sub_cdig = sub_digest(sub->second, hid);
+        chash.update(&tag, 1);
+        chash.update(reinterpret_cast<const uchar*>(sub->first.c_str()), sub->first.size() + 1); // including terminator
+        chash.update(sub_cdig ? sub_cdig : g_no_dig, TDIG_SIZE);
     }
 
     if (const auto tdig = m_tdig.get()) {
@@ -548,8 +583,7 @@ Dir::get_chash(chash::chashid hid) const
     if (hid == chash::CHASH_undefined_) { hid = g_default_hid; }
     switch (hid) {
     case chash::CHASH_SHA2_256: {
-        Dir::update_chash(); /* \todo Update only \em after load of subs */
-        ret = const_cast<const CDigestF*>(m_tdig.get())->data();
+        ret = m_tdig.get() ? const_cast<const CDigestF*>(m_tdig.get())->data() : update_tdig();
         break;
     }
     default: PTODO("Cannot handle case for hid:%d\n", hid); break;
@@ -557,6 +591,77 @@ Dir::get_chash(chash::chashid hid) const
     return ret;
 }
 
+const uchar*
+Dir::update_tdig(size_t nthreads) const
+{
+    std::vector<const Dir*> dirs; // obselete directories, parents before subs
+    std::vector<std::pair<const RegFile*, csc> > files; // files to hash, with full paths
+    if (not m_tdig.get()) { dirs.push_back(this); }
+    for (size_t i = 0; i < dirs.size(); i++) {
+        for (const auto& sub : dirs[i]->m_subs) {
+            if (auto dir = dynamic_cast<const Dir*>(sub.second)) {
+                if (not dir->m_tdig.get()) { dirs.push_back(dir); } // clean trees are skipped
+            } else if (auto file = dynamic_cast<const RegFile*>(sub.second)) {
+                if (not file->m_cdig.get()) { files.emplace_back(file, file->path()); }
+            }
+        }
+    }
+
+    // hash files in parallel, as paths are resolved and each file has its own digest
+    std::atomic<size_t> next(0);
+    auto hash_files = [&files, &next]() {
+        for (size_t i; (i = next++) < files.size();) { files[i].first->hash_at(files[i].second); }
+    };
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < std::min(nthreads, files.size()); i++) { workers.emplace_back(hash_files); }
+    hash_files();
+    for (auto& w : workers) { w.join(); }
+
+    for (auto dir = dirs.rbegin(); dir != dirs.rend(); dir++) {
+        (*dir)->update_chash();  // subs before parents
+    }
+    return const_cast<const CDigestF*>(m_tdig.get())->data();
+}
+
+size_t
+Dir::diff_tdig(const Dir * other,
+               const std::function<void(const csc&, const File*, const File*)>& f) const
+{
+    return diff_tdig(other, csc(), f);
+}
+
+size_t
+Dir::diff_tdig(const Dir * other, const csc& pathR,
+               const std::function<void(const csc&, const File*, const File*)>& f) const
+{
+    if (memcmp(get_chash(), other->get_chash(), TDIG_SIZE) == 0) { return 0; } // equal trees
+
+    size_t ret = 0;
+    const auto subsA = sorted_subs(), subsB = other->sorted_subs();
+    auto a = subsA.begin(), b = subsB.begin();
+    while (a != subsA.end() or b != subsB.end()) { // merge on name
+        const int cmp = (a == subsA.end() ? 1 :
+                         b == subsB.end() ? -1 :
+                         (*a)->first.compare((*b)->first));
+        const csc& name = cmp <= 0 ? (*a)->first : (*b)->first;
+        const csc subR = pathR.empty() ? name : pathR + PATH_SEP + name;
+        if (cmp < 0) { f(subR, (*a)->second, nullptr); ret++; a++; continue; }
+        if (cmp > 0) { f(subR, nullptr, (*b)->second); ret++; b++; continue; }
+        const File * subA = (*a++)->second, * subB = (*b++)->second;
+        const uchar tag = sub_tag(subA);
+        if (tag != sub_tag(subB)) {
+            f(subR, subA, subB); ret++;
+        } else if (tag == 'd') {
+            ret += static_cast<const Dir*>(subA)->diff_tdig(static_cast<const Dir*>(subB), subR, f);
+        } else if (tag != 'o') {
+            const uchar * digA = sub_digest(subA, chash::CHASH_SHA2_256);
+            const uchar * digB = sub_digest(subB, chash::CHASH_SHA2_256);
+            if (not (digA and digB and memcmp(digA, digB, TDIG_SIZE) == 0)) { f(subR, subA, subB); ret++; }
+        }
+    }
+    return ret;
+}
+
 /* ---------------------------- Group Separator ---------------------------- */
 
 int
@@ -695,6 +800,7 @@ Dir::load(bool recurse_flag, bool cscan_flag)
                 get_tree_csize(); // update content size
                 update_all();
             }
+            flush_subs_attrs(); // xattrs written while loading subs
 
             ret = iN;
         }
@@ -707,6 +813,7 @@ Dir::load(bool recurse_flag, bool cscan_flag)
 
 void Dir::unload()
 {
+    flush_subs_attrs();
     for (auto it : m_subs) {
         File* sub = it.second;
         sub->unload();
@@ -755,6 +862,7 @@ Dir::watch_me()
             //                   Only watch pathname if it is a directory.
             // const uint32_t mask = (IN_CLOSE_WRITE | IN_MOVE | IN_CREATE | IN_DELETE | IN_DELETE_SELF | IN_MOVE_SELF);
             const uint32_t mask = (IN_CREATE | IN_MOVE | IN_MOVE_SELF | IN_DELETE | IN_DELETE_SELF |
+                                   IN_CLOSE_WRITE | // once per write session, unlike IN_MODIFY
                                    IN_DONT_FOLLOW // don't' dereference symbolic links (since Linux 2.6.15)
                                    );
 
@@ -807,8 +915,18 @@ Dir::update_all()
     if (auto parent = get_parent()) {
         set_tree_depth(parent->get_tree_depth() + 1);
     }
-    update_VCstate();
-    update_chash();
+    update_VCstate();           // tree digest is updated on demand, see update_tdig()
+}
+
+int
+Dir::flush_subs_attrs() const
+{
+    int ret = flush_attrs();
+    for (const auto& it : m_subs) {
+        const int sret = it.second->flush_attrs();
+        if (ret >= 0) { ret = (sret < 0) ? sret : ret + sret; }
+    }
+    return ret;
 }
 
 /* ---------------------------- Group Separator ---------------------------- */
@@ -968,16 +1086,14 @@ Dir::inotify_sub(const struct inotify_event * event)
             unload_subs_stat();
         }
     }
-    else if (event->mask bitand IN_MODIFY) { // sub content changed
-        File * old_sub = get_sub(nameS, dir_flag, nullptr);
-        const auto old_size = old_sub->get_size();
-        File * sub = load_sub(path(), nameS, dir_flag);
-        sub->unload();
-        unload_tdig();
-        if (old_sub) {
-            m_tcsize += sub->get_size() - old_size;
+    else if (event->mask bitand (IN_MODIFY bitor IN_CLOSE_WRITE)) { // sub content changed
+        if (File * sub = lookup_sub(nameS)) {
+            const auto old_size = sub->get_size();
+            sub->unload();      // forget stat and content digest
+            unload_tdig();
+            if (m_tcsize != TSIZE_undefined_) { m_tcsize += sub->get_size() - old_size; }
         } else {
-            m_tcsize = TSIZE_undefined_;
+            load_sub(path(), nameS, dir_flag);
         }
         // g_mbox->post_aop(vaop_newS_WOBBLE(this, 0, 255, ATRANS_SINSHAKE, ARELAY_RESTART, 0, g_touch_tdur, OP_NONE));
     }
@@ -14,8 +14,10 @@
 #include <sys/types.h>
 #include <dirent.h>
 #include <algorithm>
+#include <functional>
 #include <memory>
 #include <system_error>
+#include <thread>
 
 #ifdef HAVE_SYS_INOTIFY_H
 struct inotify_event;
@@ -24,6 +26,8 @@ struct inotify_event;
 #define PDIR_CACHED_PATHF (1)
 
 namespace semnet {
+class Grep;
+class TreeDiff;
 namespace filesystem {
 
 class Dir;
@@ -32,10 +36,14 @@ class Dir;
 class Dir : public File {
     friend class File;
     friend class semnet::pReg;
+    friend class semnet::Grep;
+    friend class semnet::TreeDiff;
 public:
     typedef std::unordered_map<int, Dir*> Watches;
     typedef std::unordered_map<csc, File*> Subs;
 
+    typedef std::vector<const Subs::value_type*> SortedSubs;
+
     typedef Subs::iterator iterator;
     typedef Subs::const_iterator const_iterator;
 
@@ -141,8 +149,36 @@ public:
 
 /* ---------------------------- Group Separator ---------------------------- */
 
+    /*! Get Subs sorted by name, the order they are hashed and diffed in. */
+    SortedSubs sorted_subs() const;
+
+    /*! Get type tag of \p sub in tree digests and diffs: 'd' for
+     * directory, 'f' for regular file, 'l' for symbolic link and 'o' for
+     * other files, which have no contents to hash. */
+    static uchar sub_tag(const File * sub);
+
+    /*! Get \em Merkle \em Tree \em Digest, updating it if obselete.
+     * \see update_tdig()
+     */
     virtual const uchar * get_chash(chash::chashid hid = chash::CHASH_SHA2_256) const;
 
+    /*! Update \em Merkle \em Tree \em Digests of \c this and of all
+     * sub-directories whose digests are obselete, bottom-up. Contents of
+     * regular files not yet hashed are hashed first on \p nthreads threads.
+     * Clean sub-trees are not visited.
+     * \return tree digest of \c this.
+     */
+    const uchar * update_tdig(size_t nthreads = std::thread::hardware_concurrency()) const;
+
+    /*! Diff Tree \c this against \p other, descending only into
+     * sub-directories whose tree digests differ. Calls \p f(pathR, subA,
+     * subB) for each differing sub at relative path \c pathR, with \c subA
+     * (\c subB) nullptr if missing in \c this (\p other).
+     * \return number of differences.
+     */
+    size_t diff_tdig(const Dir * other,
+                     const std::function<void(const csc&, const File*, const File*)>& f) const;
+
 /* ---------------------------- Group Separator ---------------------------- */
 
     /*! Count Number of \em Sub-Duplicates common to \c this and \p pB. */
@@ -255,7 +291,9 @@ private:
 
 /* ---------------------------- Group Separator ---------------------------- */
 
-    /*! Obselete Tree Digest. */
+    /*! Obselete Tree Digest of \c this and of its parents up to the
+     * first one already obselete. A valid digest implies valid digests in
+     * the whole sub-tree, so the path to the root is all that is dirty. */
     void unload_tdig();
 
     /*! Obselete subs statistics. */
@@ -273,14 +311,24 @@ private:
 
     int update_VCS_state_from_sub_creation();
 
-    /*! Update Internal Tree \em Hash (Checksum) of the Directory (Tree) \c this.
+    /*! Update Internal Tree \em Hash (Checksum) of the Directory (Tree)
+     * \c this from the type, name and digest of each sub in name order, so
+     * it only depends on tree contents, not on load order or machine.
      * \see http://en.wikipedia.org/wiki/Hash_tree
      */
     uint64_t update_chash(chash::chashid hid = chash::CHASH_SHA2_256) const;
 
+    size_t diff_tdig(const Dir * other, const csc& pathR,
+                     const std::function<void(const csc&, const File*, const File*)>& f) const;
+
     /*! Update Internal Statistics about \p dir. */
     void update_all();
 
+    /*! Write pending attribute changes of \c this and its subs in one go.
+     * \return number of changes written, or -1 if any failed.
+     */
+    int flush_subs_attrs() const;
+
 private:
     mutable DIR* m_ds;          ///< Directory Stream.
 
@@ -123,31 +123,58 @@ File::copy_into(Dir * dir, COPY_t flags)
 
 /* ---------------------------- Group Separator ---------------------------- */
 
-#ifdef HAVE_SYS_XATTR_H
-#  include <sys/xattr.h>
-#endif
+XAttrs *
+File::get_xattrs() const
+{
+    if (open() < 0) { return nullptr; }
+    if (not m_xattrs) { m_xattrs = std::make_unique<XAttrs>(); }
+    struct timespec ctim = { 0, 0 };
+    if (m_stat or update_stat() >= 0) { ctim = m_stat->st_ctim; }
+    if (not m_xattrs->is_fresh(ctim)) { /* first use or changed since listed */
+        if (m_xattrs->is_dirty()) { /* keep pending changes, then list anew */
+            flush_attrs();
+            if (m_stat) { ctim = m_stat->st_ctim; }
+        }
+        if (m_xattrs->load(get_fd(), ctim) < 0) {
+            lperror("flistxattr()");
+        }
+    }
+    return m_xattrs.get();
+}
 
 int
-File::set_attr(const char* name, const void* value, size_t size, int flags)
+File::flush_attrs() const
 {
-#ifdef HAVE_SYS_XATTR_H
-    if (open() >= 0) {
-        auto ret = fsetxattr(get_fd(), name, value, size, flags);
-        if (ret == -1) {
-            switch (errno) {
-            case EACCES: ret = -1; break;
-            case ENOENT: ret = -1; break;
-            case ENOTDIR: ret = -1; break; // NOTE: Link is unresolved so just be silent here
-            default:
-                std::cout << "pathL:" << get_pathL() << " name::" << std::endl << name << std::endl;
-                lperror("fsetxattr()");
-                break;
-            }
-        }
-        return ret;
+    int ret = 0;
+    if (not (m_xattrs and m_xattrs->is_dirty())) { return ret; }
+    /* fall back to a private descriptor when not openable through the
+     * virtual open(), as in ~File() */
+    int tmp_fd = -1;
+    const int fd = (open() >= 0) ? get_fd() : open_fd(tmp_fd);
+    if (fd < 0) {
+        PWARN("Could not open %s to write its xattrs\n", path().c_str());
+        return -1;
     }
-#endif
-    return -1;
+    ret = m_xattrs->flush(fd);
+    if (ret < 0) {
+        PWARN("Could not write all xattrs of %s\n", path().c_str());
+    }
+    /* our own changes bumped the change time, so restamp the cache to
+     * avoid listing it again */
+    struct stat st;
+    if (::fstat(fd, &st) == 0) {
+        if (m_stat) { *m_stat = st; } else { m_stat = std::make_unique<struct stat>(st); }
+        m_xattrs->stamp(st.st_ctim);
+    }
+    close_fd(tmp_fd);
+    return ret;
+}
+
+int
+File::set_attr(const char* name, const void* value, size_t size, int flags)
+{
+    auto xattrs = get_xattrs();
+    return xattrs ? xattrs->set(name, value, size, flags) : -1;
 }
 
 int
@@ -159,55 +186,15 @@ File::set_attr_csc(const char * name, const csc& value, int flags)
 int
 File::has_attr(const char * name) const
 {
-    int ret = 0;
-#ifdef HAVE_SYS_XATTR_H
-    if (open() >= 0) {
-        void * value = nullptr; size_t size = 0;
-        /* Get the attribute NAME of the file descriptor FD to VALUE (which is SIZE
-           bytes long).  Return 0 on success, -1 for errors.  */
-        ret = fgetxattr(get_fd(), name, value, size);
-        if (ret == -1) {
-            switch (errno) {
-            case ENODATA: ret = 0; break; /* no attribute present (yet) */
-            case ERANGE: PTODO("size to small\n"); break; /* size of buffer is to small */
-            case ENOTSUP: PWARN("ENOTSUP: Not supported or disabled\n"); break;
-            default:
-                std::cout << "pathL:" << get_pathL() << " name:" << name << ":" << std::endl;
-                lperror("fgetxattr()");
-                break;
-            }
-        } else {			/* attribute present */
-            ret = 1;
-        }
-    }
-#endif
-    return ret;
+    auto xattrs = get_xattrs();
+    return xattrs ? xattrs->has(name) : 0;
 }
 
 int
 File::get_attr(const char * name, void * value, size_t size) const
 {
-    int ret = -1;
-#ifdef HAVE_SYS_XATTR_H
-    /* Get the attribute NAME of the file descriptor FD to VALUE (which is SIZE
-       bytes long).  Return 0 on success, -1 for errors.  */
-    if (open() >= 0) {
-        ret = fgetxattr(get_fd(), name, value, size);
-        if (ret == -1) {
-            switch (errno) {
-            case ENODATA: break; /* no attribute present (yet) */
-            case ERANGE: break; /* size of buffer is to small */
-            case ENOTSUP: PWARN("ENOTSUP: Not supported or disabled\n"); break;
-            default: {
-                char buf[64]; strerror_r(errno, buf, sizeof(buf));
-                std::cout << "pathL:" << get_pathL() << " name:" << name << ": fgetxattr(): " << buf << std::endl;
-                break;
-            }
-            }
-        }
-    }
-#endif
-    return ret;
+    auto xattrs = get_xattrs();
+    return xattrs ? xattrs->get(get_fd(), name, value, size) : -1;
 }
 
 const size_t g_xattr_initial_size = 4096;
@@ -247,17 +234,8 @@ File::get_attr_csc(const char * name, csc& value_ret) const
 int
 File::remove_attr(const csc& xan)
 {
-    int ret = 0;
-#ifdef HAVE_SYS_XATTR_H
-    if (open() >= 0) {
-        ret = fremovexattr(get_fd(), xan.c_str());
-        if (ret < 0) {
-            lperror("fremovexattr()");
-            /* \todo Handle specific error codes. */
-        }
-    }
-#endif
-    return ret;
+    auto xattrs = get_xattrs();
+    return xattrs ? xattrs->remove(xan.c_str()) : 0;
 }
 
 /* ---------------------------- Group Separator ---------------------------- */
@@ -491,39 +469,12 @@ File::get_attrs(bool rescan_flag)
         m_attrs = new Attrs();
     }
     if (rescan_flag) {
-        /* \todo Fix problem with \c read_all_attr_names() and @c
-           get_attr_xstr() and activate this function. */
-#ifdef HAVE_SYS_XATTR_H
-        if (open() >= 0) {
-            size_t size = g_xattr_initial_size;
-            char * list = static_cast<char*>(malloc(size)); // string containing all attributes
-            /* find number of xattr's */
-            ssize_t xret = 0;
-            while ((xret = flistxattr(get_fd(), list, size)) == -1 and
-                   errno == ERANGE) {
-                if (size * 2 > g_xattr_max_size) {
-                    PWARN("size:%zd > g_xattr_max_size:%zd", size, g_xattr_max_size);
-                    break;
-                } else {
-                    if (size == 0) { size = 1; } else { size *= 2; }
-                    list = reinterpret_cast<char*>(realloc(list, size));
-                }
-            }
-            if (xret >= 1) {                                           // if read ok
-                //const size_t xnum = std::count(list, list+size, '\0');  // count number of NULLs
-                size_t iB = 0;          // name begin index
-                for (size_t i = iB = 0; i < (size_t)xret; i++) {
-                    if (i > iB and list[i] == '\0') {
-                        csc name(&list[iB], i-iB); // note: reference string
-                        csc value; get_attr_csc(name.c_str(), value);
-                        m_attrs->push_back(FileAttr(name, value));
-                        iB = i;     /* reset begin counter */
-                    }
-                }
+        if (auto xattrs = get_xattrs()) {
+            for (const auto& name : xattrs->names()) {
+                csc value; get_attr_csc(name.c_str(), value);
+                m_attrs->push_back(FileAttr(name, value));
             }
-            free(list);
         }
-#endif
     }
     return *m_attrs;
 }
@@ -532,6 +483,8 @@ void
 File::unload_attrs()
 {
     if (m_attrs) { delete m_attrs; m_attrs = nullptr; }
+    flush_attrs();
+    m_xattrs.reset();
 }
 
 /* ---------------------------- Group Separator ---------------------------- */
@@ -666,6 +619,7 @@ File::unload() const
 
 File::~File()
 {
+    flush_attrs();
     close();
 }
 
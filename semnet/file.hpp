@@ -26,6 +26,7 @@
 class pOp;
 
 namespace semnet {
+class TreeDiff;
 namespace filesystem {
 
 /*! Default mode_t for creating \c Dir sub-files. */
@@ -48,6 +49,7 @@ class File : public boost::noncopyable, public ObMr
     friend class Dir;
     friend class SymLink;
     friend class RegFile;
+    friend class semnet::TreeDiff;
 public:
     typedef std::vector<FileAttr> Attrs;
 
@@ -285,6 +287,21 @@ protected:
     int remove_attr_if_too_small (const csc& xan);
 
     const Attrs& get_attrs(bool rescan_flag = false);
+
+    /*! Write pending attribute changes.
+     *
+     * Changes are held in memory and written to disk:
+     * - at the end of \c Dir::load() and in \c Dir::unload() for all subs,
+     * - at the end of \c RegFile::cscan(), so a content digest is written
+     *   when computed, even lazily by \c RegFile::get_chash(),
+     * - in \c unload_attrs(), \c RegFile::unload() and \c ~File().
+     *
+     * Other changes are lost if the process dies before one of these.
+     * \return number of changes written, or -1 if any failed.
+     */
+    int flush_attrs() const;
+
+    /*! Forget attributes, after flushing pending changes. */
     void unload_attrs();
 
     /* ---------------------------- Group Separator ---------------------------- */
@@ -342,10 +359,15 @@ protected:
 
     void log_open() const;
     void log_close() const;
+
+    /*! Get extended attributes cache, listed again if status change time
+     * differs, or \c nullptr if \c this cannot be opened. */
+    XAttrs * get_xattrs() const;
 protected:
     csc     m_name;             ///< Local File \em Path (Name).
     Dir * m_parent;            ///< Parent Directory.
     Attrs * m_attrs;            ///< (Extended) Attributes.
+    mutable std::unique_ptr<XAttrs> m_xattrs; ///< Cached Extended Attributes.
 
     mutable std::unique_ptr<struct stat> m_stat; ///< Only reflects filesystem state.
 
@@ -1,6 +1,13 @@
 #include "fileattr.hpp"
 #include "file.hpp"
 #include <string>
+#include <cerrno>
+#include <cstring>
+#include <cstdlib>
+
+#ifdef HAVE_SYS_XATTR_H
+#  include <sys/xattr.h>
+#endif
 
 namespace semnet { namespace filesystem {
 
@@ -12,4 +19,159 @@ FileAttr::show(std::ostream& os) const
     return os;
 }
 
+/* ---------------------------- Group Separator ---------------------------- */
+
+int
+XAttrs::load(int fd, const struct timespec& ctim)
+{
+    m_ents.clear();
+    m_loaded = false;
+    m_dirty = false;
+#ifdef HAVE_SYS_XATTR_H
+    ssize_t xret = 0;
+    std::vector<char> list;
+    for (;;) {                  // list may grow between size query and read
+        xret = flistxattr(fd, nullptr, 0);
+        if (xret <= 0) { break; }
+        list.resize(xret);
+        xret = flistxattr(fd, list.data(), list.size());
+        if (not (xret == -1 and errno == ERANGE)) { break; }
+    }
+    if (xret < 0) {
+        if (errno != ENOTSUP) { return -1; }
+        xret = 0;               // no attributes on this filesystem
+    }
+    for (size_t i = 0, iB = 0; i < (size_t)xret; i++) {
+        if (list[i] == '\0') {
+            if (i > iB) { m_ents.push_back(Entry{ csc(&list[iB], i - iB), csc(), UNREAD, true }); }
+            iB = i + 1;
+        }
+    }
+#endif
+    m_ctim = ctim;
+    m_loaded = true;
+    return m_ents.size();
+}
+
+XAttrs::Entry *
+XAttrs::find(const char* name)
+{
+    for (auto& e : m_ents) {
+        if (e.name == name) { return &e; }
+    }
+    return nullptr;
+}
+
+const XAttrs::Entry *
+XAttrs::find(const char* name) const
+{
+    return const_cast<XAttrs*>(this)->find(name);
+}
+
+int
+XAttrs::get(int fd, const char* name, void* value, size_t size)
+{
+    Entry * e = find(name);
+    if (not e or e->state == REMOVED) { errno = ENODATA; return -1; }
+#ifdef HAVE_SYS_XATTR_H
+    if (e->state == UNREAD) {
+        ssize_t xret = 0;
+        for (;;) {
+            xret = fgetxattr(fd, name, nullptr, 0);
+            if (xret < 0) { return -1; }
+            e->value.resize(xret);
+            xret = fgetxattr(fd, name, &e->value[0], e->value.size());
+            if (not (xret == -1 and errno == ERANGE)) { break; }
+        }
+        if (xret < 0) { return -1; }
+        e->value.resize(xret);
+        e->state = CLEAN;
+    }
+#else
+    if (e->state == UNREAD) { errno = ENOTSUP; return -1; }
+#endif
+    if (size == 0) { return e->value.size(); }
+    if (size < e->value.size()) { errno = ERANGE; return -1; }
+    memcpy(value, e->value.data(), e->value.size());
+    return e->value.size();
+}
+
+int
+XAttrs::set(const char* name, const void* value, size_t size, int flags)
+{
+    Entry * e = find(name);
+    const bool present = (e and e->state != REMOVED);
+#ifdef HAVE_SYS_XATTR_H
+    if ((flags & XATTR_CREATE) and present) { errno = EEXIST; return -1; }
+    if ((flags & XATTR_REPLACE) and not present) { errno = ENODATA; return -1; }
+#endif
+    const csc val(static_cast<const char*>(value), size);
+    if (e) {
+        if (e->state == CLEAN and e->value == val) { return 0; } // unchanged
+        e->value = val;
+    } else {
+        m_ents.push_back(Entry{ csc(name), val, DIRTY, false });
+        e = &m_ents.back();
+    }
+    e->state = DIRTY;
+    m_dirty = true;
+    return 0;
+}
+
+int
+XAttrs::remove(const char* name)
+{
+    Entry * e = find(name);
+    if (not e or e->state == REMOVED) { errno = ENODATA; return -1; }
+    e->value.clear();
+    e->state = REMOVED;
+    m_dirty = true;
+    return 0;
+}
+
+int
+XAttrs::flush(int fd)
+{
+    int ret = 0;
+    if (not m_dirty) { return ret; }
+    bool failed = false;
+    for (auto it = m_ents.begin(); it != m_ents.end();) {
+#ifdef HAVE_SYS_XATTR_H
+        if (it->state == DIRTY or
+            it->state == REMOVED) {
+            const bool rm = (it->state == REMOVED);
+            const int xret = (rm ?
+                              fremovexattr(fd, it->name.c_str()) :
+                              fsetxattr(fd, it->name.c_str(), it->value.data(), it->value.size(), 0));
+            if (xret == 0 or
+                (rm and errno == ENODATA)) { // removed before ever written
+                ret++;
+                if (rm) { it = m_ents.erase(it); continue; }
+                it->state = CLEAN;
+                it->stored = true;
+            } else {            // drop change, so value is read back instead
+                failed = true;
+                if (not it->stored) { it = m_ents.erase(it); continue; } // nothing to read back
+                it->value.clear();
+                it->state = UNREAD;
+            }
+        }
+#endif
+        ++it;
+    }
+    m_dirty = false;
+    return failed ? -1 : ret;
+}
+
+std::vector<csc>
+XAttrs::names() const
+{
+    std::vector<csc> ret;
+    ret.reserve(m_ents.size());
+    for (const auto& e : m_ents) {
+        if (e.state != REMOVED) { ret.push_back(e.name); }
+    }
+    return ret;
+}
+
 }}
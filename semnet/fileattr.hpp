@@ -10,6 +10,8 @@
 #include "PMAGIC_enum.h"
 #include "../substr_match.h"
 #include "../csc.hpp"
+#include <vector>
+#include <time.h>
 
 namespace semnet { namespace filesystem {
 
@@ -40,5 +42,96 @@ private:
     csc m_val;         ///< \em Value.
 };
 
+/*! Cached Extended Attributes of a File.
+ *
+ * Names are listed by one \c flistxattr() and each value is read by
+ * \c fgetxattr() only when first asked for, so asking for an absent name
+ * costs no system call. Writes and removals are held until flush(), which
+ * \c Dir does for all its subs at once. Any change of an attribute bumps
+ * the status change time of its file, which the cache is stamped with, so
+ * it only has to be listed again when that time differs.
+ */
+class XAttrs
+{
+public:
+    /*! List names of attributes of \p fd, forgetting all values, and stamp
+     * with change time \p ctim. Pending changes are lost.
+     * \return number of names, or -1 on error.
+     */
+    int load(int fd, const struct timespec& ctim);
+
+    /// Check if listed with change time \p ctim.
+    bool is_fresh(const struct timespec& ctim) const {
+        return (m_loaded and
+                m_ctim.tv_sec == ctim.tv_sec and
+                m_ctim.tv_nsec == ctim.tv_nsec);
+    }
+    bool is_loaded() const { return m_loaded; }
+    /// Check if changes are pending.
+    bool is_dirty() const { return m_dirty; }
+    /// Stamp with change time \p ctim, typically after flush().
+    void stamp(const struct timespec& ctim) { m_ctim = ctim; }
+
+    /*! Check if attribute \p name is present.
+     * \return 1 if present, 0 otherwise.
+     */
+    int has(const char* name) const {
+        const Entry * e = find(name);
+        return e and e->state != REMOVED;
+    }
+
+    /*! Read attribute \p name into \p value of size \p size, from \p fd
+     * if not yet read. If \p size is zero only its length is returned.
+     * \return length of attribute, or -1 with \c errno set to \c ENODATA
+     * if absent or \c ERANGE if \p size is too small, as \c fgetxattr().
+     */
+    int get(int fd, const char* name, void* value, size_t size);
+
+    /*! Set attribute \p name to \p value of size \p size, honouring
+     * \c XATTR_CREATE and \c XATTR_REPLACE in \p flags, until flush().
+     * \return 0 on success, -1 with \c errno set otherwise.
+     */
+    int set(const char* name, const void* value, size_t size, int flags);
+
+    /*! Remove attribute \p name until flush().
+     * \return 0 on success, -1 with \c errno set to \c ENODATA if absent.
+     */
+    int remove(const char* name);
+
+    /*! Write pending changes to \p fd. Failed changes are dropped, so
+     * attributes on \p fd are read back and those only set here vanish.
+     * \return number of changes written, or -1 if any failed.
+     */
+    int flush(int fd);
+
+    /// Get names of present attributes.
+    std::vector<csc> names() const;
+
+private:
+    /// Entry State.
+    typedef enum {
+        UNREAD,                 ///< Listed, value not read.
+        CLEAN,                  ///< Value read or written.
+        DIRTY,                  ///< Value to write.
+        REMOVED,                ///< To remove.
+    } __attribute__ ((packed)) STATE_t;
+
+    struct Entry {
+        csc name;
+        csc value;
+        STATE_t state;
+        bool stored;            ///< Known to be present on file, as listed or written.
+    };
+
+    /// Find entry named \p name, even if removed.
+    Entry * find(const char* name);
+    const Entry * find(const char* name) const;
+
+    std::vector<Entry> m_ents;
+    struct timespec m_ctim = { 0, 0 }; ///< Change time when listed.
+    bool m_loaded = false;
+    bool m_dirty = false;
+};
+
 }
 }
@@ -4,10 +4,19 @@
 #include "alt.hpp"
 #include "ctx.hpp"
 #include "regfile.hpp"
+#include "seq.hpp"
+#include "sit.hpp"
+#include <algorithm>
+#include <mutex>
+#include <string>
+#include <unordered_map>
 
 namespace semnet { namespace filesystem {
 
 FileType::Reg FileType::ms_reg;
+uint32_t FileType::ms_regno = 0;
+std::shared_ptr<const FileType::Index> FileType::ms_index;
+static std::mutex g_index_mutex;
 
 FileType::FileType(patterns::Base * nfmt,
                    patterns::Base * cfmt,
@@ -19,13 +28,23 @@ FileType::FileType(patterns::Base * nfmt,
       m_cfmt(cfmt ? patterns::gen::ctx(patterns::PCTX_IN_FILE_NAME, cfmt) : nullptr),
       m_name(name ? name : ""),
       m_doc(doc ? doc : ""),
+      m_regno(ms_regno++),
       m_dfmt(dfmt),
       m_precog(precog)
 {
     assert(nfmt or cfmt);
     if (not nfmt) { m_precog = PRECOG_CONTENTS; }
     if (not cfmt) { m_precog = PRECOG_NAME; }
+    std::lock_guard<std::mutex> lock(g_index_mutex); // index() reads ms_reg
     ms_reg.insert(this);
+    ms_index.reset();
+}
+
+FileType::~FileType()
+{
+    std::lock_guard<std::mutex> lock(g_index_mutex);
+    ms_reg.erase(this);
+    ms_index.reset();
 }
 
 bool
@@ -53,12 +72,323 @@ FileType::match(RegFile* file, bir roi, PRECOG_t override_precog) const
     }
 }
 
+/* ---------------------------- Group Separator ---------------------------- */
+
+namespace {
+
+using patterns::Base;
+
+/// Strip context wrappers off \p p.
+const Base* unwrap(const Base* p)
+{
+    while (auto c = dynamic_cast<const patterns::Ctx*>(p)) { p = c->get_sub(); }
+    return p;
+}
+
+bool is_sit(const Base* p, patterns::PRPOS_t pos)
+{
+    auto t = dynamic_cast<const patterns::Sit*>(unwrap(p));
+    return t and t->value() == pos;
+}
+
+/*! Collect the constants that \p p is an alternation of into \p out.
+ * \return false if \p p matches anything else.
+ */
+bool constants_of(const Base* p, std::vector<std::string>& out)
+{
+    p = unwrap(p);
+    if (auto a = dynamic_cast<const patterns::Alt*>(p)) {
+        if (a->is_complement() or a->get_subs().empty()) { return false; }
+        for (auto sub : a->get_subs()) {
+            if (not constants_of(sub, out)) { return false; }
+        }
+        return true;
+    }
+    if (p->is_constant()) {
+        const csc c = p->constant();
+        if (c.empty()) { return false; }
+        out.emplace_back(c.data(), c.size());
+        return true;
+    }
+    return false;
+}
+
+/*! Collect the file name extensions (without dot) that name format \p p
+ * matches into \p exts, as made by \c fnx() and alternatives of those.
+ * \return false if \p p can match names with none of these extensions.
+ */
+bool extensions_of(const Base* p, std::vector<std::string>& exts)
+{
+    p = unwrap(p);
+    if (auto a = dynamic_cast<const patterns::Alt*>(p)) {
+        if (a->is_complement() or a->get_subs().empty()) { return false; }
+        for (auto sub : a->get_subs()) {
+            if (not extensions_of(sub, exts)) { return false; }
+        }
+        return true;
+    }
+    if (auto s = dynamic_cast<const patterns::Seq*>(p)) {
+        const auto& subs = s->get_subs();
+        if (subs.size() == 3 and
+            unwrap(subs[0])->is_constant() and unwrap(subs[0])->constant() == "." and
+            is_sit(subs[2], patterns::PRPOS_EOB)) {
+            return constants_of(subs[1], exts);
+        }
+    }
+    return false;
+}
+
+/// Maximum end offset of indexed magics, bounding the prefix read by \c of().
+const size_t MAGIC_END_MAX = 1 << 16;
+
+/// Magic Bytes required at a fixed byte offset of file contents.
+struct Magic {
+    size_t off;
+    std::string bytes;
+};
+
+/*! Collect into \p out the magic of contents format \p p, a sequence
+ * anchored at the beginning of contents whose first constant lies at a
+ * fixed byte offset, or alternatives of those.
+ * \return false if \p p can match contents without any of these magics.
+ */
+bool magics_of(const Base* p, std::vector<Magic>& out, size_t off = 0, bool anchored = false)
+{
+    p = unwrap(p);
+    const size_t nout = out.size();
+    if (auto a = dynamic_cast<const patterns::Alt*>(p)) {
+        if (a->is_complement() or a->get_subs().empty()) { return false; }
+        for (auto sub : a->get_subs()) {
+            if (not magics_of(sub, out, off, anchored)) { out.resize(nout); return false; }
+        }
+        return true;
+    }
+    if (anchored and p->is_constant()) {
+        const csc c = p->constant();
+        if (c.empty()) { return false; }
+        out.push_back(Magic{ off, std::string(c.data(), c.size()) });
+        return true;
+    }
+    auto s = dynamic_cast<const patterns::Seq*>(p);
+    if (not s) { return false; }
+    const auto& subs = s->get_subs();
+    size_t i = 0;
+    if (not subs.empty() and is_sit(subs[0], patterns::PRPOS_BOB)) {
+        if (off != 0) { return false; } // BOB in the middle cannot match
+        anchored = true;
+        i = 1;
+    }
+    if (not anchored) {         // anchored by its first sub-pattern if at all
+        return not subs.empty() and magics_of(subs[0], out, off, false);
+    }
+    uint64_t bits = 8 * off;
+    for (; i < subs.size(); i++) {
+        const Base* sub = unwrap(subs[i]);
+        if (bits % 8 == 0 and magics_of(sub, out, bits / 8, true)) { return true; }
+        out.resize(nout);
+        const bir r = sub->sample_range();
+        if (not r.empty()) { return false; } // later offsets vary
+        bits += r.low().get();
+    }
+    return false;
+}
+
+}
+
+/*!
+ * File Type Classification Index.
+ *
+ * Maps file name extensions to the types whose name format is an
+ * alternation of extensions, and magic byte strings, stored per offset in
+ * a byte trie, to the types whose contents format begins with them. Types
+ * for which a key cannot be derived, including those with a magic ending
+ * beyond \c MAGIC_END_MAX, are always candidates.
+ */
+class FileType::Index {
+public:
+    /// Trie Node.
+    struct Node {
+        std::vector<std::pair<uchar, uint32_t> > edges; ///< Sorted on byte.
+        std::vector<uint32_t> types; ///< Types whose magic ends here.
+    };
+    /// Trie of magics at one offset.
+    struct Trie {
+        size_t off;
+        std::vector<Node> nodes;
+    };
+
+    std::vector<FileType*> types; ///< In registration order.
+    std::vector<bool> has_ext, has_magic;
+    std::unordered_map<std::string, std::vector<uint32_t> > by_ext;
+    std::vector<Trie> tries;    ///< Sorted on offset.
+    size_t prefix_len = 0;      ///< Bytes to read to resolve all magics, at most \c MAGIC_END_MAX.
+
+    /// Types that are candidates whatever the keys, per override \c PRECOG_t.
+    std::vector<uint32_t> always[PRECOG_NAME_OR_CONTENTS + 1];
+
+    Index() {
+        for (auto t : ms_reg) { types.push_back(t); }
+        std::sort(types.begin(), types.end(),
+                  [](const FileType* a, const FileType* b) { return a->m_regno < b->m_regno; });
+        const uint32_t n = types.size();
+        has_ext.assign(n, false);
+        has_magic.assign(n, false);
+        for (uint32_t i = 0; i < n; i++) {
+            const FileType* t = types[i];
+            std::vector<std::string> exts;
+            if (t->m_nfmt and extensions_of(t->m_nfmt, exts)) {
+                has_ext[i] = true;
+                for (auto& e : exts) { by_ext[e].push_back(i); }
+            }
+            std::vector<Magic> magics;
+            if (t->m_cfmt and magics_of(t->m_cfmt, magics) and
+                std::all_of(magics.begin(), magics.end(), [](const Magic& m) {
+                        return m.off + m.bytes.size() <= MAGIC_END_MAX; })) {
+                has_magic[i] = true;
+                for (auto& m : magics) { insert(m, i); }
+            }
+        }
+        for (int p = 0; p <= PRECOG_NAME_OR_CONTENTS; p++) {
+            for (uint32_t i = 0; i < n; i++) {
+                if (not filterable(precog_of(i, PRECOG_t(p)), i)) { always[p].push_back(i); }
+            }
+        }
+    }
+
+    PRECOG_t precog_of(uint32_t i, PRECOG_t override_precog) const {
+        return override_precog != PRECOG_any_ ? override_precog : types[i]->m_precog;
+    }
+
+    /// Check if keys of type \p i can rule it out under \p precog.
+    bool filterable(PRECOG_t precog, uint32_t i) const {
+        switch (precog) {
+        case PRECOG_NAME: return has_ext[i];
+        case PRECOG_CONTENTS: return has_magic[i];
+        case PRECOG_NAME_AND_CONTENTS: return has_ext[i] or has_magic[i];
+        case PRECOG_NAME_OR_CONTENTS: return has_ext[i] and has_magic[i];
+        default: return false;
+        }
+    }
+
+    /// Check if type \p i can match under \p precog given which of its keys hit.
+    bool candidate(PRECOG_t precog, uint32_t i, bool ext_hit, bool magic_hit) const {
+        const bool n = not has_ext[i] or ext_hit, c = not has_magic[i] or magic_hit;
+        switch (precog) {
+        case PRECOG_NAME: return n;
+        case PRECOG_CONTENTS: return c;
+        case PRECOG_NAME_AND_CONTENTS: return n and c;
+        case PRECOG_NAME_OR_CONTENTS: return (has_ext[i] and has_magic[i]) ? (ext_hit or magic_hit) : true;
+        default: return true;
+        }
+    }
+
+    /// Append the types whose extension is a suffix of \p name after a dot.
+    void lookup_name(const csc& name, std::vector<uint32_t>& hits) const {
+        if (by_ext.empty()) { return; }
+        for (size_t i = name.find('.'); i != csc::npos; i = name.find('.', i + 1)) {
+            auto it = by_ext.find(std::string(name.data() + i + 1, name.size() - i - 1));
+            if (it != by_ext.end()) { hits.insert(hits.end(), it->second.begin(), it->second.end()); }
+        }
+    }
+
+    /// Append the types whose magic occurs in the \p n first bytes \p buf of contents.
+    void lookup_contents(const uchar* buf, size_t n, std::vector<uint32_t>& hits) const {
+        for (const Trie& trie : tries) {
+            if (trie.off >= n) { break; }
+            uint32_t v = 0;
+            for (size_t k = trie.off; k < n; k++) {
+                const Node& node = trie.nodes[v];
+                auto e = std::lower_bound(node.edges.begin(), node.edges.end(),
+                                          std::make_pair(buf[k], uint32_t(0)));
+                if (e == node.edges.end() or e->first != buf[k]) { break; }
+                v = e->second;
+                const auto& ts = trie.nodes[v].types;
+                hits.insert(hits.end(), ts.begin(), ts.end());
+            }
+        }
+    }
+
+private:
+    void insert(const Magic& m, uint32_t type) {
+        auto it = std::lower_bound(tries.begin(), tries.end(), m.off,
+                                   [](const Trie& t, size_t off) { return t.off < off; });
+        if (it == tries.end() or it->off != m.off) {
+            it = tries.insert(it, Trie{ m.off, std::vector<Node>(1) });
+        }
+        std::vector<Node>& nodes = it->nodes;
+        uint32_t v = 0;
+        for (uchar b : m.bytes) {
+            auto& edges = nodes[v].edges;
+            auto e = std::lower_bound(edges.begin(), edges.end(), std::make_pair(b, uint32_t(0)));
+            if (e == edges.end() or e->first != b) {
+                const uint32_t w = nodes.size();
+                edges.insert(e, std::make_pair(b, w));
+                nodes.emplace_back();
+                v = w;
+            } else {
+                v = e->second;
+            }
+        }
+        nodes[v].types.push_back(type);
+        prefix_len = std::max(prefix_len, m.off + m.bytes.size());
+    }
+};
+
+void
+FileType::invalidate_index()
+{
+    std::lock_guard<std::mutex> lock(g_index_mutex);
+    ms_index.reset();
+}
+
+std::shared_ptr<const FileType::Index>
+FileType::index()
+{
+    std::lock_guard<std::mutex> lock(g_index_mutex);
+    if (not ms_index) { ms_index = std::make_shared<const Index>(); }
+    return ms_index;
+}
+
 FileType *
 FileType::of(RegFile* file, bir roi, PRECOG_t override_precog)
 {
-    for (auto ftype : ms_reg) {
-        if (ftype->match(file, roi, override_precog)) {
-            return ftype;         // return first hit
+    if (roi != bir::full()) {   // magics are only indexed for whole contents
+        FileType* best = nullptr;
+        for (auto ftype : ms_reg) {
+            if ((not best or ftype->m_regno < best->m_regno) and
+                ftype->match(file, roi, override_precog)) {
+                best = ftype;
+            }
+        }
+        return best;
+    }
+
+    const auto ixp = index();   // keeps it alive if invalidated meanwhile
+    const Index& ix = *ixp;
+    std::vector<uint32_t> ext_hits, magic_hits;
+    ix.lookup_name(file->get_pathL(), ext_hits);
+    if (ix.prefix_len) {
+        std::vector<uchar> buf(ix.prefix_len);
+        const ssize_t n = file->pread(buf.data(), buf.size(), 0);
+        if (n > 0) { ix.lookup_contents(buf.data(), n, magic_hits); }
+    }
+    std::sort(ext_hits.begin(), ext_hits.end());
+    std::sort(magic_hits.begin(), magic_hits.end());
+
+    std::vector<uint32_t> cands;
+    cands.reserve(ext_hits.size() + magic_hits.size() + ix.always[override_precog].size());
+    cands.insert(cands.end(), ext_hits.begin(), ext_hits.end());
+    cands.insert(cands.end(), magic_hits.begin(), magic_hits.end());
+    cands.insert(cands.end(), ix.always[override_precog].begin(), ix.always[override_precog].end());
+    std::sort(cands.begin(), cands.end());
+    cands.erase(std::unique(cands.begin(), cands.end()), cands.end());
+
+    for (const uint32_t i : cands) {
+        const bool eh = std::binary_search(ext_hits.begin(), ext_hits.end(), i);
+        const bool mh = std::binary_search(magic_hits.begin(), magic_hits.end(), i);
+        if (ix.candidate(ix.precog_of(i, override_precog), i, eh, mh) and
+            ix.types[i]->match(file, roi, override_precog)) {
+            return ix.types[i];   // return first registered hit
         }
     }
     return nullptr;
@@ -13,6 +13,7 @@
 #include "OP_enum.hpp"
 #include <unordered_set>
 #include <vector>
+#include <memory>
 
 namespace semnet { namespace filesystem {
 
@@ -47,7 +48,7 @@ public:
              DFMT_t dfmt = DFMT_any_,
              PRECOG_t precog = PRECOG_NAME_AND_CONTENTS);
 
-    virtual ~FileType() { ms_reg.erase(this); }
+    virtual ~FileType();
 
     FileType * set_name(const char * name) { m_name.assign(name); return this; }
     FileType * set_doc(const char * doc) { m_doc.assign(doc); return this; }
@@ -58,10 +59,21 @@ public:
                 bir roi = bir::full(),
                 PRECOG_t override_precog = PRECOG_any_) const;
 
+    /*! Get the first registered type matching \p file.
+     *
+     * Looks up candidates in a classification index keyed on file name
+     * extensions and on magic bytes at fixed offsets, which is built from
+     * all registered types on first use, and matches only those.
+     */
     static FileType * of(RegFile* file,
                          bir roi = bir::full(),
                          PRECOG_t override_precog = PRECOG_any_);
 
+    /*! Forget the classification index used by \c of().
+     * Call after mutating the patterns of registered types.
+     */
+    static void invalidate_index();
+
     DFMT_t get_dfmt() const { return m_dfmt; }
     bool contains(DFMT_t dfmt) const { return DFMT_match(get_dfmt(), dfmt); }
     bool is_audio() const { return DFMT_is_AUDIO(m_dfmt); }
@@ -78,6 +90,11 @@ public:
 private:
     void init();
 
+    class Index;
+    /*! Get the classification index, building it if needed. Shared so that
+     * \c invalidate_index() cannot free it while \c of() is using it. */
+    static std::shared_ptr<const Index> index();
+
 private:
     patterns::Base* m_nfmt;     ///< Name Format.
     patterns::Base* m_cfmt;     ///< Contents Format (Programming Language).
@@ -85,6 +102,9 @@ private:
     csc m_doc;                  ///< Documentation of pattern if any.
 
     static Reg ms_reg;          ///< Registered File Types.
+    static uint32_t ms_regno;   ///< Number of registrations so far.
+    static std::shared_ptr<const Index> ms_index; ///< Classification Index, nullptr until needed.
+    uint32_t m_regno;           ///< Registration number, lower wins in \c of().
     DFMT_t m_dfmt;              ///< Data Format Code.
     PRECOG_t m_precog:3;        ///< \em Preferred Recognition.
 
@@ -0,0 +1,230 @@
+#include "grep.hpp"
+#include "peg.hpp"
+#include "dir.hpp"
+#include "regfile.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace semnet {
+
+using namespace filesystem;
+using namespace patterns;
+
+/// File to Search.
+struct Grep::Job {
+    const RegFile * file;
+    csc path;
+    bool sniff;                 ///< Type unknown, so check contents for NUL.
+    bool done = false;          ///< Searched.
+    bool binary = false;        ///< Found to be binary.
+    size_t bytes = 0;           ///< Bytes searched.
+    std::vector<Hit> hits;
+};
+
+/// Jobs Shared by Walker, Workers and Consumer.
+struct Grep::Queue {
+    std::mutex mtx;
+    std::condition_variable work;  ///< Signalled on new job or walk done.
+    std::condition_variable ready; ///< Signalled when first job in flight is done.
+    std::condition_variable room;  ///< Signalled when a job leaves flight.
+    std::deque<std::unique_ptr<Job> > flight; ///< Jobs in flight, in walk order.
+    std::deque<Job*> todo;      ///< Jobs not yet taken by a worker.
+    size_t window = 1;
+    size_t skipped = 0;         ///< Files skipped by walker.
+    bool walked = false;        ///< Walk done.
+    bool stop = false;          ///< Run is abandoned, so walker and workers quit.
+};
+
+/// Stopper and Joiner of the Threads of a Run, also when unwound by an exception.
+struct Grep::Crew {
+    Queue& q;
+    std::vector<std::thread> threads;
+    ~Crew() {
+        {
+            std::lock_guard<std::mutex> lock(q.mtx);
+            q.stop = true;
+        }
+        q.work.notify_all();
+        q.room.notify_all();
+        for (auto& t : threads) {
+            if (t.joinable()) { t.join(); }
+        }
+    }
+};
+
+Grep::Grep(const Base * patt)
+    : Grep(patt, Options())
+{
+}
+
+Grep::Grep(const Base * patt, const Options& opts)
+    : m_opts(opts), m_peg(new Peg(patt))
+{
+    m_opts.nthreads = std::max<size_t>(m_opts.nthreads, 1);
+    if (m_opts.window == 0) { m_opts.window = 8 * m_opts.nthreads; }
+}
+
+Grep::~Grep()
+{
+}
+
+/* ---------------------------- Group Separator ---------------------------- */
+
+void
+Grep::walk(const Dir * dir, Queue& q) const
+{
+    std::vector<std::pair<csc, const File*> > subs(dir->begin(), dir->end());
+    std::sort(subs.begin(), subs.end(),
+              [](const std::pair<csc, const File*>& a,
+                 const std::pair<csc, const File*>& b) { return a.first < b.first; });
+    for (const auto& sub : subs) {
+        if (auto sdir = dynamic_cast<const Dir*>(sub.second)) {
+            walk(sdir, q);
+        } else if (auto file = dynamic_cast<const RegFile*>(sub.second)) {
+            const int bin = file->is_binary(); // known from earlier scans
+            if (bin == 1 and not m_opts.binary) { q.skipped++; continue; }
+            std::unique_ptr<Job> job(new Job);
+            job->file = file;
+            job->path = file->path();
+            job->sniff = (bin < 0 and not m_opts.binary);
+            std::unique_lock<std::mutex> lock(q.mtx);
+            q.room.wait(lock, [&q]() { return q.flight.size() < q.window or q.stop; });
+            if (q.stop) { return; }
+            q.todo.push_back(job.get());
+            q.flight.push_back(std::move(job));
+            q.work.notify_one();
+        }
+    }
+}
+
+/*! Read or map contents of \p job, then search them with \p parser. Files
+ * smaller than \c mmap_min are read into \p buf of capacity \p cap.
+ */
+template<class P>
+void
+Grep::scan(Job& job, P& parser, std::unique_ptr<char[]>& buf, size_t& cap) const
+{
+    const int fd = ::open(job.path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) { return; }
+    struct stat st;
+    if (::fstat(fd, &st) != 0 or st.st_size == 0) { ::close(fd); return; }
+    size_t len = st.st_size;
+
+    const char * dat = nullptr;
+    void * map = MAP_FAILED;
+    if (len >= m_opts.mmap_min) {
+        map = ::mmap(nullptr, len, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map != MAP_FAILED) {
+            ::madvise(map, len, MADV_SEQUENTIAL);
+            dat = static_cast<const char*>(map);
+        }
+    }
+    if (not dat) {              // small file or mmap() failed
+        if (cap < len) { buf.reset(new char[len]); cap = len; }
+        size_t n = 0;
+        while (n < len) {
+            const ssize_t r = ::pread(fd, buf.get() + n, len - n, n);
+            if (r < 0 and errno == EINTR) { continue; }
+            if (r <= 0) { break; }
+            n += r;
+        }
+        len = n;
+        dat = buf.get();
+    }
+    ::close(fd);                // mapping stays valid
+
+    if (job.sniff and memchr(dat, 0, std::min(len, m_opts.sniff_len))) {
+        job.binary = true;
+    } else {
+        job.bytes = len;
+        parser.reset();         // buf or mapping may be at the same address as last file
+        size_t line = 1, mark = 0; // line number at byte offset mark
+        for (size_t off = 0; off <= len and job.hits.size() < m_opts.max_count;) {
+            const pHit hit = parser.find(dat, len, off);
+            if (not hit.full()) { break; }
+            const size_t lo = to_byte(hit.low()), hi = to_byte(hit.high());
+            line += std::count(dat + mark, dat + lo, '\n');
+            mark = lo;
+            job.hits.push_back(Hit{job.file, lo, hi - lo, line});
+            off = hi > lo ? hi : hi + 1;
+        }
+    }
+    if (map != MAP_FAILED) { ::munmap(map, st.st_size); }
+}
+
+void
+Grep::work(Queue& q) const
+{
+    Peg::Parser parser(*m_peg);
+    std::unique_ptr<char[]> buf;
+    size_t cap = 0;
+    for (;;) {
+        Job * job = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(q.mtx);
+            q.work.wait(lock, [&q]() { return not q.todo.empty() or q.walked or q.stop; });
+            if (q.todo.empty() or q.stop) { break; }
+            job = q.todo.front();
+            q.todo.pop_front();
+        }
+        scan(*job, parser, buf, cap);
+        std::lock_guard<std::mutex> lock(q.mtx);
+        job->done = true;
+        if (job == q.flight.front().get()) { q.ready.notify_one(); }
+    }
+}
+
+size_t
+Grep::run(const Dir * top,
+          const std::function<void(const Hit&)>& f)
+{
+    m_stats = Stats();
+    Queue q;
+    q.window = m_opts.window;
+
+    Crew crew{q, {}};           // stops and joins threads however we leave
+    for (size_t i = 0; i < m_opts.nthreads; i++) {
+        crew.threads.emplace_back([this, &q]() { work(q); });
+    }
+    crew.threads.emplace_back([this, &q, top]() {
+            walk(top, q);
+            std::lock_guard<std::mutex> lock(q.mtx);
+            q.walked = true;
+            q.work.notify_all();
+            q.ready.notify_one();
+        });
+
+    for (;;) {                  // deliver jobs in walk order
+        std::unique_ptr<Job> job;
+        {
+            std::unique_lock<std::mutex> lock(q.mtx);
+            q.ready.wait(lock, [&q]() {
+                    return ((not q.flight.empty() and q.flight.front()->done) or
+                            (q.flight.empty() and q.walked)); });
+            if (q.flight.empty()) { break; }
+            job = std::move(q.flight.front());
+            q.flight.pop_front();
+            q.room.notify_one();
+        }
+        if (job->binary) { m_stats.skipped++; continue; }
+        m_stats.files++;
+        m_stats.bytes += job->bytes;
+        m_stats.hits += job->hits.size();
+        for (const auto& hit : job->hits) { f(hit); } // may throw
+    }
+
+    m_stats.skipped += q.skipped;
+    return m_stats.hits;
+}
+
+}
@@ -0,0 +1,97 @@
+/*! \file grep.hpp
+ * \brief Parallel Multi-File Pattern Search.
+ * \author Copyright (C) 2012 Per Nordlöw (per.nordlow@gmail.com)
+ *
+ * Searches the contents of all regular files in a loaded \c Dir tree for a
+ * pattern. The search runs as a pipeline:
+ * - one thread walks the tree, in name order, and drops files whose type or
+ *   content histogram is already known to be binary,
+ * - worker threads read each file, small ones with one \c pread() into a
+ *   reused buffer and large ones through \c mmap(), and match it with their
+ *   own \c Peg::Parser, which tests the \c Skips8 start-byte set before any
+ *   other work,
+ * - the calling thread gets the hits, file by file in walk order.
+ *
+ * At most \c window files are in flight at a time, which bounds memory and
+ * the number of open files no matter how large the tree is.
+ */
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <thread>
+
+namespace semnet {
+
+namespace filesystem {
+class Dir;
+class RegFile;
+}
+namespace patterns {
+class Base;
+class Peg;
+}
+
+/*! Parallel Content Search of a Pattern in a Directory Tree. */
+class Grep {
+public:
+    /// Search Hit.
+    struct Hit {
+        const filesystem::RegFile * file; ///< File hit.
+        size_t off;             ///< Byte offset of hit.
+        size_t len;             ///< Byte length of hit.
+        size_t line;            ///< Line number of hit, 1 for first line.
+    };
+
+    /// Search Options.
+    struct Options {
+        size_t nthreads = std::thread::hardware_concurrency(); ///< Number of worker threads.
+        size_t window = 0;      ///< Maximum files in flight, 0 for \c 8*nthreads.
+        size_t max_count = SIZE_MAX; ///< Maximum hits per file.
+        size_t mmap_min = 1 << 20; ///< Smallest file read through \c mmap().
+        size_t sniff_len = 8192; ///< Bytes checked for NUL in files of unknown type.
+        bool binary = false;    ///< Search binary files too.
+    };
+
+    /// Search Statistics.
+    struct Stats {
+        size_t files = 0;       ///< Files searched.
+        size_t skipped = 0;     ///< Binary files skipped.
+        size_t bytes = 0;       ///< Bytes searched.
+        size_t hits = 0;        ///< Hits found.
+    };
+
+    /// Prepare search for \p patt.
+    explicit Grep(const patterns::Base * patt);
+    Grep(const patterns::Base * patt, const Options& opts);
+    ~Grep();
+
+    /*! Search all regular files under \p top, calling \p f(const Hit&) on
+     * the calling thread for each hit, in order of file and then offset.
+     * If \p f throws, the search is stopped and the exception propagated.
+     * \return number of hits.
+     */
+    size_t run(const filesystem::Dir * top,
+               const std::function<void(const Hit&)>& f);
+
+    /// Get statistics of last run().
+    const Stats& stats() const { return m_stats; }
+
+private:
+    struct Job;
+    struct Queue;
+    struct Crew;
+
+    void walk(const filesystem::Dir * dir, Queue& q) const;
+    void work(Queue& q) const;
+    template<class P>
+    void scan(Job& job, P& parser, std::unique_ptr<char[]>& buf, size_t& cap) const;
+
+    Options m_opts;
+    std::unique_ptr<patterns::Peg> m_peg; ///< Compiled pattern, shared by workers.
+    Stats m_stats;
+};
+
+}
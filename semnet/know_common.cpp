@@ -336,7 +336,7 @@ void learn_common()
 
     gp_DEL = new Lit(ASCII_DEL, "Delete"); gp_ASCII_Ctrl->add(gp_DEL);
 
-    (gp_ASCII_7Bit = alt(gp_NUL, gp_DEL, true))->set_name("ASCII Character");
+    (gp_ASCII_7Bit = ran(gp_NUL, gp_DEL))->set_name("ASCII Character");
 
     gp_Eq = new Lit(ASCII_EQ, "Equality Sign");
 
@@ -484,8 +484,8 @@ void learn_common()
 
     /* --- Ranges of Letters --- */
 
-    (gp_laf = ran(gp_la, gp_lf, true))->set_name("Letter a to f")->set_pmatch(cbuf_lmatch_LETTER_a_to_f);
-    (gp_lAF = ran(gp_lA, gp_lF, true))->set_name("Letter A to F")->set_pmatch(cbuf_lmatch_LETTER_A_to_F);
+    (gp_laf = ran(gp_la, gp_lf))->set_name("Letter a to f")->set_pmatch(cbuf_lmatch_LETTER_a_to_f);
+    (gp_lAF = ran(gp_lA, gp_lF))->set_name("Letter A to F")->set_pmatch(cbuf_lmatch_LETTER_A_to_F);
 
     /* --- Ranges --- */
 
@@ -523,11 +523,11 @@ void learn_common()
 
     /* --- Ranges --- */
 
-    (gp_a_to_z = ran(gp_la, gp_lz, true))->
+    (gp_a_to_z = ran(gp_la, gp_lz))->
         set_name("English Lower Letter")->
         set_pmatch(cbuf_lmatch_LETTER_EN_LOWER);
 
-    (gp_A_to_Z = ran(gp_lA, gp_lZ, true))->
+    (gp_A_to_Z = ran(gp_lA, gp_lZ))->
         set_name("English Upper Letter")->
         set_pmatch(cbuf_lmatch_LETTER_EN_UPPER);
 
@@ -563,16 +563,16 @@ void learn_common()
 
     /* --- Digits (Ranges) --- */
 
-    (gp_DigB = alt(gp_l0, gp_l1, true))->set_name("Binary Digit")->set_pmatch(cbuf_lmatch_DIGIT_BIN);
-    (gp_DigO = ran(gp_l0, gp_l7, true))->set_name("Octal Digit")->set_pmatch(cbuf_lmatch_DIGIT_OCT);
-    (gp_DigD = ran(gp_l0, gp_l9, true))->set_name("Decimal Digit")->set_pmatch(cbuf_lmatch_DIGIT_DEC);
+    (gp_DigB = alt(gp_l0, gp_l1))->set_name("Binary Digit")->set_pmatch(cbuf_lmatch_DIGIT_BIN);
+    (gp_DigO = ran(gp_l0, gp_l7))->set_name("Octal Digit")->set_pmatch(cbuf_lmatch_DIGIT_OCT);
+    (gp_DigD = ran(gp_l0, gp_l9))->set_name("Decimal Digit")->set_pmatch(cbuf_lmatch_DIGIT_DEC);
 
     (gp_DigH = alt(gp_DigD,
                    gp_laf,
                    gp_lAF))->set_name("HexaDecimal Digit");
     gp_DigH->set_pmatch(cbuf_lmatch_DIGIT_HEX);
 
-    (gp_Dig1t9 = ran(gp_l1, gp_l9, true))->set_name("Digit 1 to 9");
+    (gp_Dig1t9 = ran(gp_l1, gp_l9))->set_name("Digit 1 to 9");
     gp_Dig1t9->set_pmatch(cbuf_lmatch_DIGIT_BIN);
 
     /* --- Sequences of Digits --- */
@@ -214,6 +214,10 @@ extern Lit * gp_lOUMLAUT_U;
 extern Alt * gp_lSV_U;
 extern Alt * gp_lSV;
 
+extern Alt * gp_DigB;           ///< Binary Digit.
+extern Alt * gp_DigO;           ///< Octal Digit.
+extern Alt * gp_DigD;           ///< Decimal Digit.
+extern Alt * gp_DigH;           ///< Hexadecimal Digit.
 extern Alt * gp_DigD_N_En;
 extern Alt * gp_DigD_N_Sv;
 
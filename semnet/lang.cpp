@@ -1,6 +1,8 @@
 #include "lang.hpp"
+#include "peg.hpp"
 #include "seq.hpp"
 #include "file.hpp"
+#include "../memory_x.hpp"
 #include <boost/algorithm/string.hpp>
 
 namespace semnet { namespace patterns {
@@ -44,4 +46,29 @@ Lang::Lang(const csc name, Base * sub) : Wrap(name, sub)
     // Open contents of .dz by finding by finding contents of CompFile.
 }
 
+Lang::~Lang() {}
+
+pHit
+Lang::match_in(const char* buf, size_t len,
+               bir roi) const
+{
+    std::shared_ptr<const Peg> peg; // kept alive if unprepared meanwhile
+    {
+        std::lock_guard<std::mutex> lock(m_peg_mutex);
+        if (not m_peg) { m_peg = std::make_shared<const Peg>(m_sub); }
+        peg = m_peg;
+    }
+    Peg::Parser parser(*peg);
+    const size_t high = (roi.high() == range<bix>::highest()) ? len : std::min<size_t>(len, to_byte(roi.high()));
+    return parser.find(buf, high, to_byte(roi.low()));
+}
+
+void
+Lang::unprepare() const
+{
+    Wrap::unprepare();
+    std::lock_guard<std::mutex> lock(m_peg_mutex);
+    m_peg.reset();
+}
+
 }}
@@ -6,19 +6,36 @@
 #pragma once
 #include <algorithm>
 #include <iosfwd>
+#include <memory>
+#include <mutex>
 #include "spatt.hpp"
 //template<class T, class H, class P, class A> class unordered_set;
 
 namespace semnet { namespace patterns {
 
-/*! Language Top Pattern. */
+class Peg;
+
+/*! Language Top Pattern.
+ *
+ * Matched through a \c Peg compiled on first use, as language grammars are
+ * large, shared and often left-recursive.
+ */
 class Lang : public Wrap {
 public:
     Lang(const csc name, Base* sub);
     Lang(const char* name, Base* sub) : Lang(csc(name), sub) {}
-    virtual ~Lang() {}
+    virtual ~Lang();
     virtual std::ostream& show(std::ostream& os) const;
+
+    /*! Find first sentence of \c this in \p buf of length \p len inside range \p roi. */
+    virtual pHit match_in(const char* buf, size_t len,
+                          bir roi = bir::full()) const;
+
+    /*! Drop compiled grammar. Call after changing the grammar. */
+    virtual void unprepare() const;
 protected:
+    mutable std::shared_ptr<const Peg> m_peg; ///< Compiled Grammar (cache).
+    mutable std::mutex m_peg_mutex; ///< Guards \c m_peg.
 //    boost::unordered_set<csc> m_wdict; ///< Language Words Dictionary.
 };
 
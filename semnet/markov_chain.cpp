@@ -0,0 +1,302 @@
+#include "markov_chain.hpp"
+#include "regfile.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace semnet { namespace patterns {
+
+using pnw::histogram::ngram::roll;
+
+namespace {
+
+const double BACKOFF = 0.4;     ///< Weight of each shorter context backed off to.
+const size_t BLOCK_SIZE = 1 << 16; ///< Read block byte size.
+const uint64_t FNV_OFFSET = 0xcbf29ce484222325ULL;
+const uint64_t FNV_PRIME = 0x100000001b3ULL;
+
+/*! Call \p f(const char*, size_t) with each block of contents of file at
+ * \p path. Blocks are read rather than mapped, so a file truncated
+ * meanwhile ends early instead of raising SIGBUS.
+ * \return number of bytes passed to \p f, or -1 if \p path could not be opened.
+ */
+template<class F>
+ssize_t with_blocks(const csc& path, F f)
+{
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) { return -1; }
+    ::posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    std::vector<char> bbuf(BLOCK_SIZE);
+    ssize_t len = 0;
+    for (;;) {
+        const ssize_t n = ::read(fd, bbuf.data(), bbuf.size());
+        if (n < 0 and errno == EINTR) { continue; }
+        if (n <= 0) { break; }  // end of file, or read error taken as one
+        f(bbuf.data(), n);
+        len += n;
+    }
+    ::close(fd);
+    return len;
+}
+
+}
+
+/* ---------------------------- Group Separator ---------------------------- */
+
+/// Streaming Splitter of Bytes into Units.
+struct MarkovChain::Units {
+    explicit Units(MCUNIT_t unit) : unit(unit) {}
+    MCUNIT_t unit;
+    uint64_t tok = 0;           ///< FNV-1a hash of current token.
+    int kind = 0;               ///< Kind of current token, 0 if none.
+
+    /// Get kind of token byte \p c is part of: 1 for word, 2 for other, 0 for none.
+    static int kind_of(uchar c) {
+        if (isalnum(c) or c == '_' or c >= 0x80) { return 1; } // including UTF-8
+        if (c == ' ' or (c >= '\t' and c <= '\r')) { return 0; }
+        return 2;
+    }
+
+    /// Call \p f(uint64_t) with each unit ended in \p buf of length \p len.
+    template<class F> void feed(const char * buf, size_t len, F& f) {
+        const uchar * ubuf = reinterpret_cast<const uchar*>(buf);
+        if (unit == MCUNIT_BYTE) {
+            for (size_t i = 0; i < len; i++) { f(ubuf[i]); }
+            return;
+        }
+        for (size_t i = 0; i < len; i++) {
+            const uchar c = ubuf[i];
+            const int k = kind_of(c);
+            if (kind and k != kind) { f(tok); kind = 0; }
+            if (k) {
+                if (not kind) { tok = FNV_OFFSET; kind = k; }
+                tok = (tok ^ c) * FNV_PRIME;
+            } else if (c == '\n') {
+                f('\n');
+            }
+        }
+    }
+
+    /// Call \p f(uint64_t) with unit ended by end of input.
+    template<class F> void finish(F& f) {
+        if (kind) { f(tok); kind = 0; }
+    }
+};
+
+/// Counter of N-grams Ending at Each Unit.
+struct MarkovChain::Trainer {
+    Trainer(Counts& counts, size_t order) : counts(counts), order(order) {}
+    Counts& counts;
+    size_t order;
+    uint64_t ctx[ORDER_MAX] = {}; ///< Rolling hashes of last 0 to order-1 units.
+    size_t units = 0;
+    void operator()(uint64_t value) {
+        const size_t n = std::min(units, order - 1); // context length
+        for (size_t k = 0; k <= n; k++) { counts.add_key(roll(ctx[k], value)); }
+        for (size_t k = std::min(n + 1, order - 1); k >= 1; k--) { ctx[k] = roll(ctx[k - 1], value); }
+        units++;
+    }
+};
+
+/// Summer of Log Probability of Each Unit.
+struct MarkovChain::Scorer {
+    explicit Scorer(const MarkovChain& mc) : mc(mc) {}
+    const MarkovChain& mc;
+    uint64_t ctx[ORDER_MAX] = {}; ///< Rolling hashes of last 0 to order-1 units.
+    size_t units = 0;
+    double sum = 0;
+    void operator()(uint64_t value) {
+        const size_t order = mc.m_opts.order;
+        const size_t n = std::min(units, order - 1); // context length
+        sum += std::log2(mc.prob(ctx, n, value));
+        for (size_t k = std::min(n + 1, order - 1); k >= 1; k--) { ctx[k] = roll(ctx[k - 1], value); }
+        units++;
+    }
+    double mean() const { return units ? sum / units : -std::numeric_limits<double>::infinity(); }
+};
+
+/* ---------------------------- Group Separator ---------------------------- */
+
+double
+MarkovChain::prob(const uint64_t * ctx, size_t n, uint64_t value) const
+{
+    double w = 1;
+    for (size_t k = n; k >= 1; k--) { // longest context first
+        if (const uint32_t c = count_key(roll(ctx[k], value))) {
+            return w * c / std::max(count_key(ctx[k]), c);
+        }
+        w *= BACKOFF;
+    }
+    /* distinct n-grams bound the number of distinct tokens */
+    const double vocab = (m_opts.unit == MCUNIT_BYTE) ? 256 : ngrams() + 1;
+    return w * (count_key(roll(0, value)) + 1.0) / (m_stats.units + vocab);
+}
+
+void
+MarkovChain::thaw()
+{
+    if (not m_frozen.is_open()) { return; }
+    m_counts = Counts(m_opts.order, m_frozen.size());
+    m_frozen.for_each_key([this](uint64_t key, uint32_t c) { m_counts.add_key(key, c); });
+    m_frozen.close();
+}
+
+void
+MarkovChain::train(const char * buf, size_t len)
+{
+    thaw();
+    Units u{m_opts.unit};
+    Trainer t{m_counts, m_opts.order};
+    u.feed(buf, len, t);
+    u.finish(t);
+    m_stats.bytes += len;
+    m_stats.units += t.units;
+}
+
+size_t
+MarkovChain::train_files(const std::vector<csc>& paths)
+{
+    thaw();
+    const size_t nthreads = std::min(m_opts.nthreads, paths.size());
+    std::vector<Counts> shards(nthreads, Counts(m_opts.order));
+    std::vector<Stats> stats(nthreads);
+    std::atomic<size_t> next(0);
+
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < nthreads; i++) {
+        workers.emplace_back([this, &paths, &shards, &stats, &next, i]() {
+                for (size_t j; (j = next++) < paths.size();) {
+                    Units u{m_opts.unit};
+                    Trainer t{shards[i], m_opts.order};
+                    const ssize_t len = with_blocks(paths[j], [&](const char * buf, size_t n) {
+                            u.feed(buf, n, t);
+                        });
+                    if (len < 0) { continue; }
+                    u.finish(t);
+                    stats[i].files++;
+                    stats[i].bytes += len;
+                    stats[i].units += t.units;
+                }
+            });
+    }
+    for (auto& w : workers) { w.join(); }
+
+    size_t ret = 0;
+    for (size_t i = 0; i < nthreads; i++) {
+        m_counts.merge(shards[i]);
+        m_stats.files += stats[i].files;
+        m_stats.bytes += stats[i].bytes;
+        m_stats.units += stats[i].units;
+        ret += stats[i].files;
+    }
+    return ret;
+}
+
+double
+MarkovChain::score(const char * buf, size_t len) const
+{
+    Units u{m_opts.unit};
+    Scorer s{*this};
+    u.feed(buf, len, s);
+    u.finish(s);
+    return s.mean();
+}
+
+double
+MarkovChain::score(filesystem::RegFile * file) const
+{
+    Units u{m_opts.unit};
+    Scorer s{*this};
+    std::vector<char> bbuf(std::min(BLOCK_SIZE, m_opts.max_bytes));
+    for (size_t off = 0; off < m_opts.max_bytes;) {
+        const ssize_t n = file->pread(bbuf.data(), std::min(bbuf.size(), m_opts.max_bytes - off), off);
+        if (n <= 0) { break; }
+        u.feed(bbuf.data(), n, s);
+        off += n;
+    }
+    u.finish(s);
+    return s.mean();
+}
+
+bool
+MarkovChain::save(const char * path) const
+{
+    const uint64_t aux[4] = { m_opts.unit, m_stats.files, m_stats.bytes, m_stats.units };
+    if (not m_frozen.is_open()) { return m_counts.save(path, aux); }
+    Counts counts(m_opts.order, m_frozen.size()); // saving a loaded model
+    m_frozen.for_each_key([&counts](uint64_t key, uint32_t c) { counts.add_key(key, c); });
+    return counts.save(path, aux);
+}
+
+bool
+MarkovChain::load(const char * path)
+{
+    if (not m_frozen.open(path)) { return false; }
+    if (m_frozen.order() < 1 or m_frozen.order() > ORDER_MAX) { m_frozen.close(); return false; }
+    const uint64_t * aux = m_frozen.aux();
+    m_opts.unit = static_cast<MCUNIT_t>(aux[0]);
+    m_opts.order = m_frozen.order();
+    m_stats.files = aux[1];
+    m_stats.bytes = aux[2];
+    m_stats.units = aux[3];
+    m_counts = Counts(m_opts.order);
+    return true;
+}
+
+/* ---------------------------- Group Separator ---------------------------- */
+
+pHit
+MarkovChain::match_in_local(const char * buf, size_t len,
+                            bir roi) const
+{
+    const size_t off = std::min<size_t>(to_byte(roi.low()), len);
+    const size_t end = std::min<size_t>(floored_to_byte(roi.high()), len);
+    const size_t n = std::min(end > off ? end - off : 0, m_opts.max_bytes);
+    return (score(buf + off, n) >= m_opts.min_score) ? pHit(roi.low(), to_bit(n)) : pHit().undefine();
+}
+
+size_t
+MarkovChain::complexity(bir mults) const
+{
+    return std::numeric_limits<size_t>::max();
+}
+
+csc
+MarkovChain::rand(bir ssr) const
+{
+    csc ret;
+    if (m_opts.unit != MCUNIT_BYTE) { return ret; } // tokens are only known by hash
+    const size_t len = std::min<size_t>(floored_to_byte(ssr.high()), 64);
+    Scorer s{*this};            // only for its context
+    double p[256];
+    for (size_t i = 0; i < len; i++) {
+        const size_t n = std::min(s.units, m_opts.order - 1);
+        double sum = 0;
+        for (size_t c = 0; c < 256; c++) { sum += (p[c] = prob(s.ctx, n, c)); }
+        double r = ::rand() / (RAND_MAX + 1.0) * sum;
+        size_t c = 0;
+        while (c < 255 and (r -= p[c]) >= 0) { c++; }
+        ret.push_back(static_cast<char>(c));
+        s(c);
+    }
+    return ret;
+}
+
+std::ostream&
+MarkovChain::show(std::ostream& os) const
+{
+    Base::show(os);
+    return os << " unit:" << (m_opts.unit == MCUNIT_BYTE ? "byte" : "token")
+              << " order:" << m_opts.order
+              << " ngrams:" << ngrams()
+              << " units:" << m_stats.units;
+}
+
+}
+}
@@ -3,13 +3,43 @@
  * \brief Markov Chain
  * \author Copyright (C) 2012 Per Nordlöw (per.nordlow@gmail.com)
  * \date 2011-10-25 21:24
+ *
+ * An n:th order Markov model of the bytes or tokens of a language or file
+ * format, trained on a corpus of files and used to detect it in files
+ * lacking a telling name or magic. All 1- to n-grams are counted in one
+ * flat \c pnw::histogram::ngram::table, so a model is a single array of
+ * (hash, count) slots.
+ *
+ * Tokens are maximal runs of word characters, maximal runs of other
+ * printable characters such as operators, and newlines. Other whitespace
+ * only separates tokens.
+ *
+ * A trained model is saved with \c save() as a \c ngram::table file and
+ * mapped back with \c load() as a \c ngram::frozen_table, so it need not
+ * be retrained nor read into memory on every run.
+ *
+ * A buffer is scored in one pass, in which the n-grams ending at each unit
+ * are hashed incrementally from the previous ones. The probability of each
+ * unit comes from the longest context seen in training, backing off to
+ * shorter ones (Stupid Backoff), down to smoothed unigram counts.
+ *
+ * \see https://en.wikipedia.org/wiki/Markov_chain
+ * \see http://www.aclweb.org/anthology/D07-1090 (Stupid Backoff)
  */
 
 #pragma once
 
-#include "spatt.hpp"
+#include <thread>
+#include <vector>
+#include "patt.hpp"
+#include "../ngram.hpp"
 
 namespace semnet {
+
+namespace filesystem {
+class RegFile;
+}
+
 namespace patterns {
 
 /*! Markov Chain
@@ -18,9 +48,120 @@ namespace patterns {
  */
 class MarkovChain : public Base {
 public:
+    /// Unit of Chain.
+    typedef enum {
+        MCUNIT_BYTE,            ///< Bytes.
+        MCUNIT_TOKEN,           ///< Tokens.
+    } __attribute__ ((packed)) MCUNIT_t;
+
+    enum { ORDER_MAX = 16 };    ///< Maximum \c order.
+
+    /// N-gram Counts of Units.
+    typedef pnw::histogram::ngram::table<uint64_t, uint32_t> Counts;
+    /// Mapped N-gram Counts of Units, saved from \c Counts.
+    typedef pnw::histogram::ngram::frozen_table<uint64_t, uint32_t> FrozenCounts;
+
+    /// Model Options.
+    struct Options {
+        MCUNIT_t unit = MCUNIT_BYTE;
+        size_t order = 3;       ///< Maximum n-gram length, at most \c ORDER_MAX.
+        size_t nthreads = std::thread::hardware_concurrency(); ///< Number of training threads.
+        size_t max_bytes = 1 << 16; ///< Maximum bytes scored of a file.
+        double min_score = -6;  ///< Minimum score of a match, in bits per unit.
+    };
+
+    /// Training Statistics.
+    struct Stats {
+        size_t files = 0;       ///< Files trained on.
+        size_t bytes = 0;       ///< Bytes trained on.
+        size_t units = 0;       ///< Units trained on.
+    };
+
     MarkovChain() : Base() { init(); }
-    MarkovChain(Const Char * name) : Base(name) { }
+    MarkovChain(const char * name) : Base(name) { init(); }
+    MarkovChain(const char * name, const Options& opts) : Base(name), m_opts(opts) { init(); }
+    MarkovChain(const csc& name, const Options& opts) : Base(name), m_opts(opts) { init(); }
+
+    virtual ~MarkovChain() {}
+
+    /// Train on \p buf of length \p len.
+    void train(const char * buf, size_t len);
+
+    /*! Train on the files at \p paths, each read by one of \c nthreads
+     * threads into a private table, merged at the end.
+     * \return number of files read.
+     */
+    size_t train_files(const std::vector<csc>& paths);
+
+    /*! Score \p buf of length \p len.
+     * \return mean log2 probability per unit, which is higher the more
+     * alike \p buf is the training corpus, or -inf if \p buf has no units.
+     */
+    double score(const char * buf, size_t len) const;
+
+    /// Score at most \c max_bytes first bytes of \p file.
+    double score(filesystem::RegFile * file) const;
+
+    /*! Save model to \p path.
+     * \return true on success.
+     */
+    bool save(const char * path) const;
+
+    /*! Map model saved at \p path with \c save(), replacing the current
+     * one. Training afterwards first copies the mapped counts into memory.
+     * \return true on success.
+     */
+    bool load(const char * path);
+
+    const Options& options() const { return m_opts; }
+    const Stats& stats() const { return m_stats; }
+    /// Get counts, empty while a model mapped by \c load() is used.
+    const Counts& counts() const { return m_counts; }
+    /// Get number of distinct n-grams.
+    size_t ngrams() const { return m_frozen.is_open() ? m_frozen.size() : m_counts.size(); }
+
+    virtual bir sample_range() const { return bir::full(); }
+    virtual size_t complexity(bir mults = bir::full()) const;
+
+    /// Get a random instance, drawn from the chain if of bytes.
+    virtual csc rand(bir ssr = bir::full()) const;
+
+    virtual Base::Skips8& intersect_skips(Skips8& skips) const { return skips; }
+
+    virtual std::ostream& show(std::ostream& os) const;
+
+protected:
+    /// Match if the score of \p buf in \p roi is at least \c min_score.
+    virtual pHit match_in_local(const char * buf, size_t len,
+                                bir roi = bir::full()) const;
+
 private:
+    struct Units;
+    struct Trainer;
+    struct Scorer;
+
+    void init() {
+        m_opts.order = std::min<size_t>(std::max<size_t>(m_opts.order, 1), ORDER_MAX);
+        m_opts.nthreads = std::max<size_t>(m_opts.nthreads, 1);
+        m_counts = Counts(m_opts.order);
+    }
+
+    /*! Get probability of unit \p value after the last \p n units, where
+     * \p ctx[k] is the rolling hash of the last \p k units. */
+    double prob(const uint64_t * ctx, size_t n, uint64_t value) const;
+
+    /// Get count of n-gram with rolling hash \p key.
+    uint32_t count_key(uint64_t key) const {
+        return m_frozen.is_open() ? m_frozen.count_key(key) : m_counts.count_key(key);
+    }
+
+    /// Copy mapped counts, if any, into \c m_counts before training.
+    void thaw();
+
+    Options m_opts;
+    Stats m_stats;
+    Counts m_counts{1};
+    FrozenCounts m_frozen;      ///< Counts of model mapped by \c load().
 };
 
 }
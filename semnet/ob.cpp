@@ -7,6 +7,7 @@
 #include "preg.hpp"
 #include "ob.hpp"
 #include "dup.hpp"
+#include "obarena.hpp"
 
 namespace semnet {
 
@@ -20,6 +21,19 @@ Ob::Ob()
 
 Ob::~Ob()
 {
+    if (m_rid != OBID_undefined_ and g_oreg) { g_oreg->unreg(this); }
+}
+
+void*
+Ob::operator new(size_t size)
+{
+    return ObArena::instance().alloc(size);
+}
+
+void
+Ob::operator delete(void* p)
+{
+    ObArena::instance().free(p);
 }
 
 void
@@ -29,6 +29,9 @@ class pReg;
 class Ob;
 typedef std::vector<Ob*> Obs;
 
+typedef uint32_t ObId;          ///< Registry Handle of an \c Ob.
+#define OBID_undefined_ (std::numeric_limits<ObId>::max()) ///< Not registered.
+
 typedef std::pair<REL_t, Ob*> TRel;
 typedef std::vector<TRel> TRels;
 
@@ -83,8 +86,17 @@ class Ob {
     friend class pReg;
 public:
     Ob();
+    Ob(const Ob&) : m_rid(OBID_undefined_) {} ///< Copies are not registered.
+    Ob& operator = (const Ob&) { return *this; }
     virtual ~Ob();
 
+    /// Allocate in \c ObArena.
+    static void* operator new(size_t size);
+    static void operator delete(void* p);
+
+    /// Get Registry Handle, or \c OBID_undefined_ if not registered.
+    ObId get_rid() const { return m_rid; }
+
     // \todo These should be put in sub-classes.
 #if 0
     void* operator new[](size_t num) {
@@ -902,6 +914,7 @@ public:
 protected:
 
 private:
+    ObId m_rid = OBID_undefined_; ///< Registry Handle.
 };
 
 }
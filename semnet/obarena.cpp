@@ -0,0 +1,76 @@
+#include "obarena.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+
+namespace semnet {
+
+ObArena::~ObArena()
+{
+    for (auto slab : m_slabs) { ::free(slab); }
+}
+
+ObArena&
+ObArena::instance()
+{
+    static ObArena * arena = new ObArena(); // never destroyed, as objects may outlive statics
+    return *arena;
+}
+
+ObArena::Slab*
+ObArena::new_slab(size_t osize, size_t bytes)
+{
+    void * mem = nullptr;
+    if (::posix_memalign(&mem, SLAB_SIZE, bytes) != 0) { throw std::bad_alloc(); }
+    auto slab = static_cast<Slab*>(mem);
+    slab->osize = osize;
+    slab->count = bytes / SLAB_SIZE;
+    if (osize <= MAX_SMALL) { m_slabs.push_back(slab); } // large ones are freed with their object
+    m_slab_bytes += bytes;
+    return slab;
+}
+
+void*
+ObArena::alloc(size_t size)
+{
+    const size_t osize = (std::max<size_t>(size, 1) + GRAIN - 1) & ~(GRAIN - 1);
+    m_used_bytes += osize;
+    if (osize > MAX_SMALL) {    // own slab, with object right after header
+        const size_t bytes = (GRAIN + osize + SLAB_SIZE - 1) & ~(SLAB_SIZE - 1);
+        return reinterpret_cast<char*>(new_slab(osize, bytes)) + GRAIN;
+    }
+    const size_t c = osize / GRAIN - 1;
+    if (auto link = m_free[c]) {
+        m_free[c] = link->next;
+        return link;
+    }
+    if (not m_next[c] or         // first use of size class
+        m_next[c] + osize > m_end[c]) {
+        auto slab = reinterpret_cast<char*>(new_slab(osize, SLAB_SIZE));
+        m_next[c] = slab + GRAIN;
+        m_end[c] = slab + SLAB_SIZE;
+    }
+    void * p = m_next[c];
+    m_next[c] += osize;
+    return p;
+}
+
+void
+ObArena::free(void* p)
+{
+    if (not p) { return; }
+    auto slab = slab_of(p);
+    const size_t osize = slab->osize;
+    m_used_bytes -= osize;
+    if (osize > MAX_SMALL) {
+        m_slab_bytes -= slab->count * SLAB_SIZE;
+        ::free(slab);
+        return;
+    }
+    const size_t c = osize / GRAIN - 1;
+    auto link = static_cast<Link*>(p);
+    link->next = m_free[c];
+    m_free[c] = link;
+}
+
+}
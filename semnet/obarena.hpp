@@ -0,0 +1,73 @@
+/*! \file obarena.hpp
+ * \brief Slab Allocator for SemNet Objects.
+ * \author Copyright (C) 2012 Per Nordlöw (per.nordlow@gmail.com)
+ *
+ * Every \c Ob is allocated here through \c Ob::operator new. Objects are
+ * packed into 64 KiB slabs per size class, rounded to 16 bytes, instead of
+ * each getting its own \c malloc() chunk with its own header. Objects of one
+ * size, and so usually of one type, then share cache lines and pages when
+ * a tree is traversed. The slab header records the object size, which gives
+ * the per-type memory report in \c pReg::show_memory().
+ *
+ * Freed objects go to a free list of their size class and are reused. Slabs
+ * are kept until the arena is destroyed. Not thread-safe.
+ */
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace semnet {
+
+/*! Object Slab Allocator. */
+class ObArena {
+public:
+    static const size_t SLAB_SIZE = size_t(1) << 16; ///< Slab byte size and alignment.
+    static const size_t GRAIN = 16;     ///< Size class granularity and object alignment.
+    static const size_t MAX_SMALL = 4096; ///< Largest object size packed into shared slabs.
+
+    ObArena() {}
+    ~ObArena();
+    ObArena(const ObArena&) = delete;
+    ObArena& operator = (const ObArena&) = delete;
+
+    /// Allocate \p size bytes.
+    void* alloc(size_t size);
+    /// Free \p p allocated by alloc().
+    void free(void* p);
+
+    /// Get bytes reserved for object at \p p, allocated by alloc().
+    static size_t size_of(const void* p) { return slab_of(p)->osize; }
+
+    size_t slab_bytes() const { return m_slab_bytes; } ///< Bytes of all slabs.
+    size_t used_bytes() const { return m_used_bytes; } ///< Bytes of live objects.
+
+    /// Get arena used by \c Ob.
+    static ObArena& instance();
+
+private:
+    /// Slab Header, at start of each slab.
+    struct Slab {
+        uint32_t osize;         ///< Object byte size.
+        uint32_t count;         ///< Number of slab bytes, as a multiple of \c SLAB_SIZE.
+    };
+    /// Free List Link, stored in freed objects.
+    struct Link { Link* next; };
+
+    static const size_t NCLASS = MAX_SMALL / GRAIN; ///< Number of size classes.
+
+    static Slab* slab_of(const void* p) {
+        return reinterpret_cast<Slab*>(reinterpret_cast<uintptr_t>(p) & ~(SLAB_SIZE - 1));
+    }
+    Slab* new_slab(size_t osize, size_t bytes);
+
+    Link* m_free[NCLASS] = {};  ///< Free lists per size class.
+    char* m_next[NCLASS] = {};  ///< Next unused object in current slab per size class.
+    char* m_end[NCLASS] = {};   ///< End of current slab per size class.
+    std::vector<Slab*> m_slabs; ///< Shared slabs.
+    size_t m_slab_bytes = 0;
+    size_t m_used_bytes = 0;
+};
+
+}
@@ -0,0 +1,460 @@
+#include "peg.hpp"
+#include "seq.hpp"
+#include "alt.hpp"
+#include "ran.hpp"
+#include "rep.hpp"
+#include "lit.hpp"
+#include "any.hpp"
+#include "sit.hpp"
+#include "pmatchers.hpp"
+#include <cctype>
+#include <cstring>
+#include <algorithm>
+
+namespace semnet { namespace patterns {
+
+namespace {
+
+/*! Get bounds \p lo and \p hi if \p ran is a pair of one-byte literals. */
+bool byte_range(const Ran * ran, uchar& lo, uchar& hi)
+{
+    if (ran->get_subs().size() != 2) { return false; }
+    size_t n = 0;
+    uchar b[2];
+    for (auto sub : ran->get_subs()) {
+        auto lit = dynamic_cast<const Lit*>(sub);
+        if (not lit or lit->bytesize() != 1) { return false; }
+        b[n++] = lit->get_byte();
+    }
+    lo = std::min(b[0], b[1]);
+    hi = std::max(b[0], b[1]);
+    return true;
+}
+
+}
+
+Peg::Peg(const Base * top)
+{
+    compile(top);
+    m_refs[0]++;                // root is entered from outside
+    analyze();
+    m_index.clear();
+}
+
+uint32_t
+Peg::add_kids(const std::vector<uint32_t>& kids)
+{
+    const uint32_t a = m_kids.size();
+    m_kids.insert(end(m_kids), begin(kids), end(kids));
+    for (auto k : kids) { m_refs[k]++; }
+    return a;
+}
+
+uint32_t
+Peg::compile(const Base * p)
+{
+    if (not p) {                // missing sub
+        m_code.emplace_back(); m_refs.push_back(0);
+        return m_code.size() - 1;
+    }
+    const auto hit = m_index.find(p);
+    if (hit != m_index.end()) { return hit->second; }
+
+    const uint32_t i = m_code.size(); // allocate first so cycles resolve
+    m_code.emplace_back(); m_refs.push_back(0);
+    m_index[p] = i;
+    m_code[i].src = p;
+    enforce_lt(i, 1u << 24);    // fits memo key
+
+    std::vector<uint32_t> kids;
+    uchar lo = 0, hi = 0;
+    if (auto rep = dynamic_cast<const Rep*>(p)) {
+        const uint32_t k = compile(rep->get_sub());
+        m_refs[k]++;
+        Ins& in = m_code[i];
+        in.op = OP_REP;
+        in.a = k;
+        in.min = rep->range().first;
+        in.max = rep->range().second;
+        in.lazy = not rep->is_greedy() and not rep->fixed();
+    } else if (dynamic_cast<const Ran*>(p) and
+               byte_range(static_cast<const Ran*>(p), lo, hi)) {
+        Ins& in = m_code[i];
+        in.op = OP_CLASS;
+        for (size_t c = lo; c <= hi; c++) { in.first.set(c); }
+        if (static_cast<const Ran*>(p)->is_complement()) { in.first.flip(); }
+    } else if (auto alt = dynamic_cast<const Alt*>(p)) {
+        for (auto sub : alt->get_subs()) { kids.push_back(compile(sub)); }
+        Ins& in = m_code[i];
+        Base::Skips8 set;
+        bool bytes = not kids.empty();
+        for (auto k : kids) {
+            if (m_code[k].op == OP_CLASS) { set |= m_code[k].first; } else { bytes = false; }
+        }
+        if (bytes) {            // fuse byte alternatives into one class
+            in.op = OP_CLASS;
+            in.first = alt->is_complement() ? ~set : set;
+        } else if (alt->is_complement()) {
+            in.op = kids.empty() ? OP_ANY : OP_NALT;
+            if (kids.empty()) { in.a = 1; }
+            else { in.a = add_kids(kids); in.b = in.a + kids.size(); }
+        } else {
+            in.op = kids.empty() ? OP_FAIL : OP_ALT;
+            in.a = add_kids(kids); in.b = in.a + kids.size();
+        }
+    } else if (auto seq = dynamic_cast<const Seq*>(p)) {
+        for (auto sub : seq->get_subs()) { kids.push_back(compile(sub)); }
+        Ins& in = m_code[i];
+        in.op = OP_SEQ;
+        in.a = add_kids(kids); in.b = in.a + kids.size();
+    } else if (auto wrap = dynamic_cast<const Wrap*>(p)) { // Lang, Ctx
+        kids.push_back(compile(wrap->get_sub()));
+        Ins& in = m_code[i];
+        in.op = OP_SEQ;
+        in.a = add_kids(kids); in.b = in.a + 1;
+    } else if (auto lit = dynamic_cast<const Lit*>(p)) {
+        Ins& in = m_code[i];
+        if (lit->bytesize() == 1) {
+            in.op = OP_CLASS;
+            in.first.set(lit->get_byte());
+        } else {
+            in.op = OP_LIT;
+            in.a = m_pool.size();
+            in.b = lit->bytesize();
+            m_pool.append(reinterpret_cast<const char*>(lit->data()), lit->bytesize());
+        }
+    } else if (auto any = dynamic_cast<const Any*>(p)) {
+        Ins& in = m_code[i];
+        if (any->bitsize().get() % 8 == 0) {
+            in.op = OP_ANY;
+            in.a = any->bytesize();
+        } else {
+            in.op = OP_EXTERN;
+        }
+    } else if (auto sit = dynamic_cast<const Sit*>(p)) {
+        Ins& in = m_code[i];
+        in.op = OP_SIT;
+        in.rpos = sit->value();
+    } else {
+        m_code[i].op = OP_EXTERN;
+    }
+    return i;
+}
+
+void
+Peg::analyze()
+{
+    // nullable and first-byte sets by fixpoint, as the graph may be cyclic
+    Base::Skips8 all; all.set();
+    for (auto& in : m_code) {
+        switch (in.op) {
+        case OP_LIT:
+            if (in.b) { in.first.set(static_cast<uchar>(m_pool[in.a])); } else { in.nullable = true; }
+            break;
+        case OP_ANY: in.nullable = (in.a == 0); in.first = all; break;
+        case OP_NALT: in.first = all; break;
+        case OP_SIT: in.nullable = true; break;
+        case OP_EXTERN: in.nullable = true; in.first = all; break;
+        default: break;
+        }
+    }
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (auto& in : m_code) {
+            bool nullable = in.nullable;
+            Base::Skips8 first = in.first;
+            switch (in.op) {
+            case OP_SEQ:
+                nullable = true;
+                for (auto k = in.a; k != in.b and nullable; k++) {
+                    first |= m_code[m_kids[k]].first;
+                    nullable = m_code[m_kids[k]].nullable;
+                }
+                break;
+            case OP_ALT:
+                for (auto k = in.a; k != in.b; k++) {
+                    first |= m_code[m_kids[k]].first;
+                    nullable = nullable or m_code[m_kids[k]].nullable;
+                }
+                break;
+            case OP_REP:
+                first |= m_code[in.a].first;
+                nullable = in.min == 0 or m_code[in.a].nullable;
+                break;
+            default:
+                break;
+            }
+            if (nullable != in.nullable or first != in.first) {
+                in.nullable = nullable; in.first = first;
+                changed = true;
+            }
+        }
+    }
+    for (size_t i = 0; i != m_code.size(); i++) {
+        auto& in = m_code[i];
+        const bool composite = (in.op == OP_SEQ or in.op == OP_ALT or in.op == OP_NALT or
+                                in.op == OP_REP or in.op == OP_EXTERN);
+        in.memo = composite and m_refs[i] >= 2; // every cycle passes such a node
+    }
+}
+
+/* ---------------------------- Group Separator ---------------------------- */
+
+Peg::Parser::Parser(const Peg& peg, size_t memo_limit)
+    : m_peg(peg), m_memo_limit(memo_limit), m_slots(1024)
+{
+}
+
+void
+Peg::Parser::reset(const char* buf, size_t len)
+{
+    if (buf != m_buf or len != m_len) {
+        clear_memo();
+        m_buf = buf; m_len = len;
+    }
+}
+
+void
+Peg::Parser::reset()
+{
+    clear_memo();
+    m_buf = nullptr; m_len = 0;
+}
+
+void
+Peg::Parser::clear_memo()
+{
+    if (m_count) {
+        std::fill(begin(m_slots), end(m_slots), Slot());
+        m_count = 0;
+    }
+}
+
+Peg::Parser::Slot*
+Peg::Parser::lookup(uint64_t key)
+{
+    const size_t mask = m_slots.size() - 1;
+    for (size_t h = hash(key);; h++) {
+        Slot& s = m_slots[h & mask];
+        if (s.key == key) { return &s; }
+        if (s.key == 0) { return nullptr; }
+    }
+}
+
+Peg::Parser::Slot*
+Peg::Parser::insert(uint64_t key)
+{
+    if (2 * (m_count + 1) > m_slots.size()) { // keep load below one half
+        std::vector<Slot> old(2 * m_slots.size());
+        old.swap(m_slots);
+        m_count = 0;
+        for (const auto& s : old) { if (s.key) { *insert(s.key) = s; } }
+    }
+    const size_t mask = m_slots.size() - 1;
+    for (size_t h = hash(key);; h++) {
+        Slot& s = m_slots[h & mask];
+        if (s.key == 0) { s.key = key; m_count++; return &s; }
+    }
+}
+
+void
+Peg::Parser::erase(uint64_t key)
+{
+    const size_t mask = m_slots.size() - 1;
+    size_t i = hash(key);
+    while (m_slots[i & mask].key != key) {
+        if (m_slots[i & mask].key == 0) { return; }
+        i++;
+    }
+    for (size_t j = i + 1;; j++) { // shift back followers of the cluster
+        Slot& s = m_slots[j & mask];
+        if (s.key == 0) { break; }
+        const size_t h = hash(s.key);
+        if (((j - h) & mask) >= ((j - i) & mask)) { // home at or before hole
+            m_slots[i & mask] = s;
+            i = j;
+        }
+    }
+    m_slots[i & mask] = Slot();
+    m_count--;
+}
+
+void
+Peg::Parser::forget(size_t from, size_t off, uint64_t keep)
+{
+    for (size_t j = from; j != m_log.size(); j++) {
+        if (m_log[j] != keep and off_of(m_log[j]) == off) { erase(m_log[j]); }
+    }
+    m_log.resize(from);
+}
+
+/* ---------------------------- Group Separator ---------------------------- */
+
+bool
+Peg::Parser::at_sit(PRPOS_t rpos, size_t off) const
+{
+    const char* b = m_buf;
+    const bool prev_sym = off > 0 and char_is_LETTER_CIDENT_REST(b[off-1]);
+    const bool next_sym = off < m_len and char_is_LETTER_CIDENT_REST(b[off]);
+    switch (rpos) {
+    case PRPOS_BOB: return off == 0;
+    case PRPOS_EOB: return off == m_len;
+    case PRPOS_BOL: return off == 0 or b[off-1] == ASCII_LF or b[off-1] == ASCII_CR;
+    case PRPOS_EOL: return off == m_len or b[off] == ASCII_LF or b[off] == ASCII_CR;
+    case PRPOS_BOS: return not prev_sym and off < m_len and char_is_LETTER_CIDENT_BEGIN(b[off]);
+    case PRPOS_EOS: return prev_sym and not next_sym;
+    case PRPOS_BOW: return ((off == 0 or not ::isalpha(static_cast<uchar>(b[off-1]))) and
+                            off < m_len and ::isalpha(static_cast<uchar>(b[off])));
+    case PRPOS_EOW: return (off > 0 and ::isalpha(static_cast<uchar>(b[off-1])) and
+                            (off == m_len or not ::isalpha(static_cast<uchar>(b[off]))));
+    default: return false;
+    }
+}
+
+size_t
+Peg::Parser::seq_from(const uint32_t* k, const uint32_t* end, size_t off)
+{
+    for (; k != end; k++) {
+        const Ins& in = m_peg.m_code[*k];
+        if (in.op == OP_REP and in.lazy) { // fewest repetitions that let the rest match
+            for (size_t n = 0;; n++) {
+                if (n >= in.min) {
+                    const size_t e = seq_from(k + 1, end, off);
+                    if (e != npos) { return e; }
+                }
+                if (n == in.max) { return npos; }
+                const size_t next = call(in.a, off);
+                if (next == npos or (next == off and n >= in.min)) { return npos; }
+                off = next;
+            }
+        }
+        off = call(*k, off);
+        if (off == npos) { return npos; }
+    }
+    return off;
+}
+
+size_t
+Peg::Parser::eval(uint32_t r, size_t off)
+{
+    const Ins& in = m_peg.m_code[r];
+    const uint32_t* kids = m_peg.m_kids.data();
+    switch (in.op) {
+    case OP_FAIL:
+        return npos;
+    case OP_LIT:
+        return (m_len - off >= in.b and
+                memcmp(m_buf + off, m_peg.m_pool.data() + in.a, in.b) == 0) ? off + in.b : npos;
+    case OP_CLASS:
+        return (off < m_len and in.first[static_cast<uchar>(m_buf[off])]) ? off + 1 : npos;
+    case OP_ANY:
+        return m_len - off >= in.a ? off + in.a : npos;
+    case OP_SIT:
+        return at_sit(in.rpos, off) ? off : npos;
+    case OP_SEQ:
+        return seq_from(kids + in.a, kids + in.b, off);
+    case OP_ALT: {
+        size_t best = npos;
+        for (auto k = in.a; k != in.b; k++) { // longest alternative
+            const size_t e = call(kids[k], off);
+            if (e != npos and (best == npos or e > best)) { best = e; }
+        }
+        return best;
+    }
+    case OP_NALT:
+        if (off >= m_len) { return npos; }
+        for (auto k = in.a; k != in.b; k++) {
+            if (call(kids[k], off) != npos) { return npos; }
+        }
+        return off + 1;
+    case OP_REP: {
+        size_t n = 0;
+        while (n < in.max) {
+            const size_t e = call(in.a, off);
+            if (e == npos) { break; }
+            n++;
+            if (e == off) { n = std::max(n, in.min); break; } // empty repeats forever
+            off = e;
+        }
+        return n >= in.min ? off : npos;
+    }
+    case OP_EXTERN: {
+        const pHit hit = in.src->match_in(m_buf, m_len, bir(to_bit(off), to_bit(m_len)));
+        return (hit.full() and hit.low() == to_bit(off)) ? off + to_padded_byte(hit.bitlength()) : npos;
+    }
+    }
+    return npos;
+}
+
+size_t
+Peg::Parser::call(uint32_t r, size_t off)
+{
+    const Ins& in = m_peg.m_code[r];
+    if (not in.nullable and
+        (off >= m_len or not in.first[static_cast<uchar>(m_buf[off])])) {
+        return npos;            // cannot start here
+    }
+    if (not in.memo) { return eval(r, off); }
+
+    const uint64_t key = key_of(r, off);
+    if (Slot* s = lookup(key)) {
+        if (s->busy) { s->lr = true; } // re-entered at same offset
+        return s->end;
+    }
+    const size_t mark = m_log.size();
+    m_log.push_back(key);
+    Slot* s = insert(key);
+    s->end = npos; s->busy = true; s->lr = false;
+
+    size_t end = eval(r, off);
+    s = lookup(key);
+    if (s->lr) {                // grow seed until it stops getting longer
+        for (;;) {
+            s->end = end;
+            forget(mark + 1, off, key); // drop results that saw the old seed
+            const size_t next = eval(r, off);
+            s = lookup(key);
+            if (next == npos or (end != npos and next <= end)) { break; }
+            end = next;
+        }
+    }
+    s->end = end; s->busy = false;
+    return end;
+}
+
+size_t
+Peg::Parser::top(size_t off)
+{
+    if (m_count > m_memo_limit) { clear_memo(); }
+    const size_t end = call(0, off);
+    m_log.clear();
+    return end;
+}
+
+pHit
+Peg::Parser::match_at(const char* buf, size_t len, size_t off)
+{
+    reset(buf, len);
+    const size_t end = off <= len ? top(off) : npos;
+    return end != npos ? pHit(to_bit(off), to_bit(end - off)) : pHit().undefine();
+}
+
+pHit
+Peg::Parser::find(const char* buf, size_t len, size_t off)
+{
+    reset(buf, len);
+    const Ins& root = m_peg.m_code[0];
+    const uchar* b = reinterpret_cast<const uchar*>(buf);
+    for (auto i = off; i <= len; i++) {
+        if (not root.nullable) { // skip bytes that cannot start a hit
+            while (i < len and not root.first[b[i]]) { i++; }
+            if (i == len) { break; }
+        }
+        const size_t end = top(i);
+        if (end != npos) { return pHit(to_bit(i), to_bit(end - i)); }
+    }
+    return pHit().undefine();
+}
+
+}}
@@ -0,0 +1,170 @@
+/*! \file peg.hpp
+ * \brief Compiled Packrat Pattern Matching.
+ * \author Copyright (C) 2012 Per Nordlöw (per.nordlow@gmail.com)
+ *
+ * Lowers a graph of \c Base patterns into a flat array of instructions
+ * that is matched as a Parsing Expression Grammar (PEG) with a packrat memo
+ * table keyed on (instruction, offset). Each shared or recursive
+ * sub-pattern is then matched at most once per offset, instead of once per
+ * backtracking path as with the recursive \c match_in_local() calls.
+ * Left-recursive rules, as in the C expression grammar, are handled by
+ * growing a seed.
+ *
+ * Semantics:
+ * - \c Alt matches its longest alternative. A complemented \c Alt matches
+ *   one byte where no alternative matches.
+ * - \c Ran of two one-byte \c Lit matches one byte in the inclusive byte
+ *   range, or outside it if complemented.
+ * - \c Rep is possessive, except that a non-greedy \c Rep directly inside
+ *   a \c Seq takes the fewest repetitions that let the rest of the \c Seq
+ *   match.
+ * - \c Sit matches zero bytes at its position.
+ * - Other patterns are matched through their own \c match_in().
+ *
+ * Each instruction carries the set of bytes (\c Base::Skips8) that can start
+ * a non-empty match. This set is tested before any other work, which prunes
+ * most alternatives and start offsets in a search.
+ */
+
+#pragma once
+#include "patt.hpp"
+#include "sit.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+namespace semnet { namespace patterns {
+
+/*! Compiled Pattern Program. Immutable and shareable between threads. */
+class Peg {
+public:
+    /// Compile \p top and everything it references.
+    explicit Peg(const Base * top);
+
+    /// Get number of instructions.
+    size_t size() const { return m_code.size(); }
+
+    class Parser;
+
+private:
+    /// Instruction Operation.
+    typedef enum {
+        OP_FAIL,                ///< Never match.
+        OP_LIT,                 ///< Match bytes \c [a, a+b) of pool.
+        OP_CLASS,               ///< Match one byte in \c first.
+        OP_ANY,                 ///< Match any \c a bytes.
+        OP_SIT,                 ///< Match empty at situation \c rpos.
+        OP_SEQ,                 ///< Match kids \c [a, b) in sequence.
+        OP_ALT,                 ///< Match longest of kids \c [a, b).
+        OP_NALT,                ///< Match one byte where no kid in \c [a, b) matches.
+        OP_REP,                 ///< Match kid \c a between \c min and \c max times.
+        OP_EXTERN,              ///< Match through \c src->match_in().
+    } __attribute__ ((packed)) OP_t;
+
+    /// Instruction.
+    struct Ins {
+        OP_t op = OP_FAIL;
+        PRPOS_t rpos = PRPOS_any_;
+        bool memo = false;      ///< Memoize results (shared or recursive).
+        bool nullable = false;  ///< May match empty.
+        bool lazy = false;      ///< Non-greedy \c Rep.
+        uint32_t a = 0, b = 0;  ///< Operands.
+        size_t min = 0, max = 0; ///< Repetition range.
+        Base::Skips8 first;     ///< Bytes that can start a non-empty match.
+        const Base * src = nullptr; ///< Source pattern.
+    };
+
+    uint32_t compile(const Base * p);
+    uint32_t add_kids(const std::vector<uint32_t>& kids);
+    void analyze();
+
+    std::vector<Ins> m_code;       ///< Instructions, root first.
+    std::vector<uint32_t> m_kids;  ///< Kid instruction lists.
+    std::string m_pool;            ///< Literal bytes.
+    std::unordered_map<const Base*, uint32_t> m_index; ///< Compiled patterns.
+    std::vector<uint32_t> m_refs;  ///< Reference counts.
+};
+
+/*! Packrat Parser running a \c Peg over one buffer at a time.
+ *
+ * Holds the memo table, so use one per thread. The table is dropped when the
+ * buffer changes, and between search attempts once it holds more than \c
+ * memo_limit entries.
+ */
+class Peg::Parser {
+public:
+    explicit Parser(const Peg& peg, size_t memo_limit = 1 << 22);
+
+    /*! Match at byte offset \p off in \p buf of length \p len.
+     * \return Hit, undefined if none.
+     */
+    pHit match_at(const char* buf, size_t len, size_t off = 0);
+
+    /*! Find first hit at or after byte offset \p off in \p buf of length \p len.
+     * \return Hit, undefined if none.
+     */
+    pHit find(const char* buf, size_t len, size_t off = 0);
+
+    /*! Call \p f(const pHit&) for each non-overlapping hit in \p buf.
+     * \return number of hits.
+     */
+    template<class F>
+    size_t find_all(const char* buf, size_t len, F f) {
+        size_t n = 0;
+        for (size_t off = 0; off <= len; n++) {
+            const pHit hit = find(buf, len, off);
+            if (not hit.full()) { break; }
+            f(hit);
+            const size_t end = to_byte(hit.high());
+            off = end > to_byte(hit.low()) ? end : end + 1;
+        }
+        return n;
+    }
+
+    /// Get number of memoized results.
+    size_t memo_size() const { return m_count; }
+
+    /*! Forget all memoized results. Call before matching in a buffer whose
+     * contents changed even if its address and length did not, such as a
+     * reused read buffer or a new mapping at the same address. */
+    void reset();
+
+private:
+    static const size_t npos = SIZE_MAX;
+
+    /// Memo Table Slot.
+    struct Slot {
+        uint64_t key;           ///< Instruction and offset plus one, 0 if empty.
+        size_t end;             ///< Match end or \c npos.
+        bool busy;              ///< Being evaluated.
+        bool lr;                ///< Left recursion detected while busy.
+    };
+
+    void reset(const char* buf, size_t len);
+    size_t top(size_t off);
+    size_t call(uint32_t r, size_t off);
+    size_t eval(uint32_t r, size_t off);
+    size_t seq_from(const uint32_t* k, const uint32_t* end, size_t off);
+    bool at_sit(PRPOS_t rpos, size_t off) const;
+
+    static uint64_t key_of(uint32_t r, size_t off) { return ((uint64_t(off) << 24) | r) + 1; }
+    static size_t off_of(uint64_t key) { return (key - 1) >> 24; }
+    /// Spread instructions apart but keep nearby offsets of one instruction in nearby slots.
+    static size_t hash(uint64_t key) { return ((key >> 24) << 1) + (key & 0xFFFFFF) * 0x9E3779B97F4A7C15ULL; }
+    Slot* lookup(uint64_t key);
+    Slot* insert(uint64_t key);
+    void erase(uint64_t key);
+    void forget(size_t from, size_t off, uint64_t keep);
+    void clear_memo();
+
+    const Peg& m_peg;
+    size_t m_memo_limit;
+    const char* m_buf = nullptr;
+    size_t m_len = 0;
+    std::vector<Slot> m_slots;     ///< Open-addressed memo table.
+    size_t m_count = 0;
+    std::vector<uint64_t> m_log;   ///< Keys inserted by current attempt.
+};
+
+}}
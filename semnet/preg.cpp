@@ -15,6 +15,7 @@
 #include "dir.hpp"
 #include "aptdir.hpp"
 #include "deb.hpp"
+#include "aptingest.hpp"
 #include "patt.hpp"
 #include "know_common.hpp"
 #include "alt.hpp"
@@ -24,6 +25,7 @@
 #include "ob_cmp.hpp"
 #include "dup.hpp"
 #include "any.hpp"
+#include "obarena.hpp"
 
 #include "pmatchers.hpp"
 #include "../fkind.h"
@@ -50,7 +52,6 @@
 #endif
 
 #include <iostream>
-#include <fstream>
 #include <string>
 
 // #include <boost/iostreams/filtering_streambuf.hpp>
@@ -126,8 +127,7 @@ pReg::add_check(Ob * ob)
 {
 #ifndef NDEBUG
     if (not ob) { PERR("ob is nullptr\n"); }
-    if (m_obR.find(ob) != m_obR.end()) { PERR("ob already in m_obR\n"); }
-    if (m_obN.find(ob) != m_obN.end()) { PERR("ob already in m_obN\n"); }
+    if (ob->m_rid != OBID_undefined_) { PERR("ob already registered\n"); }
 #endif
 }
 
@@ -135,11 +135,37 @@ void
 pReg::add1(Ob * ob)
 {
     add_check(ob);
+    ObId id;
+    if (not m_free_ids.empty()) {
+        id = m_free_ids.back();
+        m_free_ids.pop_back();
+        m_obR[id] = ob;
+    } else {
+        id = m_obR.size();
+        m_obR.push_back(ob);
+        m_obT.push_back(OB_undefined_);
+    }
+    const OB_t oT = ob->get_type();
+    m_obT[id] = oT;
+    ob->m_rid = id;
+    m_obN.push_back(id);
+    if (oT < OB_NUM) {
+        m_types_hist[oT] += 1;  // adjust type histogram
+    }
+}
+
+void
+pReg::add2(Ob * obA, Ob * obB)
+{
+    add1(obA);
+    add1(obB);
 }
 
 void
 pReg::addM(Ob * const* obsA, size_t obsA_N)
 {
+    m_obN.reserve(m_obN.size() + obsA_N);
+    for (size_t i = 0; i < obsA_N; i++) { add1(obsA[i]); }
 }
 
 // ---------------------------- Group Separator ----------------------------
@@ -166,96 +192,112 @@ filesystem::APTDir * pReg::get_APTRoot()
 
 // ---------------------------- Group Separator ----------------------------
 
-URI * pReg::load_APT_URI(filesystem::APTDir * dir, const csc& pathF)
+URI *
+pReg::load_APT_URI(std::vector<filesystem::APTDir*>& dirs,
+                   const char * pathF, size_t pathF_N,
+                   std::vector<Ob*>& news)
 {
     URI * bottom = nullptr;          // to return
-    const size_t pathF_N = pathF.size();
-    if (not is_root_path(pathF)) {
-        Ob* subsA[MAXPATHDEPTH];
-        size_t subsN = 0;
-        // go through all sub directories in pathF and create them if they don't exist
-        size_t i = 0;		// path char index
-        while (i < pathF_N) {
-            while (i < pathF_N and pathF[i] == PATH_SEP) { i++; } // skip leading '/'
-            const size_t iB = i; // index to beginnining of sub directory
-            while (i < pathF_N and pathF[i] != PATH_SEP) { i++; } // find next '/'
-            const size_t iE = i;   // index beyond end of sub directory
-            if (iB < iE) {
-                const size_t lS = iE - iB; ///< length of sub path
-                bool load_flag = false; // indicates that next was loaded
-                URI* next = dir->get_sub(csc(pathF.data()+iB, lS), // load-on-demand next
-                                          not (i == pathF_N), &load_flag); // all but last is assumed to be directory
-                if (next) {
-                    if (load_flag) {
-                        subsA[subsN++] = next;
-                    }
-                    if (not (dir = dynamic_cast<filesystem::APTDir*>(next))) { bottom = next; break; } // if bottom-most break
-                } else { // if next could not be loaded
-                    bottom = nullptr; break; // return nothing
-                }
-            }
+    size_t depth = 0;                // dirs[depth] is current directory
+    size_t i = 0;                    // path char index
+    while (i < pathF_N) {
+        while (i < pathF_N and pathF[i] == PATH_SEP) { i++; } // skip leading '/'
+        const size_t iB = i; // index to beginnining of sub directory
+        while (i < pathF_N and pathF[i] != PATH_SEP) { i++; } // find next '/'
+        const size_t lS = i - iB; ///< length of sub path
+        if (lS == 0) { break; }
+        URI * next = nullptr;
+        if (depth + 1 < dirs.size()) { // reuse directory of last path, as index is sorted
+            const csc& name = dirs[depth + 1]->get_pathL();
+            if (name.size() == lS and memcmp(name.data(), pathF + iB, lS) == 0) { next = dirs[depth + 1]; }
+        }
+        if (not next) {
+            bool load_flag = false; // indicates that next was loaded
+            next = dirs[depth]->get_sub(pathF + iB, lS, // load-on-demand next
+                                        i != pathF_N, &load_flag); // all but last is assumed to be directory
+            if (not next) { bottom = nullptr; break; } // if next could not be loaded
+            if (load_flag) { news.push_back(next); }
+            dirs.resize(depth + 1);
+            if (auto sub = dynamic_cast<filesystem::APTDir*>(next)) { dirs.push_back(sub); }
         }
-        addM(subsA, subsN);
+        bottom = next;
+        if (depth + 1 < dirs.size() and dirs[depth + 1] == next) { depth++; } else { break; } // if bottom-most break
     }
     return bottom;
 }
 
-filesystem::Deb * pReg::load_Deb(const csc& name)
+URI * pReg::load_APT_URI(filesystem::APTDir * dir, const csc& pathF)
 {
-    //::enforce(not name.empty());
-    // lookup \p name, \p name_N and if it's not loaded load it like APTDir::...sub() does.
-    filesystem::Deb * deb = nullptr;          // to return
+    std::vector<filesystem::APTDir*> dirs(1, dir);
+    std::vector<Ob*> news;
+    URI * bottom = load_APT_URI(dirs, pathF.data(), pathF.size(), news);
+    addM(news.data(), news.size());
+    return bottom;
+}
+
+filesystem::Deb * pReg::load_Deb(const char * name, size_t name_N)
+{
+    if (name_N == 0) { return nullptr; }
+    auto& deb = m_debs[csc(name, name_N)];
+    if (deb) { return deb; }    // shared by all its files
+    deb = new filesystem::Deb(csc(name, name_N));
+    add1(deb);
     return deb;
 }
 
 // ---------------------------- Group Separator ----------------------------
 
 void
-pReg::load_apt_file_pkg(filesystem::APTDir * apt_root, const std::string& line)
+pReg::load_apt_entry(std::vector<filesystem::APTDir*>& dirs,
+                     const APTIngest::Entry& entry,
+                     std::vector<Ob*>& news)
 {
-    size_t begF = 0;                      // filename begin offset
-    size_t endF = line.find_first_of(" \t", 0, 2); // filename end offset (ends with either space or tab
-    size_t begP = line.find_last_of(" "); // package begin offset
-    size_t endP = line.find_last_of("\n"); // package end offset
-
-    URI * uri = load_APT_URI(apt_root, csc(line.data(), endF-begF));
-    filesystem::Deb * deb = load_Deb(csc(line.data() + begP, endP - begP)); // \todo Use package hash table!
-    net_connectS(REL_CHILD, uri,
-                 REL_PARENT, deb);
+    URI * uri = load_APT_URI(dirs, entry.path, entry.pathN, news);
+    if (not uri) { return; }
+    const char * p = entry.pkgs, * end = entry.pkgs + entry.pkgsN;
+    while (p < end) {           // for each comma-separated package
+        const char * c = static_cast<const char*>(memchr(p, ',', end - p));
+        const char * e = c ? c : end;
+        if (filesystem::Deb * deb = load_Deb(p, e - p)) {
+            net_connectS(REL_CHILD, uri,
+                         REL_PARENT, deb);
+        }
+        p = e + 1;
+    }
 }
 
-// size_t string::find(char c, size_type opos);
+void
+pReg::load_apt_file_pkg(filesystem::APTDir * apt_root, const std::string& line)
+{
+    APTIngest::Entry entry;
+    if (not APTIngest::parse_line(line.data(), line.size(), entry)) { return; }
+    std::vector<filesystem::APTDir*> dirs(1, apt_root);
+    std::vector<Ob*> news;
+    load_apt_entry(dirs, entry, news);
+    addM(news.data(), news.size());
+}
 
 URI *
 pReg::load_apt_tree(filesystem::RegFile * apt_archive)
 {
-    csc pathF = apt_archive->path();
-    std::ifstream is(pathF.c_str(), std::ios_base::in | std::ios_base::binary);
-
-    // boost::iostreams::filtering_istreambuf in;
-    // in.push(boost::iostreams::gzip_decompressor());
-    // in.push(is);
-
     filesystem::APTDir * apt_root = get_APTRoot();
 
     net_connectS(REL_PARENT, apt_archive,  // and connect it
                  REL_CHILD, apt_root);
 
-    std::string line;
-
-    // find header "FILE" WS "LOCATION"
-    do {
-        getline(is, line);
-    } while (not (is.eof() or
-               line.compare(0, 4, "FILE"))); // starts with FILE
-
-    // for each FILE and PACKAGE
-    while (true) {
-        std::getline(is, line);
-        if (is.eof()) { break; } // exit if end of file
-        else { std::cout << "Got " << line << std::endl; } // print line
-        load_apt_file_pkg(apt_root, line);
-    }
+    // index is read, decompressed and split in parallel but the tree is built here
+    std::vector<filesystem::APTDir*> dirs(1, apt_root); // directories of last path
+    std::vector<Ob*> news;
+    APTIngest ingest;
+    const ssize_t ret = ingest.run(apt_archive->path(),
+                                   [&](const APTIngest::Entry* entries, size_t entries_N) {
+                                       for (size_t i = 0; i < entries_N; i++) {
+                                           load_apt_entry(dirs, entries[i], news);
+                                       }
+                                       addM(news.data(), news.size()); // register chunk at once
+                                       news.clear();
+                                   });
+    if (ret < 0) { PERR("Could not read APT index %s\n", apt_archive->path().c_str()); }
 
     return apt_root;
 }
@@ -264,10 +306,15 @@ pReg::load_apt_tree(filesystem::RegFile * apt_archive)
 
 void pReg::unreg(Ob * ob)
 {
-    m_tags.remove(this);
-    if (ob->get_type() < OB_NUM) {
-        m_types_hist[ob->get_type()] -= 1; // adjust type histogram
+    m_tags.remove(ob);
+    const ObId id = ob->m_rid;
+    if (id == OBID_undefined_) { return; }
+    if (m_obT[id] < OB_NUM) {   // not ob->get_type() as called from ~Ob()
+        m_types_hist[m_obT[id]] -= 1; // adjust type histogram
     }
+    m_obR[id] = nullptr;
+    m_free_ids.push_back(id);
+    ob->m_rid = OBID_undefined_;
 }
 
 int
@@ -442,20 +489,47 @@ std::ostream& pReg::show(std::ostream& os, size_t iB, size_t iE) const
         iE = std::min(iE, m_obR.size());
     }
 
-    size_t i = 0;
-    for (auto& ob : m_obR) {
-        os << "i:" << i;
-        ob->show(os);
-        os << endl;
-        if (++i >= iE) { break; }
+    for (size_t i = iB; i < iE; i++) {
+        if (auto ob = m_obR[i]) {
+            os << "i:" << i;
+            ob->show(os);
+            os << endl;
+        }
+    }
+    return os;
+}
+
+std::ostream& pReg::show_memory(std::ostream& os) const
+{
+    using std::endl;
+    size_t bytes[OB_NUM] = {};
+    for (size_t i = 0; i < m_obR.size(); i++) {
+        if (m_obR[i] and m_obT[i] < OB_NUM) {
+            bytes[m_obT[i]] += ObArena::size_of(m_obR[i]);
+        }
+    }
+    for (OB_t i = OB_FIRST; i != OB_NUM; i = static_cast<OB_t>(i + 1)) {
+        const size_t cnt = m_types_hist[i];
+        if (cnt) {
+            os << "- name:" << OB_getName(i)
+               << " count:" << cnt
+               << " bytes:" << bytes[i] << endl;
+        }
     }
+    os << "- handles:" << m_obR.size()
+       << " free:" << m_free_ids.size()
+       << " bytes:" << (m_obR.capacity() * sizeof(Ob*) +
+                        m_obT.capacity() * sizeof(OB_t) +
+                        (m_obN.capacity() + m_free_ids.capacity()) * sizeof(ObId)) << endl;
+    const auto& arena = ObArena::instance();
+    os << "- arena slab_bytes:" << arena.slab_bytes()
+       << " used_bytes:" << arena.used_bytes() << endl;
     return os;
 }
 
 void
 pReg::sort_merge()
 {
-    m_obR.insert(m_obN.begin(), m_obN.end());
     m_obN.clear();
 }
 
@@ -17,6 +17,8 @@
 #include "HISTLOG.hpp"
 #include "rels.hpp"
 #include "patt.hpp"
+#include "ob.hpp"
+#include "aptingest.hpp"
 
 #ifdef HAVE_SYS_INOTIFY_H
 #include <sys/inotify.h>
@@ -28,7 +30,8 @@
 
 #include "../xhash.hpp"
 
-#include <unordered_set>
+#include <unordered_map>
+#include <vector>
 
 namespace semnet {
 
@@ -81,7 +84,9 @@ public:
 
 /* ---------------------------- Group Separator ---------------------------- */
 
-    /*! \em Add \p ob to Registry.     */
+    /*! \em Add \p ob to Registry and give it a handle. \p ob must have
+     * been allocated with \c new, that is in \c ObArena.
+     */
     void add1(Ob * ob);
 
     /*! \em Add \p obA and \p obB to Registry.     */
@@ -95,10 +100,13 @@ public:
     //! Load whole \p pathF and return bottom-most file.
     URI * load_APT_URI(filesystem::APTDir * dir, const csc& pathF);
 
-    //! Load Debian \em Package named \p name of length name_N.
-    filesystem::Deb * load_Deb(const csc& name);
+    //! Load Debian \em Package named \p name of length name_N, once.
+    filesystem::Deb * load_Deb(const char * name, size_t name_N);
+    //! Load Debian \em Package named \p name, once.
+    filesystem::Deb * load_Deb(const csc& name) { return load_Deb(name.data(), name.size()); }
 
-    /*! Load APT information from \p apt_file
+    /*! Load APT information from \p apt_file, an APT \c Contents index,
+     * optionally gzip or bzip2 compressed, read through \c APTIngest.
      * \return APT file tree root
      */
     URI * load_apt_tree(filesystem::RegFile * apt_archive);
@@ -111,6 +119,21 @@ public:
 public:
     filesystem::APTDir* get_APTRoot();
 
+protected:
+    /*! Load \p pathF of length \p pathF_N below \p dirs[0]. \p dirs holds
+     * the directories of the last path loaded, which are reused without
+     * lookup as long as the paths share them, and is updated to those of
+     * \p pathF. Loaded objects are appended to \p news.
+     */
+    URI * load_APT_URI(std::vector<filesystem::APTDir*>& dirs,
+                       const char * pathF, size_t pathF_N,
+                       std::vector<Ob*>& news);
+
+    /*! Load \p entry below \p dirs[0] and connect it to its packages. */
+    void load_apt_entry(std::vector<filesystem::APTDir*>& dirs,
+                        const APTIngest::Entry& entry,
+                        std::vector<Ob*>& news);
+
 public:
     /*! Iterate the Registry at \p preg.     */
     void iter(int timeout_ms = 0);
@@ -123,7 +146,14 @@ public:
 
 /* ========================================================================= */
 
-    size_t ob_count() const { return m_obR.size(); }
+    size_t ob_count() const { return m_obR.size() - m_free_ids.size(); }
+
+    /// Get object with handle \p id, or nullptr if none.
+    Ob * get(ObId id) const { return id < m_obR.size() ? m_obR[id] : nullptr; }
+
+    /*! Print count and bytes of registered objects per type, along with the
+     * size of the registry and of \c ObArena. */
+    std::ostream& show_memory(std::ostream& os) const;
 
 /* ========================================================================= */
 
@@ -145,8 +175,8 @@ public:
      */
     void move_altered_to_new();
 
-    /*! Sort New Part \p this->m_obR.nthD [NEW => END[ and then merge with old
-     * part this->m_obR.nthD [0 => NEW[.
+    /*! Merge new objects \c m_obN into registered ones. As new objects are
+     * already in \c m_obR at their handle this only forgets which are new.
      */
     void sort_merge();
 protected:
@@ -175,9 +205,12 @@ protected:
     int process_events( int timeout_ms = 0);
 
 public:
-    std::unordered_set<Ob*> m_obR;  ///< \em Registered Objects.
-    std::unordered_set<Ob*> m_obN;  ///< \em New (\em Unprocessed) or Un-Modified Objects.
+    std::vector<Ob*> m_obR;     ///< \em Registered Objects by handle, nullptr at free handles.
+    std::vector<ObId> m_obN;    ///< Handles of \em New (\em Unprocessed) Objects.
 protected:
+    std::vector<OB_t> m_obT;    ///< Types of Registered Objects by handle.
+    std::vector<ObId> m_free_ids; ///< Free handles, reused before new ones.
+
     filesystem::Dir* m_rootFS;             ///< File System Tree Root Object.
     filesystem::APTDir* m_rootAPT; ///< APT Tree Root Object. \todo Decouple this from \c Reg. There may be lots more of these kinds of hub objects.
 
@@ -197,6 +230,8 @@ public:
 
     xHash m_lock_hash;          ///< \em Locked.
 
+    std::unordered_map<csc, filesystem::Deb*> m_debs; ///< \em Debian \em Packages by name.
+
 protected:
     chash::chashid m_default_hid;      ///< Content Hash Id Type.
     size_t m_types_hist[OB_NUM]; ///< Histogram of types in Registry.
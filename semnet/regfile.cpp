@@ -1,6 +1,7 @@
 /* #define _XOPEN_SOURCE 500 */
 /* #include <unistd.h> */
 
+#include <cerrno>
 #include <cstring>
 #include <ctime>
 
@@ -23,7 +24,6 @@
 #include "../memcmpn.h"
 #include "../workpool.hpp"
 #include "../ffmpeg_x.hpp"
-#include "../histogram.hpp"
 
 #ifdef HAVE_MAGIC_H
 #  include <magic.h>
@@ -46,109 +46,44 @@
 namespace semnet {
 namespace filesystem {
 
-void RegFile::init(int fd, DFMT_t dfmt, const struct stat * statp)
-{
-    File::init(FKIND_undefined_, statp);
-    m_fd = fd;
-}
-
-/* ---------------------------- Group Separator ---------------------------- */
-
-// \todo Use SSE operations PEXTRW and PINSRW to optimized these histogram
-// calculations.  See: http://www.tommesani.com/SSEPrimer.html for details.
-//
-// Table look-up operations, such as the ones found in histogram-related
-// algorithms, have always been critical to the performance of digital
-// imaging. In such cases, each of the computed R, G, and B values is used as an
-// index into its respective color look-up table. Such operations have been
-// difficult to implement in MMX technology due to the fact that the computed
-// RGBA values would be residing in an MMX register, which cannot be used
-// directly for addressing. Extracting each of them into the appropriate
-// registers for addressing, fetching the contents from the table, and inserting
-// them back into MMX registers was cumbersome and harmful to performance. SSE
-// includes a pair of instructions (PEXTRW and PINSRW) that help enhance the
-// performance of such algorithms.
-
-void RegFile::assert_hist8()
-{
-    if (not m_chist8.get()) { m_chist8 = std::make_unique<CHist8>(); }
-}
-
-void RegFile::reset_hist8()
-{
-    if (m_chist8.get()) { m_chist8.get()->reset(); }
-}
-
-void RegFile::inc_hist8(uchar x)
-{
-    assert_hist8();
-    m_chist8.get()->add(x);           /* increment histogram bucket */
-}
+namespace {
 
-void
-RegFile::process_byte(const uchar* a, off_t off8)
-{
-    inc_hist8(a[off8]);
-}
-
-void
-RegFile::process_quad(const uchar* a, off_t qoff)
+/*! Call \p f(const uchar*, size_t) for each block of the \p size first
+ * bytes of \p fd, read one block at a time into the same buffer. Reading
+ * rather than mapping lets a file truncated meanwhile end in a short read
+ * instead of SIGBUS.
+ * \return 0 on success, -1 on read error or if \p fd ends before \p size.
+ */
+template<class F>
+int scan_blocks(int fd, uint64_t size, F f)
 {
-    inc_hist8(a[qoff*4+0]);
-    inc_hist8(a[qoff*4+1]);
-    inc_hist8(a[qoff*4+2]);
-    inc_hist8(a[qoff*4+3]);
+    const size_t blksize = 1 << 18;   /* L2-sized block */
+    if (size == 0) { return 0; }
+    ::posix_fadvise(fd, 0, size, POSIX_FADV_SEQUENTIAL);
+    std::unique_ptr<uchar[]> bbuf(new uchar[std::min<uint64_t>(blksize, size)]);
+    for (uint64_t off = 0; off < size;) {
+        const size_t bsize = std::min<uint64_t>(blksize, size - off);
+        const ssize_t rsize = ::pread(fd, bbuf.get(), bsize, off);
+        if (rsize < 0) {
+            if (errno == EINTR) { continue; }
+            lperror("pread()"); return -1;
+        }
+        if (rsize == 0) { return -1; } /* truncated since \p size was taken */
+        f(bbuf.get(), rsize);
+        off += rsize;
+    }
+    return 0;
 }
 
-void
-RegFile::process_oct(const uchar* a, off_t ooff)
-{
-    inc_hist8(a[ooff*8+0]);
-    inc_hist8(a[ooff*8+1]);
-    inc_hist8(a[ooff*8+2]);
-    inc_hist8(a[ooff*8+3]);
-    inc_hist8(a[ooff*8+4]);
-    inc_hist8(a[ooff*8+5]);
-    inc_hist8(a[ooff*8+6]);
-    inc_hist8(a[ooff*8+7]);
 }
 
-void
-RegFile::process_hex(const uchar* a, off_t qoff)
+void RegFile::init(int fd, DFMT_t dfmt, const struct stat * statp)
 {
-    inc_hist8(a[qoff*16+0]);
-    inc_hist8(a[qoff*16+1]);
-    inc_hist8(a[qoff*16+2]);
-    inc_hist8(a[qoff*16+3]);
-    inc_hist8(a[qoff*16+4]);
-    inc_hist8(a[qoff*16+5]);
-    inc_hist8(a[qoff*16+6]);
-    inc_hist8(a[qoff*16+7]);
-    inc_hist8(a[qoff*16+8]);
-    inc_hist8(a[qoff*16+9]);
-    inc_hist8(a[qoff*16+10]);
-    inc_hist8(a[qoff*16+11]);
-    inc_hist8(a[qoff*16+12]);
-    inc_hist8(a[qoff*16+13]);
-    inc_hist8(a[qoff*16+14]);
-    inc_hist8(a[qoff*16+15]);
+    File::init(FKIND_undefined_, statp);
+    m_fd = fd;
 }
 
-void
-RegFile::process_block(const uchar * bbuf, uint bsize)
-{
-    uint h = 0;                 // hex counter
-    while (h < bsize % 16) {    // for each whole hex
-        process_hex(&bbuf[h], 1);
-        h++;
-    }
-
-    uint b = h * 16;            // byte counter
-    while (b < bsize) {         // for each remaining byte
-        process_byte(&bbuf[b], 1);
-        b++;
-    }
-}
+/* ---------------------------- Group Separator ---------------------------- */
 
 // void chash_print(chashid hid, const uchar * hdig)
 // {
@@ -183,9 +118,10 @@ RegFile::load(bool recurse_flag, bool cscan_flag)
 void
 RegFile::unload() const
 {
+    flush_attrs();              // before forgetting what they came from
     m_fkind = FKIND_undefined_; // directly tag as \em undefined
     m_cdig.reset();
-    m_chist8.reset();
+    m_cstats.reset();
     File::unload();
 }
 
@@ -231,43 +167,20 @@ RegFile::cscan()
     uint64_t fcsize = 0;         // file content size
     if (stat_is_readable(m_stat.get())) { fcsize = m_stat.get()->st_size; }
 
-    /* determine blocksize */
-    size_t blksize = 0;
-    if (not blksize) {
-        blksize = m_stat->st_blksize; /* use default blocksize */
-    }
-    // \todo Ask matchers for preferred block size and increase blksize if needed:
-    // blksize = std::max(blksize, blksize_pi);
-
-    const size_t bnum = fcsize / blksize; /* number of blocks */
-    const size_t restsize = fcsize % blksize; /* block rest size */
-
-    reset_hist8();
-
     open();                       /* open it */
 
     CHashF chash;
-
-    /* iterate over file blocks and process them */
-    uchar bbuf[blksize] __attribute__ ((aligned(16))); /* block buffer */
-    for (size_t i = 0; i < bnum; i++) {      /* process whole blocks */
-        lseek(m_fd, i*blksize, SEEK_SET); /* go current block */
-        ssize_t rsize = ::read(m_fd, (char*)(bbuf), blksize);
-        if (rsize == -1) { lperror("read()"); }
-        else {
-            process_block(bbuf, rsize); /* general processing */
-            if (rehashF) { chash.update(bbuf, rsize); } /* increment hash */
-        }
-    }
-    if (restsize >= 1) {             /* process last (rest) block */
-        lseek(m_fd, bnum*blksize, SEEK_SET); /* go current block */
-        ssize_t rsize = ::read(m_fd, (char*)bbuf, restsize);
-        if (rsize == -1) { lperror("read()"); }
-        else {
-            process_block(bbuf, rsize); /* general processing */
-            if (rehashF) { chash.update(bbuf, rsize); } /* increment hash */
-        }
+    pnw::byte_stats bstats;     // only its summary is kept
+
+    /* feed each block to the statistics and then to the hash while it is
+     * still in cache, so contents are read once */
+    if (scan_blocks(m_fd, fcsize, [rehashF, &chash, &bstats](const uchar * bbuf, size_t bsize) {
+                bstats.add(bbuf, bsize);
+                if (rehashF) { chash.update(bbuf, bsize); } /* increment hash */
+            }) < 0) {
+        return -1;              /* rather than keeping a digest of part of it */
     }
+    m_cstats = std::make_unique<CStats>(bstats);
 
     /* set chash file xattrs */
     if (rehashF) {
@@ -280,6 +193,9 @@ RegFile::cscan()
         cache_attr(xan, const_cast<const CDigestF*>(m_cdig.get())->data(), hsize, 0); // cache it
     }
 
+    /* cscan() may run after our Dir has flushed, lazily from get_chash() */
+    flush_attrs();
+
     /* if (m_cdig.get()) { chash_print(CHASH_SHA2_256, m_cdig.get()->data()); } */
 
     ret = 1;
@@ -388,6 +304,18 @@ std::vector<OP_t> RegFile::get_ops() const {
     return ops;
 }
 
+int RegFile::is_binary() const
+{
+    const auto hit = g_hits.left.find(const_cast<RegFile*>(this));
+    if (hit != g_hits.left.end()) {
+        return DFMT_is_BINARY(hit->second->get_dfmt()) ? 1 : 0;
+    }
+    if (m_cstats.get()) {
+        return m_cstats.get()->binary ? 1 : 0;
+    }
+    return -1;
+}
+
 /* ---------------------------- Group Separator ---------------------------- */
 
 void RegFile::cache_attr(const csc& name, const void* value, size_t size, int flags)
@@ -512,8 +440,26 @@ RegFile::cmp_content(const RegFile * pB) const
 const uchar *
 RegFile::get_chash(chash::chashid hid) const
 {
-    if (not m_cdig.get()) { const_cast<RegFile*>(this)->load(); }
-    return const_cast<const CDigestF*>(m_cdig.get())->data();
+    if (not m_cdig.get()) { const_cast<RegFile*>(this)->load(false, true); }
+    return m_cdig.get() ? const_cast<const CDigestF*>(m_cdig.get())->data() : nullptr;
+}
+
+int
+RegFile::hash_at(const csc& pathF) const
+{
+    if (m_cdig.get()) { return 0; }
+    const int fd = ::open(pathF.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) { return -1; }
+    struct stat st;
+    if (::fstat(fd, &st) != 0) { ::close(fd); return -1; }
+    CHashF chash;
+    const int ret = scan_blocks(fd, st.st_size, [&chash](const uchar * bbuf, size_t bsize) {
+            chash.update(bbuf, bsize);
+        });
+    ::close(fd);
+    if (ret < 0) { return -1; }
+    m_cdig = std::make_unique<CDigestF>(chash);
+    return 1;
 }
 
 const uchar*
@@ -577,6 +523,12 @@ RegFile::show(std::ostream& os) const
         os << "none";
     }
 
+    if (auto cstats = m_cstats.get()) {
+        os << " lines:" << cstats->lines
+           << " entropy:" << cstats->entropy
+           << " binary:" << cstats->binary;
+    }
+
     if (auto dfmt = dynamic_cast<patterns::Base*>(net_first(REL_PARENT, OB_PATT_))) {
         if (DFMT_is_IMAGE(dfmt->get_dfmt())) {
             if (open() >= 0) {
@@ -20,7 +20,7 @@
 #include "../substr_match.h"
 
 #include "../chash.hpp"
-#include "../histogram.hpp"
+#include "../bytestats.hpp"
 #include "OP_enum.hpp"
 
 #ifdef HAVE_OPENCV_CV_H
@@ -28,10 +28,6 @@
 #include <opencv2/highgui/highgui.hpp>
 #endif
 
-// namespace pnw { namespace histogram {
-// template<class V, class C = size_t, class H = typename std::vector<C> > class dense;
-// }}
-
 class CDigest256;
 
 namespace semnet { namespace filesystem {
@@ -50,7 +46,15 @@ class RegFile: public File {
     friend class SymLink;
     friend class Dir;
 public:
-    typedef pnw::histogram::dense<uint8_t> CHist8;
+    /*! Content Statistics, summarized from the \c pnw::byte_stats
+     * accumulated by \c cscan(). */
+    struct CStats {
+        CStats(const pnw::byte_stats& bstats)
+            : lines(bstats.lines()), entropy(bstats.entropy()), binary(bstats.is_binary()) {}
+        uint64_t lines;         ///< Number of lines.
+        float entropy;          ///< Shannon entropy in bits per byte.
+        bool binary;            ///< Contents look binary.
+    };
 
     typedef boost::bimap<RegFile*, FileType*> TypeHits; // Maps Regular Files to their Corresponding Types
     typedef TypeHits::value_type TypeHit;
@@ -79,20 +83,8 @@ public:
 
 /* ---------------------------- Group Separator ---------------------------- */
 
-    /*! Process value \p a at byte offset \p off8. */
-    void process_byte(const uchar* a, off_t off8);
-
-    /*! Process value \p a at quad offset \p qoff. */
-    void process_quad(const uchar* a, off_t qoff);
-
-    /*! Process value \p a at oct offset \p ooff. */
-    void process_oct(const uchar* a, off_t ooff);
-
-    /*! Process value \p a at hex offset \p qoff. */
-    void process_hex(const uchar* a, off_t qoff);
-
-    /*! Process the block at \p bbuf of size \p bsize. */
-    void process_block(const uchar* bbuf, uint bsize);
+    /*! Get Content Statistics, or nullptr if not scanned by \c cscan(). */
+    const CStats * get_cstats() const { return m_cstats.get(); }
 
 /* ---------------------------- Group Separator ---------------------------- */
 
@@ -105,10 +97,17 @@ public:
     virtual int load(bool recurse_flag = false, bool cscan_flag = false);
     virtual void unload() const;
 
-    /*! Scan Contents and Calculate Statistics. */
+    /*! Scan Contents, Calculating Content Statistics and Hash Digest in
+     * One Pass.
+     * \return 1 if scanned, -1 if it could not be read in full, such as
+     * when truncated meanwhile, in which case nothing is kept. */
     int cscan();
     /*! Detect File Types. */
     int load_types() const;
+    /*! Check if contents are binary, as known from detected type or content statistics.
+     * \return 1 if binary, 0 if text, -1 if not yet known.
+     */
+    int is_binary() const;
     /*! Get \em Possible Operations. */
     virtual std::vector<OP_t> get_ops() const;
 
@@ -159,6 +158,14 @@ public:
      */
     const uchar * get_chash_dynamic(chash::chashid * hid_ret, uint32_t * size_ret) const;
 
+    /*!
+     * Hash Contents of file at full path \p pathF, unless already hashed.
+     * Opens \p pathF directly instead of through the cache of open files,
+     * so distinct files can be hashed by concurrent threads.
+     * \return 1 if hashed, 0 if already hashed, -1 on error.
+     */
+    int hash_at(const csc& pathF) const;
+
 /* ---------------------------- Group Separator ---------------------------- */
 
     virtual int cmp_content(const RegFile * pB) const;
@@ -184,13 +191,6 @@ public:
     virtual tdepth_t get_tree_depth() const;
     virtual theight_t get_tree_height() const { return 0; }
 
-protected:
-    void assert_hist8();
-    void reset_hist8();
-
-    /*! Increment Histogram Bucket. */
-    void inc_hist8 (uchar x);
-
 private:
     void init(int fd, DFMT_t dfmt = DFMT_any_, const struct stat * statp = nullptr);
 
@@ -199,7 +199,7 @@ private:
 
     //mutable std::unique_ptr<std::fstream> m_fs; ///< File Stream. As pointer to Minimize Memory Usage.
     mutable std::unique_ptr<CDigestF> m_cdig __attribute__ ((aligned(16))); ///< \em Content Hash \em Digest.
-    mutable std::unique_ptr<CHist8>  m_chist8 __attribute__ ((aligned(16)));  ///< \em 8-bit (Byte) Content \em Histogram.
+    mutable std::unique_ptr<CStats> m_cstats; ///< \em Content \em Statistics: lines, entropy, binary.
 
     static TypeHits g_hits;     ///< Pattern Match TypeHits.
 };
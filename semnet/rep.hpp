@@ -37,6 +37,7 @@ public:
     virtual std::ostream& show(std::ostream& os) const;
 
     Rep * set_greedy(bool greedyF) { m_greedy = greedyF; return this; }
+    bool is_greedy() const { return m_greedy; }
 
     RRan range() const { return m_rrange; }
 
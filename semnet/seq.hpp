@@ -62,6 +62,9 @@ public:
     virtual size_t size() const { return m_subs.size(); }
     virtual bool empty() const { return m_subs.empty(); }
 
+    /// Get Sub-Patterns in sequence order.
+    const Seqs& get_subs() const { return m_subs; }
+
     // TODO: Replace \c mutating_canonicalize with expression templates when use smart pointers.
     // friend Seq * operator& (Base * a, Base * b) {
     //     auto as = dynamic_cast<Seq*>(a);
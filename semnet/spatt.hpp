@@ -74,6 +74,9 @@ public:
 
     virtual ~Wrap() { if (m_sub) { m_sub->remove_super(this); } }
 
+    /// Get Sub Pattern.
+    Base * get_sub() const { return m_sub; }
+
     virtual csc rand(bir ssr = bir::full()) const { return m_sub->rand(ssr); }
 
     virtual Base::Skips8& intersect_skips(Skips8& skips) const { return m_sub->intersect_skips(skips); }
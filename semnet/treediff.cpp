@@ -0,0 +1,351 @@
+#include "treediff.hpp"
+#include "dir.hpp"
+#include "regfile.hpp"
+#include "symlink.hpp"
+#include "../pathops.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <sys/param.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace semnet {
+
+using namespace filesystem;
+
+/// Pair of Directories to Diff.
+struct TreeDiff::Job {
+    const Dir * a;
+    const Dir * b;
+    csc pathR;                  ///< Path relative to tree roots.
+    csc pathA;                  ///< Full path of \c a.
+    csc pathB;                  ///< Full path of \c b.
+};
+
+/// Changes and Sub-Directory Pairs Found in a Job.
+struct TreeDiff::Result {
+    std::vector<Change> modified, added, removed;
+    std::vector<Job> subs;
+    Stats stats;
+};
+
+/// Jobs and Changes Shared by Workers and Consumer.
+struct TreeDiff::Queue {
+    std::mutex mtx;
+    std::condition_variable work;  ///< Signalled on new jobs or when all are done.
+    std::condition_variable ready; ///< Signalled on new modifications or when all are done.
+    std::deque<Job> todo;
+    size_t pending = 0;         ///< Jobs queued or being diffed.
+    std::vector<Change> modified; ///< Modifications not yet delivered.
+    std::vector<Change> added, removed; ///< Held for pairing into moves.
+    Stats stats;
+    bool stop = false;          ///< Run is abandoned, so workers quit.
+};
+
+/// Stopper and Joiner of the Workers of a Run, also when unwound by an exception.
+struct TreeDiff::Crew {
+    Queue& q;
+    std::vector<std::thread> threads;
+    ~Crew() {
+        {
+            std::lock_guard<std::mutex> lock(q.mtx);
+            q.stop = true;
+        }
+        q.work.notify_all();
+        for (auto& t : threads) {
+            if (t.joinable()) { t.join(); }
+        }
+    }
+};
+
+namespace {
+
+const size_t DIG_SIZE = sizeof(CDigestF); ///< Digest byte size.
+
+csc path_join(const csc& dir, const csc& name)
+{
+    if (dir.empty()) { return name; }
+    if (dir[dir.size() - 1] == PATH_SEP) { return dir + name; }
+    return dir + PATH_SEP + name;
+}
+
+/// Get target of symbolic link at \p pathF, or empty if none.
+csc link_target(const csc& pathF)
+{
+    char buf[MAXPATHLEN];
+    const ssize_t n = ::readlink(pathF.c_str(), buf, sizeof(buf));
+    return n >= 0 ? csc(buf, n) : csc();
+}
+
+void add_stats(TreeDiff::Stats& s, const TreeDiff::Stats& t)
+{
+    s.dirs += t.dirs;
+    s.files += t.files;
+    s.skipped += t.skipped;
+    s.hashed += t.hashed;
+    s.changes += t.changes;
+}
+
+/// Hash contents of \p files in parallel on \p nthreads threads.
+size_t hash_files(const std::vector<std::pair<const RegFile*, csc> >& files, size_t nthreads)
+{
+    std::atomic<size_t> next(0), hashed(0);
+    auto hash = [&files, &next, &hashed]() {
+        for (size_t i; (i = next++) < files.size();) {
+            hashed += (files[i].first->hash_at(files[i].second) == 1);
+        }
+    };
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < std::min(nthreads, files.size()); i++) { workers.emplace_back(hash); }
+    hash();
+    for (auto& w : workers) { w.join(); }
+    return hashed;
+}
+
+}
+
+TreeDiff::TreeDiff()
+    : TreeDiff(Options())
+{
+}
+
+TreeDiff::TreeDiff(const Options& opts)
+    : m_opts(opts)
+{
+    m_opts.nthreads = std::max<size_t>(m_opts.nthreads, 1);
+}
+
+TreeDiff::~TreeDiff()
+{
+}
+
+/* ---------------------------- Group Separator ---------------------------- */
+
+bool
+TreeDiff::stat_of(const File * file, const csc& pathF, struct stat& st)
+{
+    if (const auto fst = file->m_stat.get()) { st = *fst; return true; } // as loaded
+    return ::lstat(pathF.c_str(), &st) == 0;
+}
+
+off_t
+TreeDiff::files_size(const Dir * dir)
+{
+    off_t ret = 0;
+    for (const auto& sub : dir->m_subs) {
+        if (auto sdir = dynamic_cast<const Dir*>(sub.second)) { ret += files_size(sdir); }
+        else { ret += sub.second->get_size(); }
+    }
+    return ret;
+}
+
+bool
+TreeDiff::eq_files(const RegFile * a, const csc& pathA,
+                   const RegFile * b, const csc& pathB,
+                   Result& res) const
+{
+    struct stat sa, sb;
+    if (not (stat_of(a, pathA, sa) and stat_of(b, pathB, sb))) { return false; }
+    if (sa.st_size != sb.st_size) { return false; }
+    if (sa.st_size == 0) { return true; }
+    if (m_opts.mtime and
+        sa.st_mtim.tv_sec == sb.st_mtim.tv_sec and
+        sa.st_mtim.tv_nsec == sb.st_mtim.tv_nsec) { return true; }
+    const int hA = a->hash_at(pathA), hB = b->hash_at(pathB); // only now read contents
+    res.stats.hashed += (hA == 1) + (hB == 1);
+    if (hA < 0 or hB < 0) { return false; }
+    return memcmp(a->get_chash(), b->get_chash(), DIG_SIZE) == 0;
+}
+
+void
+TreeDiff::diff(const Job& job, Result& res) const
+{
+    res.stats.dirs++;
+    const auto subsA = job.a->sorted_subs(), subsB = job.b->sorted_subs();
+    auto a = subsA.begin(), b = subsB.begin();
+    while (a != subsA.end() or b != subsB.end()) { // merge on name
+        const int cmp = (a == subsA.end() ? 1 :
+                         b == subsB.end() ? -1 :
+                         (*a)->first.compare((*b)->first));
+        const csc& name = cmp <= 0 ? (*a)->first : (*b)->first;
+        const csc subR = path_join(job.pathR, name);
+        if (cmp < 0) { res.removed.push_back(Change{REMOVED, subR, csc(), (*a++)->second, nullptr}); continue; }
+        if (cmp > 0) { res.added.push_back(Change{ADDED, subR, csc(), nullptr, (*b++)->second}); continue; }
+        const File * subA = (*a++)->second, * subB = (*b++)->second;
+        const uchar kind = Dir::sub_tag(subA);
+        if (kind != Dir::sub_tag(subB)) {
+            res.removed.push_back(Change{REMOVED, subR, csc(), subA, nullptr});
+            res.added.push_back(Change{ADDED, subR, csc(), nullptr, subB});
+        } else if (kind == 'd') {
+            auto dirA = static_cast<const Dir*>(subA), dirB = static_cast<const Dir*>(subB);
+            if (dirA->m_tdig and dirB->m_tdig and
+                memcmp(dirA->m_tdig->data(), dirB->m_tdig->data(), DIG_SIZE) == 0) {
+                res.stats.skipped++; // equal trees
+            } else {
+                res.subs.push_back(Job{dirA, dirB, subR,
+                            path_join(job.pathA, name), path_join(job.pathB, name)});
+            }
+        } else if (kind == 'f') {
+            res.stats.files++;
+            if (not eq_files(static_cast<const RegFile*>(subA), path_join(job.pathA, name),
+                             static_cast<const RegFile*>(subB), path_join(job.pathB, name), res)) {
+                res.modified.push_back(Change{MODIFIED, subR, csc(), subA, subB});
+            }
+        } else if (kind == 'l') {
+            if (link_target(path_join(job.pathA, name)) != link_target(path_join(job.pathB, name))) {
+                res.modified.push_back(Change{MODIFIED, subR, csc(), subA, subB});
+            }
+        }
+    }
+}
+
+void
+TreeDiff::work(Queue& q) const
+{
+    for (;;) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(q.mtx);
+            q.work.wait(lock, [&q]() { return not q.todo.empty() or q.pending == 0 or q.stop; });
+            if (q.todo.empty() or q.stop) { break; }
+            job = std::move(q.todo.front());
+            q.todo.pop_front();
+        }
+        Result res;
+        diff(job, res);
+        std::lock_guard<std::mutex> lock(q.mtx);
+        for (auto& c : res.modified) { q.modified.push_back(std::move(c)); }
+        for (auto& c : res.added) { q.added.push_back(std::move(c)); }
+        for (auto& c : res.removed) { q.removed.push_back(std::move(c)); }
+        for (auto& sub : res.subs) { q.todo.push_front(std::move(sub)); } // depth-first bounds queue
+        add_stats(q.stats, res.stats);
+        q.pending += res.subs.size();
+        q.pending--;
+        if (q.pending == 0 or res.subs.size() > 1) { q.work.notify_all(); }
+        else if (res.subs.size() == 1) { q.work.notify_one(); }
+        if (q.pending == 0 or not res.modified.empty()) { q.ready.notify_one(); }
+    }
+}
+
+/* ---------------------------- Group Separator ---------------------------- */
+
+void
+TreeDiff::pair_moves(std::vector<Change>& removed, std::vector<Change>& added,
+                     const csc& pathA, const csc& pathB,
+                     std::vector<Change>& moved)
+{
+    // candidates must have equal sizes, summed over files for directories, only those are hashed
+    std::unordered_multimap<off_t, size_t> sizes; // removed by size
+    std::vector<off_t> sizeR(removed.size(), -1), sizeA(added.size(), -1);
+    for (size_t i = 0; i < removed.size(); i++) {
+        const File * sub = removed[i].a;
+        const uchar kind = Dir::sub_tag(sub);
+        if (kind == 'f') { sizeR[i] = sub->get_size(); }
+        else if (kind == 'd') { sizeR[i] = files_size(static_cast<const Dir*>(sub)); }
+        if (sizeR[i] > 0) { sizes.emplace(sizeR[i] * 2 + (kind == 'd'), i); } // kinds apart
+    }
+    std::vector<bool> candR(removed.size(), false), candA(added.size(), false);
+    for (size_t i = 0; i < added.size(); i++) {
+        const File * sub = added[i].b;
+        const uchar kind = Dir::sub_tag(sub);
+        if (kind == 'f') { sizeA[i] = sub->get_size(); }
+        else if (kind == 'd') { sizeA[i] = files_size(static_cast<const Dir*>(sub)); }
+        if (sizeA[i] <= 0) { continue; }
+        auto hits = sizes.equal_range(sizeA[i] * 2 + (kind == 'd'));
+        for (auto hit = hits.first; hit != hits.second; hit++) { candR[hit->second] = true; candA[i] = true; }
+    }
+
+    std::vector<std::pair<const RegFile*, csc> > files; // candidate files to hash
+    for (size_t i = 0; i < removed.size(); i++) {
+        if (candR[i] and Dir::sub_tag(removed[i].a) == 'f') {
+            files.emplace_back(static_cast<const RegFile*>(removed[i].a), path_join(pathA, removed[i].path));
+        }
+    }
+    for (size_t i = 0; i < added.size(); i++) {
+        if (candA[i] and Dir::sub_tag(added[i].b) == 'f') {
+            files.emplace_back(static_cast<const RegFile*>(added[i].b), path_join(pathB, added[i].path));
+        }
+    }
+    m_stats.hashed += hash_files(files, m_opts.nthreads);
+
+    /// Get digest of candidate \p sub, or nullptr if none.
+    auto digest = [](const File * sub) -> const uchar * {
+        if (auto dir = dynamic_cast<const Dir*>(sub)) { return dir->update_tdig(); } // hashes files in parallel
+        return static_cast<const RegFile*>(sub)->get_chash(); // hashed above
+    };
+    std::unordered_multimap<csc, size_t> digs; // removed candidates by kind and digest
+    for (size_t i = 0; i < removed.size(); i++) {
+        if (not candR[i]) { continue; }
+        if (auto dig = digest(removed[i].a)) {
+            digs.emplace(csc(1, Dir::sub_tag(removed[i].a)) + csc(reinterpret_cast<const char*>(dig), DIG_SIZE), i);
+        }
+    }
+    std::vector<bool> usedR(removed.size(), false), usedA(added.size(), false);
+    for (size_t i = 0; i < added.size(); i++) {
+        if (not candA[i]) { continue; }
+        auto dig = digest(added[i].b);
+        if (not dig) { continue; }
+        auto hit = digs.find(csc(1, Dir::sub_tag(added[i].b)) + csc(reinterpret_cast<const char*>(dig), DIG_SIZE));
+        if (hit == digs.end()) { continue; }
+        const size_t r = hit->second;
+        digs.erase(hit);        // each removed sub moves once
+        moved.push_back(Change{MOVED, added[i].path, removed[r].path, removed[r].a, added[i].b});
+        usedR[r] = usedA[i] = true;
+    }
+
+    size_t n = 0;
+    for (size_t i = 0; i < removed.size(); i++) { if (not usedR[i]) { removed[n++] = std::move(removed[i]); } }
+    removed.resize(n);
+    n = 0;
+    for (size_t i = 0; i < added.size(); i++) { if (not usedA[i]) { added[n++] = std::move(added[i]); } }
+    added.resize(n);
+}
+
+size_t
+TreeDiff::run(const Dir * a, const Dir * b,
+              const std::function<void(const Change&)>& f)
+{
+    m_stats = Stats();
+    Queue q;
+    const csc pathA = a->path(), pathB = b->path(); // resolved here, as path() caches
+    q.todo.push_back(Job{a, b, csc(), pathA, pathB});
+    q.pending = 1;
+
+    {
+        Crew crew{q, {}};       // stops and joins workers however we leave
+        for (size_t i = 0; i < m_opts.nthreads; i++) {
+            crew.threads.emplace_back([this, &q]() { work(q); });
+        }
+
+        for (bool done = false; not done;) { // deliver modifications as found
+            std::vector<Change> batch;
+            {
+                std::unique_lock<std::mutex> lock(q.mtx);
+                q.ready.wait(lock, [&q]() { return not q.modified.empty() or q.pending == 0; });
+                batch.swap(q.modified);
+                done = (q.pending == 0);
+            }
+            for (const auto& c : batch) { f(c); } // may throw
+            m_stats.changes += batch.size();
+        }
+    }
+    add_stats(m_stats, q.stats);
+
+    std::vector<Change> moved;
+    if (m_opts.moves) { pair_moves(q.removed, q.added, pathA, pathB, moved); }
+    for (auto changes : { &moved, &q.removed, &q.added }) {
+        std::sort(changes->begin(), changes->end(),
+                  [](const Change& x, const Change& y) { return x.path < y.path; });
+        for (const auto& c : *changes) { f(c); }
+        m_stats.changes += changes->size();
+    }
+    return m_stats.changes;
+}
+
+}
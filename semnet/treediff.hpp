@@ -0,0 +1,114 @@
+/*! \file treediff.hpp
+ * \brief Parallel Diff of Two Directory Trees.
+ * \author Copyright (C) 2012 Per Nordlöw (per.nordlow@gmail.com)
+ *
+ * Compares two loaded \c Dir trees, such as a backup and its live tree, by
+ * walking pairs of sub-directories in lock-step over their subs sorted by
+ * name. Regular files are compared by the cheapest evidence first:
+ * - different sizes mean modified,
+ * - equal sizes and modification times mean unchanged, unless \c mtime is
+ *   false,
+ * - otherwise their content digests decide, which are computed only then.
+ * Pairs of sub-directories whose tree digests are both known and equal are
+ * skipped without visiting them.
+ *
+ * Directory pairs are diffed by worker threads and modifications reach the
+ * calling thread as each pair is done. Added and removed subs are held until
+ * the walk is done and then paired into moves, by size and then by digest.
+ * Trees are only read, so must not be loaded or changed during run().
+ */
+
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <thread>
+#include <vector>
+#include <sys/stat.h>
+#include "../csc.hpp"
+
+namespace semnet {
+
+namespace filesystem {
+class File;
+class Dir;
+class RegFile;
+}
+
+/*! Parallel Diff of Directory Trees. */
+class TreeDiff {
+public:
+    /// Kind of Change.
+    typedef enum {
+        ADDED,                  ///< Only in tree B.
+        REMOVED,                ///< Only in tree A.
+        MODIFIED,               ///< In both trees with different contents.
+        MOVED,                  ///< Only in tree A at \c from and only in tree B at \c path, with equal contents.
+    } Kind;
+
+    /// Change from Tree A to Tree B.
+    struct Change {
+        Kind kind;
+        csc path;               ///< Path relative to tree roots, in tree B unless removed.
+        csc from;               ///< Path relative to tree A root, if moved.
+        const filesystem::File * a; ///< Sub in tree A, nullptr if added.
+        const filesystem::File * b; ///< Sub in tree B, nullptr if removed.
+    };
+
+    /// Diff Options.
+    struct Options {
+        size_t nthreads = std::thread::hardware_concurrency(); ///< Number of worker threads.
+        bool mtime = true;      ///< Trust equal size and modification time to mean equal contents.
+        bool moves = true;      ///< Pair added and removed subs into moves.
+    };
+
+    /// Diff Statistics.
+    struct Stats {
+        size_t dirs = 0;        ///< Directory pairs diffed.
+        size_t files = 0;       ///< File pairs compared.
+        size_t skipped = 0;     ///< Directory pairs skipped by equal tree digests.
+        size_t hashed = 0;      ///< Files hashed.
+        size_t changes = 0;     ///< Changes found.
+    };
+
+    TreeDiff();
+    explicit TreeDiff(const Options& opts);
+    ~TreeDiff();
+
+    /*! Diff tree \p a against tree \p b, calling \p f(const Change&) on the
+     * calling thread for each change. Modifications come in the order they
+     * are found, followed by moves, removals and additions sorted by path.
+     * If \p f throws, the diff is stopped and the exception propagated.
+     * \return number of changes.
+     */
+    size_t run(const filesystem::Dir * a, const filesystem::Dir * b,
+               const std::function<void(const Change&)>& f);
+
+    /// Get statistics of last run().
+    const Stats& stats() const { return m_stats; }
+
+private:
+    struct Job;
+    struct Result;
+    struct Queue;
+    struct Crew;
+
+    /// Get status of \p file at \p pathF, as loaded or else from \c lstat().
+    static bool stat_of(const filesystem::File * file, const csc& pathF, struct stat& st);
+    /*! Get sum of sizes of all non-directories under \p dir. Sizes of the
+     * directories themselves are left out, as they depend on how many
+     * entries they have held rather than on what they hold. */
+    static off_t files_size(const filesystem::Dir * dir);
+    void work(Queue& q) const;
+    void diff(const Job& job, Result& res) const;
+    bool eq_files(const filesystem::RegFile * a, const csc& pathA,
+                  const filesystem::RegFile * b, const csc& pathB,
+                  Result& res) const;
+    void pair_moves(std::vector<Change>& removed, std::vector<Change>& added,
+                    const csc& pathA, const csc& pathB,
+                    std::vector<Change>& moved);
+
+    Options m_opts;
+    Stats m_stats;
+};
+
+}
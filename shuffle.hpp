@@ -1,9 +1,13 @@
 #pragma once
 #include <cstdlib>
+#include <utility>
+#include "rand_streams.hpp"
 
+/*! Shuffle \p a uniformly (Fisher-Yates) using the calling thread's random stream. */
 template<class C> void shuffle(C& a)
 {
-    for (size_t i = 0; i < a.size(); i++) {
-        std::swap(a[i], a[std::rand() % a.size()]);
+    auto& g = pnw::thread_rand_stream();
+    for (size_t i = a.size(); i > 1; i--) {
+        std::swap(a[i - 1], a[g.bounded(i)]);
     }
 }
@@ -6,5 +6,9 @@ template Mat<float> sinefit3par(const Col<float>& y,
                                 const Col<float>& wt);
 template Mat<double> sinefit3par(const Col<double>& y,
                                  const Col<double>& wt);
+template Mat<float> sinefit3par_batch(const Mat<float>& Y,
+                                      const Col<float>& wt, size_t nthreads);
+template Mat<double> sinefit3par_batch(const Mat<double>& Y,
+                                       const Col<double>& wt, size_t nthreads);
 }
 #endif
@@ -9,6 +9,7 @@
 #pragma once
 #include "enforce.hpp"
 #include "cc_features.h"
+#include "sinefit_batch.hpp"
 #include <armadillo>
 
 namespace arma {
@@ -38,11 +39,47 @@ template<class T> pure Mat<T> sinefit3par(const Col<T>& y,
     // return lscov(D0,y);
 }
 
+/*! 3-parameter Fit of y = sin(qt) to each column of \p Y, all sampled at
+ * \p wt.
+ * \return 3 x Y.n_cols matrix of fits, one column per channel as returned
+ * by \c sinefit3par().
+ * \see pnw::sinefit3par_plan
+ */
+template<class T> pure Mat<T> sinefit3par_batch(const Mat<T>& Y,
+                                                const Col<T>& wt,
+                                                size_t nthreads = std::thread::hardware_concurrency())
+{
+    enforce_eq(Y.n_rows, wt.n_rows); // dimensions must match
+    const pnw::sinefit3par_plan<T> plan(wt.memptr(), wt.n_rows);
+    Mat<T> X(3, Y.n_cols);
+    plan.fit(Y.memptr(), Y.n_rows, Y.n_cols, X.memptr(), nullptr, nthreads);
+    return X;
+}
+
+/*! 4-parameter Fit of y = A*cos(w*k) + B*sin(w*k) + C to each column of
+ * \p Y, starting at frequency \p w0 [radians per sample].
+ * \return 4 x Y.n_cols matrix of [A B C w] per channel.
+ * \see pnw::sinefit4par
+ */
+template<class T> pure Mat<T> sinefit4par_batch(const Mat<T>& Y, T w0,
+                                                size_t max_iter = 20,
+                                                size_t nthreads = std::thread::hardware_concurrency())
+{
+    Mat<T> X(4, Y.n_cols);
+    pnw::sinefit4par(Y.memptr(), Y.n_rows, Y.n_rows, Y.n_cols, w0,
+                     X.memptr(), static_cast<T*>(nullptr), max_iter, 1e-12, nthreads);
+    return X;
+}
+
 #if HAVE_CXX11_EXTERN_TEMPLATES
 extern template Mat<float> sinefit3par(const Col<float>& y,
                                        const Col<float>& wt);
 extern template Mat<double> sinefit3par(const Col<double>& y,
                                         const Col<double>& wt);
+extern template Mat<float> sinefit3par_batch(const Mat<float>& Y,
+                                             const Col<float>& wt, size_t nthreads);
+extern template Mat<double> sinefit3par_batch(const Mat<double>& Y,
+                                              const Col<double>& wt, size_t nthreads);
 #endif
 
 }
@@ -0,0 +1,333 @@
+/*! \file sinefit_batch.hpp
+ * \brief Fit Sine Waves to Many Channels at Once.
+ * \author Copyright (C) 2013 Per Nordlöw (per.nordlow@gmail.com)
+ *
+ * Batch counterparts of \c sinefit3par() in sinefit.hpp that need no
+ * Armadillo. Channels are stored column-major: channel \c i is the \c n
+ * samples at \c Y + i*ldy.
+ *
+ * - \c sinefit3par_plan factors the shared basis <tt>[cos(wt) sin(wt) 1]</tt>
+ *   once (QR by twice-iterated Gram-Schmidt), so fitting a channel is one
+ *   fused pass of three dot products plus a 3x3 back substitution.
+ * - \c sinefit4par() refines frequency per channel from a shared start
+ *   (IEEE 1057 four-parameter fit) by Gauss-Newton, generating the basis
+ *   from a small table rotated block by block instead of calling sin/cos
+ *   per sample.
+ *
+ * Channels are split over threads, and sample loops accumulate into eight
+ * independent lanes so they vectorize without reassociation.
+ *
+ * \see IEEE Std 1057-2007, Annex B
+ */
+
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+namespace pnw
+{
+
+/*! Run \p fn(begin, end) over channel ranges of [0, \p nch) on up to
+ * \p nthreads threads. */
+template<class F>
+inline void for_channels(size_t nch, size_t nthreads, F fn)
+{
+    const size_t nt = std::max<size_t>(1, std::min(nthreads, nch));
+    if (nt == 1) { fn(size_t(0), nch); return; }
+    std::vector<std::thread> threads;
+    threads.reserve(nt);
+    for (size_t t = 0; t < nt; t++) {
+        threads.emplace_back(fn, nch * t / nt, nch * (t + 1) / nt);
+    }
+    for (auto& th : threads) { th.join(); }
+}
+
+/*!
+ * Shared Plan for 3-parameter Sine Fits y = A*cos(wt) + B*sin(wt) + C.
+ */
+template<class T>
+class sinefit3par_plan {
+public:
+    /// Plan fits at the \p n sample phases \p wt.
+    sinefit3par_plan(const T* wt, size_t n) : m_n(n), m_Q(3 * n) {
+        T* q0 = m_Q.data(); T* q1 = q0 + n; T* q2 = q1 + n;
+        for (size_t k = 0; k < n; k++) {
+            q0[k] = std::cos(wt[k]);
+            q1[k] = std::sin(wt[k]);
+            q2[k] = 1;
+        }
+        std::fill(m_R, m_R + 9, T(0));
+        T* q[3] = { q0, q1, q2 };
+        for (size_t j = 0; j < 3; j++) {
+            for (int pass = 0; pass < 2; pass++) { // reorthogonalize once
+                for (size_t i = 0; i < j; i++) {
+                    const T r = dot(q[i], q[j]);
+                    for (size_t k = 0; k < n; k++) { q[j][k] -= r * q[i][k]; }
+                    m_R[i*3 + j] += r;
+                }
+            }
+            const T r = std::sqrt(dot(q[j], q[j]));
+            const T ir = r > 0 ? 1 / r : 0;
+            for (size_t k = 0; k < n; k++) { q[j][k] *= ir; }
+            m_R[j*3 + j] = r;
+        }
+    }
+
+    /*! Fit \p nch channels of \p Y into \p X = [A B C] per channel.
+     *
+     * \param[out] rms if non-null, root-mean-square residual per channel.
+     */
+    void fit(const T* Y, size_t ldy, size_t nch, T* X,
+             T* rms = nullptr,
+             size_t nthreads = std::thread::hardware_concurrency()) const {
+        for_channels(nch, nthreads, [&](size_t b, size_t e) {
+                for (size_t i = b; i < e; i++) {
+                    fit1(Y + i*ldy, X + 3*i, rms ? rms + i : nullptr);
+                }
+            });
+    }
+
+    size_t size() const { return m_n; }
+
+private:
+    T dot(const T* a, const T* b) const {
+        T acc[8] = { 0 };
+        size_t k = 0;
+        for (; k + 8 <= m_n; k += 8) {
+            for (size_t l = 0; l < 8; l++) { acc[l] += a[k+l] * b[k+l]; }
+        }
+        for (; k < m_n; k++) { acc[0] += a[k] * b[k]; }
+        return sum8(acc);
+    }
+
+    static T sum8(const T* a) { return ((a[0] + a[1]) + (a[2] + a[3])) + ((a[4] + a[5]) + (a[6] + a[7])); }
+
+    /// Fit one channel: z = Q'y in one pass, then solve R x = z.
+    void fit1(const T* y, T* x, T* rms) const {
+        const T* q0 = m_Q.data(); const T* q1 = q0 + m_n; const T* q2 = q1 + m_n;
+        T a0[8] = { 0 }, a1[8] = { 0 }, a2[8] = { 0 }, ay[8] = { 0 };
+        size_t k = 0;
+        for (; k + 8 <= m_n; k += 8) {
+            for (size_t l = 0; l < 8; l++) {
+                const T v = y[k+l];
+                a0[l] += q0[k+l] * v;
+                a1[l] += q1[k+l] * v;
+                a2[l] += q2[k+l] * v;
+                ay[l] += v * v;
+            }
+        }
+        for (; k < m_n; k++) {
+            const T v = y[k];
+            a0[0] += q0[k] * v; a1[0] += q1[k] * v; a2[0] += q2[k] * v; ay[0] += v * v;
+        }
+        const T z0 = sum8(a0), z1 = sum8(a1), z2 = sum8(a2);
+        const T* R = m_R;
+        x[2] = R[8] != 0 ? z2 / R[8] : 0;
+        x[1] = R[4] != 0 ? (z1 - R[5]*x[2]) / R[4] : 0;
+        x[0] = R[0] != 0 ? (z0 - R[1]*x[1] - R[2]*x[2]) / R[0] : 0;
+        if (rms) {              // |y|^2 - |Q'y|^2, y projected onto the basis
+            const T r2 = sum8(ay) - (z0*z0 + z1*z1 + z2*z2);
+            *rms = std::sqrt(std::max<T>(r2, 0) / std::max<size_t>(m_n, 1));
+        }
+    }
+
+    size_t m_n;                 ///< Number of samples.
+    std::vector<T> m_Q;         ///< Orthonormal basis, three columns of \c m_n.
+    T m_R[9];                   ///< Upper triangular factor, row-major.
+};
+
+/* ---------------------------- Group Separator ---------------------------- */
+
+namespace detail {
+
+/// Solve 4x4 system \p G x = \p b in place by Gaussian elimination with partial pivoting.
+inline bool solve4(double G[4][4], double b[4])
+{
+    for (int c = 0; c < 4; c++) {
+        int p = c;
+        for (int r = c + 1; r < 4; r++) { if (std::abs(G[r][c]) > std::abs(G[p][c])) { p = r; } }
+        if (G[p][c] == 0) { return false; }
+        if (p != c) { std::swap(G[p], G[c]); std::swap(b[p], b[c]); }
+        for (int r = c + 1; r < 4; r++) {
+            const double f = G[r][c] / G[c][c];
+            for (int j = c; j < 4; j++) { G[r][j] -= f * G[c][j]; }
+            b[r] -= f * b[c];
+        }
+    }
+    for (int c = 3; c >= 0; c--) {
+        for (int j = c + 1; j < 4; j++) { b[c] -= G[c][j] * b[j]; }
+        b[c] /= G[c][c];
+    }
+    return true;
+}
+
+/*! Per-thread 4-parameter fitter. Phases are taken relative to the
+ * middle sample, tau = k - (n-1)/2, which decouples the frequency column
+ * from the others and keeps the normal equations well conditioned.
+ */
+template<class T>
+class sinefit4 {
+public:
+    static const size_t L = 64; ///< Basis table length.
+
+    explicit sinefit4(size_t n) : m_n(n), m_mid(0.5 * (double(n) - 1)) {}
+
+    /*! Refine \p x = [A B C w] (phases from sample 0) of \p y.
+     * \return number of iterations used. */
+    size_t fit(const T* y, T* x, T* rms, size_t max_iter, double tol) {
+        double w = x[3];
+        double A, B, C = x[2];
+        from_origin(w, x[0], x[1], A, B);
+        size_t it = 0;
+        while (it < max_iter) {
+            it++;
+            double G[4][4], b[4];
+            normal(y, w, A, B, G, b);
+            if (!solve4(G, b)) { break; }
+            A = b[0]; B = b[1]; C = b[2];
+            const double dw = b[3];
+            w += dw;
+            if (std::abs(dw) <= tol * std::abs(w)) { break; }
+        }
+        {                       // final linear fit at the refined frequency
+            double G[4][4], b[4];
+            normal(y, w, A, B, G, b);
+            if (solve3(G, b)) { A = b[0]; B = b[1]; C = b[2]; }
+        }
+        if (rms) { *rms = static_cast<T>(residual(y, w, A, B, C)); }
+        double a0, b0;
+        to_origin(w, A, B, a0, b0);
+        x[0] = static_cast<T>(a0); x[1] = static_cast<T>(b0);
+        x[2] = static_cast<T>(C); x[3] = static_cast<T>(w);
+        return it;
+    }
+
+private:
+    void from_origin(double w, double a, double b, double& A, double& B) const {
+        const double c = std::cos(w * m_mid), s = std::sin(w * m_mid);
+        A = a * c + b * s; B = -a * s + b * c;
+    }
+    void to_origin(double w, double A, double B, double& a, double& b) const {
+        const double c = std::cos(w * m_mid), s = std::sin(w * m_mid);
+        a = A * c - B * s; b = A * s + B * c;
+    }
+
+    /// Solve the leading 3x3 (linear) part of \p G x = \p b.
+    static bool solve3(double G[4][4], double b[4]) {
+        double H[4][4] = { { G[0][0], G[0][1], G[0][2], 0 },
+                           { G[1][0], G[1][1], G[1][2], 0 },
+                           { G[2][0], G[2][1], G[2][2], 0 },
+                           { 0, 0, 0, 1 } };
+        b[3] = 0;
+        return solve4(H, b);
+    }
+
+    /// Fill basis table for frequency \p w.
+    void table(double w) {
+        for (size_t j = 0; j < L; j++) { m_ct[j] = std::cos(w * j); m_st[j] = std::sin(w * j); }
+    }
+
+    /*! Accumulate normal equations of columns [cos sin 1 g] where
+     * g = tau*(B*cos - A*sin) is the derivative with respect to w.
+     */
+    void normal(const T* y, double w, double A, double B,
+                double G[4][4], double b[4]) {
+        table(w);
+        enum { CC, CS, C1, SS, S1, GC, GS, G1, GG, YC, YS, Y1, YG, NS };
+        double acc[NS][8] = { { 0 } };
+        for (size_t k0 = 0; k0 < m_n; k0 += L) {
+            const double t0 = double(k0) - m_mid;
+            const double c0 = std::cos(w * t0), s0 = std::sin(w * t0);
+            const size_t m = std::min(L, m_n - k0);
+            for (size_t j0 = 0; j0 < m; j0 += 8) {
+                const size_t ml = std::min<size_t>(8, m - j0);
+                for (size_t l = 0; l < ml; l++) {
+                    const size_t j = j0 + l;
+                    const double c = c0 * m_ct[j] - s0 * m_st[j];
+                    const double s = s0 * m_ct[j] + c0 * m_st[j];
+                    const double g = (t0 + j) * (B * c - A * s);
+                    const double v = y[k0 + j];
+                    acc[CC][l] += c * c; acc[CS][l] += c * s; acc[C1][l] += c;
+                    acc[SS][l] += s * s; acc[S1][l] += s;
+                    acc[GC][l] += g * c; acc[GS][l] += g * s; acc[G1][l] += g; acc[GG][l] += g * g;
+                    acc[YC][l] += v * c; acc[YS][l] += v * s; acc[Y1][l] += v; acc[YG][l] += v * g;
+                }
+            }
+        }
+        double S[NS];
+        for (int i = 0; i < NS; i++) {
+            const double* a = acc[i];
+            S[i] = ((a[0] + a[1]) + (a[2] + a[3])) + ((a[4] + a[5]) + (a[6] + a[7]));
+        }
+        const double n = double(m_n);
+        const double g[4][4] = { { S[CC], S[CS], S[C1], S[GC] },
+                                 { S[CS], S[SS], S[S1], S[GS] },
+                                 { S[C1], S[S1], n,     S[G1] },
+                                 { S[GC], S[GS], S[G1], S[GG] } };
+        for (int i = 0; i < 4; i++) { for (int j = 0; j < 4; j++) { G[i][j] = g[i][j]; } }
+        b[0] = S[YC]; b[1] = S[YS]; b[2] = S[Y1]; b[3] = S[YG];
+    }
+
+    double residual(const T* y, double w, double A, double B, double C) {
+        table(w);
+        double acc[8] = { 0 };
+        for (size_t k0 = 0; k0 < m_n; k0 += L) {
+            const double t0 = double(k0) - m_mid;
+            const double c0 = std::cos(w * t0), s0 = std::sin(w * t0);
+            const size_t m = std::min(L, m_n - k0);
+            for (size_t j0 = 0; j0 < m; j0 += 8) {
+                const size_t ml = std::min<size_t>(8, m - j0);
+                for (size_t l = 0; l < ml; l++) {
+                    const size_t j = j0 + l;
+                    const double c = c0 * m_ct[j] - s0 * m_st[j];
+                    const double s = s0 * m_ct[j] + c0 * m_st[j];
+                    const double r = y[k0 + j] - (A * c + B * s + C);
+                    acc[l] += r * r;
+                }
+            }
+        }
+        const double s = ((acc[0] + acc[1]) + (acc[2] + acc[3])) + ((acc[4] + acc[5]) + (acc[6] + acc[7]));
+        return std::sqrt(s / std::max<size_t>(m_n, 1));
+    }
+
+    size_t m_n;
+    double m_mid;               ///< Middle sample, origin of tau.
+    double m_ct[L], m_st[L];    ///< cos/sin(w*j), j < L.
+};
+
+}
+
+/*! 4-parameter Fit y = A*cos(w*k) + B*sin(w*k) + C of \p nch channels of
+ * \p n uniformly spaced samples \p Y, with w in radians per sample.
+ *
+ * All channels start from a shared 3-parameter fit at \p w0 (one plan),
+ * then each refines its own frequency until the relative update is below
+ * \p tol or \p max_iter iterations.
+ *
+ * \param[out] X [A B C w] per channel.
+ * \param[out] rms if non-null, root-mean-square residual per channel.
+ */
+template<class T>
+inline void sinefit4par(const T* Y, size_t ldy, size_t n, size_t nch, T w0,
+                        T* X, T* rms = nullptr,
+                        size_t max_iter = 20, double tol = 1e-12,
+                        size_t nthreads = std::thread::hardware_concurrency())
+{
+    std::vector<T> wt(n);
+    for (size_t k = 0; k < n; k++) { wt[k] = w0 * T(k); }
+    const sinefit3par_plan<T> plan(wt.data(), n);
+    std::vector<T> X3(3 * nch);
+    plan.fit(Y, ldy, nch, X3.data(), nullptr, nthreads);
+    for_channels(nch, nthreads, [&](size_t b, size_t e) {
+            detail::sinefit4<T> f(n);
+            for (size_t i = b; i < e; i++) {
+                T* x = X + 4*i;
+                x[0] = X3[3*i + 0]; x[1] = X3[3*i + 1]; x[2] = X3[3*i + 2]; x[3] = w0;
+                f.fit(Y + i*ldy, x, rms ? rms + i : nullptr, max_iter, tol);
+            }
+        });
+}
+
+}
@@ -1,7 +1,6 @@
 #include "utils.h"
-#include "alz3d.h"
+#include "alz_engine.h"
 #include "audioutils.h"
-#include "fdutils.h"
 
 #include "soundFXs.h"
 
@@ -10,32 +9,69 @@
 #endif
 
 #include <errno.h>
-#include <poll.h>
 #include <pthread.h>
 
 /* ========================================================================= */
 
-/*!
- * Audiolizer main loop function to be spawned in a separate thread.
- * \param[in,out] arg not currently used
- */
-static void * alz3d_writer(void * arg);
-
-/* ---------------------------- Group Separator ---------------------------- */
-
 static AudioCtx g_audio_ctx;
 
 int g_alz3d_uopt = FALSE;
 static int g_audiofd = -1;
-static Alz3d g_alz;
-static pthread_t g_alz_thread;
-static int g_alz3d_swnum = 128;
+static AlzEngine g_alz;
+static AlzFdSink g_alz_sink;
+static A3d g_a3d;
+static A3dConvBank g_a3d_bank;
+static bool g_a3d_flag = FALSE;
+static size_t g_alz3d_swnum = 128; /**< Samples per block written to device. */
 
 /* ---------------------------- Group Separator ---------------------------- */
 
-static SoundFX * g_sfxs = NULL;	/**< Pending Sound Effects Buffer. */
-static size_t g_sfxsN = 0; /**< Number of Pending Sound Effects. */
-static pthread_mutex_t g_soundFXs_mutex; /**< Assure Consistency for SoundFX-tranfers */
+/*! Serializes producers of the audiolizer command queue against each other
+ * and against soundFXs_release(), which closes \c g_audiofd under it. The
+ * audio thread never takes it. */
+static pthread_mutex_t g_soundFXs_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/*! Enable 3D-audio for \p eng at \p srate if KEMAR-data can be loaded. */
+static void
+soundFXs_init_a3d(AlzEngine * eng, int srate)
+{
+  if (a3d_init(&g_a3d, "/home/per/KEMAR/compact", ".dat", srate) < 0) {
+    leprintf("Could not load KEMAR-data. 3D-audio will not be used\n");
+    return;
+  }
+  if (a3d_conv_bank_init_a3d(&g_a3d_bank, g_alz3d_swnum, &g_a3d) < 0) {
+    a3d_clear(&g_a3d);
+    return;
+  }
+  if (alz_engine_use_a3d(eng, &g_a3d, &g_a3d_bank) < 0) {
+    a3d_conv_bank_clear(&g_a3d_bank);
+    a3d_clear(&g_a3d);
+    return;
+  }
+  g_a3d_flag = TRUE;
+}
+
+/*! Release audiolizer, 3D-audio and audio device, if not already done.
+ * Sound effects are dropped from then on. */
+static void
+soundFXs_release(void)
+{
+  pthread_mutex_lock(&g_soundFXs_mutex);
+  if (g_audiofd < 0) {
+    pthread_mutex_unlock(&g_soundFXs_mutex);
+    return;
+  }
+  alz_engine_clear(&g_alz);	/* stops and joins audiolizer thread */
+  alz_fd_sink_clear(&g_alz_sink);
+  close(g_audiofd);
+  g_audiofd = -1;
+  if (g_a3d_flag) {
+    a3d_conv_bank_clear(&g_a3d_bank);
+    a3d_clear(&g_a3d);
+    g_a3d_flag = FALSE;
+  }
+  pthread_mutex_unlock(&g_soundFXs_mutex);
+}
 
 void soundFXs_init(void)
 {
@@ -49,27 +85,31 @@ void soundFXs_init(void)
     bool little_endian_flag = FALSE;
     int frag = 0x0004000b;
     bool use_a3d_flag = TRUE;
+    const size_t nvoices = 256;
 
     /* open audio device */
     g_audiofd = audioctx_open(&g_audio_ctx, devname, &schan, &srate,
 			      &frag,
 			      &sprecision, sign_flag, little_endian_flag);
-    if (g_audiofd >= 0) {
+    if (g_audiofd >= 0 && (schan != 2 || sprecision != 16)) {
+      leprintf("Audio device format not supported\n");
+      close(g_audiofd);
+      g_audiofd = -1;
+    }
+    /* blocking writes pace the audio thread */
+    if (g_audiofd >= 0 &&
+        alz_engine_init(&g_alz, srate, g_alz3d_swnum, nvoices, nvoices) >= 0) {
       lprintf("Sound will be used (on /dev/audio)\n");
-      unblockfd(g_audiofd);
-
-      g_sfxs = NULL;
-      g_sfxsN = 0;
-      pthread_mutex_init(&g_soundFXs_mutex, 0);
-
-      alz3d_init(&g_alz, schan, srate, sprecision, sign_flag,
-		 little_endian_flag,
-		 use_a3d_flag,
-		 NULL);
-      int rcode = pthread_create(&g_alz_thread, 0, alz3d_writer, 0);
-      if (rcode < 0) { lperror("pthread_create"); }
+
+      if (use_a3d_flag) { soundFXs_init_a3d(&g_alz, srate); }
+      alz_fd_sink_init(&g_alz_sink, g_audiofd, little_endian_flag, g_alz3d_swnum);
+      if (alz_engine_start(&g_alz, alz_fd_sink_write, &g_alz_sink) < 0) {
+        PWARN("Could not start audiolizer thread. Sound will not be used\n");
+        soundFXs_release();
+      }
     } else {
       lprintf("Sound will not be used\n");
+      if (g_audiofd >= 0) { close(g_audiofd); }
       g_audiofd = -1;
     }
   }
@@ -77,19 +117,7 @@ void soundFXs_init(void)
 
 void soundFXs_clear(void)
 {
-  if (g_alz3d_uopt) {
-    /* initialize audiolizer fd, mutex, thread */
-    alz3d_clear(&g_alz);
-    if (g_audiofd >= 0) {
-      close(g_audiofd);
-      int sig = SIGKILL;		/* signal number */
-      pthread_kill(g_alz_thread, sig);	/* kill audiolizer thread */
-      pthread_mutex_destroy(&g_soundFXs_mutex);
-    }
-  }
-
-  if (g_sfxs) { free(g_sfxs); g_sfxs = NULL; }
-  g_sfxsN = 0;
+  if (g_alz3d_uopt) { soundFXs_release(); }
 
   audioctx_close(&g_audio_ctx);
 }
@@ -120,16 +148,10 @@ soundFXs_add(float fq, float tdur_sec, float azim, float amp)
   if (pthread_mutex_lock(&g_soundFXs_mutex) != 0) {
     pthread_mutex_lock_warn();
   } else {
-    g_sfxs = (SoundFX*)realloc(g_sfxs, (g_sfxsN + 1) * sizeof(SoundFX));
-    if (g_sfxs) {
-      g_sfxs[g_sfxsN].fq = fq;
-      g_sfxs[g_sfxsN].tdur_sec = tdur_sec;
-      g_sfxs[g_sfxsN].azim = azim;
-      g_sfxs[g_sfxsN].amp = amp;
-
-      g_sfxsN++;
-    } else {
-      PWARN("Could not allocate memory for new sound effect\n\n");
+    if (g_audiofd >= 0 &&	/* else not started or already released */
+        !alz_engine_add(&g_alz, fq, tdur_sec, azim, amp,
+                        ALZ3D_WAVE_SINE, ALZ3D_FADE_OUT)) {
+      PWARN("Audiolizer command queue full, dropped sound effect\n");
     }
 
     int rval = pthread_mutex_unlock(&g_soundFXs_mutex);
@@ -141,66 +163,4 @@ void soundFXs_add_xstr(const xStr * effect_name)
 {
 }
 
-/*!
- * Transfer Sound-Effects to Audiolizer.
- *
- * \return 1 upon success, 0 otherwise.
- */
-int
-soundFXs_transferNow(Alz3d * alz)
-{
-  if (pthread_mutex_lock(&g_soundFXs_mutex) != 0) {
-    pthread_mutex_lock_warn();
-    return 0;
-  } else {
-    /* transfer sfxs to audiolizer */
-    for (size_t i = 0; i < g_sfxsN; i++) {
-      alz3d_addNow(alz,
-		   g_sfxs[i].fq,
-		   g_sfxs[i].tdur_sec,
-		   g_sfxs[i].azim,
-		   g_sfxs[i].amp,
-		   ALZ3D_WAVE_SINE, ALZ3D_FADE_OUT);
-    }
-
-    /* clear sfx buffer */
-    g_sfxsN = 0;
-    g_sfxs = (SoundFX*)dynalloc(g_sfxs, (g_sfxsN) * sizeof(SoundFX));
-
-    int rval = pthread_mutex_unlock(&g_soundFXs_mutex);
-    if (rval == 1) { pthread_mutex_unlock_warn(); }
-
-    return 1;
-  }
-}
-
-/* ---------------------------- Group Separator ---------------------------- */
-
-void * alz3d_writer(void * arg)
-{
-  struct pollfd ufds[1];
-  const size_t nfds = 1;
-  const int timeout = 100;		/* timeout in milliseconds */
-  while (TRUE) {
-    ufds[0].fd = g_audiofd;	/* one to poll */
-    ufds[0].events = POLLOUT;	/* we check if we can write to it */
-    int rval = poll(&ufds[0], nfds, timeout); /* check it */
-    if (rval == 1) {
-      if (ufds[0].revents & POLLOUT) {
-	int ret_num;
-	soundFXs_transferNow(&g_alz); /* if any transfer new sfx to audiolizer */
-	/* write to audio device */
-	ret_num = alz3d_write(&g_alz, g_audiofd, g_alz3d_swnum);
-	/* lprintf("alz3d_write wrote %d of %d samples.", ret_num, g_alz3d_swnum); */
-      }
-    } else if (rval == 0) {
-      /* do nothing */
-    } else if (rval < 0) {
-      lperror("poll");
-    }
-  }
-
-  return 0;
-}
-
 /* ========================================================================= */
@@ -28,16 +28,6 @@ extern "C" {
 
 /* @{ */
 
-/*!
- * Sound Effect.
- */
-typedef struct {
-  float fq;			/**< Frequency [Hz] */
-  float tdur_sec;		/**< Time Duration [s] */
-  float azim;			/**< Azimuth Angle */
-  float amp;			/**< Amplitude */
-} SoundFX;
-
 void soundFXs_init(void);
 
 void soundFXs_clear(void);
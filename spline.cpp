@@ -1,4 +1,5 @@
 #include "spline.hpp"
+#include <algorithm>
 #include <cstdlib>
 #include <iostream>
 #include <iomanip>
@@ -6542,4 +6543,194 @@ void timestamp ( )
 # undef TIME_SIZE
 }
 
+//****************************************************************************80
+//
+//  PIECEWISE_CUBIC: Precomputed coefficients and batch evaluation.
+//
+//****************************************************************************80
+
+void piecewise_cubic::init_knots ( int n, const Td t[] )
+{
+  m_t.assign ( t, t + n );
+  m_c.assign ( 4 * ( n > 1 ? n - 1 : 1 ), 0.0 );
+
+  // Eytzinger layout of the interior knots t[1..n-2] for unsorted queries.
+  const size_t k = n > 2 ? n - 2 : 0;
+  m_eyt.assign ( k + 1, 0.0 );
+  m_eyt_rank.assign ( k + 1, 0 );
+  size_t j = 0;
+  // In-order walk of the implicit tree assigns sorted keys.
+  struct walk
+  {
+    static void run ( const Td *t, size_t k, size_t node, size_t &j,
+                      std::vector<Td> &eyt, std::vector<unsigned> &rank )
+    {
+      if ( k < node ) { return; }
+      run ( t, k, 2 * node, j, eyt, rank );
+      eyt[node] = t[1 + j];
+      rank[node] = static_cast<unsigned> ( ++j );
+      run ( t, k, 2 * node + 1, j, eyt, rank );
+    }
+  };
+  walk::run ( t, k, 1, j, m_eyt, m_eyt_rank );
+}
+
+void piecewise_cubic::set_hermite ( size_t i, Td y0, Td y1, Td d0, Td d1 )
+{
+  const Td h = m_t[i+1] - m_t[i];
+  const Td delta = ( y1 - y0 ) / h;
+  Td *c = &m_c[4*i];
+  c[0] = y0;
+  c[1] = d0;
+  c[2] = ( 3.0 * delta - 2.0 * d0 - d1 ) / h;
+  c[3] = ( d0 + d1 - 2.0 * delta ) / ( h * h );
+}
+
+piecewise_cubic piecewise_cubic::linear ( int n, const Td t[], const Td y[] )
+{
+  piecewise_cubic p;
+  p.init_knots ( n, t );
+  if ( n == 1 ) { p.m_c[0] = y[0]; }
+  for ( int i = 0; i + 1 < n; i++ )
+  {
+    p.m_c[4*i] = y[i];
+    p.m_c[4*i+1] = ( y[i+1] - y[i] ) / ( t[i+1] - t[i] );
+  }
+  return p;
+}
+
+piecewise_cubic piecewise_cubic::cubic ( int n, const Td t[], const Td y[],
+                                         int ibcbeg, Td ybcbeg, int ibcend, Td ybcend )
+{
+  piecewise_cubic p;
+  p.init_knots ( n, t );
+  Td *ypp = spline_cubic_set ( n, const_cast<Td*> ( t ), const_cast<Td*> ( y ),
+                               ibcbeg, ybcbeg, ibcend, ybcend );
+  if ( !ypp ) { return p; }
+  for ( int i = 0; i + 1 < n; i++ )
+  {
+    const Td h = t[i+1] - t[i];
+    Td *c = &p.m_c[4*i];
+    c[0] = y[i];
+    c[1] = ( y[i+1] - y[i] ) / h - ( ypp[i+1] / 6.0 + ypp[i] / 3.0 ) * h;
+    c[2] = 0.5 * ypp[i];
+    c[3] = ( ypp[i+1] - ypp[i] ) / ( 6.0 * h );
+  }
+  delete [] ypp;
+  return p;
+}
+
+piecewise_cubic piecewise_cubic::hermite ( int n, const Td t[], const Td y[], const Td yp[] )
+{
+  piecewise_cubic p;
+  p.init_knots ( n, t );
+  for ( int i = 0; i + 1 < n; i++ )
+  {
+    p.set_hermite ( i, y[i], y[i+1], yp[i], yp[i+1] );
+  }
+  return p;
+}
+
+piecewise_cubic piecewise_cubic::pchip ( int n, const Td t[], const Td y[] )
+{
+  std::vector<Td> d ( n );
+  spline_pchip_set ( n, const_cast<Td*> ( t ), const_cast<Td*> ( y ), d.data() );
+  return hermite ( n, t, y, d.data() );
+}
+
+size_t piecewise_cubic::interval ( Td x ) const
+{
+  // Branch-free descent; the final node index encodes the path, and
+  // stripping the trailing right turns gives the first key > x.
+  const size_t k = m_eyt.size() - 1;
+  size_t i = 1;
+  while ( i <= k )
+  {
+    i = 2 * i + ( m_eyt[i] <= x );
+  }
+  i >>= __builtin_ffsll ( ~i );
+  return i ? m_eyt_rank[i] - 1 : k;
+}
+
+Td piecewise_cubic::operator () ( Td x ) const
+{
+  Td y;
+  eval_unsorted ( &x, 1, &y );
+  return y;
+}
+
+void piecewise_cubic::eval_block ( const Td x[], const unsigned idx[], size_t m,
+                                   Td y[], Td yp[] ) const
+{
+  typedef Td v4d __attribute__ ((vector_size (4*sizeof(Td))));
+  const Td *t = m_t.data();
+  const Td *C = m_c.data();
+  size_t j = 0;
+  for ( ; j + 4 <= m; j += 4 )
+  {
+    const Td *c0 = C + 4*idx[j], *c1 = C + 4*idx[j+1], *c2 = C + 4*idx[j+2], *c3 = C + 4*idx[j+3];
+    const v4d s = { x[j] - t[idx[j]], x[j+1] - t[idx[j+1]],
+                    x[j+2] - t[idx[j+2]], x[j+3] - t[idx[j+3]] };
+    const v4d a = { c0[0], c1[0], c2[0], c3[0] };
+    const v4d b = { c0[1], c1[1], c2[1], c3[1] };
+    const v4d c = { c0[2], c1[2], c2[2], c3[2] };
+    const v4d d = { c0[3], c1[3], c2[3], c3[3] };
+    const v4d v = a + s * ( b + s * ( c + s * d ) );
+    __builtin_memcpy ( y + j, &v, sizeof ( v ) );
+    if ( yp )
+    {
+      const v4d dv = b + s * ( 2.0 * c + 3.0 * s * d );
+      __builtin_memcpy ( yp + j, &dv, sizeof ( dv ) );
+    }
+  }
+  for ( ; j < m; j++ )
+  {
+    const Td *c = C + 4*idx[j];
+    const Td s = x[j] - t[idx[j]];
+    y[j] = c[0] + s * ( c[1] + s * ( c[2] + s * c[3] ) );
+    if ( yp ) { yp[j] = c[1] + s * ( 2.0 * c[2] + 3.0 * s * c[3] ); }
+  }
+}
+
+void piecewise_cubic::eval_sorted ( const Td x[], size_t m, Td y[], Td yp[] ) const
+{
+  enum { B = 256 };
+  unsigned idx[B];
+  const size_t last = m_t.size() > 2 ? m_t.size() - 2 : 0;
+  size_t i = m ? interval ( x[0] ) : 0;
+  for ( size_t j0 = 0; j0 < m; j0 += B )
+  {
+    const size_t mb = std::min<size_t> ( B, m - j0 );
+    for ( size_t j = 0; j < mb; j++ )
+    {
+      while ( i < last && m_t[i+1] <= x[j0+j] ) { i++; }
+      idx[j] = static_cast<unsigned> ( i );
+    }
+    eval_block ( x + j0, idx, mb, y + j0, yp ? yp + j0 : nullptr );
+  }
+}
+
+void piecewise_cubic::eval_unsorted ( const Td x[], size_t m, Td y[], Td yp[] ) const
+{
+  enum { B = 256 };
+  unsigned idx[B];
+  for ( size_t j0 = 0; j0 < m; j0 += B )
+  {
+    const size_t mb = std::min<size_t> ( B, m - j0 );
+    for ( size_t j = 0; j < mb; j++ )
+    {
+      idx[j] = static_cast<unsigned> ( interval ( x[j0+j] ) );
+    }
+    eval_block ( x + j0, idx, mb, y + j0, yp ? yp + j0 : nullptr );
+  }
+}
+
+void piecewise_cubic::eval ( const Td x[], size_t m, Td y[], Td yp[] ) const
+{
+  size_t j = 1;
+  while ( j < m && x[j-1] <= x[j] ) { j++; }
+  if ( j >= m ) { eval_sorted ( x, m, y, yp ); }
+  else { eval_unsorted ( x, m, y, yp ); }
+}
+
 }
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <string>
+#include <vector>
+#include <cstddef>
 
 typedef double Td;
 
@@ -98,4 +100,62 @@ namespace splines {
                               Td tval, Td *yval, Td *ypval );
   void timestamp ( );
 
+  /*! Piecewise Cubic with Precomputed Coefficients and Batch Evaluation.
+   *
+   * Built once from one of the \c spline_*_set routines, then evaluated
+   * at arrays of points. On interval \c i the value at \c x is
+   * \c a+s*(b+s*(c+s*d)) with \c s = \c x - \c t[i], stored interleaved
+   * per interval so one lookup touches one cache line. Points outside the
+   * knots are extrapolated from the end intervals, as the \c *_val
+   * routines do.
+   *
+   * eval() brackets ascending queries with a monotone cursor (amortized
+   * O(1) per point) and others with a branch-free Eytzinger-layout
+   * search, then evaluates the polynomials four points at a time.
+   */
+  class piecewise_cubic
+  {
+  public:
+    piecewise_cubic() {}
+
+    /// Linear interpolant of \p y at knots \p t.
+    static piecewise_cubic linear ( int n, const Td t[], const Td y[] );
+    /// Cubic spline of \p y at \p t with end conditions as for spline_cubic_set().
+    static piecewise_cubic cubic ( int n, const Td t[], const Td y[],
+                                   int ibcbeg = 2, Td ybcbeg = 0,
+                                   int ibcend = 2, Td ybcend = 0 );
+    /// Monotone piecewise cubic Hermite interpolant (spline_pchip_set()).
+    static piecewise_cubic pchip ( int n, const Td t[], const Td y[] );
+    /// Cubic Hermite interpolant of values \p y and derivatives \p yp.
+    static piecewise_cubic hermite ( int n, const Td t[], const Td y[], const Td yp[] );
+
+    /// Number of knots.
+    size_t size ( ) const { return m_t.size(); }
+
+    /// Get interval index of \p x: largest \c i in [0, n-2] with \c t[i] <= \p x, or 0.
+    size_t interval ( Td x ) const;
+
+    /// Evaluate at \p x.
+    Td operator () ( Td x ) const;
+
+    /*! Evaluate at the \p m points \p x into \p y and, if non-null, the
+     * first derivative into \p yp. Detects whether \p x is ascending.
+     */
+    void eval ( const Td x[], size_t m, Td y[], Td yp[] = nullptr ) const;
+    /// Evaluate at the \p m ascending points \p x.
+    void eval_sorted ( const Td x[], size_t m, Td y[], Td yp[] = nullptr ) const;
+    /// Evaluate at the \p m points \p x in any order.
+    void eval_unsorted ( const Td x[], size_t m, Td y[], Td yp[] = nullptr ) const;
+
+  private:
+    void init_knots ( int n, const Td t[] );
+    void set_hermite ( size_t i, Td y0, Td y1, Td d0, Td d1 );
+    void eval_block ( const Td x[], const unsigned idx[], size_t m, Td y[], Td yp[] ) const;
+
+    std::vector<Td> m_t;        ///< Knots.
+    std::vector<Td> m_c;        ///< Coefficients \c a b c d per interval.
+    std::vector<Td> m_eyt;      ///< Interior knots t[1..n-2] in Eytzinger order, 1-based.
+    std::vector<unsigned> m_eyt_rank; ///< Number of interior knots <= \c m_eyt[k].
+  };
+
 }
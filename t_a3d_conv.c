@@ -0,0 +1,145 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+
+#include "../utils.h"
+#include "../meman.h"
+#include "../extremes.h"
+#include "../a3d_conv.h"
+
+/*! Direct convolution of \p in (\p n samples) with \p ir (\p irlen samples). */
+static void
+conv_direct(const float * in, size_t n, const float * ir, size_t irlen, float * out)
+{
+  for (size_t t = 0; t < n; t++) {
+    float s = 0;
+    for (size_t k = 0; k < irlen && k <= t; k++) { s += ir[k] * in[t - k]; }
+    out[t] = s;
+  }
+}
+
+static float
+frand(void)
+{
+  return (float)rand() / RAND_MAX - 0.5f;
+}
+
+/*! Render \p nsrc sources with fixed directions and one source changing
+ * direction in block \p change_blk, compare with direct convolution.
+ */
+int
+test_a3d_conv(size_t B, size_t irlen, size_t ndirs, size_t nsrc, size_t nblk)
+{
+  const size_t n = B * nblk, change_blk = nblk / 2;
+  float *irs_L = farray_calloc(ndirs * irlen);
+  float *irs_R = farray_calloc(ndirs * irlen);
+  for (size_t i = 0; i < ndirs * irlen; i++) { irs_L[i] = frand(); irs_R[i] = frand(); }
+
+  A3dConvBank bank;
+  A3dConv conv;
+  a3d_conv_bank_init(&bank, B, irs_L, irs_R, ndirs, irlen);
+  a3d_conv_init(&conv, &bank, nsrc);
+
+  float *in = farray_calloc(nsrc * n);
+  for (size_t i = 0; i < nsrc * n; i++) { in[i] = frand(); }
+  for (size_t s = 0; s < nsrc; s++) {
+    a3d_conv_source_set(&conv, s, s % ndirs, s & 1, 1.0f / (s + 1));
+  }
+
+  /* Reference: steady mix, plus source 0 through its new direction from change_blk. */
+  const int d0 = 0, d1 = 1;
+  float *refL = farray_calloc(n), *refR = farray_calloc(n);
+  float *newL = farray_calloc(n), *newR = farray_calloc(n);
+  float *y = farray_calloc(n);
+  for (size_t s = 0; s < nsrc; s++) {
+    const size_t d = s % ndirs;
+    const float g = 1.0f / (s + 1);
+    const float *hL = (s & 1 ? irs_R : irs_L) + d * irlen;
+    const float *hR = (s & 1 ? irs_L : irs_R) + d * irlen;
+    conv_direct(in + s * n, n, hL, irlen, y);
+    for (size_t t = 0; t < n; t++) { refL[t] += g * y[t]; }
+    conv_direct(in + s * n, n, hR, irlen, y);
+    for (size_t t = 0; t < n; t++) { refR[t] += g * y[t]; }
+  }
+  conv_direct(in, n, irs_L + d1 * irlen, irlen, newL);
+  conv_direct(in, n, irs_R + d1 * irlen, irlen, newR);
+  conv_direct(in, n, irs_L + d0 * irlen, irlen, y);
+  for (size_t t = 0; t < n; t++) { newL[t] -= y[t]; }
+  conv_direct(in, n, irs_R + d0 * irlen, irlen, y);
+  for (size_t t = 0; t < n; t++) { newR[t] -= y[t]; }
+
+  const float **ins = (const float**)calloc(nsrc, sizeof(float*));
+  float *outL = farray_calloc(B), *outR = farray_calloc(B);
+  float err = 0;
+  for (size_t b = 0; b < nblk; b++) {
+    if (b == change_blk) { a3d_conv_source_set(&conv, 0, d1, 0, 1.0f); }
+    for (size_t s = 0; s < nsrc; s++) { ins[s] = in + s * n + b * B; }
+    a3d_conv_process(&conv, ins, outL, outR);
+    for (size_t i = 0; i < B; i++) {
+      const size_t t = b * B + i;
+      const float w = b < change_blk ? 0 : b > change_blk ? 1 : (float)(i + 1) / B;
+      err = MAX2(err, fabsf(outL[i] - (refL[t] + w * newL[t])));
+      err = MAX2(err, fabsf(outR[i] - (refR[t] + w * newR[t])));
+    }
+  }
+
+  printf("a3d_conv B:%zd irlen:%zd nsrc:%zd max error:%g: %s\n",
+         B, irlen, nsrc, err, err < 1e-3 ? "OK" : "FAIL");
+
+  a3d_conv_clear(&conv);
+  a3d_conv_bank_clear(&bank);
+  free(ins); free(outL); free(outR);
+  free(in); free(refL); free(refR); free(newL); free(newR); free(y);
+  free(irs_L); free(irs_R);
+  return err >= 1e-3;
+}
+
+/*! Report how many moving sources one core renders in real time. */
+void
+bench_a3d_conv(size_t B, size_t irlen, size_t nsrc, int srate)
+{
+  const size_t ndirs = 368, nblk = 200;
+  float *irs_L = farray_calloc(ndirs * irlen);
+  float *irs_R = farray_calloc(ndirs * irlen);
+  for (size_t i = 0; i < ndirs * irlen; i++) { irs_L[i] = frand(); irs_R[i] = frand(); }
+  A3dConvBank bank;
+  A3dConv conv;
+  a3d_conv_bank_init(&bank, B, irs_L, irs_R, ndirs, irlen);
+  a3d_conv_init(&conv, &bank, nsrc);
+
+  float *in = farray_calloc(B);
+  for (size_t i = 0; i < B; i++) { in[i] = frand(); }
+  const float **ins = (const float**)calloc(nsrc, sizeof(float*));
+  for (size_t s = 0; s < nsrc; s++) { ins[s] = in; }
+  float *outL = farray_calloc(B), *outR = farray_calloc(B);
+
+  const clock_t c0 = clock();
+  for (size_t b = 0; b < nblk; b++) {
+    for (size_t s = 0; s < nsrc; s++) {
+      a3d_conv_source_set(&conv, s, (s * 7 + b / 4) % ndirs, 0, 1.0f); /* move every 4th block */
+    }
+    a3d_conv_process(&conv, ins, outL, outR);
+  }
+  const double sec = (double)(clock() - c0) / CLOCKS_PER_SEC;
+  const double rt = (double)nblk * B / srate;
+  printf("a3d_conv B:%zd irlen:%zd: %zd moving sources in %.3fx real time => %.0f sources per core at %d Hz\n",
+         B, irlen, nsrc, sec / rt, nsrc * rt / sec, srate);
+
+  a3d_conv_clear(&conv);
+  a3d_conv_bank_clear(&bank);
+  free(ins); free(in); free(outL); free(outR);
+  free(irs_L); free(irs_R);
+}
+
+int
+main(int argc, char *argv[])
+{
+  int err = 0;
+  err |= test_a3d_conv(4, 1, 2, 1, 4);
+  err |= test_a3d_conv(64, 128, 4, 3, 16);
+  err |= test_a3d_conv(32, 200, 5, 4, 20);
+  bench_a3d_conv(128, 128, 256, 48000);
+  bench_a3d_conv(64, 512, 256, 48000);
+  return err;
+}
@@ -0,0 +1,172 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "../utils.h"
+#include "../extremes.h"
+#include "../alz_engine.h"
+
+/* ---------------------------- Group Separator ---------------------------- */
+
+#define QTEST_N (1 << 20)
+
+static void *
+queue_producer(void * arg)
+{
+  AlzQueue *q = (AlzQueue*)arg;
+  AlzCmd cmd;
+  memset(&cmd, 0, sizeof(cmd));
+  for (uint32_t i = 1; i <= QTEST_N;) {
+    cmd.id = i;
+    if (alz_queue_push(q, &cmd)) { i++; } else { sched_yield(); }
+  }
+  return NULL;
+}
+
+/*! Pass \c QTEST_N commands between two threads through a small queue and
+ * check that they arrive complete and in order.
+ */
+int
+test_alz_queue(void)
+{
+  AlzQueue q;
+  alz_queue_init(&q, 13);
+  pthread_t thr;
+  pthread_create(&thr, NULL, queue_producer, &q);
+  uint32_t expect = 1, nbad = 0;
+  AlzCmd cmd;
+  while (expect <= QTEST_N) {
+    if (alz_queue_pop(&q, &cmd)) {
+      nbad += cmd.id != expect;
+      expect++;
+    } else {
+      sched_yield();
+    }
+  }
+  pthread_join(thr, NULL);
+  nbad += alz_queue_pop(&q, &cmd);
+  alz_queue_clear(&q);
+  printf("alz_queue %d commands, %u out of order: %s\n",
+         QTEST_N, nbad, nbad ? "FAIL" : "OK");
+  return nbad != 0;
+}
+
+/* ---------------------------- Group Separator ---------------------------- */
+
+/*! Render \p nvoices unfaded voices and compare with the stereo model of
+ * alz3d_getSample() evaluated directly.
+ */
+int
+test_alz_engine_stereo(uint srate, size_t B, size_t nvoices, size_t nblk)
+{
+  AlzEngine eng;
+  alz_engine_init(&eng, srate, B, nvoices, 64);
+  float *wfq = (float*)calloc(nvoices, sizeof(float));
+  float *azim = (float*)calloc(nvoices, sizeof(float));
+  const float amp = 1.0f / nvoices;
+  for (size_t v = 0; v < nvoices; v++) {
+    wfq[v] = 100 + 37 * v;
+    azim[v] = (float)(v * 360) / nvoices;
+    alz_engine_add(&eng, wfq[v], 1000, azim[v], amp, ALZ3D_WAVE_SINE, ALZ3D_FADE_NONE);
+  }
+  const float etr = 0.075f / 340.29f;
+  float err = 0;
+  for (size_t b = 0; b < nblk; b++) {
+    alz_engine_render(&eng);
+    for (size_t i = 0; i < B; i++) {
+      const double t = (double)(b * B + i) / srate;
+      double yL = 0, yR = 0;
+      for (size_t v = 0; v < nvoices; v++) {
+        const double azim_cos = cos(float_azim2rad(azim[v]));
+        const double dtd = etr * azim_cos;
+        yL += amp * (1 - azim_cos) / 2 * sin(M_2PI * wfq[v] * (t + dtd));
+        yR += amp * (1 + azim_cos) / 2 * sin(M_2PI * wfq[v] * (t - dtd));
+      }
+      err = MAX2(err, fabs(eng.out[2*i + 0] - yL));
+      err = MAX2(err, fabs(eng.out[2*i + 1] - yR));
+    }
+  }
+  printf("alz_engine stereo B:%zd voices:%zd samples:%zd max error:%g: %s\n",
+         B, nvoices, nblk * B, err, err < 1e-3 ? "OK" : "FAIL");
+  free(wfq); free(azim);
+  alz_engine_clear(&eng);
+  return err >= 1e-3;
+}
+
+/*! Check that voices end on time, that removal releases them within a
+ * block and that the pool stays dense.
+ */
+int
+test_alz_engine_remove(void)
+{
+  const uint srate = 48000;
+  const size_t B = 64;
+  AlzEngine eng;
+  alz_engine_init(&eng, srate, B, 20, 64);
+  int fail = 0;
+
+  uint32_t ids[20];
+  for (size_t v = 0; v < 20; v++) {
+    ids[v] = alz_engine_add(&eng, 440, v < 10 ? (float)(4 * B) / srate : 1000, 90, 0.01f,
+                            ALZ3D_WAVE_SINE, ALZ3D_FADE_OUT);
+  }
+  alz_engine_render(&eng);
+  fail |= eng.nactive != 20;
+  for (size_t b = 0; b < 4; b++) { alz_engine_render(&eng); }
+  fail |= eng.nactive != 10;    /* short voices ended */
+
+  alz_engine_remove(&eng, ids[12]);
+  alz_engine_remove(&eng, ids[15]);
+  alz_engine_render(&eng);
+  fail |= eng.nactive != 8;
+  for (size_t v = 0; v < eng.nactive; v++) {
+    fail |= eng.voices[v].id == ids[12] || eng.voices[v].id == ids[15];
+  }
+
+  alz_engine_remove(&eng, 0);
+  alz_engine_render(&eng);
+  fail |= eng.nactive != 0;
+  alz_engine_render(&eng);
+  float peak = 0;
+  for (size_t i = 0; i < 2 * B; i++) { peak = MAX2(peak, fabsf(eng.out[i])); }
+  fail |= peak != 0;
+
+  printf("alz_engine remove: %s\n", fail ? "FAIL" : "OK");
+  alz_engine_clear(&eng);
+  return fail;
+}
+
+/*! Report how many voices one core renders in real time. */
+void
+bench_alz_engine(uint srate, size_t B, size_t nvoices)
+{
+  const size_t nblk = 2000;
+  AlzEngine eng;
+  alz_engine_init(&eng, srate, B, nvoices, nvoices);
+  for (size_t v = 0; v < nvoices; v++) {
+    alz_engine_add(&eng, 100 + v, 1000, v % 360, 1.0f / nvoices,
+                   ALZ3D_WAVE_SINE, ALZ3D_FADE_INOUT);
+  }
+  const clock_t c0 = clock();
+  for (size_t b = 0; b < nblk; b++) { alz_engine_render(&eng); }
+  const double sec = (double)(clock() - c0) / CLOCKS_PER_SEC;
+  const double rt = (double)nblk * B / srate;
+  printf("alz_engine B:%zd: %zd voices in %.3fx real time => %.0f voices per core at %u Hz\n",
+         B, nvoices, sec / rt, nvoices * rt / sec, srate);
+  alz_engine_clear(&eng);
+}
+
+int
+main(int argc, char *argv[])
+{
+  int err = 0;
+  err |= test_alz_queue();
+  err |= test_alz_engine_stereo(44100, 64, 1, 100);
+  err |= test_alz_engine_stereo(48000, 128, 13, 200);
+  err |= test_alz_engine_remove();
+  bench_alz_engine(48000, 128, 1024);
+  return err;
+}
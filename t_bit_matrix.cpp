@@ -2,6 +2,7 @@
 #include "hamming_distance.hpp"
 #include "show.hpp"
 #include "bit_matrix.hpp"
+#include "conn_matrix.hpp"
 
 using std::cout;
 using std::endl;
@@ -21,13 +22,77 @@ void test_bit_matrix()
     bit_xor(c, a, b);
     cout << "c: " << c << endl;
 
-    cout << "hamming_distance: " << pnw::hamming_distance(a, b) << endl;
+    cout << "hamming_distance: " << hamming_distance(a, b) << endl;
 }
 
-int main(int argc, char *argv[])
+void test_bool_mul(size_t m, size_t k, size_t n)
 {
-    while (true)
+    bit_matrix b(m, k), c(k, n), a;
+    b.rand();
+    c.rand();
+    bool_mul(a, b, c);
+    size_t err = 0;
+    for (size_t i = 0; i < m; i++)
     {
-        test_bit_matrix();
+        for (size_t j = 0; j < n; j++)
+        {
+            bool x = false;
+            for (size_t l = 0; l < k; l++) { x = x or (b(i, l) and c(l, j)); }
+            err += (x != a(i, j));
+        }
     }
+    cout << "bool_mul " << m << "x" << k << " * " << k << "x" << n
+         << ": " << (err ? "FAIL" : "OK") << endl;
+}
+
+void test_transpose(size_t m, size_t n)
+{
+    bit_matrix b(m, n), a;
+    b.rand();
+    transpose(a, b);
+    size_t err = (a.n_rows() != n or a.n_cols() != m);
+    for (size_t i = 0; not err and i < m; i++)
+    {
+        for (size_t j = 0; j < n; j++) { err += (a(j, i) != b(i, j)); }
+    }
+    cout << "transpose " << m << "x" << n << ": " << (err ? "FAIL" : "OK") << endl;
+}
+
+void test_transitive_closure(size_t n, size_t e)
+{
+    conn_matrix g(n);
+    g.randomly_set_n_ones(e);
+
+    // Reference: Warshall.
+    conn_matrix r(g);
+    for (size_t k = 0; k < n; k++)
+    {
+        for (size_t i = 0; i < n; i++)
+        {
+            if (r(i, k)) { pnw::bitwords::ip_or_n(r.row_words(i), r.row_words(k), r.n_row_words()); }
+        }
+    }
+
+    conn_matrix c(g);
+    c.transitive_closure();
+    size_t err = hamming_distance(c, r);
+    for (size_t i = 0; i < n; i++)
+    {
+        const std::vector<bit_matrix::word_type> s = g.reachable_from(i);
+        err += pnw::bitwords::popcount_xor_n(s.data(), r.row_words(i), r.n_row_words());
+    }
+    cout << "transitive_closure n:" << n << " e:" << e << ": " << (err ? "FAIL" : "OK") << endl;
+}
+
+int main(int argc, char *argv[])
+{
+    test_bit_matrix();
+    test_bool_mul(13, 70, 9);
+    test_bool_mul(100, 131, 257);
+    test_transpose(7, 5);
+    test_transpose(130, 67);
+    test_transitive_closure(1, 1);
+    test_transitive_closure(70, 60);
+    test_transitive_closure(300, 400);
+    return 0;
 }
@@ -0,0 +1,83 @@
+#include "../bitvec_rs.h"
+#include "../elias_fano.h"
+#include "../stdio_x.h"
+
+#include <stdlib.h>
+
+int
+test_bitvec_rs(size_t l, int density)
+{
+  Bitvec a;
+  bitvec_initZ(&a, l);
+  for (size_t i = 0; i < l; i++) {
+    if (rand() % 100 < density) { bitvec_set1(&a, i); }
+  }
+
+  Bitvec_RS rs;
+  bitvec_rs_init(&rs, &a);
+
+  size_t c = 0, err = 0;
+  for (size_t i = 0; i <= l; i++) {
+    if (bitvec_rs_rank1(&rs, i) != c) { err++; }
+    if (i < l && bitvec_get(&a, i)) {
+      if (bitvec_rs_select1(&rs, c) != i) { err++; }
+      c++;
+    }
+  }
+  if (bitvec_rs_select1(&rs, c) != l) { err++; }
+
+  printf("bitvec_rs l:%zd density:%d%% ones:%zd bytes:%zd: %s\n",
+         l, density, rs.ones, bitvec_rs_bytesize(&rs), err ? "FAIL" : "OK");
+
+  bitvec_rs_clear(&rs);
+  bitvec_clear(&a);
+  return err != 0;
+}
+
+static int
+uint64_cmp(const void * p, const void * q)
+{
+  const uint64_t a = *(const uint64_t*)p, b = *(const uint64_t*)q;
+  return (a > b) - (a < b);
+}
+
+int
+test_elias_fano(size_t n, uint64_t u)
+{
+  uint64_t * x = (uint64_t*)malloc(n * sizeof(uint64_t));
+  for (size_t i = 0; i < n; i++) { x[i] = (uint64_t)rand() % u; }
+  qsort(x, n, sizeof(uint64_t), uint64_cmp);
+
+  EliasFano ef;
+  elias_fano_init(&ef, x, n, u);
+
+  size_t err = 0;
+  for (size_t i = 0; i < n; i++) {
+    if (elias_fano_get(&ef, i) != x[i]) { err++; }
+    const size_t j = elias_fano_lower_bound(&ef, x[i]);
+    if (j > i || x[j] != x[i]) { err++; }
+  }
+
+  printf("elias_fano n:%zd u:%lu bytes:%zd (vs %zd): %s\n",
+         n, (ulong)u, elias_fano_bytesize(&ef), n * sizeof(size_t),
+         err ? "FAIL" : "OK");
+
+  elias_fano_clear(&ef);
+  free(x);
+  return err != 0;
+}
+
+int
+main(int argc, char *argv[])
+{
+  int err = 0;
+  err |= test_bitvec_rs(0, 50);
+  err |= test_bitvec_rs(1, 100);
+  err |= test_bitvec_rs(512, 100);
+  err |= test_bitvec_rs(100000, 50);
+  err |= test_bitvec_rs(100000, 1);
+  err |= test_elias_fano(1, 1);
+  err |= test_elias_fano(1000, 1000);
+  err |= test_elias_fano(100000, 1u << 30);
+  return err;
+}
@@ -0,0 +1,65 @@
+/*!
+ * \file t_bytestats.cpp
+ * \brief Test Byte Content Statistics.
+ */
+
+#include <iostream>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+#include <algorithm>
+
+#include "bytestats.hpp"
+
+using std::cout;
+using std::endl;
+
+/// Check \p x added in random chunks against a plain histogram.
+int test_byte_stats(const std::vector<uint8_t>& x, const char* name, bool binary)
+{
+    pnw::byte_stats s;
+    auto t0 = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < x.size();) {
+        const size_t m = std::min<size_t>(1 + rand() % 100000, x.size() - i);
+        s.add(x.data() + i, m);
+        i += m;
+    }
+    const double h = s.entropy();
+    auto t1 = std::chrono::steady_clock::now();
+
+    uint64_t ref[256] = {};
+    for (auto b : x) { ref[b]++; }
+    double href = 0;
+    for (size_t i = 0; i < 256; i++) {
+        if (ref[i]) { const double p = double(ref[i]) / x.size(); href -= p * std::log2(p); }
+    }
+    const uint64_t lines = ref[size_t('\n')] + (not x.empty() and x.back() != '\n');
+
+    size_t nbad = (s.bytes() != x.size() or s.lines() != lines or
+                   std::abs(h - href) > 1e-9 or s.is_binary() != binary);
+    for (size_t i = 0; i < 256; i++) { nbad += s[i] != ref[i]; }
+    const double sec = std::chrono::duration<double>(t1 - t0).count();
+    cout << "byte_stats " << name << " n:" << x.size() << " lines:" << s.lines()
+         << " entropy:" << h << " binary:" << s.is_binary()
+         << " " << x.size() / sec * 1e-6 << " MB/s"
+         << (nbad ? ": FAIL" : ": OK") << endl;
+    return nbad != 0;
+}
+
+int main(int argc, const char * argv[], const char * envp[])
+{
+    int ret = 0;
+    std::vector<uint8_t> text(1 << 24);
+    for (size_t i = 0; i < text.size(); i++) {
+        text[i] = (i % 80 == 79) ? '\n' : (rand() % 7 == 0) ? ' ' : 'a' + rand() % 26;
+    }
+    ret |= test_byte_stats(text, "text", false);
+    std::vector<uint8_t> runs(1 << 24, ' ');
+    ret |= test_byte_stats(runs, "runs", false);
+    std::vector<uint8_t> bin(1 << 20);
+    for (auto& b : bin) { b = rand(); }
+    ret |= test_byte_stats(bin, "random", true);
+    ret |= test_byte_stats(std::vector<uint8_t>(), "empty", false);
+    return ret;
+}
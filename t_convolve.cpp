@@ -1,4 +1,7 @@
 #include <iostream>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
 
 #include "algorithm_x.hpp"
 #include "show.hpp"
@@ -19,8 +22,167 @@ void test_convolve(int bn = 8, int cn = 4)
     cout << c << endl;
 }
 
+template<typename T>
+std::vector<T> random_vector(size_t n, int range)
+{
+    std::vector<T> x(n);
+    for (auto& e : x) { e = T(rand() % (2 * range + 1) - range); }
+    return x;
+}
+
+/// Reference product computed in double.
+template<typename T>
+std::vector<double> reference(const std::vector<T>& a, const std::vector<T>& b)
+{
+    std::vector<double> r(a.size() + b.size() - 1, 0);
+    for (size_t i = 0; i < a.size(); i++) {
+        for (size_t j = 0; j < b.size(); j++) { r[i + j] += double(a[i]) * b[j]; }
+    }
+    return r;
+}
+
+/// Check every algorithm on \p na by \p nb with small integer values, so
+/// that the exact result is known.
+template<typename T>
+int test_convolve_algorithms(size_t na, size_t nb)
+{
+    const std::vector<T> a = random_vector<T>(na, 5), b = random_vector<T>(nb, 5);
+    const std::vector<double> r = reference(a, b);
+    std::vector<T> out(na + nb - 1);
+    double err[4] = { 0, 0, 0, 0 };
+    for (int alg = 0; alg < 4; alg++) {
+        if (alg == 2 && !std::is_floating_point<T>::value) { continue; }
+        switch (alg) {
+        case 0: pnw::convolve_direct(out.data(), a.data(), na, b.data(), nb); break;
+        case 1: pnw::convolve_karatsuba(out.data(), a.data(), na, b.data(), nb); break;
+        case 2: pnw::convolve_fft(out.data(), a.data(), na, b.data(), nb); break;
+        case 3: pnw::convolve(out.data(), a.data(), na, b.data(), nb); break;
+        }
+        for (size_t i = 0; i < r.size(); i++) { err[alg] = std::max(err[alg], std::abs(double(out[i]) - r[i])); }
+    }
+    const double tol = std::is_floating_point<T>::value ? 1e-6 * std::sqrt(double(na * nb)) : 0;
+    const bool ok = err[0] <= tol && err[1] <= tol && err[2] <= tol && err[3] <= tol;
+    cout << "convolve " << na << "x" << nb << " errors direct:" << err[0] << " karatsuba:" << err[1]
+         << " fft:" << err[2] << " auto:" << err[3] << (ok ? ": OK" : ": FAIL") << endl;
+    return !ok;
+}
+
+int test_convolve2d(size_t ha, size_t wa, size_t hb, size_t wb)
+{
+    const std::vector<double> a = random_vector<double>(ha * wa, 9), b = random_vector<double>(hb * wb, 9);
+    const size_t H = ha + hb - 1, W = wa + wb - 1;
+    std::vector<double> out(H * W), ref(H * W, 0);
+    pnw::convolve2d(out.data(), a.data(), ha, wa, b.data(), hb, wb);
+    for (size_t i = 0; i < ha; i++) {
+        for (size_t j = 0; j < wa; j++) {
+            for (size_t k = 0; k < hb; k++) {
+                for (size_t l = 0; l < wb; l++) { ref[(i + k) * W + j + l] += a[i * wa + j] * b[k * wb + l]; }
+            }
+        }
+    }
+    double e = 0;
+    for (size_t i = 0; i < H * W; i++) { e = std::max(e, std::abs(out[i] - ref[i])); }
+    cout << "convolve2d " << ha << "x" << wa << " by " << hb << "x" << wb << " max error:" << e
+         << (e < 1e-6 ? ": OK" : ": FAIL") << endl;
+    return e >= 1e-6;
+}
+
+int test_convolve_ntt(size_t na, size_t nb)
+{
+    std::vector<uint32_t> a(na), b(nb);
+    for (auto& e : a) { e = rand() & 0xffff; }
+    for (auto& e : b) { e = rand() & 0xffff; }
+    std::vector<uint64_t> out(na + nb - 1), ref(na + nb - 1, 0);
+    pnw::convolve_ntt(out.data(), a.data(), na, b.data(), nb);
+    for (size_t i = 0; i < na; i++) {
+        for (size_t j = 0; j < nb; j++) { ref[i + j] += uint64_t(a[i]) * b[j]; }
+    }
+    const bool ok = out == ref;
+
+    // 12345678901234567890 * 98765432109876543210 in base 10
+    const char* x = "12345678901234567890", * y = "98765432109876543210";
+    std::vector<uint32_t> dx, dy, dz(40);
+    for (size_t i = 20; i-- > 0;) { dx.push_back(x[i] - '0'); dy.push_back(y[i] - '0'); }
+    pnw::multiply_digits(dz.data(), dx.data(), 20, dy.data(), 20, 10);
+    std::string z;
+    for (size_t i = 40; i-- > 0;) { if (!z.empty() || dz[i]) { z += char('0' + dz[i]); } }
+    const bool ok2 = z == "1219326311370217952237463801111263526900";
+    cout << "convolve_ntt " << na << "x" << nb << (ok ? " exact" : " WRONG") << ", multiply_digits "
+         << z << ((ok && ok2) ? ": OK" : ": FAIL") << endl;
+    return !(ok && ok2);
+}
+
+/// Check sampled outputs of a product longer than the transforms of convolve_ntt().
+int test_convolve_ntt_long(size_t na, size_t nb, size_t nsamples = 64)
+{
+    std::vector<uint32_t> a(na), b(nb);
+    for (auto& e : a) { e = rand() & 0xffff; }
+    for (auto& e : b) { e = rand() & 0xffff; }
+    std::vector<uint64_t> out(na + nb - 1);
+    pnw::convolve_ntt(out.data(), a.data(), na, b.data(), nb);
+    size_t nbad = 0;
+    for (size_t s = 0; s < nsamples; s++) {
+        const size_t k = (s == 0) ? 0 : (s == 1) ? out.size() - 1 : size_t(rand()) % out.size();
+        uint64_t ref = 0;
+        for (size_t i = (k >= nb ? k - nb + 1 : 0); i < na && i <= k; i++) { ref += uint64_t(a[i]) * b[k - i]; }
+        nbad += out[k] != ref;
+    }
+    cout << "convolve_ntt " << na << "x" << nb << " " << nbad << " of " << nsamples << " sampled outputs wrong"
+         << (nbad ? ": FAIL" : ": OK") << endl;
+    return nbad != 0;
+}
+
+/// Time the automatic choice against the direct loops for n by n.
+void bench_convolve(size_t n, bool direct)
+{
+    const std::vector<double> a = random_vector<double>(n, 100), b = random_vector<double>(n, 100);
+    std::vector<double> out(2 * n - 1);
+    auto t0 = std::chrono::steady_clock::now();
+    pnw::convolve(out.data(), a.data(), n, b.data(), n);
+    auto t1 = std::chrono::steady_clock::now();
+    cout << "convolve " << n << "x" << n << " auto:" << std::chrono::duration<double>(t1 - t0).count() << " s";
+    if (direct) {
+        t0 = std::chrono::steady_clock::now();
+        pnw::convolve_direct(out.data(), a.data(), n, b.data(), n);
+        t1 = std::chrono::steady_clock::now();
+        cout << " direct:" << std::chrono::duration<double>(t1 - t0).count() << " s";
+    }
+    cout << endl;
+}
+
+/// Time 2-D convolution of an \p n x \p n image by a \p k x \p k kernel.
+void bench_convolve2d(size_t n, size_t k)
+{
+    const std::vector<double> a = random_vector<double>(n * n, 100), b = random_vector<double>(k * k, 100);
+    std::vector<double> out((n + k - 1) * (n + k - 1));
+    auto t0 = std::chrono::steady_clock::now();
+    pnw::convolve2d(out.data(), a.data(), n, n, b.data(), k, k);
+    auto t1 = std::chrono::steady_clock::now();
+    cout << "convolve2d " << n << "x" << n << " by " << k << "x" << k << ": "
+         << std::chrono::duration<double>(t1 - t0).count() << " s" << endl;
+}
+
 int main(int argc, char *argv[])
 {
+    int ret = 0;
     test_convolve<int>();
-    return 0;
+    ret |= test_convolve_algorithms<double>(1, 1);
+    ret |= test_convolve_algorithms<double>(100, 7);
+    ret |= test_convolve_algorithms<double>(333, 257);
+    ret |= test_convolve_algorithms<double>(5000, 300);
+    ret |= test_convolve_algorithms<float>(1000, 1000);
+    ret |= test_convolve_algorithms<int>(1000, 999);
+    ret |= test_convolve_algorithms<int64_t>(77, 3000);
+    ret |= test_convolve2d(1, 1, 1, 1);
+    ret |= test_convolve2d(30, 40, 5, 5);
+    ret |= test_convolve2d(64, 64, 33, 17);
+    ret |= test_convolve2d(3, 3, 100, 80);
+    ret |= test_convolve2d(200, 150, 19, 21);
+    ret |= test_convolve_ntt(1000, 1500);
+    ret |= test_convolve_ntt_long((1 << 22) + 1, (1 << 22) + 1);
+    bench_convolve2d(1000, 3);
+    bench_convolve2d(1000, 31);
+    bench_convolve(20000, true);
+    bench_convolve(1000000, false);
+    return ret;
 }
@@ -101,6 +101,37 @@ int test_levenshtein()
             test_levenshtein_performance<T, D>(uirange(10000,10001)));
 }
 
+/*! Cross-check bit-parallel, banded and batch unit-cost distances. */
+int test_levenshtein_myers()
+{
+    using namespace pnw::distance;
+    auto rs = [](size_t n) { std::string s; for (size_t i = 0; i < n; i++) { s += 'a' + rand() % 4; } return s; };
+    int ret = 0;
+    for (size_t i = 0; i < 1000; i++) {
+        const std::string s = rs(rand() % 150), t = rs(rand() % 150);
+        const size_t d = levenshtein(s, t, std::numeric_limits<size_t>::max(), size_t(1), size_t(1), size_t(1));
+        const size_t k = rand() % 40;
+        ret += not (levenshtein_myers(s, t) == d);
+        ret += not (levenshtein_myers(s, t, k) == std::min(d, k+1));
+        ret += not (levenshtein_banded(s, t, k) == std::min(d, k+1));
+        ret += not (levenshtein_banded(s, t, std::numeric_limits<size_t>::max()) == d); // k + 1 must not wrap
+        ret += not (levenshtein_myers(s, t, std::numeric_limits<size_t>::max()) == d);
+    }
+    const std::string q = rs(20);
+    std::vector<std::string> cands;
+    for (size_t i = 0; i < 1000; i++) { cands.push_back(rs(rand() % 40)); }
+    const std::vector<size_t> ds = levenshtein_batch(q, cands, 10);
+    for (size_t i = 0; i < cands.size(); i++) {
+        ret += not (ds[i] == levenshtein_banded(q, cands[i], 10));
+    }
+    const std::vector<size_t> ds_max = levenshtein_batch(q, cands, std::numeric_limits<size_t>::max());
+    for (size_t i = 0; i < cands.size(); i++) {
+        ret += not (ds_max[i] == levenshtein_banded(q, cands[i], std::numeric_limits<size_t>::max()));
+    }
+    cout << __FUNCTION__ << ": " << (ret ? "FAILURE" : "SUCCESS") << endl;
+    return ret;
+}
+
 template<class D = size_t>
 int test_levenshtein_all()
 {
@@ -111,5 +142,6 @@ int test_levenshtein_all()
 int main(int argc, char *argv[])
 {
     return (test_levenshtein_all<uint32_t>() +
-            test_levenshtein_all<uint64_t>());
+            test_levenshtein_all<uint64_t>() +
+            test_levenshtein_myers());
 }
@@ -1,27 +1,145 @@
 /*!
  * \file t_emd.cpp
- * \brief
+ * \brief Test Empirical Mode Decomposition.
  */
 
 #include <iostream>
-#include <string>
+#include <chrono>
+#include <cmath>
+#include <vector>
 
-#include "randomize.hpp"
 #include "emd.hpp"
-#include "fshow.hpp"
-#include <vector>
-#include <iomanip>
 
 using std::cout;
 using std::endl;
 
+/// Max abs difference between \p x and the sum of functions \p f(i).
+template<class T, class D>
+T reconstruction_error(const D& d, const T* x, size_t n)
+{
+    T err = 0;
+    for (size_t k = 0; k < n; k++) {
+        T s = 0;
+        for (size_t i = 0; i < d.nfuns(); i++) { s += d.imf(i)[k]; }
+        err = std::max(err, std::abs(s - x[k]));
+    }
+    return err;
+}
+
+/// Test signal: fast tone, slow tone and linear trend.
+template<class T>
+std::vector<T> tones(size_t n, std::vector<T>* fast = nullptr)
+{
+    std::vector<T> x(n);
+    if (fast) { fast->resize(n); }
+    for (size_t k = 0; k < n; k++) {
+        const T f = std::sin(T(2*M_PI) * k / 16);
+        x[k] = f + T(2) * std::sin(T(2*M_PI) * k / 200) + T(k) / n;
+        if (fast) { (*fast)[k] = f; }
+    }
+    return x;
+}
+
+template<class T>
+int test_emd(size_t n)
+{
+    int ret = 0;
+    std::vector<T> fast;
+    const std::vector<T> x = tones<T>(n, &fast);
+    pnw::emd<T> e(4, 10);
+    e.decompose(x.data(), n);
+
+    const T rerr = reconstruction_error(e, x.data(), n);
+    T ferr = 0;                 // first IMF away from ends should be the fast tone
+    for (size_t k = n/8; k < n - n/8; k++) { ferr = std::max(ferr, std::abs(e.imf(0)[k] - fast[k])); }
+    const bool ok = rerr < 1e-4 and ferr < 0.05 and e.nimfs() >= 2;
+    cout << "emd n:" << n << " imfs:" << e.nimfs()
+         << " reconstruction error:" << rerr << " fast tone error:" << ferr
+         << (ok ? ": OK" : ": FAIL") << endl;
+    ret |= !ok;
+
+    e.decompose(x.data(), n / 2); // reuse workspace at other size
+    ret |= reconstruction_error(e, x.data(), n / 2) >= 1e-4;
+    return ret;
+}
+
+/// Locality below the spacing of all extrema must not change the decomposition.
+template<class T>
+int test_emd_locality(size_t n)
+{
+    const std::vector<T> x = tones<T>(n); // first maximum at index 4, extrema 8 apart
+    pnw::emd<T> e0(4, 10), el(4, 10, 5);
+    e0.decompose(x.data(), n);
+    el.decompose(x.data(), n);
+    T derr = 0;
+    for (size_t i = 0; i < e0.nfuns(); i++) {
+        for (size_t k = 0; k < n; k++) { derr = std::max(derr, std::abs(e0.imf(i)[k] - el.imf(i)[k])); }
+    }
+    const bool ok = derr == 0;
+    cout << "emd locality:5 difference:" << derr << (ok ? ": OK" : ": FAIL") << endl;
+    return !ok;
+}
+
+template<class T>
+int test_eemd(size_t n, size_t nens)
+{
+    const std::vector<T> x = tones<T>(n);
+    pnw::eemd<T> e1(5, 10, nens, T(0.2), 1, true, 1);
+    pnw::eemd<T> en(5, 10, nens, T(0.2), 1, true);
+    auto t0 = std::chrono::steady_clock::now();
+    e1.decompose(x.data(), n);
+    auto t1 = std::chrono::steady_clock::now();
+    en.decompose(x.data(), n);
+    auto t2 = std::chrono::steady_clock::now();
+
+    T derr = 0;                 // threading must not change the result beyond rounding
+    for (size_t i = 0; i < e1.nfuns(); i++) {
+        for (size_t k = 0; k < n; k++) { derr = std::max(derr, std::abs(e1.imf(i)[k] - en.imf(i)[k])); }
+    }
+    const T rerr = reconstruction_error(en, x.data(), n);
+    const bool ok = rerr < 1e-3 and derr < 1e-4;
+    cout << "eemd n:" << n << " ensemble:" << nens
+         << " reconstruction error:" << rerr << " thread difference:" << derr
+         << " 1 thread:" << std::chrono::duration<double>(t1 - t0).count() << "s"
+         << " " << std::thread::hardware_concurrency() << " threads:"
+         << std::chrono::duration<double>(t2 - t1).count() << "s"
+         << (ok ? ": OK" : ": FAIL") << endl;
+    return !ok;
+}
+
+template<class T>
+int test_emd_stream(size_t n, size_t window, size_t hop, size_t chunk)
+{
+    const std::vector<T> x = tones<T>(n);
+    pnw::emd_stream<T> s(pnw::emd<T>(4, 10), window, hop);
+    std::vector<T> sum;
+    auto sink = [&](const T* const* imfs, size_t nf, size_t len) {
+        for (size_t k = 0; k < len; k++) {
+            T v = 0;
+            for (size_t i = 0; i < nf; i++) { v += imfs[i][k]; }
+            sum.push_back(v);
+        }
+    };
+    for (size_t k = 0; k < n; k += chunk) { s.push(x.data() + k, std::min(chunk, n - k), sink); }
+    s.flush(sink);
+
+    T err = sum.size() == n ? 0 : 1;
+    for (size_t k = 0; k < std::min(n, sum.size()); k++) { err = std::max(err, std::abs(sum[k] - x[k])); }
+    const bool ok = err < 1e-4;
+    cout << "emd_stream n:" << n << " window:" << window << " hop:" << hop
+         << " emitted:" << sum.size() << " reconstruction error:" << err
+         << (ok ? ": OK" : ": FAIL") << endl;
+    return !ok;
+}
+
 int main(int argc, const char * argv[], const char * envp[])
 {
-    n = 32;
-    std::vector<float> x(n);
-    pnw::rand_n(x, 0,1);
-    emd e(x);
-    rand(x,0,1);
-    cout << x << endl;
-    return 0;
+    int ret = 0;
+    ret |= test_emd<float>(1000);
+    ret |= test_emd<double>(4096);
+    ret |= test_emd_locality<double>(1000);
+    ret |= test_eemd<double>(4096, 100);
+    ret |= test_emd_stream<double>(10000, 1024, 512, 300);
+    ret |= test_emd_stream<float>(3001, 1000, 999, 77);
+    return ret;
 }
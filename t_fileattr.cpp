@@ -0,0 +1,95 @@
+/*!
+ * \file t_fileattr.cpp
+ * \brief Test Cached Extended Attributes.
+ */
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/xattr.h>
+#include <unistd.h>
+
+#include "semnet/fileattr.hpp"
+
+using namespace semnet::filesystem;
+using std::cout;
+using std::endl;
+
+size_t g_fails = 0;
+
+void check(const char * what, bool ok)
+{
+    g_fails += not ok;
+    cout << what << (ok ? " OK" : " FAIL") << endl;
+}
+
+/// Get value of attribute \p name as cached by \p xa, or "-errno" if none.
+std::string cached(XAttrs& xa, int fd, const char * name)
+{
+    char buf[256];
+    const int n = xa.get(fd, name, buf, sizeof(buf));
+    return n < 0 ? "-" + std::to_string(errno) : std::string(buf, n);
+}
+
+/// Get value of attribute \p name on \p fd, or "-errno" if none.
+std::string stored(int fd, const char * name)
+{
+    char buf[256];
+    const ssize_t n = ::fgetxattr(fd, name, buf, sizeof(buf));
+    return n < 0 ? "-" + std::to_string(errno) : std::string(buf, n);
+}
+
+struct timespec ctim_of(int fd)
+{
+    struct stat st;
+    ::fstat(fd, &st);
+    return st.st_ctim;
+}
+
+int main(int argc, const char * argv[], const char * envp[])
+{
+    char path[] = "/tmp/t_fileattr.XXXXXX";
+    const int fd = ::mkstemp(path);
+    if (fd < 0) { perror("mkstemp"); return EXIT_FAILURE; }
+    if (::fsetxattr(fd, "user.t.old", "old", 3, 0) != 0) {
+        cout << "No user extended attributes on " << path << ", skipped" << endl;
+        ::close(fd); ::unlink(path);
+        return EXIT_SUCCESS;
+    }
+    const std::string nodata = "-" + std::to_string(ENODATA);
+
+    XAttrs xa;
+    check("load", xa.load(fd, ctim_of(fd)) == 1 and xa.has("user.t.old") and not xa.has("user.t.new"));
+    check("fresh", xa.is_fresh(ctim_of(fd)));
+
+    // changes are held until flush
+    check("set", (xa.set("user.t.new", "new", 3, 0) == 0 and xa.is_dirty() and
+                  xa.has("user.t.new") and cached(xa, fd, "user.t.new") == "new" and
+                  stored(fd, "user.t.new") == nodata));
+    check("set create", xa.set("user.t.new", "x", 1, XATTR_CREATE) == -1 and errno == EEXIST);
+    check("set replace", xa.set("user.t.none", "x", 1, XATTR_REPLACE) == -1 and errno == ENODATA);
+    check("remove", (xa.remove("user.t.old") == 0 and not xa.has("user.t.old") and
+                     cached(xa, fd, "user.t.old") == nodata and stored(fd, "user.t.old") == "old"));
+    check("remove absent", xa.remove("user.t.none") == -1 and errno == ENODATA);
+    check("flush", (xa.flush(fd) == 2 and not xa.is_dirty() and
+                    stored(fd, "user.t.new") == "new" and stored(fd, "user.t.old") == nodata));
+    xa.stamp(ctim_of(fd));
+    check("stamped", xa.is_fresh(ctim_of(fd)));
+
+    // failed changes are dropped: stored values are read back, others vanish
+    std::string big(1 << 17, 'x');  // larger than any filesystem takes
+    check("failed flush", (xa.set("user.t.new", big.data(), big.size(), 0) == 0 and
+                           xa.set("bogus.t.cache", "c", 1, 0) == 0 and
+                           xa.flush(fd) == -1));
+    check("read back", xa.has("user.t.new") and cached(xa, fd, "user.t.new") == "new");
+    check("vanished", not xa.has("bogus.t.cache") and cached(xa, fd, "bogus.t.cache") == nodata);
+    check("names", xa.names().size() == 1);
+
+    ::close(fd);
+    ::unlink(path);
+    return g_fails ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,118 @@
+/*!
+ * \file t_filetype.cpp
+ * \brief Test File Type Classification.
+ */
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+#include "semnet/filetype.hpp"
+#include "semnet/filex.hpp"
+#include "semnet/regfile.hpp"
+
+using namespace semnet;
+using namespace semnet::filesystem;
+using namespace semnet::filesystem::gen;
+
+/// Write \p data to file \p name in \p dir, at offset \p off.
+void write_file(const std::string& dir, const char * name, const std::string& data, size_t off = 0)
+{
+    std::ofstream os(dir + "/" + name, std::ios::binary);
+    os << std::string(off, ' ') << data;
+}
+
+/// Get first type of \p types, in registration order, matching \p file.
+FileType * of_linear(const std::vector<FileType*>& types, RegFile * file)
+{
+    for (auto t : types) {
+        if (t->match(file)) { return t; }
+    }
+    return nullptr;
+}
+
+/*! Test that \c FileType::of(), which only matches candidates from its
+ * index, finds the same types as trying them all in order. */
+int test_filetype_of()
+{
+    using std::cout;
+    using std::endl;
+    char tmpl[] = "/tmp/t_filetype.XXXXXX";
+    if (not ::mkdtemp(tmpl)) { perror("mkdtemp"); return -1; }
+    const std::string dir(tmpl);
+
+    const std::string tar_magic("ustar" "\0" "00", 8);
+    const std::vector<const char*> names = { "a.tfx", "b.bin", "c.dat", "d.tfy", "e.tfy", "f.far", "g.txt" };
+    write_file(dir, "a.tfx", "hello");
+    write_file(dir, "b.bin", "TFMAGIC1 and more");
+    write_file(dir, "c.dat", tar_magic, 257);
+    write_file(dir, "d.tfy", "TFMAGIC2");
+    write_file(dir, "e.tfy", "no magic");
+    write_file(dir, "f.far", "TFFAR", 70000); // beyond indexed prefix
+    write_file(dir, "g.txt", "text");
+
+    std::vector<FileType*> types;
+    types.push_back(filetype_N(fnx("tfx"), DFMT_any_, "Name"));
+    types.push_back(filetype_C(seq(bob(), lit("TFMAGIC1")), DFMT_any_, "Magic"));
+    auto tar = seq();
+    tar->add_at_BOB(lit(tar_magic.data(), tar_magic.size()), bix(8*257));
+    types.push_back(filetype_C(tar, DFMT_any_, "Magic at Offset"));
+    types.push_back(filetype_NaC(fnx("tfy"), seq(bob(), lit("TFMAGIC2")), DFMT_any_, "Name and Magic"));
+    auto far = seq();
+    far->add_at_BOB(lit("TFFAR"), bix(8*70000));
+    types.push_back(filetype_C(far, DFMT_any_, "Far Magic"));
+
+    std::vector<RegFile*> files;
+    for (auto name : names) {
+        files.push_back(dynamic_cast<RegFile*>(File::load_path((dir + "/" + name).c_str())));
+    }
+
+    size_t err = 0;
+    const std::vector<int> expected = { 0, 1, 2, 3, -1, 4, -1 }; // index into types
+    for (size_t i = 0; i < files.size(); i++) {
+        if (not files[i]) { err++; continue; }
+        const auto hit = FileType::of(files[i]);
+        err += hit != of_linear(types, files[i]);
+        err += hit != (expected[i] >= 0 ? types[expected[i]] : nullptr);
+    }
+
+    // a new type invalidates the index
+    types.push_back(filetype_N(fnx("txt"), DFMT_any_, "Text"));
+    err += files.back() and FileType::of(files.back()) != types.back();
+
+    /* index may be invalidated and rebuilt while in use, the only shared
+     * state left to mutate as files and patterns are loaded above */
+    std::atomic<size_t> racy_err(0);
+    std::atomic<bool> done(false);
+    std::vector<std::thread> workers;
+    for (size_t t = 0; t < 4; t++) {
+        workers.emplace_back([&]() {
+                while (not done) {
+                    for (size_t i = 0; i < files.size(); i++) {
+                        if (files[i] and FileType::of(files[i]) != of_linear(types, files[i])) { racy_err++; }
+                    }
+                }
+            });
+    }
+    for (size_t k = 0; k < 1000; k++) { FileType::invalidate_index(); }
+    done = true;
+    for (auto& w : workers) { w.join(); }
+    err += racy_err;
+
+    for (auto name : names) { ::unlink((dir + "/" + name).c_str()); }
+    ::rmdir(dir.c_str());
+
+    cout << "FileType::of" << (err ? " FAIL" : " OK") << endl;
+    return err ? -1 : 0;
+}
+
+int main(int argc, const char * argv[], const char * envp[])
+{
+    return test_filetype_of() < 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
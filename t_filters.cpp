@@ -0,0 +1,222 @@
+/*!
+ * \file t_filters.cpp
+ * \brief Test Window Functions and the FIR/IIR Filter Engine.
+ */
+
+#include <iostream>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+#include "filters.hpp"
+
+using std::cout;
+using std::endl;
+
+template<class T>
+std::vector<T> random_vector(size_t n)
+{
+    std::vector<T> x(n);
+    for (auto& e : x) { e = T(2) * (T)rand() / RAND_MAX - 1; }
+    return x;
+}
+
+/// Direct FIR of the whole signal.
+template<class T>
+std::vector<T> fir_reference(const std::vector<T>& h, const std::vector<T>& x)
+{
+    std::vector<T> y(x.size());
+    for (size_t i = 0; i < x.size(); i++) {
+        double s = 0;
+        for (size_t j = 0; j < h.size() && j <= i; j++) { s += double(h[j]) * x[i - j]; }
+        y[i] = T(s);
+    }
+    return y;
+}
+
+template<class T>
+T max_abs_diff(const T* a, const T* b, size_t n)
+{
+    T e = 0;
+    for (size_t i = 0; i < n; i++) { e = std::max(e, std::abs(a[i] - b[i])); }
+    return e;
+}
+
+template<class T>
+int test_windows(size_t n)
+{
+    std::vector<T> a(n), b(n), c(n);
+    hamming(a.data(), n);
+    blackman(b.data(), n);
+    hanning(c.data(), n);
+    double e = 0;
+    for (size_t i = 0; i < n; i++) {
+        const double x = 2 * M_PI * i / (n - 1);
+        e = std::max(e, std::abs(a[i] - (0.54 - 0.46 * std::cos(x))));
+        e = std::max(e, std::abs(b[i] - (0.42 - 0.5 * std::cos(x) + 0.08 * std::cos(2 * x))));
+        e = std::max(e, std::abs(c[i] - (0.5 - 0.5 * std::cos(x))));
+    }
+    const double tol = sizeof(T) == 4 ? 1e-5 : 1e-12;
+    cout << "windows n:" << n << " max error:" << e << (e < tol ? ": OK" : ": FAIL") << endl;
+    return e >= tol;
+}
+
+template<class T>
+int test_fir(size_t m, size_t n, size_t fft_min_taps)
+{
+    const std::vector<T> h = random_vector<T>(m), x = random_vector<T>(n);
+    const std::vector<T> ref = fir_reference(h, x);
+    pnw::fir<T> f(h.data(), m, 256, fft_min_taps);
+    std::vector<T> y(n);
+    for (size_t i = 0; i < n;) {
+        const size_t k = std::min<size_t>(rand() % 2 ? f.block_size() : 1 + rand() % 300, n - i);
+        f.process(x.data() + i, y.data() + i, k);
+        i += k;
+    }
+    const T e = max_abs_diff(y.data(), ref.data(), n);
+    const T tol = T(sizeof(T) == 4 ? 1e-4 : 1e-10) * std::sqrt(T(m));
+    cout << "fir taps:" << m << (f.uses_fft() ? " fft" : " direct") << " max error:" << e
+         << (e < tol ? ": OK" : ": FAIL") << endl;
+    return e >= tol;
+}
+
+/// Check that chunks of typical sizes, smaller than block_size(), still go through the FFT.
+template<class T>
+int test_fir_chunks(size_t m, size_t n, size_t chunk)
+{
+    const std::vector<T> h = random_vector<T>(m), x = random_vector<T>(n);
+    const std::vector<T> ref = fir_reference(h, x);
+    pnw::fir<T> f(h.data(), m);
+    std::vector<T> y(n);
+    for (size_t i = 0; i < n; i += chunk) {
+        f.process(x.data() + i, y.data() + i, std::min(chunk, n - i));
+    }
+    const T e = max_abs_diff(y.data(), ref.data(), n);
+    const T tol = T(sizeof(T) == 4 ? 1e-4 : 1e-10) * std::sqrt(T(m));
+    const bool ok = f.uses_fft(chunk) && chunk < f.block_size() && e < tol;
+    cout << "fir taps:" << m << " block:" << f.block_size() << " chunk:" << chunk
+         << (f.uses_fft(chunk) ? " fft" : " direct") << " max error:" << e
+         << (ok ? ": OK" : ": FAIL") << endl;
+    return !ok;
+}
+
+template<class T>
+int test_decimator(size_t m, size_t factor, size_t n)
+{
+    const std::vector<T> h = random_vector<T>(m), x = random_vector<T>(n);
+    const std::vector<T> ref = fir_reference(h, x);
+    pnw::fir_decimator<T> d(h.data(), m, factor, 100);
+    std::vector<T> y(n / factor + 2);
+    size_t ny = 0;
+    for (size_t i = 0; i < n;) {
+        const size_t k = std::min<size_t>(1 + rand() % 77, n - i);
+        ny += d.process(x.data() + i, k, y.data() + ny);
+        i += k;
+    }
+    T e = ny != (n + factor - 1) / factor;
+    for (size_t k = 0; k < ny; k++) { e = std::max(e, std::abs(y[k] - ref[k * factor])); }
+    cout << "fir_decimator taps:" << m << " factor:" << factor << " outputs:" << ny << " max error:" << e
+         << (e < T(1e-4) ? ": OK" : ": FAIL") << endl;
+    return e >= T(1e-4);
+}
+
+template<class T>
+int test_interpolator(size_t m, size_t factor, size_t n)
+{
+    const std::vector<T> h = random_vector<T>(m), x = random_vector<T>(n);
+    std::vector<T> up(n * factor, T(0));
+    for (size_t i = 0; i < n; i++) { up[i * factor] = x[i]; }
+    const std::vector<T> ref = fir_reference(h, up);
+    pnw::fir_interpolator<T> p(h.data(), m, factor, 64);
+    std::vector<T> y(n * factor);
+    for (size_t i = 0; i < n;) {
+        const size_t k = std::min<size_t>(1 + rand() % 100, n - i);
+        p.process(x.data() + i, k, y.data() + i * factor);
+        i += k;
+    }
+    const T e = max_abs_diff(y.data(), ref.data(), n * factor);
+    cout << "fir_interpolator taps:" << m << " factor:" << factor << " max error:" << e
+         << (e < T(1e-4) ? ": OK" : ": FAIL") << endl;
+    return e >= T(1e-4);
+}
+
+template<class T>
+int test_biquad_bank(size_t C, size_t S, size_t nframes)
+{
+    const double fs = 48000;
+    pnw::biquad_bank<T> bank(C, S);
+    std::vector<pnw::biquad<T> > q(C * S);
+    for (size_t s = 0; s < S; s++) {
+        for (size_t c = 0; c < C; c++) {
+            const double f0 = 100 + 50 * c + 1000 * s;
+            q[s * C + c] = (s % 2 ? pnw::biquad<T>::peaking(fs, f0, 0.7, 6) :
+                            pnw::biquad<T>::lowpass(fs, f0 * 4, 0.707));
+            bank.set(s, c, q[s * C + c]);
+        }
+    }
+    const std::vector<T> x = random_vector<T>(C * nframes);
+    std::vector<T> y(C * nframes);
+    auto t0 = std::chrono::steady_clock::now();
+    bank.process(x.data(), y.data(), nframes);
+    auto t1 = std::chrono::steady_clock::now();
+
+    T e = 0;                    // scalar direct form I per channel
+    for (size_t c = 0; c < C; c++) {
+        std::vector<T> v(nframes);
+        for (size_t t = 0; t < nframes; t++) { v[t] = x[t * C + c]; }
+        for (size_t s = 0; s < S; s++) {
+            const pnw::biquad<T>& k = q[s * C + c];
+            T x1 = 0, x2 = 0, y1 = 0, y2 = 0;
+            for (size_t t = 0; t < nframes; t++) {
+                const T in = v[t];
+                const T out = k.b0 * in + k.b1 * x1 + k.b2 * x2 - k.a1 * y1 - k.a2 * y2;
+                x2 = x1; x1 = in; y2 = y1; y1 = out;
+                v[t] = out;
+            }
+        }
+        for (size_t t = 0; t < nframes; t++) { e = std::max(e, std::abs(v[t] - y[t * C + c])); }
+    }
+    const double sec = std::chrono::duration<double>(t1 - t0).count();
+    cout << "biquad_bank channels:" << C << " sections:" << S << " max error:" << e << " "
+         << C * S * nframes / sec * 1e-6 << " M section-samples/s"
+         << (e < T(1e-3) ? ": OK" : ": FAIL") << endl;
+    return e >= T(1e-3);
+}
+
+/// Compare direct and FFT FIR throughput for kernel length \p m.
+template<class T>
+void bench_fir(size_t m, size_t n)
+{
+    const std::vector<T> h = random_vector<T>(m), x = random_vector<T>(n);
+    std::vector<T> y(n);
+    for (size_t fft_min_taps : { size_t(0), size_t(1) }) {
+        pnw::fir<T> f(h.data(), m, 1024, fft_min_taps);
+        auto t0 = std::chrono::steady_clock::now();
+        f.process(x.data(), y.data(), n);
+        auto t1 = std::chrono::steady_clock::now();
+        const double sec = std::chrono::duration<double>(t1 - t0).count();
+        cout << "fir taps:" << m << (f.uses_fft() ? " fft:   " : " direct:") << n / sec * 1e-6 << " Msamples/s" << endl;
+    }
+}
+
+int main(int argc, const char * argv[], const char * envp[])
+{
+    int ret = 0;
+    ret |= test_windows<float>(1000);
+    ret |= test_windows<double>(4097);
+    ret |= test_fir<float>(1, 3000, 64);
+    ret |= test_fir<float>(31, 5000, 64);
+    ret |= test_fir<double>(200, 10000, 64);
+    ret |= test_fir<float>(1000, 20000, 64);
+    ret |= test_fir_chunks<float>(4000, 20000, 1024);
+    ret |= test_fir_chunks<double>(4000, 20000, 4096);
+    ret |= test_decimator<float>(48, 4, 5000);
+    ret |= test_decimator<double>(7, 3, 1000);
+    ret |= test_interpolator<float>(48, 4, 2000);
+    ret |= test_interpolator<double>(10, 3, 500);
+    ret |= test_biquad_bank<float>(16, 4, 20000);
+    ret |= test_biquad_bank<double>(3, 2, 1000);
+    for (size_t m : { 16, 64, 256, 4096 }) { bench_fir<float>(m, 1 << 20); }
+    return ret;
+}
@@ -0,0 +1,156 @@
+/*!
+ * \file t_grep.cpp
+ * \brief Test Parallel Multi-File Pattern Search.
+ */
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <vector>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "semnet/grep.hpp"
+#include "semnet/dir.hpp"
+#include "semnet/regfile.hpp"
+#include "semnet/alt.hpp"
+#include "semnet/lit.hpp"
+#include "semnet/ran.hpp"
+#include "semnet/rep.hpp"
+#include "semnet/seq.hpp"
+
+using namespace semnet;
+using namespace semnet::filesystem;
+using namespace semnet::patterns::gen;
+using std::cout;
+using std::endl;
+
+/// Hit as (file name relative to top, offset, length, line).
+typedef std::tuple<std::string, size_t, size_t, size_t> Got;
+
+size_t g_fails = 0;
+
+void check(const char * what, const std::vector<Got>& got, const std::vector<Got>& expected)
+{
+    const bool ok = got == expected;
+    g_fails += not ok;
+    cout << what << ": hits:" << got.size() << (ok ? " OK" : " FAIL") << endl;
+    if (not ok) {
+        for (const auto& g : got) {
+            cout << "  " << std::get<0>(g) << ":" << std::get<3>(g) << ": "
+                 << std::get<1>(g) << "+" << std::get<2>(g) << endl;
+        }
+    }
+}
+
+/// Run \p grep over \p top, collecting hits relative to \p top_path.
+std::vector<Got> collect(Grep& grep, const Dir * top, const std::string& top_path)
+{
+    std::vector<Got> got;
+    grep.run(top, [&](const Grep::Hit& hit) {
+            got.emplace_back(std::string(hit.file->path().c_str()).substr(top_path.size() + 1),
+                             hit.off, hit.len, hit.line);
+        });
+    return got;
+}
+
+void write_file(const std::string& path, const std::string& data)
+{
+    std::ofstream os(path, std::ios::binary);
+    os << data;
+}
+
+int main(int argc, const char * argv[], const char * envp[])
+{
+    char tmpl[] = "/tmp/t_grep.XXXXXX";
+    if (not ::mkdtemp(tmpl)) { perror("mkdtemp"); return EXIT_FAILURE; }
+    const std::string top_path(tmpl);
+    ::mkdir((top_path + "/b").c_str(), 0700);
+    write_file(top_path + "/a.txt", "ab\nxab ab\n");
+    write_file(top_path + "/b/c.txt", "ab");
+    write_file(top_path + "/d.bin", std::string("ab\0ab", 5));
+    write_file(top_path + "/e.txt", "");
+    write_file(top_path + "/f.txt", "axxb");
+    write_file(top_path + "/g1.txt", "xyz1"); // same size, so same read buffer
+    write_file(top_path + "/g2.txt", "xy2z");
+
+    auto top = dynamic_cast<Dir*>(File::load_path(top_path.c_str()));
+    if (not top) { cout << "Could not load " << top_path << endl; return EXIT_FAILURE; }
+    top->load(true);
+
+    auto ab = lit("ab");
+    {
+        Grep::Options opts;
+        opts.window = 1;        // one file in flight still keeps order
+        for (size_t nthreads : { 1, 4 }) {
+            opts.nthreads = nthreads;
+            Grep grep(ab, opts);
+            check("order", collect(grep, top, top_path),
+                  { Got("a.txt", 0, 2, 1), Got("a.txt", 4, 2, 2), Got("a.txt", 7, 2, 2),
+                    Got("b/c.txt", 0, 2, 1) });
+            g_fails += grep.stats().skipped != 1;
+        }
+    }
+    {
+        Grep::Options opts;
+        opts.max_count = 1;
+        Grep grep(ab, opts);
+        check("max_count", collect(grep, top, top_path),
+              { Got("a.txt", 0, 2, 1), Got("b/c.txt", 0, 2, 1) });
+    }
+    {
+        Grep::Options opts;
+        opts.binary = true;
+        Grep grep(ab, opts);
+        check("binary", collect(grep, top, top_path),
+              { Got("a.txt", 0, 2, 1), Got("a.txt", 4, 2, 2), Got("a.txt", 7, 2, 2),
+                Got("b/c.txt", 0, 2, 1), Got("d.bin", 0, 2, 1), Got("d.bin", 3, 2, 1) });
+    }
+    {
+        // empty hits advance by one byte, up to and including end of file
+        Grep grep(rep0oM(lit('x')));
+        std::vector<Got> got = collect(grep, top, top_path), f_got;
+        for (const auto& g : got) {
+            if (std::get<0>(g) == "f.txt") { f_got.push_back(g); }
+        }
+        check("empty", f_got,
+              { Got("f.txt", 0, 0, 1), Got("f.txt", 1, 2, 1), Got("f.txt", 3, 0, 1), Got("f.txt", 4, 0, 1) });
+    }
+    {
+        // shared word is memoized, but not across files
+        auto word = rep1oM(ran(lit('a'), lit('z')))->set_greedy(true);
+        Grep::Options opts;
+        opts.nthreads = 1;
+        Grep grep(alt(seq(word, lit('1')), seq(word, lit('2'))), opts);
+        check("memo", collect(grep, top, top_path),
+              { Got("g1.txt", 0, 4, 1), Got("g2.txt", 0, 3, 1) });
+    }
+    {
+        // exception from callback stops the search and reaches the caller
+        Grep::Options opts;
+        opts.window = 1;
+        Grep grep(ab, opts);
+        bool caught = false;
+        try {
+            grep.run(top, [](const Grep::Hit& hit) { throw std::runtime_error("stop"); });
+        } catch (const std::runtime_error&) {
+            caught = true;
+        }
+        g_fails += not caught;
+        cout << "throw" << (caught ? " OK" : " FAIL") << endl;
+        check("after throw", collect(grep, top, top_path),
+              { Got("a.txt", 0, 2, 1), Got("a.txt", 4, 2, 2), Got("a.txt", 7, 2, 2),
+                Got("b/c.txt", 0, 2, 1) });
+    }
+
+    for (auto name : { "/a.txt", "/b/c.txt", "/d.bin", "/e.txt", "/f.txt", "/g1.txt", "/g2.txt" }) {
+        ::unlink((top_path + name).c_str());
+    }
+    ::rmdir((top_path + "/b").c_str());
+    ::rmdir(top_path.c_str());
+
+    return g_fails ? EXIT_FAILURE : EXIT_SUCCESS;
+}
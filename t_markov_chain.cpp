@@ -0,0 +1,118 @@
+/*!
+ * \file t_markov_chain.cpp
+ * \brief Test Markov Chain Content Model.
+ */
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+#include "semnet/markov_chain.hpp"
+
+using namespace semnet::patterns;
+using std::cout;
+using std::endl;
+
+size_t g_fails = 0;
+
+const char * g_code[] = {
+    "for (int i = 0; i < n; i++) { sum += a[i] * b[i]; }\n",
+    "if (x == nullptr) { return -1; } else { x->next = y; }\n",
+    "static int count_bits(uint32_t x) { int c = 0; while (x) { c += x & 1; x >>= 1; } return c; }\n",
+    "std::vector<int> v(n, 0); for (size_t k = 0; k != v.size(); ++k) { v[k] = k * k; }\n",
+    "while (p < end and *p != '\\n') { p++; } // skip to end of line\n",
+    "const size_t len = strlen(s); char * t = new char[len + 1]; memcpy(t, s, len + 1);\n",
+};
+
+const char * g_prose[] = {
+    "The quick brown fox jumps over the lazy dog while the farmer sleeps in the shade.\n",
+    "It was the best of times, it was the worst of times, it was the age of wisdom.\n",
+    "She walked along the river and watched the boats drift slowly towards the sea.\n",
+    "In the morning the children went to school and the town was quiet once again.\n",
+    "They talked for hours about books, music and the long winter that was coming.\n",
+    "When the rain stopped, the birds began to sing and the sun came out of the clouds.\n",
+};
+
+const char * g_code_held = "for (size_t j = 0; j < m; j++) { if (b[j] == 0) { return j; } }\n";
+const char * g_prose_held = "The old man went down to the harbour and looked at the ships in the evening.\n";
+
+std::string corpus(const char ** lines, size_t n, size_t reps)
+{
+    std::string s;
+    for (size_t r = 0; r < reps; r++) {
+        for (size_t i = 0; i < n; i++) { s += lines[i]; }
+    }
+    return s;
+}
+
+void check(const char * what, bool ok)
+{
+    g_fails += not ok;
+    cout << what << (ok ? " OK" : " FAIL") << endl;
+}
+
+void test_markov_chain(MarkovChain::MCUNIT_t unit, const char * tmp_dir)
+{
+    MarkovChain::Options opts;
+    opts.unit = unit;
+    opts.order = 3;
+    opts.nthreads = 2;
+    const char * uname = unit == MarkovChain::MCUNIT_BYTE ? "byte" : "token";
+    cout << uname << ":" << endl;
+
+    MarkovChain code("Code", opts), prose("Prose", opts);
+    const std::string cc = corpus(g_code, 6, 4);
+    code.train(cc.data(), cc.size());
+
+    // train prose from files, by threads
+    std::vector<csc> paths;
+    for (size_t i = 0; i < 6; i++) {
+        paths.push_back(csc(tmp_dir) + "/prose" + std::to_string(i) + ".txt");
+        std::ofstream os(paths.back().c_str());
+        for (size_t r = 0; r < 4; r++) { os << g_prose[i]; }
+    }
+    check("  train_files", prose.train_files(paths) == paths.size());
+    for (const auto& p : paths) { ::unlink(p.c_str()); }
+
+    const double cc_s = code.score(g_code_held, strlen(g_code_held));
+    const double pc_s = prose.score(g_code_held, strlen(g_code_held));
+    const double cp_s = code.score(g_prose_held, strlen(g_prose_held));
+    const double pp_s = prose.score(g_prose_held, strlen(g_prose_held));
+    cout << "  code: " << cc_s << " vs " << pc_s << ", prose: " << pp_s << " vs " << cp_s << endl;
+    check("  code ranked as code", cc_s > pc_s);
+    check("  prose ranked as prose", pp_s > cp_s);
+
+    // save, map back and get the same scores
+    const std::string path = std::string(tmp_dir) + "/code.ngt";
+    check("  save", code.save(path.c_str()));
+    MarkovChain loaded;
+    check("  load", loaded.load(path.c_str()));
+    check("  loaded model", (loaded.options().unit == unit and
+                             loaded.options().order == opts.order and
+                             loaded.ngrams() == code.ngrams() and
+                             loaded.stats().units == code.stats().units and
+                             loaded.score(g_code_held, strlen(g_code_held)) == cc_s and
+                             loaded.score(g_prose_held, strlen(g_prose_held)) == cp_s));
+
+    // train on after load
+    loaded.train(g_code_held, strlen(g_code_held));
+    code.train(g_code_held, strlen(g_code_held));
+    check("  trained after load", (loaded.ngrams() == code.ngrams() and
+                                   loaded.score(g_prose_held, strlen(g_prose_held)) ==
+                                   code.score(g_prose_held, strlen(g_prose_held))));
+    ::unlink(path.c_str());
+}
+
+int main(int argc, const char * argv[], const char * envp[])
+{
+    char tmpl[] = "/tmp/t_markov_chain.XXXXXX";
+    if (not ::mkdtemp(tmpl)) { perror("mkdtemp"); return EXIT_FAILURE; }
+    test_markov_chain(MarkovChain::MCUNIT_BYTE, tmpl);
+    test_markov_chain(MarkovChain::MCUNIT_TOKEN, tmpl);
+    ::rmdir(tmpl);
+    return g_fails ? EXIT_FAILURE : EXIT_SUCCESS;
+}
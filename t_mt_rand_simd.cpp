@@ -13,6 +13,7 @@ extern "C" { extern char *gets(char *__s) { return 0; }; }
 #include <ext/random>
 #include <chrono>
 #include <cstdlib>
+#include "rand_streams.hpp"
 
 using std::cout;
 using std::endl;
@@ -40,6 +41,15 @@ int test_mersenne_simd(int argc,
         cout << "__gnu_cxx::sfmt607: " << count << " milliseconds" << endl;
     }
 
+    {
+        pnw::xoshiro256ss_x4 r;
+        auto tA = hrc::now();
+        r.fill_u64(reinterpret_cast<uint64_t*>(f.data()), f.size() * sizeof(T) / sizeof(uint64_t));
+        auto tB = hrc::now();
+        auto count = std::chrono::duration_cast<std::chrono::milliseconds>(tB - tA).count();
+        cout << "pnw::xoshiro256ss_x4::fill_u64: " << count << " milliseconds" << endl;
+    }
+
     {
         auto tA = hrc::now();
         std::generate(begin(f), end(f), rand);
@@ -6,8 +6,12 @@
 
 #include <iostream>
 #include <iomanip>
+#include <new>
+#include <vector>
 #include "opt_funs.hpp"
 #include "nelder_mead.hpp"
+#include "pso.hpp"
+#include "cmaes.hpp"
 
 using std::cout;
 using std::endl;
@@ -261,9 +265,63 @@ int test_nelder_mead_min() {
     return 0;
 }
 
+/*! Use batched optimizers on \c rosenbrock and \c quartic. */
+template<class T>
+int test_batch_opt() {
+    cout << endl << __FUNCTION__ << endl << endl;
+    auto fr = pnw::opt::parallel_batch<T>([](const T* x) { return rosenbrock<T>(x); });
+    auto fq = pnw::opt::parallel_batch<T>([](const T* x) { return quartic<T>(x); });
+    const T lower[] = { -2, -2, -2, -2, -2, -2, -2, -2, -2, -2 };
+    const T upper[] = {  2,  2,  2,  2,  2,  2,  2,  2,  2,  2 };
+    const T start[] = {  1,  1,  1,  1,  1,  1,  1,  1,  1,  1 };
+    int err = 0;
+
+    auto show = [&](const char* name, const pnw::opt::result<T>& r, T tol) {
+        cout << "  " << std::setw(24) << std::left << name << std::right
+             << " F(X*) = " << std::setw(14) << r.ymin
+             << " evals: " << r.nevals << " restarts: " << r.nrestarts << "\n";
+        if (not (r.ymin < tol)) { err++; }
+    };
+    show("nelder_mead_multistart", nelder_mead_multistart<T>(fr, 2, lower, upper, 8, 20000), 1e-3);
+    show("pso", pso<T>(fr, 2, lower, upper, 32, 400), 1e-3);
+    show("cmaes rosenbrock", cmaes<T>(fr, 2, start, 0.5, 20000, lower, upper), 1e-3);
+    show("cmaes quartic", cmaes<T>(fq, 10, start, 0.5, 20000), 1e-3);
+
+    // objective never below max, so no best point
+    auto fnan = pnw::opt::serial_batch<T>([](const T* x) { return std::numeric_limits<T>::quiet_NaN(); });
+    const auto rnan = pso<T>(fnan, 2, lower, upper, 8, 10);
+    cout << "  " << std::setw(24) << std::left << "pso nan" << std::right
+         << " xmin empty: " << rnan.xmin.empty() << "\n";
+    if (not rnan.xmin.empty()) { err++; }
+    return err;
+}
+
+/*! Check that random streams of \c pso work at any 8-byte aligned
+ * address, as in a \c std::vector, also when built with AVX. */
+int test_pso_streams() {
+    pnw::xoshiro256ss_x4 ref(7, 1);
+    std::vector<pnw::xoshiro256ss_x4> rngs;
+    for (size_t t = 0; t < 3; ++t) { rngs.emplace_back(7, 1); }
+    alignas(32) char buf[sizeof(pnw::xoshiro256ss_x4) + 8];
+    auto odd = new (buf + 8) pnw::xoshiro256ss_x4(7, 1);
+    int err = 0;
+    for (size_t i = 0; i < 100; ++i) {
+        const uint64_t x = ref();
+        for (auto& g : rngs) { err += g() != x; }
+        err += (*odd)() != x;
+    }
+    cout << "  " << std::setw(24) << std::left << "pso streams" << std::right
+         << (err ? " FAIL" : " OK") << "\n";
+    return err;
+}
+
 int main(int argc, const char * argv[], const char * envp[])
 {
     test_nelder_mead_min<float>();
     test_nelder_mead_min<double>();
-    return 0;
+    int err = 0;
+    err |= test_pso_streams();
+    err |= test_batch_opt<float>();
+    err |= test_batch_opt<double>();
+    return err;
 }
@@ -8,6 +8,9 @@
 #include <fstream>
 #include <string>
 #include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
 
 #include <boost/spirit/include/support_istream_iterator.hpp>
 #include <boost/spirit/include/qi_binary.hpp>
@@ -35,16 +38,84 @@ template<class V> void test_ngram(size_t num, size_t nlevels = 3, bool show_flag
     // pnw::histogram::sparse<V,C> sh(begin(seq), end(seq));
 }
 
+/*! Count errors of \p tab against all 1- to \p nlevels-grams below \p t,
+ * prefixed by \p path, and add number of such n-grams to \p num. */
+template<class V, class T, class Tab>
+size_t compare_ngram(const T& t, const Tab& tab, std::vector<V>& path, size_t nlevels, size_t& num)
+{
+    size_t err = 0;
+    for (const auto& bin : t.map().get()) {
+        path.push_back(bin.first);
+        num++;
+        err += tab.count(begin(path), end(path)) != bin.second.first;
+        if (path.size() < nlevels) {
+            err += compare_ngram(*bin.second.second, tab, path, nlevels, num);
+        }
+        path.pop_back();
+    }
+    return err;
+}
+
+/*! Test Hashed N-Gram Table against \c tree and its frozen form. */
+template<class V> void test_ngram_table(size_t num, size_t nlevels = 3)
+{
+    using std::cout;
+    using std::endl;
+    typedef std::vector<V> C;   // container
+    C seq = rand_n<C>(num);
+
+    pnw::histogram::ngram::table<V> tab(begin(seq), end(seq), nlevels);
+    char path[] = "/tmp/t_ngram.tab.XXXXXX";
+    const int fd = ::mkstemp(path);
+    if (fd < 0) { perror("mkstemp"); return; }
+    ::close(fd);
+    size_t err = not tab.save(path);
+    pnw::histogram::ngram::frozen_table<V> ftab(path);
+
+    // same counts as the tree, which logs one level deeper
+    pnw::histogram::ngram::tree<V> tree(begin(seq), end(seq), nlevels);
+    std::vector<V> ngram;
+    size_t num_ngrams = 0;
+    err += compare_ngram(tree, tab, ngram, nlevels, num_ngrams);
+    err += num_ngrams != tab.size();
+
+    for (size_t i = 0; i + nlevels <= num; i++) {
+        err += tab.count(begin(seq) + i, begin(seq) + i + nlevels) == 0;
+        err += tab.count(begin(seq) + i, begin(seq) + i + nlevels) != ftab.count(begin(seq) + i, begin(seq) + i + nlevels);
+    }
+    // same counts when logged as a stream of n-grams ending at each element
+    pnw::histogram::ngram::table<V> stab(nlevels);
+    std::vector<uint64_t> ctx(nlevels, 0); // hashes of last 0 to nlevels-1 elements
+    for (size_t i = 0; i < num; i++) {
+        const size_t k_max = std::min(i, nlevels - 1);
+        for (size_t k = 0; k <= k_max; k++) { stab.add_key(pnw::histogram::ngram::roll(ctx[k], seq[i])); }
+        for (size_t k = std::min(k_max + 1, nlevels - 1); k >= 1; k--) { ctx[k] = pnw::histogram::ngram::roll(ctx[k - 1], seq[i]); }
+    }
+    err += stab.size() != tab.size();
+    for (size_t i = 0; i + nlevels <= num; i++) {
+        err += tab.count(begin(seq) + i, begin(seq) + i + nlevels) != stab.count(begin(seq) + i, begin(seq) + i + nlevels);
+    }
+
+    ::unlink(path);
+
+    cout << "ngram::table size:" << tab.size() << " bytes:" << tab.bytesize()
+         << (err ? " FAIL" : " OK") << endl;
+}
+
 void test_ngram_all(size_t num = 1e2,
                     size_t nlevels = 3) {
     test_ngram<uint8_t>(num, nlevels, true);
     test_ngram<uint16_t>(num, nlevels, true);
+    test_ngram_table<uint8_t>(num, nlevels);
+    test_ngram_table<uint16_t>(num, nlevels);
 }
 
 void bench_ngram_all(size_t num = 1e6,
                      size_t nlevels = 3) {
     test_ngram<uint8_t>(num, nlevels, false);
     test_ngram<uint16_t>(num, nlevels, false);
+    test_ngram_table<uint8_t>(num, nlevels);
+    test_ngram_table<uint16_t>(num, nlevels);
 }
 
 int main(int argc, const char * argv[], const char * envp[])
@@ -0,0 +1,126 @@
+/*!
+ * \file t_obarena.cpp
+ * \brief Test Object Slab Allocator and Registry Handles.
+ */
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "semnet/obarena.hpp"
+#include "semnet/preg.hpp"
+#include "semnet/obmr.hpp"
+
+using namespace semnet;
+using std::cout;
+using std::endl;
+
+size_t g_fails = 0;
+
+void check(const char * what, bool ok)
+{
+    g_fails += not ok;
+    cout << what << (ok ? " OK" : " FAIL") << endl;
+}
+
+/// Smallest concrete object.
+class TestOb : public ObMr {
+public:
+    virtual OB_t get_type() const { return OB_NUMBER; }
+};
+
+bool is_aligned(const void * p, size_t n) { return reinterpret_cast<uintptr_t>(p) % n == 0; }
+
+void test_arena()
+{
+    ObArena arena;
+
+    // one object of each of a few size classes, the first use of each
+    const size_t sizes[] = { 0, 1, 16, 17, 100, ObArena::MAX_SMALL };
+    std::vector<char*> ps;
+    bool ok = true;
+    size_t used = 0;
+    for (auto size : sizes) {
+        auto p = static_cast<char*>(arena.alloc(size));
+        const size_t osize = ObArena::size_of(p);
+        ok = ok and is_aligned(p, ObArena::GRAIN) and osize >= size and osize < size + 1 + ObArena::GRAIN;
+        memset(p, 0xa5, osize);
+        ps.push_back(p);
+        used += osize;
+    }
+    ok = ok and arena.used_bytes() == used;
+    ok = ok and arena.slab_bytes() == 4 * ObArena::SLAB_SIZE; // 0, 1 and 16 share a class
+    check("size classes", ok);
+
+    // freed objects are reused within their class only
+    arena.free(ps[4]);
+    auto q = arena.alloc(ObArena::size_of(ps[3]));
+    auto r = arena.alloc(99);
+    check("reuse", q != ps[4] and r == ps[4] and arena.used_bytes() == used + ObArena::size_of(q));
+    arena.free(q);
+
+    // a full slab is followed by a new one of the same class
+    const size_t per_slab = (ObArena::SLAB_SIZE - ObArena::GRAIN) / 64; // after slab header
+    std::vector<void*> qs;
+    for (size_t i = 0; i < per_slab + 1; i++) { qs.push_back(arena.alloc(64)); }
+    ok = arena.slab_bytes() == 6 * ObArena::SLAB_SIZE;
+    for (auto p : qs) { ok = ok and ObArena::size_of(p) == 64; arena.free(p); }
+    check("slabs", ok);
+
+    // large objects get slabs of their own, freed with them
+    const size_t slab_bytes = arena.slab_bytes();
+    auto big = arena.alloc(ObArena::MAX_SMALL + 1);
+    auto huge = static_cast<char*>(arena.alloc(3 * ObArena::SLAB_SIZE));
+    ok = (is_aligned(big, ObArena::GRAIN) and is_aligned(huge, ObArena::GRAIN) and
+          ObArena::size_of(big) == ObArena::MAX_SMALL + ObArena::GRAIN and
+          ObArena::size_of(huge) == 3 * ObArena::SLAB_SIZE and
+          arena.slab_bytes() == slab_bytes + 5 * ObArena::SLAB_SIZE);
+    memset(huge, 0x5a, 3 * ObArena::SLAB_SIZE);
+    arena.free(big);
+    arena.free(huge);
+    ok = ok and arena.slab_bytes() == slab_bytes;
+    check("large", ok);
+
+    arena.free(r);
+    for (size_t i = 0; i < ps.size(); i++) {
+        if (i != 4) { arena.free(ps[i]); }
+    }
+    check("empty", arena.used_bytes() == 0);
+}
+
+void test_handles()
+{
+    pReg reg;
+    g_oreg = &reg;              // ~Ob() unregisters from it
+
+    Ob * a = new TestOb, * b = new TestOb, * c = new TestOb;
+    reg.add1(a);
+    reg.add2(b, c);
+    check("add", (a->get_rid() == 0 and b->get_rid() == 1 and c->get_rid() == 2 and
+                  reg.get(1) == b and reg.get(3) == nullptr and reg.ob_count() == 3 and
+                  ObArena::size_of(a) >= sizeof(TestOb)));
+
+    delete b;
+    check("unreg", reg.get(1) == nullptr and reg.ob_count() == 2);
+
+    Ob * d = new TestOb, * e = new TestOb;
+    reg.add1(d);
+    reg.add1(e);
+    check("recycle", (d->get_rid() == 1 and e->get_rid() == 3 and
+                      reg.get(1) == d and reg.ob_count() == 4));
+
+    Ob * f = new TestOb;        // never registered
+    check("unregistered", f->get_rid() == OBID_undefined_);
+    for (auto ob : { a, c, d, e, f }) { delete ob; }
+    check("all unreg", reg.ob_count() == 0);
+    g_oreg = nullptr;
+}
+
+int main(int argc, const char * argv[], const char * envp[])
+{
+    test_arena();
+    test_handles();
+    return g_fails ? EXIT_FAILURE : EXIT_SUCCESS;
+}
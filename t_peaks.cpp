@@ -40,9 +40,30 @@ int test_valleys(int argc, const char * argv[], const char * envp[])
     return 0;
 }
 
+/// Compare \c extrema() with \c peaks() and \c valleys() on random data.
+template<class T>
+int test_extrema(size_t n)
+{
+    std::vector<T> x(n);
+    for (auto& e : x) { e = static_cast<T>(rand() % 7); } // plenty of plateaus
+    std::vector<size_t> pk(n / 2 + 1), vl(n / 2 + 1);
+    size_t npk, nvl;
+    extrema(x.data(), n, pk.data(), npk, vl.data(), nvl);
+    pk.resize(npk);
+    vl.resize(nvl);
+    const bool ok = (pk == peaks<std::vector<T>, size_t>(x) and
+                     vl == valleys<std::vector<T>, size_t>(x));
+    cout << "extrema n:" << n << " peaks:" << npk << " valleys:" << nvl
+         << (ok ? ": OK" : ": FAIL") << endl;
+    return !ok;
+}
+
 int main(int argc, const char * argv[], const char * envp[])
 {
     typedef int T;
     return (test_peaks<T>(argc, argv, envp) +
-            test_valleys<T>(argc, argv, envp));
+            test_valleys<T>(argc, argv, envp) +
+            test_extrema<T>(2) +
+            test_extrema<T>(9) +
+            test_extrema<float>(1001));
 }
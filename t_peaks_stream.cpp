@@ -0,0 +1,134 @@
+/*!
+ * \file t_peaks_stream.cpp
+ * \brief Test Streaming Peaks and Sliding-Window Extremes.
+ */
+
+#include <iostream>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+#include <algorithm>
+
+#include "peaks_stream.hpp"
+
+using std::cout;
+using std::endl;
+
+/// Noisy test signal with occasional large bumps.
+template<class T>
+std::vector<T> make_signal(size_t n)
+{
+    std::vector<T> x(n);
+    for (size_t i = 0; i < n; i++) {
+        x[i] = T(0.1) * (T)rand() / RAND_MAX + std::sin(T(i) / 50) + (i % 997 < 20 ? T(2) : T(0));
+    }
+    return x;
+}
+
+template<class T>
+int test_sliding_minmax(size_t n, size_t window)
+{
+    const std::vector<T> x = make_signal<T>(n);
+    std::vector<T> mins(n), maxs(n);
+    pnw::sliding_minmax<T> s(window);
+    for (size_t i = 0; i < n;) {        // random chunking
+        const size_t m = std::min<size_t>(1 + rand() % 100, n - i);
+        s.push(x.data() + i, m, mins.data() + i, maxs.data() + i);
+        i += m;
+    }
+    size_t nbad = 0;
+    for (size_t i = 0; i < n; i++) {
+        const size_t b = i + 1 >= window ? i + 1 - window : 0;
+        const auto mm = std::minmax_element(x.begin() + b, x.begin() + i + 1);
+        nbad += mins[i] != *mm.first or maxs[i] != *mm.second;
+    }
+    T mn = 0, mx = 0;
+    pnw::minmax(x.data(), n, mn, mx);
+    const auto mm = std::minmax_element(x.begin(), x.end());
+    nbad += mn != *mm.first or mx != *mm.second;
+    cout << "sliding_minmax n:" << n << " window:" << window << " mismatches:" << nbad
+         << (nbad ? ": FAIL" : ": OK") << endl;
+    return nbad != 0;
+}
+
+/// Whole-signal reference of the definitions in \c peak_stream.
+template<class T>
+std::vector<pnw::peak_info<T> > peaks_reference(const std::vector<T>& x0,
+                                                const typename pnw::peak_stream<T>::params& p)
+{
+    std::vector<T> x(x0);
+    if (p.valleys) { for (auto& e : x) { e = -e; } }
+    const size_t n = x.size(), half = std::max<size_t>(p.wlen / 2, 1);
+    std::vector<pnw::peak_info<T> > r;
+    for (size_t c = 1; c + 1 < n; c++) {
+        if (!(x[c-1] < x[c] and x[c] > x[c+1] and x[c] >= p.min_height)) { continue; }
+        const size_t lo = c >= half ? c - half : 0, hi = std::min(c + half, n - 1);
+        size_t lb = c, rb = c;
+        T lmin = x[c], rmin = x[c];
+        for (size_t k = c; k-- > lo and x[k] <= x[c];) { if (x[k] < lmin) { lmin = x[k]; lb = k; } }
+        for (size_t k = c + 1; k <= hi and x[k] <= x[c]; k++) { if (x[k] < rmin) { rmin = x[k]; rb = k; } }
+        const T prom = x[c] - std::max(lmin, rmin);
+        if (prom < p.min_prominence) { continue; }
+        const T ref = x[c] - p.rel_height * prom;
+        double left = lb, right = rb;
+        for (size_t k = c; k > lb; k--) {
+            if (x[k-1] < ref) { left = (k-1) + double(ref - x[k-1]) / double(x[k] - x[k-1]); break; }
+        }
+        for (size_t k = c; k < rb; k++) {
+            if (x[k+1] < ref) { right = k + double(x[k] - ref) / double(x[k] - x[k+1]); break; }
+        }
+        if (T(right - left) < p.min_width) { continue; }
+        pnw::peak_info<T> pk;
+        pk.index = c; pk.value = x0[c]; pk.prominence = prom; pk.width = T(right - left);
+        pk.left = left; pk.right = right; pk.left_base = lb; pk.right_base = rb;
+        r.push_back(pk);
+    }
+    return r;
+}
+
+template<class T>
+int test_peak_stream(size_t n, size_t wlen, T min_prominence, bool valleys)
+{
+    const std::vector<T> x = make_signal<T>(n);
+    typename pnw::peak_stream<T>::params p;
+    p.wlen = wlen;
+    p.min_prominence = min_prominence;
+    p.valleys = valleys;
+    pnw::peak_stream<T> s(p);
+    std::vector<pnw::peak_info<T> > got;
+    auto sink = [&](const pnw::peak_info<T>& pk) { got.push_back(pk); };
+    auto t0 = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < n;) {
+        const size_t m = std::min<size_t>(1 + rand() % 1000, n - i);
+        s.push(x.data() + i, m, sink);
+        i += m;
+    }
+    s.flush(sink);
+    auto t1 = std::chrono::steady_clock::now();
+
+    const auto ref = peaks_reference(x, p);
+    size_t nbad = got.size() != ref.size();
+    for (size_t i = 0; i < std::min(got.size(), ref.size()); i++) {
+        nbad += (got[i].index != ref[i].index or got[i].value != ref[i].value or
+                 got[i].prominence != ref[i].prominence or got[i].width != ref[i].width);
+    }
+    const double sec = std::chrono::duration<double>(t1 - t0).count();
+    cout << "peak_stream n:" << n << " wlen:" << wlen << (valleys ? " valleys:" : " peaks:") << got.size()
+         << " mismatches:" << nbad << " " << n / sec * 1e-6 << " Msamples/s"
+         << (nbad ? ": FAIL" : ": OK") << endl;
+    return nbad != 0;
+}
+
+int main(int argc, const char * argv[], const char * envp[])
+{
+    int ret = 0;
+    ret |= test_sliding_minmax<float>(10000, 1);
+    ret |= test_sliding_minmax<double>(10000, 37);
+    ret |= test_sliding_minmax<float>(20000, 1000);
+    ret |= test_peak_stream<double>(100000, 256, 0, false);
+    ret |= test_peak_stream<float>(100000, 300, 0.5f, false);
+    ret |= test_peak_stream<double>(100000, 64, 0.05, true);
+    ret |= test_peak_stream<double>(10, 256, 0, false);
+    return ret;
+}
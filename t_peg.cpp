@@ -0,0 +1,183 @@
+/*!
+ * \file t_peg.cpp
+ * \brief Test Compiled Packrat Pattern Matching.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "semnet/peg.hpp"
+#include "semnet/alt.hpp"
+#include "semnet/any.hpp"
+#include "semnet/know_common.hpp"
+#include "semnet/lang.hpp"
+#include "semnet/lit.hpp"
+#include "semnet/ran.hpp"
+#include "semnet/rep.hpp"
+#include "semnet/seq.hpp"
+#include "semnet/sit.hpp"
+
+using namespace semnet::patterns;
+using namespace semnet::patterns::gen;
+using std::cout;
+using std::endl;
+
+size_t g_fails = 0;
+
+/// Check that \p hit is at byte offset \p off of byte length \p len, or undefined if \p off is -1.
+void check(const char * what, const pHit& hit, long off, long len)
+{
+    const long o = hit.full() ? long(to_byte(hit.low())) : -1;
+    const long l = hit.full() ? long(to_byte(hit.bitsize())) : -1;
+    const bool ok = (o == off and l == len);
+    g_fails += not ok;
+    cout << what << ": off:" << o << " len:" << l << (ok ? " OK" : " FAIL") << endl;
+}
+
+/// Alternative of single characters in \p s.
+Alt * chars(const char * s)
+{
+    auto a = alt();
+    for (; *s; s++) { a->add(lit(*s)); }
+    return a;
+}
+
+Base * g_letter = nullptr;
+Base * g_digit = nullptr;
+Base * g_ident = nullptr;
+
+/*! Build the grammar of expressions such as <tt>a+b*(c-d)</tt>, whose
+ * additive and multiplicative rules are left-recursive. */
+Alt * expr_grammar()
+{
+    g_letter = alt(ran(lit('a'), lit('z')), ran(lit('A'), lit('Z')), lit('_'));
+    g_digit = ran(lit('0'), lit('9'));
+    g_ident = seq(bos(), g_letter, rep0oM(alt(g_letter, g_digit)), eos());
+    auto num = rep1oM(g_digit)->set_greedy(true);
+    auto expr = alt();
+    auto primary = alt(g_ident, num, seq(lit('('), expr, lit(')')));
+    auto mult = alt();
+    mult->add(primary, seq(mult, chars("*/%"), primary));
+    auto add = alt();
+    add->add(mult, seq(add, chars("+-"), mult));
+    expr->add(add);
+    return expr;
+}
+
+void test_peg_expr(Alt * expr)
+{
+    Peg peg(expr);
+    Peg::Parser p(peg);
+    const char * e1 = "a+b*(c-d)/e-f";
+    check("expr", p.match_at(e1, strlen(e1)), 0, strlen(e1));
+    const char * e2 = "  x1+23*y;";
+    check("expr find", p.find(e2, strlen(e2)), 2, 7);
+
+    Peg pid(g_ident);
+    Peg::Parser q(pid);
+    const char * e3 = "foo_bar9";
+    check("ident", q.match_at(e3, strlen(e3)), 0, 8);
+    check("ident inside word", q.match_at(e3, strlen(e3), 1), -1, -1);
+
+    // 2 MB of nested expressions, parsed in linear time thanks to the memo
+    std::string big;
+    for (int i = 0; i < 200000; i++) { big += "(a" + std::to_string(i % 97) + "*b-c)+"; }
+    big += "z";
+    auto t0 = std::chrono::steady_clock::now();
+    const pHit hit = p.match_at(big.data(), big.size());
+    auto t1 = std::chrono::steady_clock::now();
+    check("big expr", hit, 0, big.size());
+    cout << "big expr of " << big.size() << " bytes in "
+         << std::chrono::duration<double>(t1 - t0).count() << " s" << endl;
+}
+
+void test_peg_indirect_left_recursion()
+{
+    auto A = alt(), B = alt();
+    A->add(seq(B, lit('x')), lit('a'));
+    B->add(seq(A, lit('y')), lit('b'));
+    Peg peg(A);
+    Peg::Parser p(peg);
+    check("indirect lr", p.match_at("ayxyx", 5), 0, 5);
+    check("indirect lr prefix", p.match_at("bxyxz", 5), 0, 4);
+}
+
+void test_peg_lazy()
+{
+    // string literal with escaped quotes, by a lazy repetition
+    auto str = seq(lit('"'), rep0oM(alt(anybytes(1), lit("\\\""))), lit('"'));
+    Peg peg(str);
+    Peg::Parser p(peg);
+    const char * s = "s = \"ab\\\"c\" + \"x\"";
+    check("string", p.find(s, strlen(s)), 4, 7);
+    const size_t n = p.find_all(s, strlen(s), [](const pHit&) {});
+    g_fails += n != 2;
+    cout << "strings: " << n << (n == 2 ? " OK" : " FAIL") << endl;
+}
+
+void test_peg_complement()
+{
+    Peg pn(rep1oM(alt(lit('\\'), lit('"'), true))->set_greedy(true));
+    Peg::Parser p(pn);
+    check("alt complement", p.match_at("abc\"d", 5), 0, 3);
+
+    Peg pr(rep1oM(ran(lit('0'), lit('9'), true))->set_greedy(true));
+    Peg::Parser q(pr);
+    check("ran complement", q.match_at("ab1", 3), 0, 2);
+    check("ran complement find", q.find("12x3", 4), 2, 1);
+}
+
+/// Match common character classes, none of which is a complement.
+void test_peg_common()
+{
+    learn_common();
+    Peg pb(rep1oM(gp_DigB)->set_greedy(true));
+    Peg::Parser p(pb);
+    check("binary digits", p.match_at("0110x2", 6), 0, 4);
+    check("binary digit not", p.match_at("2", 1), -1, -1);
+
+    Peg pa(rep1oM(gp_ASCII_7Bit)->set_greedy(true));
+    Peg::Parser q(pa);
+    const char s[] = "a\0b\x7f\x80c";
+    check("ascii", q.match_at(s, sizeof(s) - 1), 0, 4);
+    check("ascii not", q.match_at(s + 4, 2), -1, -1);
+}
+
+/// Match one \c Lang from several threads, while it is unprepared now and then.
+void test_lang_threads(Alt * expr)
+{
+    auto l = lang("Expr", expr);
+    const char * e = "a+b*(c-d)/e-f";
+    std::atomic<size_t> fails(0);
+    std::vector<std::thread> workers;
+    for (size_t t = 0; t < 4; t++) {
+        workers.emplace_back([&]() {
+                for (size_t k = 0; k < 1000; k++) {
+                    const pHit hit = l->match_in(e, strlen(e));
+                    if (not hit.full() or to_byte(hit.bitsize()) != strlen(e)) { fails++; }
+                }
+            });
+    }
+    for (size_t k = 0; k < 100; k++) { l->unprepare(); }
+    for (auto& w : workers) { w.join(); }
+    g_fails += fails;
+    cout << "lang threads" << (fails ? " FAIL" : " OK") << endl;
+}
+
+int main(int argc, const char * argv[], const char * envp[])
+{
+    auto expr = expr_grammar();
+    test_peg_expr(expr);
+    test_peg_indirect_left_recursion();
+    test_peg_lazy();
+    test_peg_complement();
+    test_peg_common();
+    test_lang_threads(expr);
+    return g_fails ? EXIT_FAILURE : EXIT_SUCCESS;
+}
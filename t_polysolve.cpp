@@ -1,6 +1,12 @@
 #include "polysolve.hpp"
+#include "polyval.hpp"
 #include "utils.h"
 
+#include <cstdlib>
+#include <ctime>
+#include <vector>
+#include <algorithm>
+
 template<class T>
 void test_polysolve(void)
 {
@@ -14,9 +20,181 @@ void test_polysolve(void)
     darray_print(x, 1);
 }
 
+template<class T> T urand(T l, T h) { return l + (h - l) * (T)rand() / RAND_MAX; }
+
+/*! Build \p n equations of degree \p deg from known real roots (and, for
+ * every other equation, a pair of complex roots instead of two real ones),
+ * solve them in batch and check the roots found.
+ */
+template<class T>
+int test_polysolve_batch(size_t deg, size_t n)
+{
+    std::vector<std::vector<T> > c(deg + 1, std::vector<T>(n));
+    std::vector<std::vector<T> > x(deg, std::vector<T>(n));
+    std::vector<std::vector<T> > ref(n);
+    std::vector<int> nroots(n);
+    for (size_t i = 0; i < n; i++) {
+        std::vector<T> p(1, urand<T>(0.5, 2) * (rand() & 1 ? 1 : -1)); // leading coefficient
+        size_t k = 0;
+        if (deg >= 2 and (i & 1)) { // (x - u)^2 + v^2
+            const T u = urand<T>(-3, 3), v = urand<T>(0.5, 2);
+            const T f[3] = { u*u + v*v, -2*u, 1 };
+            std::vector<T> q(p.size() + 2, T(0));
+            for (size_t a = 0; a < p.size(); a++) { for (size_t b = 0; b < 3; b++) { q[a + b] += p[a] * f[b]; } }
+            p.swap(q);
+            k = 2;
+        }
+        for (; k < deg; k++) {
+            T r;
+            bool close;
+            do {                // keep roots apart, close ones are ill-conditioned
+                r = urand<T>(-4, 4);
+                close = false;
+                for (auto e : ref[i]) { close |= std::abs(e - r) < T(0.25); }
+            } while (close);
+            ref[i].push_back(r);
+            std::vector<T> q(p.size() + 1, T(0)); // multiply by (x - r)
+            for (size_t a = 0; a < p.size(); a++) { q[a] -= r * p[a]; q[a + 1] += p[a]; }
+            p.swap(q);
+        }
+        std::sort(ref[i].begin(), ref[i].end());
+        for (size_t j = 0; j <= deg; j++) { c[j][i] = p[j]; }
+    }
+
+    const clock_t t0 = clock();
+    switch (deg) {
+    case 2: polysolve2nd_batch(n, c[0].data(), c[1].data(), c[2].data(),
+                               x[0].data(), x[1].data(), nroots.data()); break;
+    case 3: polysolve3rd_batch(n, c[0].data(), c[1].data(), c[2].data(), c[3].data(),
+                               x[0].data(), x[1].data(), x[2].data(), nroots.data()); break;
+    case 4: polysolve4th_batch(n, c[0].data(), c[1].data(), c[2].data(), c[3].data(), c[4].data(),
+                               x[0].data(), x[1].data(), x[2].data(), x[3].data(), nroots.data()); break;
+    }
+    const double sec = (double)(clock() - t0) / CLOCKS_PER_SEC;
+
+    size_t nbad = 0;
+    T err = 0;
+    for (size_t i = 0; i < n; i++) {
+        if ((size_t)nroots[i] != ref[i].size()) { nbad++; continue; }
+        for (size_t k = 0; k < ref[i].size(); k++) { err = std::max(err, std::abs(x[k][i] - ref[i][k])); }
+    }
+    const T tol = sizeof(T) == 4 ? 1e-3 : 1e-9;
+    const bool ok = nbad == 0 and err < tol;
+    printf("polysolve degree %zd batch of %zd: %zd wrong root counts, max root error:%g, %.1f Msolves/s: %s\n",
+           deg, n, nbad, (double)err, n / sec * 1e-6, ok ? "OK" : "FAIL");
+    return !ok;
+}
+
+/*! Test degenerate inputs handled by masks. */
+int test_polysolve_degenerate(void)
+{
+    const double c0[] = { 1, -4, 0, 1, 2, -16 };
+    const double c1[] = { 2, 0, 0, 0, 0, 0 };
+    const double c2[] = { 1, 1, 0, 0, 0, 0 };
+    const double c3[] = { 0, 0, 0, 0, 1, 0 };
+    const double c4[] = { 0, 0, 0, 0, 0, 1 };
+    double x0[6], x1[6], x2[6], x3[6];
+    int n[6];
+    polysolve4th_batch(6, c0, c1, c2, c3, c4, x0, x1, x2, x3, n);
+    const bool ok = (n[0] >= 1 and std::abs(x0[0] + 1) < 1e-6 and // (x+1)^2
+                     n[1] == 2 and x0[1] == -2 and x1[1] == 2 and
+                     n[2] == 0 and n[3] == 0 and    // 0 = 0 and 1 = 0
+                     n[4] == 1 and std::abs(x0[4] + std::cbrt(2.0)) < 1e-12 and
+                     n[5] == 2 and std::abs(x0[5] + 2) < 1e-12 and std::abs(x1[5] - 2) < 1e-12 and
+                     x2[5] != x2[5]);
+    printf("polysolve degenerate cases: %s\n", ok ? "OK" : "FAIL");
+    return !ok;
+}
+
+/*! Test repeated roots, where the cubic discriminant and, for quartics,
+ * that of their resolvent cubic vanish. Every root must be found and every
+ * root found must be one, at the precision a root of multiplicity m has.
+ */
+int test_polysolve_repeated(void)
+{
+    const std::vector<std::vector<double> > roots = {
+        { -2, 1, 1 },           // x^3 - 3x + 2
+        { 1, 1, 3 },
+        { 2, 2, 2 },
+        { -3, 1, 1, 2 },
+        { -2, 1, 1, 1 },
+        { -1, -1, 1, 1 },
+        { 1, 1, 1, 1 },
+        { 0.5, 0.5, 4, 4 },
+        { -2, 1, 1, 4 },        // resolvent with double root
+        { -1, -1, -1, 3 },
+    };
+    size_t nbad = 0;
+    for (const auto& r : roots) {
+        const size_t deg = r.size();
+        std::vector<double> p(1, 1);
+        for (auto e : r) {      // multiply by (x - e)
+            std::vector<double> q(p.size() + 1, 0);
+            for (size_t a = 0; a < p.size(); a++) { q[a] -= e * p[a]; q[a + 1] += p[a]; }
+            p.swap(q);
+        }
+        double x[4] = { NAN, NAN, NAN, NAN };
+        int n = 0;
+        if (deg == 3) {
+            polysolve3rd_batch(1, &p[0], &p[1], &p[2], &p[3], &x[0], &x[1], &x[2], &n);
+        } else {
+            polysolve4th_batch(1, &p[0], &p[1], &p[2], &p[3], &p[4], &x[0], &x[1], &x[2], &x[3], &n);
+        }
+        const double tol = 1e-4;  // about cbrt(eps) for triple roots
+        bool ok = n >= 1;
+        for (auto e : r) {
+            bool found = false;
+            for (int k = 0; k < n; k++) { found |= std::abs(x[k] - e) < tol; }
+            ok &= found;
+        }
+        for (int k = 0; k < n; k++) {
+            bool real = false;
+            for (auto e : r) { real |= std::abs(x[k] - e) < tol; }
+            ok &= real;
+        }
+        if (not ok) {
+            printf("polysolve repeated roots of degree %zd: got %d:", deg, n);
+            for (int k = 0; k < n; k++) { printf(" %g", x[k]); }
+            printf("\n");
+        }
+        nbad += not ok;
+    }
+    printf("polysolve repeated roots: %s\n", nbad ? "FAIL" : "OK");
+    return nbad != 0;
+}
+
+template<class T>
+int test_polyval_batch(size_t deg, size_t n)
+{
+    std::vector<T> c(deg + 1), x(n), y(n);
+    for (auto& e : c) { e = urand<T>(-1, 1); }
+    for (auto& e : x) { e = urand<T>(-1, 1); }
+    polyval_batch(c.data(), deg, x.data(), y.data(), n);
+    T err = 0;
+    for (size_t i = 0; i < n; i++) {
+        T ref = 0, xp = 1;
+        for (size_t j = 0; j <= deg; j++) { ref += c[j] * xp; xp *= x[i]; }
+        err = std::max(err, std::abs(y[i] - ref));
+        err = std::max(err, std::abs(polyval_estrin(c.data(), deg, x[i]) - ref));
+    }
+    const bool ok = err < (sizeof(T) == 4 ? 1e-4 : 1e-12);
+    printf("polyval degree %zd at %zd points max error:%g: %s\n", deg, n, (double)err, ok ? "OK" : "FAIL");
+    return !ok;
+}
+
 int
 main(int argc, char *argv[])
 {
+    int ret = 0;
     test_polysolve<double>();
-    return 0;
+    ret |= test_polysolve_batch<double>(2, 1000000);
+    ret |= test_polysolve_batch<double>(3, 1000000);
+    ret |= test_polysolve_batch<double>(4, 1000000);
+    ret |= test_polysolve_batch<float>(4, 100000);
+    ret |= test_polysolve_degenerate();
+    ret |= test_polysolve_repeated();
+    ret |= test_polyval_batch<double>(0, 10);
+    ret |= test_polyval_batch<double>(7, 1001);
+    ret |= test_polyval_batch<float>(20, 1000);
+    return ret;
 }
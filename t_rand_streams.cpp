@@ -0,0 +1,121 @@
+/*!
+ * \file t_rand_streams.cpp
+ * \brief Test Vectorized Parallel Random Streams.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include "rand_streams.hpp"
+
+using std::cout;
+using std::endl;
+
+size_t g_fails = 0;
+
+void check(const char * what, bool ok)
+{
+    g_fails += not ok;
+    cout << what << (ok ? " OK" : " FAIL") << endl;
+}
+
+/// Check that lane \c l of stream \p index of \p seed is the scalar generator jumped \c l times.
+void test_lanes(uint64_t seed, uint64_t index)
+{
+    pnw::xoshiro256ss g(seed);
+    for (uint64_t i = 0; i < index; i++) { g.long_jump(); }
+    std::vector<pnw::xoshiro256ss> lanes;
+    for (int l = 0; l < 4; l++) { lanes.push_back(g); g.jump(); }
+
+    const size_t steps = 1000;
+    std::vector<uint64_t> expected;       // interleaved by lane
+    for (size_t i = 0; i < steps; i++) {
+        for (auto& lane : lanes) { expected.push_back(lane()); }
+    }
+
+    bool ok = true;
+    pnw::xoshiro256ss_x4 r(seed, index);
+    for (size_t i = 0; i < steps / 2; i++) {
+        const pnw::xoshiro256ss_x4::v4u v = r.next4();
+        for (int l = 0; l < 4; l++) { ok &= v[l] == expected[4 * i + l]; }
+    }
+    check("  next4", ok);
+
+    // the same sequence through operator() and fill_u64 from an odd offset
+    r.seed(seed, index);
+    std::vector<uint64_t> got(4 * steps);
+    got[0] = r();
+    r.fill_u64(got.data() + 1, 4 * steps - 2);
+    got[4 * steps - 1] = r();
+    check("  operator() and fill_u64", got == expected);
+}
+
+/// Check that bounded fills stay in range and reach both ends.
+void test_bounded()
+{
+    pnw::xoshiro256ss_x4 r(7);
+    const size_t n = 100000;
+    {
+        std::vector<int> x(n);
+        r.fill_int(x.data(), n, -3, 5);
+        std::vector<size_t> hist(9, 0);
+        bool ok = true;
+        for (auto e : x) { if (e >= -3 and e <= 5) { hist[e + 3]++; } else { ok = false; } }
+        for (auto h : hist) { ok &= h > n / 9 * 9 / 10 and h < n / 9 * 11 / 10; } // within 10 percent
+        check("  fill_int [-3, 5]", ok);
+    }
+    {
+        std::vector<uint8_t> x(n);
+        r.fill_int<uint8_t>(x.data(), n, 0, 255); // full range
+        std::vector<bool> seen(256, false);
+        for (auto e : x) { seen[e] = true; }
+        check("  fill_int full range", std::find(seen.begin(), seen.end(), false) == seen.end());
+    }
+    {
+        std::vector<double> x(n);
+        r.fill_uniform(x.data(), n, -2.0, 3.0);
+        bool ok = true;
+        for (auto e : x) { ok &= e >= -2.0 and e < 3.0; }
+        check("  fill_uniform double [-2, 3)", ok);
+    }
+    {
+        std::vector<float> x(n + 3); // not a multiple of the lanes
+        r.fill_uniform(x.data(), n + 3, 1.0f, 2.0f);
+        bool ok = true;
+        for (auto e : x) { ok &= e >= 1.0f and e < 2.0f; }
+        check("  fill_uniform float [1, 2)", ok);
+    }
+}
+
+/// Check that normal fills of odd length \p n have the expected mean and variance.
+template<class T>
+void test_normal(size_t n, T mean, T sd)
+{
+    pnw::xoshiro256ss_x4 r(11);
+    std::vector<T> x(n);
+    r.fill_normal(x.data(), n, mean, sd);
+    double s = 0, s2 = 0;
+    for (auto e : x) { s += e; s2 += double(e) * e; }
+    const double m = s / n, v = s2 / n - m * m;
+    // five standard errors of the mean and of the variance
+    const bool ok = (std::abs(m - mean) < 5 * sd / std::sqrt(n) and
+                     std::abs(v - sd * sd) < 5 * sd * sd * std::sqrt(2.0 / n));
+    cout << "  fill_normal<" << sizeof(T) * 8 << "> mean:" << m << " variance:" << v;
+    check("", ok);
+}
+
+int main(int argc, const char * argv[], const char * envp[])
+{
+    cout << "lanes:" << endl;
+    test_lanes(0, 0);
+    test_lanes(42, 3);
+    cout << "bounded:" << endl;
+    test_bounded();
+    cout << "normal:" << endl;
+    test_normal<double>(1000001, 2.0, 3.0);
+    test_normal<float>(1000001, -1.0f, 0.5f);
+    return g_fails ? EXIT_FAILURE : EXIT_SUCCESS;
+}
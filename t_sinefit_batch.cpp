@@ -0,0 +1,103 @@
+/*!
+ * \file t_sinefit_batch.cpp
+ * \brief Test Batched Sine Fitting.
+ */
+
+#include <iostream>
+#include <chrono>
+#include <cmath>
+#include <vector>
+
+#include "sinefit_batch.hpp"
+#include "rand_streams.hpp"
+
+using std::cout;
+using std::endl;
+
+/// Fill \p nch channels of \p n samples with known sines plus noise of \p sd.
+template<class T>
+void make_channels(std::vector<T>& Y, std::vector<T>& P, size_t n, size_t nch,
+                   T w0, T dw, T sd)
+{
+    pnw::xoshiro256ss_x4 rng(7);
+    Y.resize(n * nch);
+    P.resize(4 * nch);
+    std::vector<T> u(4);
+    for (size_t i = 0; i < nch; i++) {
+        rng.fill_uniform(u.data(), 4);
+        const T amp = T(0.5) + T(0.5) * u[0], phi = T(2 * M_PI) * u[1];
+        const T A = amp * std::cos(phi), B = amp * std::sin(phi), C = u[2] - T(0.5);
+        const T w = w0 + dw * (2*u[3] - 1);
+        P[4*i + 0] = A; P[4*i + 1] = B; P[4*i + 2] = C; P[4*i + 3] = w;
+        T* y = &Y[i * n];
+        rng.fill_normal(y, n, T(0), sd);
+        for (size_t k = 0; k < n; k++) {
+            y[k] += A * std::cos(w * k) + B * std::sin(w * k) + C;
+        }
+    }
+}
+
+template<class T>
+int test_sinefit3par(size_t n, size_t nch)
+{
+    const T w0 = T(2 * M_PI * 0.0123);
+    std::vector<T> Y, P;
+    make_channels(Y, P, n, nch, w0, T(0), T(0.01));
+    std::vector<T> wt(n);
+    for (size_t k = 0; k < n; k++) { wt[k] = w0 * k; }
+
+    auto t0 = std::chrono::steady_clock::now();
+    const pnw::sinefit3par_plan<T> plan(wt.data(), n);
+    std::vector<T> X(3 * nch), rms(nch);
+    plan.fit(Y.data(), n, nch, X.data(), rms.data());
+    auto t1 = std::chrono::steady_clock::now();
+
+    T err = 0, rerr = 0;
+    for (size_t i = 0; i < nch; i++) {
+        for (size_t j = 0; j < 3; j++) { err = std::max(err, std::abs(X[3*i + j] - P[4*i + j])); }
+        rerr = std::max(rerr, std::abs(rms[i] - T(0.01)));
+    }
+    const double sec = std::chrono::duration<double>(t1 - t0).count();
+    const bool ok = err < 5e-3 and rerr < 2e-3;
+    cout << "sinefit3par n:" << n << " channels:" << nch
+         << " max parameter error:" << err << " max rms error:" << rerr
+         << " " << nch / sec << " fits/s" << (ok ? ": OK" : ": FAIL") << endl;
+    return !ok;
+}
+
+template<class T>
+int test_sinefit4par(size_t n, size_t nch)
+{
+    const T w0 = T(2 * M_PI * 0.0123);
+    std::vector<T> Y, P;
+    make_channels(Y, P, n, nch, w0, T(w0 * 1e-3), T(0.01));
+
+    auto t0 = std::chrono::steady_clock::now();
+    std::vector<T> X(4 * nch), rms(nch);
+    pnw::sinefit4par(Y.data(), n, n, nch, w0, X.data(), rms.data());
+    auto t1 = std::chrono::steady_clock::now();
+
+    T err = 0, werr = 0, rerr = 0;
+    for (size_t i = 0; i < nch; i++) {
+        for (size_t j = 0; j < 3; j++) { err = std::max(err, std::abs(X[4*i + j] - P[4*i + j])); }
+        werr = std::max(werr, std::abs(X[4*i + 3] - P[4*i + 3]) / P[4*i + 3]);
+        rerr = std::max(rerr, std::abs(rms[i] - T(0.01)));
+    }
+    const double sec = std::chrono::duration<double>(t1 - t0).count();
+    const bool ok = err < 5e-3 and werr < 1e-4 and rerr < 2e-3;
+    cout << "sinefit4par n:" << n << " channels:" << nch
+         << " max parameter error:" << err << " max relative frequency error:" << werr
+         << " max rms error:" << rerr
+         << " " << nch / sec << " fits/s" << (ok ? ": OK" : ": FAIL") << endl;
+    return !ok;
+}
+
+int main(int argc, const char * argv[], const char * envp[])
+{
+    int ret = 0;
+    ret |= test_sinefit3par<double>(1000, 10);
+    ret |= test_sinefit3par<float>(4096, 2000);
+    ret |= test_sinefit4par<double>(4096, 2000);
+    ret |= test_sinefit4par<float>(1003, 100);
+    return ret;
+}
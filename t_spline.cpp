@@ -1,11 +1,13 @@
 #include "spline.hpp"
 
+#include <algorithm>
 #include <cstdlib>
 #include <iostream>
 #include <iomanip>
 #include <cmath>
 
 using namespace std;
+using namespace splines;
 
 int main ( void );
 void test001 ( void );
@@ -51,6 +53,7 @@ void test225 ( void );
 void test23 ( void );
 void test235 ( void );
 void test24 ( void );
+void test25 ( void );
 
 double frunge ( double x );
 double fprunge ( double x );
@@ -114,6 +117,7 @@ int main ( void )
   test23 ( );
   test235 ( );
   test24 ( );
+  test25 ( );
 
   cout << "\n";
   cout << "SPLINE_PRB\n";
@@ -5517,3 +5521,110 @@ double fppcube ( double x )
 
   return fx;
 }
+//****************************************************************************80
+
+void test25 ( void )
+
+//****************************************************************************80
+//
+//  Purpose:
+//
+//    TEST25 tests PIECEWISE_CUBIC batch evaluation against the _VAL routines.
+//
+{
+# define N 11
+# define M 10007
+
+  double t[N];
+  double y[N];
+  double d[N];
+  int seed = 123456789;
+
+  cout << "\n";
+  cout << "TEST25\n";
+  cout << "  PIECEWISE_CUBIC::EVAL evaluates linear, cubic and PCHIP\n";
+  cout << "  splines at sorted and unsorted points in batch.\n";
+
+  for ( int i = 0; i < N; i++ )
+  {
+    t[i] = -1.0 + 2.0 * ( double ) i / ( double ) ( N - 1 );
+    y[i] = frunge ( t[i] );
+  }
+
+  double *xs = r8vec_uniform ( M, -1.5, 1.5, &seed );
+  double *xu = new double[M];
+  for ( int j = 0; j < M; j++ ) { xu[j] = xs[j]; }
+  sort ( xs, xs + M );
+  xs[0] = t[0];
+  xs[M-1] = t[N-1];
+
+  double *ypp = spline_cubic_set ( N, t, y, 2, 0.0, 2, 0.0 );
+  spline_pchip_set ( N, t, y, d );
+
+  const piecewise_cubic pl = piecewise_cubic::linear ( N, t, y );
+  const piecewise_cubic pc = piecewise_cubic::cubic ( N, t, y, 2, 0.0, 2, 0.0 );
+  const piecewise_cubic pp = piecewise_cubic::pchip ( N, t, y );
+
+  double *ys = new double[M];
+  double *yps = new double[M];
+  double *yu = new double[M];
+  double *yref = new double[M];
+
+  cout << "\n";
+  cout << "  Kind        Max error sorted   Max error unsorted\n";
+  cout << "\n";
+
+  for ( int k = 0; k < 3; k++ )
+  {
+    const piecewise_cubic &p = k == 0 ? pl : k == 1 ? pc : pp;
+    double es = 0.0;
+    double eu = 0.0;
+    p.eval ( xs, M, ys, yps );
+    p.eval ( xu, M, yu );
+    for ( int pass = 0; pass < 2; pass++ )
+    {
+      double *x = pass == 0 ? xs : xu;
+      double *yv = pass == 0 ? ys : yu;
+      double &e = pass == 0 ? es : eu;
+      if ( k == 2 )
+      {
+        spline_pchip_val ( N, t, y, d, M, x, yref );
+      }
+      for ( int j = 0; j < M; j++ )
+      {
+        double yval;
+        double ypval;
+        double yppval;
+        if ( k == 0 )
+        {
+          spline_linear_val ( N, t, y, x[j], &yval, &ypval );
+        }
+        else if ( k == 1 )
+        {
+          yval = spline_cubic_val ( N, t, x[j], y, ypp, &ypval, &yppval );
+          if ( pass == 0 ) { e = r8_max ( e, fabs ( yps[j] - ypval ) ); }
+        }
+        else
+        {
+          yval = yref[j];
+        }
+        e = r8_max ( e, fabs ( yv[j] - yval ) );
+      }
+    }
+    cout << "  " << setw(8) << ( k == 0 ? "LINEAR" : k == 1 ? "CUBIC" : "PCHIP" )
+         << "  " << setw(16) << es
+         << "  " << setw(16) << eu << "\n";
+  }
+
+  delete [] xs;
+  delete [] xu;
+  delete [] ypp;
+  delete [] ys;
+  delete [] yps;
+  delete [] yu;
+  delete [] yref;
+
+  return;
+# undef N
+# undef M
+}
@@ -0,0 +1,41 @@
+#include "../transpose.h"
+#include "../stdio_x.h"
+#include <stdlib.h>
+
+/*! Check in-place transpose of \p side-by-\p side matrix of shorts
+ * against a reference copy. */
+int
+test_shortmatrix_sqr_transpose_16(int side)
+{
+  int ret = 0;
+  short **a = (short**)malloc(side * sizeof(short*));
+  short *dat = (short*)malloc(side * side * sizeof(short));
+  for (int y = 0; y < side; y++) {
+    a[y] = dat + y * side;
+    for (int x = 0; x < side; x++) { a[y][x] = (short)(y * side + x); }
+  }
+  shortmatrix_sqr_transpose_16(a, side);
+  for (int y = 0; y < side && ret == 0; y++) {
+    for (int x = 0; x < side; x++) {
+      if (a[y][x] != (short)(x * side + y)) {
+        leprintf("error: side:%d a[%d][%d]:%d != %d\n", side, y, x, a[y][x], x * side + y);
+        ret = -1;
+        break;
+      }
+    }
+  }
+  lprintf("shortmatrix_sqr_transpose_16 %dx%d: %s\n", side, side, ret == 0 ? "OK" : "FAIL");
+  free(dat);
+  free(a);
+  return ret;
+}
+
+int
+main(int argc, char *argv[])
+{
+  int ret = 0;
+  ret |= test_shortmatrix_sqr_transpose_16(1);
+  ret |= test_shortmatrix_sqr_transpose_16(7);
+  ret |= test_shortmatrix_sqr_transpose_16(16);
+  return ret ? EXIT_FAILURE : EXIT_SUCCESS;
+}
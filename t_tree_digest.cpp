@@ -0,0 +1,136 @@
+/*!
+ * \file t_tree_digest.cpp
+ * \brief Test Merkle Tree Digests of Directory Trees.
+ */
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <tuple>
+#include <vector>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "semnet/dir.hpp"
+#include "semnet/preg.hpp"
+
+using namespace semnet;
+using namespace semnet::filesystem;
+using std::cout;
+using std::endl;
+
+/// Difference as (relative path, present in first tree, present in second tree).
+typedef std::tuple<std::string, bool, bool> Got;
+
+const size_t TDIG_SIZE = sizeof(CDigestF); ///< Tree digest byte size.
+
+size_t g_fails = 0;
+
+void check(const char * what, bool ok)
+{
+    g_fails += not ok;
+    cout << what << (ok ? " OK" : " FAIL") << endl;
+}
+
+void write_file(const std::string& path, const std::string& data)
+{
+    std::ofstream os(path, std::ios::binary);
+    os << data;
+}
+
+/// Files of the test trees, relative to their tops.
+const char * const g_names[] = { "a.txt", "s1/x.txt", "s1/y.txt", "s2/z.txt", "s2/d/w.txt", "s3/v.txt" };
+
+/// Write tree at \p top, in reverse order if \p reverse_flag.
+void write_tree(const std::string& top, bool reverse_flag)
+{
+    const std::vector<std::string> dirs = (reverse_flag ?
+                                           std::vector<std::string>{ "", "/s3", "/s2", "/s2/d", "/s1" } :
+                                           std::vector<std::string>{ "", "/s1", "/s2", "/s2/d", "/s3" });
+    std::vector<std::string> names(std::begin(g_names), std::end(g_names));
+    if (reverse_flag) { names.assign(names.rbegin(), names.rend()); }
+    for (const auto& d : dirs) { ::mkdir((top + d).c_str(), 0700); }
+    for (const auto& n : names) { write_file(top + "/" + n, "contents of " + n); }
+}
+
+void remove_tree(const std::string& top)
+{
+    for (auto name : g_names) { ::unlink((top + "/" + name).c_str()); }
+    ::unlink((top + "/s2/d/n.txt").c_str());
+    for (auto d : { "/s2/d", "/s1", "/s2", "/s3", "" }) { ::rmdir((top + d).c_str()); }
+}
+
+/// Load tree at \p path.
+const Dir * load_tree(const std::string& path)
+{
+    auto top = dynamic_cast<Dir*>(File::load_path(path.c_str()));
+    if (top) { top->load(true); }
+    return top;
+}
+
+/// Diff \p a against \p b.
+std::vector<Got> diff(const Dir * a, const Dir * b)
+{
+    std::vector<Got> got;
+    a->diff_tdig(b, [&](const csc& pathR, const File * subA, const File * subB) {
+            got.emplace_back(pathR.c_str(), subA != nullptr, subB != nullptr);
+        });
+    return got;
+}
+
+int main(int argc, const char * argv[], const char * envp[])
+{
+    char tmpl[] = "/tmp/t_tree_digest.XXXXXX";
+    if (not ::mkdtemp(tmpl)) { perror("mkdtemp"); return EXIT_FAILURE; }
+    const std::string top(tmpl), pathA(top + "/a"), pathB(top + "/b"), pathC(top + "/c");
+
+    // all trees are written before any is watched
+    write_tree(pathA, false);
+    write_tree(pathB, true);
+    write_tree(pathC, false);
+    write_file(pathC + "/s1/x.txt", "new contents of x"); // C is what A will look like
+    write_file(pathC + "/s2/d/n.txt", "n");
+
+    pReg reg;                   // dispatches inotify events to the loaded trees
+    const Dir * a = load_tree(pathA), * b = load_tree(pathB);
+    if (not (a and b)) { cout << "Could not load " << top << endl; return EXIT_FAILURE; }
+
+    check("load order", memcmp(a->update_tdig(), b->update_tdig(), TDIG_SIZE) == 0);
+    check("equal diff", diff(a, b).empty());
+
+    // rewrite s2/z.txt and s3/v.txt through descriptors kept open, so no
+    // close-write event reaches A: if A rehashed them, it would no longer
+    // match C, which has their old contents
+    std::vector<int> fds;
+    for (auto name : { "/s2/z.txt", "/s3/v.txt" }) {
+        const int fd = ::open((pathA + name).c_str(), O_WRONLY);
+        const std::string data = "CONTENTS OF STALE";
+        if (fd < 0 or ::pwrite(fd, data.data(), data.size(), 0) < 0) { perror("pwrite"); }
+        fds.push_back(fd);
+    }
+    write_file(pathA + "/s1/x.txt", "new contents of x");
+    write_file(pathA + "/s2/d/n.txt", "n");
+    reg.iter();
+
+    const Dir * c = load_tree(pathC);
+    if (not c) { cout << "Could not load " << pathC << endl; return EXIT_FAILURE; }
+    check("dirty path", memcmp(a->update_tdig(), c->update_tdig(), TDIG_SIZE) == 0);
+
+    const std::vector<Got> got = diff(b, a);
+    const std::vector<Got> expected = { Got("s1/x.txt", true, true), Got("s2/d/n.txt", false, true) };
+    check("diff", got == expected);
+    if (got != expected) {
+        for (const auto& g : got) {
+            cout << "  " << std::get<0>(g) << " " << std::get<1>(g) << " " << std::get<2>(g) << endl;
+        }
+    }
+
+    for (auto fd : fds) { ::close(fd); }
+    for (const auto& p : { pathA, pathB, pathC }) { remove_tree(p); }
+    ::rmdir(top.c_str());
+
+    return g_fails ? EXIT_FAILURE : EXIT_SUCCESS;
+}
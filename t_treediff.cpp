@@ -0,0 +1,141 @@
+/*!
+ * \file t_treediff.cpp
+ * \brief Test Parallel Diff of Two Directory Trees.
+ */
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <vector>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "semnet/treediff.hpp"
+#include "semnet/dir.hpp"
+
+using namespace semnet;
+using namespace semnet::filesystem;
+using std::cout;
+using std::endl;
+
+/// Change as (kind, path, from).
+typedef std::tuple<TreeDiff::Kind, std::string, std::string> Got;
+
+size_t g_fails = 0;
+
+void check(const char * what, const std::vector<Got>& got, const std::vector<Got>& expected)
+{
+    const bool ok = got == expected;
+    g_fails += not ok;
+    cout << what << ": changes:" << got.size() << (ok ? " OK" : " FAIL") << endl;
+    if (not ok) {
+        for (const auto& g : got) {
+            cout << "  " << std::get<0>(g) << " " << std::get<1>(g) << " " << std::get<2>(g) << endl;
+        }
+    }
+}
+
+void write_file(const std::string& path, const std::string& data, time_t mtime)
+{
+    {
+        std::ofstream os(path, std::ios::binary);
+        os << data;
+    }
+    const struct timespec ts[2] = { { mtime, 0 }, { mtime, 0 } };
+    ::utimensat(AT_FDCWD, path.c_str(), ts, 0);
+}
+
+/// Load tree at \p path.
+const Dir * load_tree(const std::string& path)
+{
+    auto top = dynamic_cast<Dir*>(File::load_path(path.c_str()));
+    if (top) { top->load(true); }
+    return top;
+}
+
+int main(int argc, const char * argv[], const char * envp[])
+{
+    char tmpl[] = "/tmp/t_treediff.XXXXXX";
+    if (not ::mkdtemp(tmpl)) { perror("mkdtemp"); return EXIT_FAILURE; }
+    const std::string top(tmpl), pathA(top + "/a"), pathB(top + "/b");
+    ::mkdir(pathA.c_str(), 0700);
+    ::mkdir(pathB.c_str(), 0700);
+
+    const time_t t0 = 1000000000;
+    for (const auto& p : { pathA, pathB }) {
+        write_file(p + "/same.txt", "same", p == pathA ? t0 : t0 + 1); // equal contents, hashed
+        write_file(p + "/touched.txt", "touched", t0);                 // trusted by mtime
+    }
+    write_file(pathA + "/edit.txt", "aaaa", t0); // same size, different mtime
+    write_file(pathB + "/edit.txt", "bbbb", t0 + 1);
+    write_file(pathA + "/gone.txt", "gone!", t0);
+    write_file(pathB + "/new.txt", "new", t0);
+    write_file(pathA + "/old_name.txt", "renamed file", t0);
+    write_file(pathB + "/new_name.txt", "renamed file", t0 + 2);
+
+    // renamed directory, whose own size in A has grown by entries since removed
+    ::mkdir((pathA + "/dirx").c_str(), 0700);
+    for (bool create : { true, false }) {
+        for (size_t i = 0; i < 200; i++) {
+            const std::string tmp = pathA + "/dirx/a_rather_long_temporary_file_name_" + std::to_string(i);
+            if (create) { write_file(tmp, "", t0); } else { ::unlink(tmp.c_str()); }
+        }
+    }
+    ::mkdir((pathB + "/diry").c_str(), 0700);
+    for (const auto& d : { pathA + "/dirx", pathB + "/diry" }) {
+        write_file(d + "/one.txt", "one", t0);
+        write_file(d + "/two.txt", "two two", t0);
+    }
+
+    const Dir * a = load_tree(pathA), * b = load_tree(pathB);
+    if (not (a and b)) { cout << "Could not load " << top << endl; return EXIT_FAILURE; }
+
+    for (size_t nthreads : { 1, 4 }) {
+        TreeDiff::Options opts;
+        opts.nthreads = nthreads;
+        TreeDiff td(opts);
+        std::vector<Got> got;
+        td.run(a, b, [&](const TreeDiff::Change& c) {
+                got.emplace_back(c.kind, c.path.c_str(), c.from.c_str());
+            });
+        check("diff", got,
+              { Got(TreeDiff::MODIFIED, "edit.txt", ""),
+                Got(TreeDiff::MOVED, "diry", "dirx"),
+                Got(TreeDiff::MOVED, "new_name.txt", "old_name.txt"),
+                Got(TreeDiff::REMOVED, "gone.txt", ""),
+                Got(TreeDiff::ADDED, "new.txt", "") });
+        g_fails += td.stats().files != 3;
+    }
+    {
+        // exception from callback stops the diff and reaches the caller
+        TreeDiff td;
+        bool caught = false;
+        try {
+            td.run(a, b, [](const TreeDiff::Change& c) { throw std::runtime_error("stop"); });
+        } catch (const std::runtime_error&) {
+            caught = true;
+        }
+        g_fails += not caught;
+        cout << "throw" << (caught ? " OK" : " FAIL") << endl;
+    }
+
+    for (const auto& d : { pathA + "/dirx", pathB + "/diry" }) {
+        ::unlink((d + "/one.txt").c_str());
+        ::unlink((d + "/two.txt").c_str());
+        ::rmdir(d.c_str());
+    }
+    for (auto name : { "/same.txt", "/touched.txt", "/edit.txt", "/gone.txt", "/new.txt",
+                       "/old_name.txt", "/new_name.txt" }) {
+        ::unlink((pathA + name).c_str());
+        ::unlink((pathB + name).c_str());
+    }
+    ::rmdir(pathA.c_str());
+    ::rmdir(pathB.c_str());
+    ::rmdir(top.c_str());
+
+    return g_fails ? EXIT_FAILURE : EXIT_SUCCESS;
+}
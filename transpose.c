@@ -21,34 +21,6 @@ shortmatrix_sqr_transpose_16(short **out, int side)
       SWAP(out[y][x], out[x][y]);
 }
 
-void
-shortmatrix_sqr_transpose_16(short **out, int side)
-{
-  int x, y;
-  /* Transpose in 2x2xU16 blocks */
-  ulong tmp0, tmp1, tmp2, tmp3, tmp4, tmp5;
-  for (y = 0; y < side; y += 2)
-    for (x = y + 2; x < side; x += 2) {
-      tmp0 = *((ulong *) &out[y][x]);
-      tmp1 = *((ulong *) &out[y + 1][x]);
-
-      tmp2 = (tmp0 & 0xffff) + (tmp1 << 16);
-      tmp3 = (tmp0 >> 16) + (tmp1 & 0xffff0000);
-
-      tmp0 = *((ulong *) &out[x][y]);
-      tmp1 = *((ulong *) &out[x + 1][y]);
-
-      tmp4 = (tmp0 & 0xffff) + (tmp1 << 16);
-      tmp5 = (tmp0 >> 16) + (tmp1 & 0xffff0000);
-
-      *((ulong *) &out[y][x]) = tmp4;
-      *((ulong *) &out[y + 1][x]) = tmp5;
-
-      *((ulong *) &out[x][y]) = tmp2;
-      *((ulong *) &out[x + 1][y]) = tmp3;
-    }
-}
-
 void
 llongmatrix_sqr_transpose(long long **out, int side)
 {
@@ -100,7 +72,7 @@ chara8_bitTranspose8x8(char *out, const char *in)
   /* Lookup byte, mask out bit, and set it. */
   for (o = 0; o < 8; o++)
     for (i = 0; i < 8; i++)
-      out[o] |= table[8 * in[i] + o] & (1 << i);
+      out[o] |= table[8 * (unsigned char)in[i] + o] & (1 << i);
 }
 
 #if 0
@@ -115,6 +115,10 @@ longarray_transpose2x2(long *out, long *in)
 }
 #endif
 
+void charm_sqr_transpose(char **out, int side);
+
+void shortmatrix_sqr_transpose_16(short **out, int side);
+
 void llongmatrix_sqr_transpose(long long **out, int side);
 
 void llongmatrix_transpose(long long **out, const long long **in, int w_out,
@@ -684,18 +684,34 @@ farray_eud2D(float *a, const float *b, const float *c, size_t n)
 /* ---------------------------- Group Separator ---------------------------- */
 
 /*
- * Zero length arrays should at least be safe.
+ * Zero length arrays should at least be safe and give min > max.
+ *
+ * The compare-selects of the eight independent lanes map directly onto
+ * vector min/max instructions.
  */
 void
-farray_extremes(float *a, size_t n, float *min_ret, float *max_ret)
+farray_extremes(const float *a, size_t n, float *min_ret, float *max_ret)
 {
-  float min = FLT_MAX, max = FLT_MIN;
-  for (size_t j = 0; j < n; j++) {
-    min = MIN2(min, a[j]);
-    max = MAX2(max, a[j]);
+  float mn[8], mx[8];
+  for (size_t l = 0; l < 8; l++) { mn[l] = FLT_MAX; mx[l] = -FLT_MAX; }
+  size_t j = 0;
+  for (; j + 8 <= n; j += 8) {
+    for (size_t l = 0; l < 8; l++) {
+      const float x = a[j + l];
+      mn[l] = x < mn[l] ? x : mn[l];
+      mx[l] = x > mx[l] ? x : mx[l];
+    }
+  }
+  for (; j < n; j++) {
+    mn[0] = MIN2(mn[0], a[j]);
+    mx[0] = MAX2(mx[0], a[j]);
+  }
+  for (size_t l = 1; l < 8; l++) {
+    mn[0] = MIN2(mn[0], mn[l]);
+    mx[0] = MAX2(mx[0], mx[l]);
   }
-  *min_ret = min;
-  *max_ret = max;
+  *min_ret = mn[0];
+  *max_ret = mx[0];
 }
 
 /* ---------------------------- Group Separator ---------------------------- */
@@ -1333,18 +1349,31 @@ darray_eud2D(double *a, const double *b, const double *c, size_t n)
 /* ---------------------------- Group Separator ---------------------------- */
 
 /*
- * Zero length arrays should at least be safe.
+ * Same eight lanes as farray_extremes().
  */
 void
-darray_extremes(double *a, size_t n, double *min_ret, double *max_ret)
+darray_extremes(const double *a, size_t n, double *min_ret, double *max_ret)
 {
-  double min = DBL_MAX, max = DBL_MIN;
-  for (size_t j = 0; j < n; j++) {
-    min = MIN2(min, a[j]);
-    max = MAX2(max, a[j]);
+  double mn[8], mx[8];
+  for (size_t l = 0; l < 8; l++) { mn[l] = DBL_MAX; mx[l] = -DBL_MAX; }
+  size_t j = 0;
+  for (; j + 8 <= n; j += 8) {
+    for (size_t l = 0; l < 8; l++) {
+      const double x = a[j + l];
+      mn[l] = x < mn[l] ? x : mn[l];
+      mx[l] = x > mx[l] ? x : mx[l];
+    }
+  }
+  for (; j < n; j++) {
+    mn[0] = MIN2(mn[0], a[j]);
+    mx[0] = MAX2(mx[0], a[j]);
+  }
+  for (size_t l = 1; l < 8; l++) {
+    mn[0] = MIN2(mn[0], mn[l]);
+    mx[0] = MAX2(mx[0], mx[l]);
   }
-  *min_ret = min;
-  *max_ret = max;
+  *min_ret = mn[0];
+  *max_ret = mx[0];
 }
 
 /* ---------------------------- Group Separator ---------------------------- */
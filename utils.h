@@ -397,7 +397,11 @@ void darray_atan(double *a, const double *b, size_t n);
 
 void darray_eud2D(double *a, const double *b, const double *c, size_t n);
 
-void darray_extremes(double *a, size_t n, double *min_ret, double *max_ret);
+/*! Get minimum \p min_ret and maximum \p max_ret of the \p n elements of \p a
+ * in one pass, or \c FLT_MAX and \c -FLT_MAX (\c DBL_ for \c double) if \p n is zero.
+ */
+void farray_extremes(const float *a, size_t n, float *min_ret, float *max_ret);
+void darray_extremes(const double *a, size_t n, double *min_ret, double *max_ret);
 
 void darray_fprint(FILE * stream, const double *a, size_t n);
 void ldarray_fprint(FILE * stream, const long double *a, size_t n);
@@ -15,7 +15,9 @@
 #include "zlib_utils.h"
 #include "enforce.hpp"
 
+#include <limits.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <assert.h>
 #include <zlib.h>
@@ -80,6 +82,66 @@ int zlib_compress(FILE *source, FILE *dest, int level)
   return Z_OK;
 }
 
+int zlib_decompress_cb(const void *src, size_t srclen, size_t blksize,
+                       zlib_sink_t sink, void *ctx)
+{
+  int ret;
+  z_stream strm;
+  unsigned char *out = (unsigned char *)malloc(blksize);
+  if (!out)
+    return Z_MEM_ERROR;
+
+  /* allocate inflate state, detecting zlib or gzip header */
+  strm.zalloc = Z_NULL;
+  strm.zfree = Z_NULL;
+  strm.opaque = Z_NULL;
+  strm.avail_in = 0;
+  strm.next_in = Z_NULL;
+  ret = inflateInit2(&strm, 15 + 32);
+  if (ret != Z_OK) {
+    free(out);
+    return ret;
+  }
+
+  const unsigned char *in = (const unsigned char *)src;
+  do {
+    /* feed input in pieces that fit in avail_in */
+    const size_t n = srclen < UINT_MAX ? srclen : UINT_MAX;
+    strm.next_in = (unsigned char *)in;
+    strm.avail_in = n;
+    do {
+      strm.avail_out = blksize;
+      strm.next_out = out;
+      ret = inflate(&strm, Z_NO_FLUSH);
+      switch (ret) {
+      case Z_NEED_DICT:
+        ret = Z_DATA_ERROR;     /* and fall through */
+      case Z_DATA_ERROR:
+      case Z_MEM_ERROR:
+      case Z_STREAM_ERROR:
+        goto done;
+      }
+      if (strm.next_out != out &&
+          sink(ctx, out, strm.next_out - out) != 0) {
+        ret = Z_BUF_ERROR;
+        goto done;
+      }
+      if (ret == Z_STREAM_END && strm.avail_in != 0) {
+        inflateReset(&strm);    /* next gzip member */
+        ret = Z_OK;
+      }
+    } while (ret != Z_STREAM_END && (strm.avail_in != 0 || strm.avail_out == 0));
+    in += n - strm.avail_in;
+    srclen -= n - strm.avail_in;
+  } while (ret != Z_STREAM_END && srclen != 0);
+
+  ret = (ret == Z_STREAM_END) ? Z_OK : Z_DATA_ERROR;
+done:
+  (void)inflateEnd(&strm);
+  free(out);
+  return ret;
+}
+
 int zlib_decompress(FILE *source, FILE *dest)
 {
   int ret;
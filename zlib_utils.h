@@ -6,6 +6,7 @@
  */
 
 #pragma once
+#include <stdio.h>
 #include <zlib.h>
 
 #ifdef __cplusplus
@@ -33,6 +34,19 @@ int zlib_compress(FILE *source, FILE *dest, int level);
  */
 int zlib_decompress(FILE *source, FILE *dest);
 
+/*! Sink for decompressed blocks. Returns non-zero to stop decompression. */
+typedef int (*zlib_sink_t)(void *ctx, const void *buf, size_t len);
+
+/*! Decompress zlib or gzip data at \p src of length \p srclen, calling
+ * \p sink with \p ctx for each decompressed block of at most \p blksize
+ * bytes. Concatenated gzip members are decompressed in turn.
+ *
+ * \return \c Z_OK on success, \c Z_BUF_ERROR if \p sink stopped it, or the
+ * zlib error code.
+ */
+int zlib_decompress_cb(const void *src, size_t srclen, size_t blksize,
+                       zlib_sink_t sink, void *ctx);
+
 /*! Compress or decompress from stdin to stdout. */
 int zlib_test(int argc, char **argv);
 